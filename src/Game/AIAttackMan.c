@@ -506,7 +506,7 @@ void aiaProcessAttackTeams(void)
                         // raise hell
                         aiplayerLog((aiIndex, "%x Taking Out with current team", aiCurrentAIPlayer->attackTeam[i]));
                         aitDeleteAllTeamMoves(aiCurrentAIPlayer->attackTeam[i]);
-                        aioCreateTakeoutTargetsWithCurrentTeam(aiCurrentAIPlayer->attackTeam[i],enemyships);
+                        aioCreateTakeoutTargetsWithCurrentTeam(aiCurrentAIPlayer->attackTeam[i],selectMemDupSelection(enemyships, "takeout", 0));
                     }
                     else
                     {
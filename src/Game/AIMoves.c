@@ -1755,7 +1755,7 @@ sdword aimProcessHarassAttack(AITeam *team)
                         formation = AIM_HARASS_SINGLETARGET_FORMATION;
                     }
 
-                    newMove = aimCreateAdvancedAttackNoAdd(team, protection, formation,Aggressive,TRUE, TRUE);
+                    newMove = aimCreateAdvancedAttackNoAdd(team, selectMemDupSelection(protection, "protect", 0), formation,Aggressive,TRUE, TRUE);
                     newMove->events = thisMove->events;
                     if (aiuAttackFeatureEnabled(AIA_KAMIKAZE))
                     {
@@ -23,6 +23,7 @@
 #include "Physics.h"
 #include "ProfileTimers.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "Ships.h"
 #include "Tactics.h"
 #include "Tweak.h"
@@ -748,6 +749,7 @@ void rowSignalShipToGetOutOfWayOfMe(Ship *ship,Ship *me,vector *meToShip,vector
 
     ship->rowState = 0;
     ship->rowGetOutOfWay = me;
+    refSet((SpaceObj *)ship, REF_RowGetOutOfWay, (SpaceObj *)me);
     ship->rowOriginalPoint = ship->posinfo.position;
 
     // calculate outOfWayPoint;
@@ -1908,6 +1910,7 @@ bool aishipGuideMissile(Missile *missile)
         if(missile->target->flags & SOF_Cloaked)
         {
             missile->target = NULL;
+            refSet((SpaceObj *)missile, REF_Target, NULL);
         }
         else if(missile->haveCheckedForLoss < tweakNumTimesCheck)
         {
@@ -1916,6 +1919,7 @@ bool aishipGuideMissile(Missile *missile)
                 if(shouldMissileLoseTarget(missile))
                 {
                     missile->target = NULL;
+                    refSet((SpaceObj *)missile, REF_Target, NULL);
                 }
             }
         }
@@ -1971,6 +1975,7 @@ bool aishipFlyMineToTarget(Missile *mine,SpaceObjRotImpTarg *target)
     {
         //target flew out of range.
         mine->target = NULL;
+        refSet((SpaceObj *)mine, REF_Target, NULL);
         return(FALSE);
     }
     else if(mine->target != NULL)
@@ -1978,6 +1983,7 @@ bool aishipFlyMineToTarget(Missile *mine,SpaceObjRotImpTarg *target)
         if(mine->target->flags & SOF_Cloaked || mine->target->flags &SOF_Disabled)
         {
             mine->target = NULL;
+            refSet((SpaceObj *)mine, REF_Target, NULL);
             return FALSE;
         }
     }
@@ -1990,6 +1996,7 @@ bool aishipFlyMineToTarget(Missile *mine,SpaceObjRotImpTarg *target)
         {
             //target is flying faster than mine can go so don't follow it!
             mine->target = NULL;
+            refSet((SpaceObj *)mine, REF_Target, NULL);
             return(FALSE);
         }
     }
@@ -2262,6 +2269,7 @@ bool mine_do_search(Missile *mine)
         if(mine->target == NULL)
         {
             mine->target = (SpaceObjRotImpTarg *)aishipmineaquiretarget(mine);
+            refSet((SpaceObj *)mine, REF_Target, (SpaceObj *)mine->target);
         }
         if(mine->target != NULL)
         {
@@ -2302,6 +2310,7 @@ bool aishipGuideMine(Missile *mine)
             case OBJ_NebulaType:
             case OBJ_DustType:
                 mine->target = NULL;
+                refSet((SpaceObj *)mine, REF_Target, NULL);
             default:
                 break;
         }
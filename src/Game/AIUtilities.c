@@ -17,6 +17,7 @@
 #include "CommandDefs.h"
 #include "CommandWrap.h"
 #include "FastMath.h"
+#include "Job.h"
 #include "Randy.h"
 #include "Select.h"
 #include "Ships.h"
@@ -28,6 +29,14 @@
 //later put this into the scripts
 #define AIU_MOTHERSHIP_VALUE    5500
 
+#define AIU_RateBlobsGrain      8       //blobs rated per job
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define AIU_VERIFY_BLOB_RATINGS 1       //rate the blobs again serially and check against the job results
+#else
+#define AIU_VERIFY_BLOB_RATINGS 0
+#endif
+
 
 /*=============================================================================
     Structures:
@@ -63,6 +72,14 @@ typedef struct
     aiblob *blob[1];
 } aiblob_array;
 
+//blobs being filtered and rated on the job threads
+typedef struct
+{
+    Player *player;
+    sdword  numGoodGuyBlobs;    //good guy blobs first, then the enemy blobs
+    aiblob *ratings;
+} aiublobjob;
+
 
 /*=============================================================================
     AI Utility Variables:
@@ -1016,7 +1033,8 @@ SelectCommand *aiuEnemyShipsInMothershipBlob(void)
 
     if (tempsel.numShips)
     {
-        enemyships = selectMemDupSelection((SelectCommand *)&tempsel, "esimb", 0);
+        enemyships = (SelectCommand *)memFrameAlloc(sizeofSelectCommand(tempsel.numShips), "esimb");
+        memcpy(enemyships, &tempsel, sizeofSelectCommand(tempsel.numShips));
     }
 
     return enemyships;
@@ -1496,7 +1514,7 @@ SelectCommand *aiuFindUnarmedEnemyShips(void)
 
     if (temp_sel.numShips)
     {
-        unarmed_ships = (SelectCommand *)memAlloc(sizeofSelectCommand(temp_sel.numShips), "unarmedenemy", 0);
+        unarmed_ships = (SelectCommand *)memFrameAlloc(sizeofSelectCommand(temp_sel.numShips), "unarmedenemy");
 
         selSelectionCopy((MaxAnySelection *)unarmed_ships, (MaxAnySelection *)&temp_sel);
     }
@@ -1551,7 +1569,7 @@ SelectCommand *aiuFindFighterVulnerableEnemyShips(void)
 
     if (temp_sel.numShips)
     {
-        vulnerable_ships = (SelectCommand *)memAlloc(sizeofSelectCommand(temp_sel.numShips), "unarmedenemy", 0);
+        vulnerable_ships = (SelectCommand *)memFrameAlloc(sizeofSelectCommand(temp_sel.numShips), "unarmedenemy");
 
         selSelectionCopy((MaxAnySelection *)vulnerable_ships, (MaxAnySelection *)&temp_sel);
     }
@@ -1809,8 +1827,7 @@ SelectCommand *aiuFindClosestVulnerableGoodGuyShips(ShipPtr ship, udword type)
     real32 dist, tempdist;
 
     //initialize structures
-    targets = (SelectCommand *)memAlloc(sizeofSelectCommand(aiuGoodGuyBlobs->numBlobs), "cvggs", 0);
-    targets->numShips = 0;
+    aiuNewFrameSelection(targets, aiuGoodGuyBlobs->numBlobs, "cvggs");
     tempsel.numShips  = 0;
 
     //go through all the good guy blobs
@@ -2055,8 +2072,7 @@ SelectCommand *aiuFindNearbyEnemyShips(Ship *primarytarget,real32 range)
 
     if (ship == NULL)
     {
-        enemyShips = (SelectCommand *)memAlloc(sizeofSelectCommand(1), "emptysel", 0);
-        enemyShips->numShips = 0;
+        aiuNewFrameSelection(enemyShips, 1, "emptysel");
         return enemyShips;      // done to prevent crash - many places expect non-null to be returned ...Gary
     }
 
@@ -2070,7 +2086,7 @@ SelectCommand *aiuFindNearbyEnemyShips(Ship *primarytarget,real32 range)
     MakeTargetsOnlyBeWithinRangeAndNotIncludeMe((SelectAnyCommand *)&tempShips, (SpaceObjRotImpTarg *)primarytarget, range);
 
     //size of function needs to be one more because frequently another ship is added by the calling function
-    aiuNewSelection(enemyShips, (tempShips.numShips + 1), "fnes");
+    aiuNewFrameSelection(enemyShips, (tempShips.numShips + 1), "fnes");
     memcpy(enemyShips,&tempShips,sizeofSelectCommand(tempShips.numShips));
     enemyShips->numShips = tempShips.numShips;
 
@@ -2129,7 +2145,7 @@ SelectCommand *aiuFindAttackingShips(ShipPtr ship)
     {
         if (!attackers)
         {
-            aiuNewSelection(attackers, 1, "fas");
+            aiuNewFrameSelection(attackers, 1, "fas");
         }
         selSelectionAddSingleShip((MaxSelection *)attackers, ship->gettingrocked);
     }
@@ -3742,6 +3758,7 @@ bool aiuFindArmadaTarget(vector *dest_target, SelectCommand **sel_target, Select
 //        (*sel_target)->numShips  = 0;
 		*sel_target = aiuFindNearbyEnemyShips(aiCurrentAIPlayer->primaryEnemyPlayer->PlayerMothership, 9000);
         selSelectionAddSingleShip((MaxSelection *)*sel_target, aiCurrentAIPlayer->primaryEnemyPlayer->PlayerMothership);
+        *sel_target = selectMemDupSelection(*sel_target, "ftarg", 0);     //the armada keeps it
         return mothership_blob->visibility;
     }
     else
@@ -4531,230 +4548,229 @@ void aiuFillInArrays(blob_array *goodGuy_blob_array, blob_array *enemy_blob_arra
 
 
 
+#define AIU_PLAYERMOTHERSHIP_FACTOR     1.5
+
 /*-----------------------------------------------------------------------------
-    Name        : aiuFillInAIBlobArrays
-    Description : Fills in the aiblob arrays
-    Inputs      : enemy_blob_array - blob array of blobs with enemy ships present
-                  goodGuy_blob_array - blob array of blobs with good guy ships present
-    Outputs     :
+    Name        : aiuRateBlob
+    Description : Rates a blob for enemy ship strength and all that jazz.
+                  Only reads the universe and writes to tempblob, so blobs
+                  can be rated in parallel.
+    Inputs      : tempblob - the blob to rate, with its filtered ship list
+                  player - the current computer player's player structure
+                  enemyBlob - TRUE if this is one of the enemy blobs
+    Outputs     : Fills in the strength and value of tempblob
     Return      : void
 ----------------------------------------------------------------------------*/
-void aiuFillInAIBlobArrays(blob_array *goodGuy_blob_array, blob_array *enemy_blob_array, Player *player)
+static void aiuRateBlob(aiblob *tempblob, Player *player, bool enemyBlob)
 {
-    SelectCommand *tempShips;
-    udword i, j;
+    udword j;
+    udword tempstrength, tempvalue;
+    SelectCommand *ships = tempblob->blobShips;
+    ShipPtr ship;
+    Player *shipplayer;
+    Player *primaryenemy = player->aiPlayer->primaryEnemyPlayer;
 
-    //allocate the global blob arrays
-    aiuEnemyBlobs   = (aiblob_array *)memAlloc(sizeof_aiblob_array(enemy_blob_array->numBlobs), "enbs", Pyrophoric);
-    aiuGoodGuyBlobs = (aiblob_array *)memAlloc(sizeof_aiblob_array(goodGuy_blob_array->numBlobs), "ggbs", Pyrophoric);
+    tempblob->primaryenemystrength = 0;
+    tempblob->primaryenemyvalue    = 0;
+    tempblob->otherenemystrength   = 0;
+    tempblob->otherenemyvalue      = 0;
+    tempblob->goodGuystrength      = 0;
+    tempblob->goodGuyvalue         = 0;
+    tempblob->goodGuyResourcers    = 0;
+    tempblob->visibility           = !enemyBlob;
+    tempblob->mothership           = FALSE;
 
-    //transfer over the results from above over to the global blob array
-    for (i = 0, j = 0; i < enemy_blob_array->numBlobs; i++)
+    for (j=0;j<ships->numShips;j++)
     {
-        //first eliminate blobs that have no non-cloaked enemy ships in them
-        tempShips = selectMemDupSelection(enemy_blob_array->blob[i]->blobShips, "fibe", Pyrophoric);
-        MakeSelectionNotHaveNonVisibleEnemyShips(tempShips, player);
+        ship       = ships->ShipPtr[j];
+        shipplayer = ship->playerowner;
+
+        aiuRateShip(&tempstrength, &tempvalue, ship);
 
-        //if enemy blob still has any visible ships, store in EnemyBlobs array, else don't
-        if (tempShips->numShips)
+        if ((shipplayer->PlayerMothership) &&
+            (ship == shipplayer->PlayerMothership))
         {
-            aiuEnemyBlobs->blob[j] = (aiblob *)memAlloc(sizeof(aiblob), "aieb", Pyrophoric);
-            blob_to_aiblob(enemy_blob_array->blob[i], aiuEnemyBlobs->blob[j]);
-            aiuEnemyBlobs->blob[j]->blobShips = tempShips;
-            j++;
+            tempvalue  = (udword)(AIU_PLAYERMOTHERSHIP_FACTOR * (real32)tempvalue);
+            tempblob->mothership = TRUE;
         }
-    }
-    aiuEnemyBlobs->numBlobs = j;
 
-    for (i = 0; i < goodGuy_blob_array->numBlobs; i++)
-    {
-        tempShips = selectMemDupSelection(goodGuy_blob_array->blob[i]->blobShips, "fibg", Pyrophoric);
-        MakeSelectionNotHaveNonVisibleEnemyShips(tempShips, player);
+        //hack for cryotray
+        if ((enemyBlob) && (ship->shiptype == CryoTray))
+        {
+            tempvalue = 1000;
+        }
 
-        //no need to check if tempships has ships left over (as with enemy blobs)
-        //because good guy blobs will always have at least one good guy (and
-        //therefore visible) ship
-        aiuGoodGuyBlobs->blob[i] = (aiblob *)memAlloc(sizeof(aiblob), "aigb", Pyrophoric);
-        blob_to_aiblob(goodGuy_blob_array->blob[i], aiuGoodGuyBlobs->blob[i]);
-        aiuGoodGuyBlobs->blob[i]->blobShips = tempShips;
+        if (shipplayer == player)
+        {
+            tempblob->goodGuystrength += tempstrength;
+            tempblob->goodGuyvalue    += tempvalue;
+            tempblob->visibility       = TRUE;
 
+            if (ship->shiptype == ResourceCollector)
+            {
+                tempblob->goodGuyResourcers++;
+            }
+        }
+        else if (shipplayer == primaryenemy)
+        {
+            tempblob->primaryenemystrength += tempstrength;
+            tempblob->primaryenemyvalue    += tempvalue;
+        }
+        else
+        {
+            tempblob->otherenemystrength += tempstrength;
+            tempblob->otherenemyvalue    += tempvalue;
+        }
     }
-    aiuGoodGuyBlobs->numBlobs = i;
-
 }
 
-#define AIU_PLAYERMOTHERSHIP_FACTOR     1.5
-
 /*-----------------------------------------------------------------------------
-    Name        : aiuRateBlobs
-    Description : Rates each blob for enemy ship strength and all that jazz
-    Inputs      : player - the current computer player's player structure
+    Name        : aiuRateBlobsJob
+    Description : Job which filters out the non-visible enemy ships of a range
+                  of blobs and rates them.
+    Inputs      : data - aiublobjob
+                  first, last - range of blobs; good guy blobs come first,
+                    followed by the enemy blobs
     Outputs     :
     Return      : void
 ----------------------------------------------------------------------------*/
-void aiuRateBlobs(Player *player)
+static void aiuRateBlobsJob(void *data, sdword first, sdword last)
 {
-    udword i,j;
-    udword primaryenemystrength, primaryenemyvalue;
-    udword otherenemystrength, otherenemyvalue;
-    udword goodGuystrength, goodGuyvalue;
-    udword tempstrength, tempvalue;
-    udword goodGuyResourcers;
-    bool   mothership;
-    SelectCommand *ships;
-    ShipPtr ship;
-    Player *shipplayer;
-    Player *primaryenemy = player->aiPlayer->primaryEnemyPlayer;
-    aiblob *tempblob;
-
-    //for every blob with good guy ships in it
-    for (i=0,primaryenemystrength = 0,
-             primaryenemyvalue    = 0,
-             otherenemystrength   = 0,
-             otherenemyvalue      = 0,
-             goodGuystrength      = 0,
-             goodGuyvalue         = 0,
-             goodGuyResourcers    = 0,
-             mothership           = FALSE;
-         i<aiuGoodGuyBlobs->numBlobs;
-         i++,primaryenemystrength = 0,
-             primaryenemyvalue    = 0,
-             otherenemystrength   = 0,
-             otherenemyvalue      = 0,
-             goodGuystrength      = 0,
-             goodGuyvalue         = 0,
-             goodGuyResourcers    = 0,
-             mothership           = FALSE)
-    {
-        tempblob   = aiuGoodGuyBlobs->blob[i];
-        ships      = tempblob->blobShips;
-
-        for (j=0,tempstrength=0,tempvalue=0;j<ships->numShips;j++)
-        {
-            ship       = ships->ShipPtr[j];
-            shipplayer = ship->playerowner;
-
-            aiuRateShip(&tempstrength,&tempvalue, ship);
+    aiublobjob *job = (aiublobjob *)data;
+    aiblob *rating;
+    sdword i;
 
-            if ((shipplayer->PlayerMothership) &&
-                (ship == shipplayer->PlayerMothership))
-            {
-                tempvalue  = (udword)(AIU_PLAYERMOTHERSHIP_FACTOR * (real32)tempvalue);
-                mothership = TRUE;
-            }
+    for (i = first; i < last; i++)
+    {
+        rating = &job->ratings[i];
 
-            if (shipplayer == player)
-            {
-                goodGuystrength += tempstrength;
-                goodGuyvalue    += tempvalue;
+        //first eliminate ships in the blob which can't be seen
+        MakeSelectionNotHaveNonVisibleEnemyShips(rating->blobShips, job->player);
+        aiuRateBlob(rating, job->player, i >= job->numGoodGuyBlobs);
+    }
+}
 
-                if (ship->shiptype == ResourceCollector)
-                {
-                    goodGuyResourcers++;
-                }
-            }
-            else if (shipplayer == primaryenemy)
-            {
-                primaryenemystrength += tempstrength;
-                primaryenemyvalue    += tempvalue;
-            }
-            else
-            {
-                otherenemystrength += tempstrength;
-                otherenemyvalue    += tempvalue;
-            }
-        }
-        tempblob->primaryenemystrength = primaryenemystrength;
-        tempblob->primaryenemyvalue    = primaryenemyvalue;
-        tempblob->otherenemystrength   = otherenemystrength;
-        tempblob->otherenemyvalue      = otherenemyvalue;
-        tempblob->goodGuystrength      = goodGuystrength;
-        tempblob->goodGuyvalue         = goodGuyvalue;
-        tempblob->goodGuyResourcers    = goodGuyResourcers;
-        tempblob->visibility           = TRUE;
-        tempblob->mothership           = mothership;
-
-//        dbgAssertOrIgnore(tempblob->goodGuyvalue);
-    }
-
-    for (i=0,goodGuystrength      = 0,
-             goodGuyvalue         = 0,
-             primaryenemystrength = 0,
-             primaryenemyvalue    = 0,
-             otherenemystrength   = 0,
-             otherenemyvalue      = 0,
-             goodGuyResourcers    = 0,
-             mothership           = FALSE;
-         i<aiuEnemyBlobs->numBlobs;
-         i++,primaryenemystrength = 0,
-             primaryenemyvalue    = 0,
-             otherenemystrength   = 0,
-             otherenemyvalue      = 0,
-             goodGuystrength      = 0,
-             goodGuyvalue         = 0,
-             goodGuyResourcers    = 0,
-             mothership           = FALSE)
-    {
-        tempblob = aiuEnemyBlobs->blob[i];
-        ships    = tempblob->blobShips;
-
-        for (j=0;j<ships->numShips;j++)
-        {
-            ship       = ships->ShipPtr[j];
-            shipplayer = ship->playerowner;
+#if AIU_VERIFY_BLOB_RATINGS
+/*-----------------------------------------------------------------------------
+    Name        : aiuVerifyBlobRating
+    Description : Rates a blob again on this thread and checks the result
+                  matches the one from the job threads.
+    Inputs      : rating - blob rated by aiuRateBlobsJob
+                  player, enemyBlob - as for aiuRateBlob
+    Outputs     :
+    Return      : void
+----------------------------------------------------------------------------*/
+static void aiuVerifyBlobRating(aiblob *rating, Player *player, bool enemyBlob)
+{
+    aiblob serial = *rating;
+
+    aiuRateBlob(&serial, player, enemyBlob);
+
+    dbgAssertOrIgnore(serial.primaryenemystrength == rating->primaryenemystrength);
+    dbgAssertOrIgnore(serial.primaryenemyvalue    == rating->primaryenemyvalue);
+    dbgAssertOrIgnore(serial.otherenemystrength   == rating->otherenemystrength);
+    dbgAssertOrIgnore(serial.otherenemyvalue      == rating->otherenemyvalue);
+    dbgAssertOrIgnore(serial.goodGuystrength      == rating->goodGuystrength);
+    dbgAssertOrIgnore(serial.goodGuyvalue         == rating->goodGuyvalue);
+    dbgAssertOrIgnore(serial.goodGuyResourcers    == rating->goodGuyResourcers);
+    dbgAssertOrIgnore(serial.visibility           == rating->visibility);
+    dbgAssertOrIgnore(serial.mothership           == rating->mothership);
+}
+#endif
 
-            aiuRateShip(&tempstrength, &tempvalue, ship);
+/*-----------------------------------------------------------------------------
+    Name        : aiuFillInAIBlobArrays
+    Description : Fills in the aiblob arrays and rates the blobs.  The ship
+                  lists are copied first, then filtered and rated on the job
+                  threads, then copied into the aiblob arrays in order.
+    Inputs      : enemy_blob_array - blob array of blobs with enemy ships present
+                  goodGuy_blob_array - blob array of blobs with good guy ships present
+    Outputs     :
+    Return      : void
+----------------------------------------------------------------------------*/
+void aiuFillInAIBlobArrays(blob_array *goodGuy_blob_array, blob_array *enemy_blob_array, Player *player)
+{
+    aiublobjob job;
+    aiblob *rating, *tempblob;
+    udword i, j;
+    sdword numBlobs = goodGuy_blob_array->numBlobs + enemy_blob_array->numBlobs;
 
-            if ((shipplayer->PlayerMothership) &&
-                (ship == shipplayer->PlayerMothership))
-            {
-                tempvalue  = (udword)(AIU_PLAYERMOTHERSHIP_FACTOR * (real32)tempvalue);
-                mothership = TRUE;
-            }
+    //allocate the global blob arrays
+    aiuEnemyBlobs   = (aiblob_array *)memAlloc(sizeof_aiblob_array(enemy_blob_array->numBlobs), "enbs", Pyrophoric);
+    aiuGoodGuyBlobs = (aiblob_array *)memAlloc(sizeof_aiblob_array(goodGuy_blob_array->numBlobs), "ggbs", Pyrophoric);
 
-            //hack for cryotray
-            if (ship->shiptype == CryoTray)
-            {
-                tempvalue = 1000;
-            }
+    if (numBlobs == 0)
+    {
+        aiuEnemyBlobs->numBlobs   = 0;
+        aiuGoodGuyBlobs->numBlobs = 0;
+        return;
+    }
 
+    //copy the ship lists here, the jobs can't allocate memory
+    job.player          = player;
+    job.numGoodGuyBlobs = goodGuy_blob_array->numBlobs;
+    job.ratings         = (aiblob *)memAlloc(numBlobs * sizeof(aiblob), "aiur", Pyrophoric);
 
-            if (shipplayer == player)
-            {
-                goodGuystrength += tempstrength;
-                goodGuyvalue    += tempvalue;
-                tempblob->visibility = TRUE;
+    for (i = 0, rating = job.ratings; i < goodGuy_blob_array->numBlobs; i++, rating++)
+    {
+        blob_to_aiblob(goodGuy_blob_array->blob[i], rating);
+        rating->blobShips = selectMemDupSelection(goodGuy_blob_array->blob[i]->blobShips, "fibg", Pyrophoric);
+    }
+    for (i = 0; i < enemy_blob_array->numBlobs; i++, rating++)
+    {
+        blob_to_aiblob(enemy_blob_array->blob[i], rating);
+        rating->blobShips = selectMemDupSelection(enemy_blob_array->blob[i]->blobShips, "fibe", Pyrophoric);
+    }
 
-                if (ship->shiptype == ResourceCollector)
-                {
-                    goodGuyResourcers++;
-                }
-            }
-            else if (shipplayer == primaryenemy)
-            {
-                primaryenemystrength += tempstrength;
-                primaryenemyvalue    += tempvalue;
-            }
-            else
-            {
-                otherenemystrength += tempstrength;
-                otherenemyvalue    += tempvalue;
-            }
-        }
-        tempblob->primaryenemystrength = primaryenemystrength;
-        tempblob->primaryenemyvalue    = primaryenemyvalue;
-        tempblob->otherenemystrength   = otherenemystrength;
-        tempblob->otherenemyvalue      = otherenemyvalue;
-        tempblob->goodGuystrength      = goodGuystrength;
-        tempblob->goodGuyvalue         = goodGuyvalue;
-        tempblob->goodGuyResourcers    = goodGuyResourcers;
-        tempblob->mothership           = mothership;
+    jobParallelFor(numBlobs, AIU_RateBlobsGrain, aiuRateBlobsJob, NULL, &job);
 
-        dbgAssertOrIgnore((tempblob->primaryenemyvalue) || (tempblob->otherenemyvalue));
+    //no need to check if good guy blobs have ships left over (as with enemy
+    //blobs) because they will always have at least one good guy (and
+    //therefore visible) ship
+    for (i = 0, rating = job.ratings; i < goodGuy_blob_array->numBlobs; i++, rating++)
+    {
+#if AIU_VERIFY_BLOB_RATINGS
+        aiuVerifyBlobRating(rating, player, FALSE);
+#endif
+        aiuGoodGuyBlobs->blob[i] = (aiblob *)memAlloc(sizeof(aiblob), "aigb", Pyrophoric);
+        *aiuGoodGuyBlobs->blob[i] = *rating;
     }
-}
+    aiuGoodGuyBlobs->numBlobs = i;
 
+    //if enemy blob still has any visible ships, store in EnemyBlobs array, else don't
+    for (i = 0, j = 0; i < enemy_blob_array->numBlobs; i++, rating++)
+    {
+        if (rating->blobShips->numShips == 0)
+        {
+            memFree(rating->blobShips);
+            continue;
+        }
+#if AIU_VERIFY_BLOB_RATINGS
+        aiuVerifyBlobRating(rating, player, TRUE);
+#endif
+        dbgAssertOrIgnore((rating->primaryenemyvalue) || (rating->otherenemyvalue));
+
+        tempblob = aiuEnemyBlobs->blob[j] = (aiblob *)memAlloc(sizeof(aiblob), "aieb", Pyrophoric);
+        blob_to_aiblob(rating, tempblob);
+        tempblob->goodGuyResourcers    = rating->goodGuyResourcers;
+        tempblob->mothership           = rating->mothership;
+        tempblob->primaryenemystrength = rating->primaryenemystrength;
+        tempblob->primaryenemyvalue    = rating->primaryenemyvalue;
+        tempblob->otherenemystrength   = rating->otherenemystrength;
+        tempblob->otherenemyvalue      = rating->otherenemyvalue;
+        tempblob->goodGuystrength      = rating->goodGuystrength;
+        tempblob->goodGuyvalue         = rating->goodGuyvalue;
+        //enemy blobs have only ever been marked visible, never invisible
+        if (rating->visibility)
+        {
+            tempblob->visibility = TRUE;
+        }
+        j++;
+    }
+    aiuEnemyBlobs->numBlobs = j;
 
+    memFree(job.ratings);
+}
 
 /*-----------------------------------------------------------------------------
     Name        : aiuCreateBlobArrays
@@ -4776,7 +4792,6 @@ void aiuCreateBlobArrays(Player *player)
 
     aiuFillInArrays(goodGuy_blob_array, enemy_blob_array, player);
     aiuFillInAIBlobArrays(goodGuy_blob_array, enemy_blob_array, player);
-    aiuRateBlobs(player);
 
     memFree(enemy_blob_array);
     memFree(goodGuy_blob_array);
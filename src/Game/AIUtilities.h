@@ -51,6 +51,10 @@ bool ShipAlreadyHyperspaceOut(Ship *ship);      // don't include singleplayer.h,
 #define aiuNewPyroSelection(sel, size, string)  \
                                         (sel) = (SelectCommand *)memAlloc(sizeofSelectCommand((size)), (string), Pyrophoric);\
                                         (sel)->numShips = 0;
+//scratch selection which only lasts until the next universe update, don't keep it
+#define aiuNewFrameSelection(sel, size, string)  \
+                                        (sel) = (SelectCommand *)memFrameAlloc(sizeofSelectCommand((size)), (string));\
+                                        (sel)->numShips = 0;
 
 
 #define aiuRandomRange(prob, range)     randyrandombetween(RANDOM_AI_PLAYER, ((prob)-(range)), ((prob)+(range)))
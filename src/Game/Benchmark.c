@@ -0,0 +1,378 @@
+/*=============================================================================
+    Name    : Benchmark.c
+    Purpose : Headless deterministic simulation benchmark (hwbench)
+
+    Boots the game systems without a visible window or audio device, loads a
+    saved game and runs univUpdate back to back the way HaveShipsFight() in
+    Stats.c does.  Reports ticks/sec, the PTSLAB phase timings (see
+    ProfileTimers.h) and the universe checksums at the end of the run so two
+    builds can be compared for both speed and determinism.
+=============================================================================*/
+
+#include "Benchmark.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CommandLayer.h"
+#include "File.h"
+#include "Globals.h"
+#include "Job.h"
+#include "main.h"
+#include "mainswitches.h"
+#include "Memory.h"
+#include "ProfileTimers.h"
+#include "SaveGame.h"
+#include "TimeoutTimer.h"
+#include "Universe.h"
+#include "UnivUpdate.h"
+#include "utility.h"
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+bool benchEnabled = FALSE;
+bool benchCheckThreads = FALSE;
+udword benchFrames = BENCH_DEFAULT_FRAMES;
+char benchLoadFile[BENCH_LOADFILE_LENGTH] = "";
+
+/*=============================================================================
+    Private types:
+=============================================================================*/
+
+//checksums after one universe update, for benchCheckThreads
+typedef struct benchcheck
+{
+    udword univ;
+    udword ship;
+    udword orders;                              // what the players (mostly computer players) have told their ships to do
+}
+benchcheck;
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+static void benchReport(char *format, ...)
+{
+    char buffer[200];
+    va_list argList;
+
+    va_start(argList, format);
+    vsnprintf(buffer, sizeof(buffer), format, argList);
+    va_end(argList);
+
+    printf("%s", buffer);
+    logfileLog(BENCH_LOGFILE, buffer);
+}
+
+static real64 benchTicksToMs(uqword ticks, uqword frequency)
+{
+    return ((real64)ticks * 1000.0) / (real64)frequency;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : benchOrdersChecksum
+    Description : Checksum of the ships in the universe, their orders and the
+                  players' resource units.  Catches the computer players
+                  deciding differently before it shows up as ship movement.
+    Inputs      :
+    Outputs     :
+    Return      : the checksum
+----------------------------------------------------------------------------*/
+static udword benchOrdersChecksum(void)
+{
+    Node *objnode;
+    Ship *ship;
+    udword check = 0;
+    sdword i;
+
+    for (objnode = universe.ShipList.head; objnode != NULL; objnode = objnode->next)
+    {
+        ship = (Ship *)listGetStructOfNode(objnode);
+        check = check * 31 + (udword)ship->shipID.shipNumber;
+        check = check * 31 + (udword)ship->shiptype;
+        if (ship->command != NULL)
+        {
+            check = check * 31 + (udword)ship->command->ordertype.order;
+            check = check * 31 + (udword)ship->command->ordertype.attributes;
+        }
+    }
+    for (i = 0; i < universe.numPlayers; i++)
+    {
+        check = check * 31 + (udword)universe.players[i].resourceUnits;
+    }
+    return check;
+}
+
+static void benchChecksum(benchcheck *check)
+{
+    sdword numShipsInChecksum;
+
+    check->univ = Real32ToUdword(univGetChecksum(&numShipsInChecksum));
+    check->ship = univCalcShipChecksum();
+    check->orders = benchOrdersChecksum();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : benchLoad
+    Description : Loads benchLoadFile the way the in-game load menu does
+    Inputs      :
+    Outputs     : singlePlayer - TRUE if it was a single player game
+    Return      : OKAY, or ERROR if the game didn't start
+----------------------------------------------------------------------------*/
+static sdword benchLoad(bool *singlePlayer)
+{
+    *singlePlayer = SaveFileIsSinglePlayer(benchLoadFile);
+    if (*singlePlayer)
+    {
+        utyLoadSinglePlayerGameGivenFilename(benchLoadFile);
+    }
+    else
+    {
+        utyLoadMultiPlayerGameGivenFilename(benchLoadFile);
+    }
+
+    if (!gameIsRunning)
+    {
+        fprintf(stderr, "hwbench: loading '%s' was aborted\n", benchLoadFile);
+        return ERROR;
+    }
+    return OKAY;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : benchSimulate
+    Description : Runs up to benchFrames universe updates
+    Inputs      : checks - if not NULL, where to record the checksums after
+                    each update
+    Outputs     : numChecks - number of checksums recorded, which is one
+                    less than the updates run if the game ended
+    Return      : number of updates run
+----------------------------------------------------------------------------*/
+static udword benchSimulate(benchcheck *checks, udword *numChecks)
+{
+    udword frame;
+
+    for (frame = 0; frame < benchFrames; frame++)
+    {
+        if (univUpdate(UNIVERSE_UPDATE_PERIOD) || !gameIsRunning)
+        {
+            *numChecks = frame;
+            return frame + 1;                               // game ended during this update
+        }
+        if (checks != NULL)
+        {
+            benchChecksum(&checks[frame]);
+        }
+    }
+    *numChecks = frame;
+    return frame;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : benchCheckSerial
+    Description : Reloads the saved game, runs it again with no job workers
+                    and compares the checksums after every update with those
+                    of the threaded run, so anything spread over the job
+                    threads can be checked for lockstep determinism.
+    Inputs      : checks - checksums recorded by the threaded run
+                  numFrames - updates in the threaded run
+                  numChecks - checksums recorded by the threaded run
+    Outputs     :
+    Return      : OKAY if every update matched
+----------------------------------------------------------------------------*/
+static sdword benchCheckSerial(benchcheck *checks, udword numFrames, udword numChecks)
+{
+    benchcheck *serial;
+    bool singlePlayer;
+    udword frame, serialFrames, serialChecks;
+    sdword numThreads = jobNumThreads();
+    sdword result = OKAY;
+
+    gameEnd();
+    jobShutdown();
+    jobStartup(0);
+
+    serial = memAlloc(benchFrames * sizeof(benchcheck), "benchCheckSerial", NonVolatile);
+
+    if (benchLoad(&singlePlayer) != OKAY)
+    {
+        result = ERROR;
+        serialFrames = serialChecks = 0;
+    }
+    else
+    {
+        serialFrames = benchSimulate(serial, &serialChecks);
+    }
+
+    if (result == OKAY)
+    {
+        if (serialFrames != numFrames || serialChecks != numChecks)
+        {
+            benchReport("check   : FAILED, game ran %u updates with %d threads and %u serially\n",
+                        numFrames, numThreads, serialFrames);
+            result = ERROR;
+        }
+        else
+        {
+            for (frame = 0; frame < numChecks; frame++)
+            {
+                if (checks[frame].univ != serial[frame].univ || checks[frame].ship != serial[frame].ship ||
+                    checks[frame].orders != serial[frame].orders)
+                {
+                    benchReport("check   : FAILED at update %u, univ 0x%08x/0x%08x ship 0x%08x/0x%08x orders 0x%08x/0x%08x (%d threads/serial)\n",
+                                frame, checks[frame].univ, serial[frame].univ,
+                                checks[frame].ship, serial[frame].ship,
+                                checks[frame].orders, serial[frame].orders, numThreads);
+                    result = ERROR;
+                    break;
+                }
+            }
+            if (result == OKAY)
+            {
+                benchReport("check   : %d threads and serial match over %u updates\n", numThreads, numFrames);
+            }
+        }
+    }
+
+    memFree(serial);
+
+    jobShutdown();
+    jobStartup(jobNumWorkers);
+
+    return result;
+}
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : benchPrepareHeadless
+    Description : Override startup switches so the game systems come up
+                  without a visible window or sound device.  Call before any
+                  game systems are started.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void benchPrepareHeadless(void)
+{
+    // don't override drivers the user explicitly asked for
+    SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+
+    fullScreen = FALSE;
+    enableAVI = FALSE;
+    enableSFX = FALSE;
+    enableSpeech = FALSE;
+
+    // the benchmark is only useful if two runs of it can be compared
+    determCompPlayer = TRUE;
+    autoSaveDebug = FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : benchRun
+    Description : Loads benchLoadFile and simulates benchFrames universe
+                  updates, writing the results to stdout and BENCH_LOGFILE.
+                  With benchCheckThreads, also checks the run against a
+                  serial one (see benchCheckSerial).
+    Inputs      :
+    Outputs     :
+    Return      : OKAY if the benchmark ran, ERROR if the game couldn't load
+                  or the serial check failed
+----------------------------------------------------------------------------*/
+sdword benchRun(void)
+{
+    sdword verify, i;
+    bool singlePlayer;
+    udword frame, startFrame, numChecks;
+    uqword timeStart, timeStop, timeTotal, frequency;
+    real32 univcheck;
+    sdword numShipsInChecksum;
+    udword shipcheck;
+    real64 totalMs;
+    benchcheck *checks = NULL;
+    sdword result = OKAY;
+
+    verify = VerifySaveFile(benchLoadFile);
+    if (verify != VERIFYSAVEFILE_OK)
+    {
+        fprintf(stderr, "hwbench: can't load saved game '%s' (error %d)\n", benchLoadFile, verify);
+        return ERROR;
+    }
+
+    if (benchLoad(&singlePlayer) != OKAY)
+    {
+        return ERROR;
+    }
+
+    if (benchCheckThreads)
+    {                                                       // recording the checksums is part of the timing
+        checks = memAlloc(benchFrames * sizeof(benchcheck), "benchChecks", NonVolatile);
+    }
+
+    startFrame = universe.univUpdateCounter;
+
+    benchTimers.timersOn = TRUE;
+    benchTimersReset();
+#if JOB_STATS
+    jobStatsUpdate();
+#endif
+
+    GetRawTimeHiRes(&timeStart);
+    frame = benchSimulate(checks, &numChecks);
+    GetRawTimeHiRes(&timeStop);
+
+    benchTimers.timersOn = FALSE;
+
+    frequency = GetRawTimeHiResFrequency();
+    timeTotal = timeStop - timeStart;
+    totalMs = benchTicksToMs(timeTotal, frequency);
+
+    univcheck = univGetChecksum(&numShipsInChecksum);
+    shipcheck = univCalcShipChecksum();
+
+    logfileClear(BENCH_LOGFILE);
+    benchReport("hwbench: %s (%s)\n", benchLoadFile, singlePlayer ? "single player" : "multiplayer");
+    benchReport("frames  : %u (from universe frame %u)\n", frame, startFrame);
+    benchReport("time    : %.1f ms, %.1f ticks/sec, %.3f ms/tick\n",
+                totalMs,
+                (totalMs > 0.0) ? (real64)frame * 1000.0 / totalMs : 0.0,
+                (frame > 0) ? totalMs / (real64)frame : 0.0);
+    benchReport("threads : %d\n", jobNumThreads());
+#if JOB_STATS
+    jobStatsUpdate();
+    benchReport("jobs    : %d run, %d stolen, %d inline\n", jobStats.numJobs, jobStats.numStolen, jobStats.numInline);
+#endif
+
+    benchReport("%-16s %10s %10s %10s %7s\n", "phase", "total ms", "avg ms", "max ms", "%");
+    for (i = 0; i < NUM_PROFILE_TIMERS; i++)
+    {
+        if (benchTimers.numSamples[i] == 0)
+        {
+            continue;
+        }
+        benchReport("%-16s %10.1f %10.4f %10.4f %6.1f%%\n",
+                    benchTimers.timeLabel[i],
+                    benchTicksToMs(benchTimers.timeTotal[i], frequency),
+                    benchTicksToMs(benchTimers.timeTotal[i], frequency) / (real64)benchTimers.numSamples[i],
+                    benchTicksToMs(benchTimers.timeMax[i], frequency),
+                    (timeTotal > 0) ? (real64)benchTimers.timeTotal[i] * 100.0 / (real64)timeTotal : 0.0);
+    }
+
+    benchReport("checksum: univ 0x%08x (%d ships) ship 0x%08x\n",
+                Real32ToUdword(univcheck), numShipsInChecksum, shipcheck);
+
+    if (checks != NULL)
+    {
+        result = benchCheckSerial(checks, frame, numChecks);
+        memFree(checks);
+    }
+
+    return result;
+}
@@ -0,0 +1,42 @@
+/*=============================================================================
+    Name    : Benchmark.h
+    Purpose : Headless deterministic simulation benchmark (hwbench)
+
+    Loads a saved game and drives univUpdate in a tight loop, reporting
+    ticks/sec, per-phase timings for the PTSLAB sections and the final
+    universe checksums so performance changes can be checked for determinism.
+    With benchCheckThreads set the run is repeated with no job workers and
+    the checksums of every update are compared against the threaded run.
+=============================================================================*/
+
+#ifndef ___BENCHMARK_H
+#define ___BENCHMARK_H
+
+#include "Types.h"
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define BENCH_DEFAULT_FRAMES        4800        // 5 minutes of game time at 16Hz
+#define BENCH_LOADFILE_LENGTH       256
+
+#define BENCH_LOGFILE               "hwbench.txt"
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+extern bool benchEnabled;
+extern bool benchCheckThreads;
+extern udword benchFrames;
+extern char benchLoadFile[BENCH_LOADFILE_LENGTH];
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void benchPrepareHeadless(void);
+sdword benchRun(void);
+
+#endif
@@ -18,16 +18,24 @@
 #include "BigFile.h"
 
 #include "BitIO.h"
+#include "LZB.h"
 #include "LZSS.h"
 #include "standard_library.h"
 
 
 #ifdef BF_HOMEWORLD
+    #include "SDL.h"
     #include "Memory.h"
     #include "Debug.h"
     #include "File.h"
 #endif
 
+// only the tool builds bigfiles, so only the tool compresses on several threads
+#if !defined(BF_HOMEWORLD) && !defined(_WIN32)
+    #define BF_THREADED_CREATE
+    #include <pthread.h>
+#endif
+
 
 //
 // The following value sets the threshold used by the bigfile system to decide which
@@ -39,6 +47,12 @@
 
 #define MINIMUM_COMPRESSION_RATIO 0.950f
 
+// bigBenchmark expands every entry this many times with each codec
+#define BENCHMARK_REPEATS 8
+
+// bigFastCreate workers may run this many entries per thread ahead of the writer
+#define PACK_ENTRIES_AHEAD 4
+
 
 #ifdef BF_HOMEWORLD
 
@@ -63,6 +77,10 @@ bool IgnoreBigfiles = FALSE;
 //  (useful for ordering or creating a bigfile)
 bool LogFileLoads = FALSE;
 
+//  expand the entries a level needs on a background thread while
+//  it loads, see bigPrefetchStart
+bool PrefetchBigfiles = TRUE;
+
 #endif
 
 
@@ -816,6 +834,63 @@ static int bigCreateNew(char *filename)
     return 1;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : bigCompressLZB
+    Description : LZB compress a whole file onto the end of a bigfile
+    Inputs      : dataFP - file to compress, positioned at its start
+                  realLength - size of that file
+                  bigFP - bigfile, positioned where the data goes
+    Outputs     : compressed data is written to bigFP
+    Return      : compressed size, or 0 if it couldn't be compressed
+----------------------------------------------------------------------------*/
+static int bigCompressLZB(FILE *dataFP, udword realLength, FILE *bigFP)
+{
+    int boundLength = lzbCompressBound(realLength);
+    char *realData = malloc(realLength + 1);
+    char *storedData = malloc(boundLength);
+    int storedLength = 0;
+
+    if (realData != NULL && storedData != NULL &&
+        fread(realData, 1, realLength, dataFP) == realLength)
+    {
+        storedLength = lzbCompressBuffer(realData, realLength, storedData, boundLength);
+        if (storedLength > 0 && fwrite(storedData, 1, storedLength, bigFP) != (size_t)storedLength)
+        {
+            storedLength = 0;
+        }
+    }
+
+    free(realData);
+    free(storedData);
+    return storedLength;
+}
+
+#ifdef BF_HOMEWORLD
+/*-----------------------------------------------------------------------------
+    Name        : bigExpandLZB
+    Description : Expand an LZB compressed bigfile entry into memory
+    Inputs      : entry - TOC entry to expand
+                  bigFP - bigfile, positioned at the entry's data
+                  address - where to expand to, entry->realLength bytes
+    Outputs     : address is filled in
+    Return      : expanded size, or -1 if the data couldn't be read or is corrupt
+----------------------------------------------------------------------------*/
+static int bigExpandLZB(bigTOCFileEntry *entry, FILE *bigFP, void *address)
+{
+    char *storedData = malloc(entry->storedLength + 1);
+    int expandedSize = -1;
+
+    if (storedData != NULL &&
+        fread(storedData, 1, entry->storedLength, bigFP) == entry->storedLength)
+    {
+        expandedSize = lzbExpandBuffer(storedData, entry->storedLength, address, entry->realLength);
+    }
+
+    free(storedData);
+    return expandedSize;
+}
+#endif
+
 //
 //  Create a "patch" bigfile from all the files in the newbigfile that have
 //  have been changed or added since the oldbigfile.  A byte-for-byte comparison
@@ -1293,6 +1368,310 @@ int bigAdd(char *bigfilename, int numFiles, char *filenames[], int optCompressio
     return 1;
 }
 
+//  one bigFastCreate entry on its way into the bigfile
+typedef struct
+{
+    char *filename;                 // local file to read
+    int compressionType;            // requested, then BF_COMPRESSION_XXX actually used
+    udword realLength;
+    char *storedData;               // exactly what follows the name in the bigfile
+    int storedLength;
+    int failed;                     // couldn't read filename
+    int packed;                     // the fields above are ready
+} bigPackedEntry;
+
+//  the entries of a bigfile being fast-created, packed in order by zero or
+//  more worker threads while the caller writes them out in that same order
+typedef struct
+{
+    bigPackedEntry *entries;
+    int maxEntries;                 // allocated
+    int numEntries;                 // queued
+    int numThreads;                 // 0 = pack on demand in the caller
+    int nextEntry;                  // next to be picked up by a worker
+    int numWritten;                 // entries before this have been freed
+    int entriesAhead;               // how far past numWritten workers may go
+#ifdef BF_THREADED_CREATE
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;           // an entry has been packed
+    pthread_cond_t written;         // numWritten moved on (or the pool stopped)
+#endif
+} bigPackPool;
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPackEntry
+    Description : Read a file into memory and compress it the way it will be
+                  stored in a bigfile.  This touches nothing but the entry, so
+                  it may run on any thread.
+    Inputs      : packed - filename and requested compressionType
+    Outputs     : packed - realLength, storedData/storedLength and the
+                  compressionType actually used (none if it didn't pay off)
+    Return      : 1 on success, 0 if the file couldn't be read
+----------------------------------------------------------------------------*/
+static int bigPackEntry(bigPackedEntry *packed)
+{
+    FILE *dataFP;
+    char *realData = NULL, *storedData = NULL;
+    long realLength;
+    int boundLength, storedLength = 0;
+
+    packed->failed = 1;
+    dataFP = fopen(packed->filename, "rb");
+    if (!dataFP)
+    {
+        return 0;
+    }
+    fseek(dataFP, 0, SEEK_END);
+    realLength = ftell(dataFP);
+    fseek(dataFP, 0, SEEK_SET);
+
+    realData = malloc(realLength + 1);
+    if (realLength < 0 || realData == NULL ||
+        fread(realData, 1, realLength, dataFP) != (size_t)realLength)
+    {
+        fclose(dataFP);
+        free(realData);
+        return 0;
+    }
+    fclose(dataFP);
+
+    packed->realLength = (udword)realLength;
+
+    if (packed->compressionType == BF_COMPRESSION_LZB)
+    {
+        boundLength = lzbCompressBound(realLength);
+        storedData = malloc(boundLength);
+        if (storedData != NULL)
+        {
+            storedLength = lzbCompressBuffer(realData, realLength, storedData, boundLength);
+        }
+    }
+    else if (packed->compressionType)
+    {
+        // worst case is 9 bits a byte plus the end of stream marker
+        boundLength = realLength + realLength / 8 + 4;
+        storedData = malloc(boundLength);
+        if (storedData != NULL)
+        {
+            storedLength = lzssCompressBuffer(realData, realLength, storedData, boundLength);
+        }
+    }
+
+    //  revert to uncompressed if the file won't compress
+    if (packed->compressionType &&
+        (storedLength <= 0 ||
+         (float)storedLength/(float)packed->realLength > MINIMUM_COMPRESSION_RATIO))
+    {
+        packed->compressionType = BF_COMPRESSION_NONE;
+    }
+
+    if (packed->compressionType)
+    {
+        free(realData);
+        packed->storedData   = storedData;
+        packed->storedLength = storedLength;
+    }
+    else
+    {
+        free(storedData);
+        packed->storedData   = realData;
+        packed->storedLength = packed->realLength;
+    }
+
+    packed->failed = 0;
+    return 1;
+}
+
+#ifdef BF_THREADED_CREATE
+/*-----------------------------------------------------------------------------
+    Name        : bigPackWorker
+    Description : Thread body for bigFastCreate; packs entries in order until
+                  there are none left, staying a bounded distance ahead of
+                  the writer so memory use doesn't grow with the bigfile.
+    Inputs      : data - the bigPackPool
+    Outputs     :
+    Return      : NULL
+----------------------------------------------------------------------------*/
+static void *bigPackWorker(void *data)
+{
+    bigPackPool *pool = (bigPackPool *)data;
+    int index;
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->nextEntry < pool->numEntries &&
+               pool->nextEntry >= pool->numWritten + pool->entriesAhead)
+        {
+            pthread_cond_wait(&pool->written, &pool->lock);
+        }
+        if (pool->nextEntry >= pool->numEntries)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        index = pool->nextEntry++;
+        pthread_mutex_unlock(&pool->lock);
+
+        bigPackEntry(&pool->entries[index]);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->entries[index].packed = 1;
+        pthread_cond_broadcast(&pool->ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPackStart
+    Description : Start packing the entries queued up in a bigPackPool.
+    Inputs      : pool - entries to pack
+                  numThreads - worker threads to use; 1 or less (or a build
+                      without threads) packs each entry when it is asked for
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bigPackStart(bigPackPool *pool, int numThreads)
+{
+    pool->numThreads = 0;
+    pool->nextEntry  = 0;
+    pool->numWritten = 0;
+
+#ifdef BF_THREADED_CREATE
+    if (numThreads > 1 && pool->numEntries > 1)
+    {
+        numThreads = min(numThreads, pool->numEntries);
+        pool->threads = malloc(sizeof(pthread_t) * numThreads);
+        pool->entriesAhead = numThreads * PACK_ENTRIES_AHEAD;
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->ready, NULL);
+        pthread_cond_init(&pool->written, NULL);
+
+        while (pool->numThreads < numThreads &&
+               pthread_create(&pool->threads[pool->numThreads], NULL, bigPackWorker, pool) == 0)
+        {
+            pool->numThreads++;
+        }
+        if (pool->numThreads == 0)
+        {
+            // couldn't get any threads, so just do it all in order
+            free(pool->threads);
+            pool->threads = NULL;
+            pthread_cond_destroy(&pool->written);
+            pthread_cond_destroy(&pool->ready);
+            pthread_mutex_destroy(&pool->lock);
+        }
+    }
+#else
+    (void)numThreads;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPackWait
+    Description : Get a packed entry, waiting for (or doing) the packing.
+                  Entries must be asked for in order.
+    Inputs      : pool - the pool
+                  index - entry wanted
+    Outputs     :
+    Return      : the entry; check its failed flag
+----------------------------------------------------------------------------*/
+static bigPackedEntry *bigPackWait(bigPackPool *pool, int index)
+{
+    bigPackedEntry *packed = &pool->entries[index];
+
+#ifdef BF_THREADED_CREATE
+    if (pool->numThreads)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!packed->packed)
+        {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return packed;
+    }
+#endif
+
+    bigPackEntry(packed);
+    packed->packed = 1;
+    return packed;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPackDone
+    Description : Release an entry's data once it has been written, letting
+                  the workers move on to later entries.
+    Inputs      : pool - the pool
+                  index - entry just written
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bigPackDone(bigPackPool *pool, int index)
+{
+    free(pool->entries[index].storedData);
+    pool->entries[index].storedData = NULL;
+
+#ifdef BF_THREADED_CREATE
+    if (pool->numThreads)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->numWritten = index + 1;
+        pthread_cond_broadcast(&pool->written);
+        pthread_mutex_unlock(&pool->lock);
+    }
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPackStop
+    Description : Stop the workers (abandoning anything not yet packed) and
+                  free everything in the pool.
+    Inputs      : pool - the pool
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bigPackStop(bigPackPool *pool)
+{
+    int index;
+
+#ifdef BF_THREADED_CREATE
+    if (pool->numThreads)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->numEntries = pool->nextEntry;
+        pthread_cond_broadcast(&pool->written);
+        pthread_mutex_unlock(&pool->lock);
+
+        for (index = 0; index < pool->numThreads; index++)
+        {
+            pthread_join(pool->threads[index], NULL);
+        }
+        free(pool->threads);
+        pool->threads = NULL;
+        pool->numThreads = 0;
+        pthread_cond_destroy(&pool->written);
+        pthread_cond_destroy(&pool->ready);
+        pthread_mutex_destroy(&pool->lock);
+    }
+#endif
+
+    if (pool->entries != NULL)
+    {
+        for (index = 0; index < pool->maxEntries; index++)
+        {
+            free(pool->entries[index].filename);
+            free(pool->entries[index].storedData);
+        }
+        free(pool->entries);
+        pool->entries = NULL;
+    }
+}
+
 /*-----------------------------------------------------------------------------
     Name        : bigFastCreate
     Description : Create a new bigfile quickly
@@ -1303,22 +1682,23 @@ int bigAdd(char *bigfilename, int numFiles, char *filenames[], int optCompressio
                   optNewer - 1|0 add files only if newer
                   optMove - 1|0 move (not just copy) files
                   optPathnames - 1|0 store full pathnames
+                  optThreads - read and compress this many files at once;
+                      the bigfile is the same whatever this is
                   consoleOutput - 1|0 = output to stdout (yes/no)
     Outputs     : New bigfile.
                   Possibly deleted (moved) files.
                   Output to stdout (if enabled).
     Return      : 1 on success, 0 on failure
 ----------------------------------------------------------------------------*/
-int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCompression, int optNewer, int optMove, int optPathnames, int consoleOutput)
+int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCompression, int optNewer, int optMove, int optPathnames, int optThreads, int consoleOutput)
 {
     char tempshortfilename[BF_MAX_FILENAME_LENGTH+1];
     char tempshortfilenamei[BF_MAX_FILENAME_LENGTH+1];
-    char ch;
     int filesAdded = 0, dupesSkipped = 0;
     int pass;
     int f, i, j, index;
     int *moveFiles = NULL;
-    FILE *bigFP = NULL, *filelistFP = NULL, *dataFP = NULL;
+    FILE *bigFP = NULL, *filelistFP = NULL;
     int filelist;
     char *filelistName = NULL;
     char filelistLine[BF_MAX_FILENAME_LENGTH+1];
@@ -1327,10 +1707,14 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
     struct stat findData;
     bigTOCFileEntry fileEntry;
     unsigned long curOffset = 0;
-    int compressedSize = 0;
     crc32 *crcAdded1 = NULL, *crcAdded2 = NULL;
     int dupe = 0;
     uword halfFilenameLength = 0;
+    bigPackPool pool;
+    bigPackedEntry *packed;
+
+    memset(&pool, 0, sizeof(pool));
+    memset(&fileEntry, 0, sizeof(fileEntry));   // padding goes into the TOC too
 
     // either update or create
     if (bigFileExists(bigfilename))
@@ -1395,6 +1779,7 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                         printf("ERROR: Can't open filelist: %s\n", filelistName);
                     }
                     
+                    bigPackStop(&pool);
                     free(moveFiles);
                     return 0;
                 }
@@ -1504,6 +1889,11 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                         {
                             continue;
                         }
+                        // queue the data up for reading & compression
+                        pool.entries[filesAdded].filename = malloc(strlen(filename) + 1);
+                        strcpy(pool.entries[filesAdded].filename, filename);
+                        pool.entries[filesAdded].compressionType = optCompression;
+                        pool.numEntries = filesAdded + 1;
                         break;
                         
                     case 2:
@@ -1528,19 +1918,15 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                             
                             fclose(bigFP);
                             unlink(bigfilename);
+                            bigPackStop(&pool);
                             free(moveFiles);
                             return 0;
                         }
-                        fileEntry.realLength = findData.st_size;
                         fileEntry.timeStamp = findData.st_mtime;
 
-                        // data
-                        fseek(bigFP, curOffset, SEEK_SET);
-                        bigFilenameEncrypt(tempshortfilename);
-                        fwrite((void *)(tempshortfilename), 1, fileEntry.nameLength+1, bigFP);
-                        bigFilenameDecrypt(tempshortfilename, fileEntry.nameLength);
-                        dataFP = fopen(filename, "rb");
-                        if (!dataFP)
+                        // read & compress (or pick up what a worker thread already did)
+                        packed = bigPackWait(&pool, filesAdded);
+                        if (packed->failed)
                         {
                             if (consoleOutput)
                             {
@@ -1548,40 +1934,21 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                             }
                             fclose(bigFP);
                             unlink(bigfilename);
+                            bigPackStop(&pool);
                             free(moveFiles);
                             return 0;
                         }
-                        if (fileEntry.compressionType)
-                        {
-                            // compress and append
-                            BitFile *bitFile;
-                            bitFile = bitioFileAppendStart(bigFP);
-                            lzssCompressFile(dataFP, bitFile);
-                            compressedSize = bitioFileAppendStop(bitFile);
-                            //  revert to uncompressed if the file won't compress
-                            if ((float)compressedSize/(float)fileEntry.realLength > MINIMUM_COMPRESSION_RATIO)
-                            {
-                                fileEntry.compressionType = 0;
-                                // theoretically, this could leave some harmless data at the end of a bigfile
-                                fseek(bigFP, curOffset + strlen(tempshortfilename)+1, SEEK_SET);
-                                fseek(dataFP, 0, SEEK_SET);
-                            }
-                        }
-                        if (!fileEntry.compressionType)
-                        {
-                            // raw, uncompressed copy
-                            while (1)
-                            {
-                                // inefficient!
-                                ch = (char)getc(dataFP);
-                                if (feof(dataFP))
-                                {
-                                    break;
-                                }
-                                putc(ch, bigFP);
-                            }
-                        }
-                        fclose(dataFP);
+                        fileEntry.realLength      = packed->realLength;
+                        fileEntry.storedLength    = packed->storedLength;
+                        fileEntry.compressionType = packed->compressionType;
+
+                        // data
+                        fseek(bigFP, curOffset, SEEK_SET);
+                        bigFilenameEncrypt(tempshortfilename);
+                        fwrite((void *)(tempshortfilename), 1, fileEntry.nameLength+1, bigFP);
+                        bigFilenameDecrypt(tempshortfilename, fileEntry.nameLength);
+                        fwrite(packed->storedData, 1, packed->storedLength, bigFP);
+                        bigPackDone(&pool, filesAdded);
 
                         // TOC header entry
                         fseek(bigFP,   // overwrite placeholder from previous step
@@ -1590,7 +1957,6 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                                 sizeof(toc.flags) +
                                 (filesAdded * sizeof(bigTOCFileEntry)), SEEK_SET);
 
-                        fileEntry.storedLength = fileEntry.compressionType ? compressedSize : findData.st_size;
                         fileEntry.offset = curOffset;
 
                         bigTOCFileEntryWrite(&fileEntry, bigFP);
@@ -1633,6 +1999,8 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
             case -1:
                 crcAdded1 = (crc32 *)malloc(sizeof(crc32) * filesAdded);
                 crcAdded2 = (crc32 *)malloc(sizeof(crc32) * filesAdded);
+                pool.entries = (bigPackedEntry *)calloc(filesAdded + 1, sizeof(bigPackedEntry));
+                pool.maxEntries = filesAdded;
                 filesAdded = 0;
                 break;
 
@@ -1666,11 +2034,13 @@ int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCom
                         + sizeof(toc.flags)
                         + (filesAdded * sizeof(bigTOCFileEntry));
                 filesAdded = 0;  // reset for final pass, to keep track of dupes
+                bigPackStart(&pool, optThreads);
                 break;
         }
     }
 
     fclose(bigFP);
+    bigPackStop(&pool);
 
     if (consoleOutput)
     {
@@ -1828,7 +2198,35 @@ int bigAddFile(char *bigFilename, char *filename, char *storedFilename, int optC
     }
 
     // compress file to temp file if required
-    if (optCompression)
+    if (optCompression == BF_COMPRESSION_LZB)
+    {
+        FILE *compressedfp = fopen(compressedTempFilename, "wb");
+        int compressedSize;
+        if (!compressedfp)
+        {
+            if (consoleOutput)
+                printf("\nERROR: Can't create temporary file %s\n", compressedTempFilename);
+            goto abort;
+        }
+        datafp = fopen(filename, "rb");
+        if (!datafp)
+        {
+            if (consoleOutput)
+                printf("\nERROR: Can't open %s\n", filename);
+            fclose(compressedfp);
+            goto abort;
+        }
+        compressedSize = bigCompressLZB(datafp, findData.st_size, compressedfp);
+        fclose(datafp);
+        fclose(compressedfp);
+        if (compressedSize == 0)
+        {
+            if (consoleOutput)
+                printf("\nERROR: Can't compress %s\n", filename);
+            goto abort;
+        }
+    }
+    else if (optCompression)
     {
         BitFile *bf = bitioFileOpenOutput(compressedTempFilename);
         if (!bf)
@@ -1847,6 +2245,9 @@ int bigAddFile(char *bigFilename, char *filename, char *storedFilename, int optC
         lzssCompressFile(datafp, bf);
         fclose(datafp);
         bitioFileCloseOutput(bf);
+    }
+    if (optCompression)
+    {
         if (stat(compressedTempFilename, &findDataCompressed) == -1)
         {
             if (consoleOutput)
@@ -2159,8 +2560,8 @@ int bigView(char *bigFilename, int consoleOutput)
         printf(  "(%s bytes, ", PrettyFilesize(findData.st_size, pStoredSize));
         printf(  "%s):\n", (toc.flags & BF_FLAG_TOC_SORTED)?"CRC-sorted TOC":"unsorted TOC");
 
-        printf("\n             CRC   Stored Size     Real Size  Ratio        Date     Time  Filename\n");
-        printf("----------------  ------------  ------------  -----  ---------- --------  ------------\n");
+        printf("\n             CRC   Stored Size     Real Size  Ratio  Codec        Date     Time  Filename\n");
+        printf("----------------  ------------  ------------  -----  -----  ---------- --------  ------------\n");
         for (f = 0; f < toc.numFiles; ++f)
         {
             bigFilenameRetrieve(&toc, f, fp, filename);
@@ -2171,12 +2572,14 @@ int bigView(char *bigFilename, int consoleOutput)
                      : 0.0));
             else
                 strcpy(pRatio, "  na ");
-            printf("%08x%08x %13s %13s  %s  %s  %s\n",
+            printf("%08x%08x %13s %13s  %s  %-5s  %s  %s\n",
                 (toc.fileEntries + f)->nameCRC1,
                 (toc.fileEntries + f)->nameCRC2,
                 PrettyFilesize((toc.fileEntries + f)->storedLength, pStoredSize),
                 PrettyFilesize((toc.fileEntries + f)->realLength, pRealSize),
                 pRatio,
+                (toc.fileEntries + f)->compressionType == BF_COMPRESSION_LZB ? "lzb" :
+                (toc.fileEntries + f)->compressionType == BF_COMPRESSION_LZSS ? "lzss" : "",
                 PrettyDateTime((toc.fileEntries + f)->timeStamp, pTimestamp),
                 filename);
             totalCompressed += (toc.fileEntries + f)->storedLength;
@@ -2335,7 +2738,8 @@ int bigExtract(char *bigFilename, int numFiles, char *filenames[], int optFreshe
             printf("Extracting: %s", filename);
             
             // uncompress file if necessary
-            if (fileEntry->compressionType == '\1')
+            if (fileEntry->compressionType == BF_COMPRESSION_LZSS ||
+                fileEntry->compressionType == BF_COMPRESSION_LZB)
             {
                 compressedFile   = (char *) malloc(fileEntry->storedLength);
                 uncompressedFile = (char *) malloc(fileEntry->realLength);
@@ -2343,8 +2747,11 @@ int bigExtract(char *bigFilename, int numFiles, char *filenames[], int optFreshe
                 if (compressedFile != NULL && uncompressedFile != NULL)
                 {
                     fread(compressedFile, 1, fileEntry->storedLength, extractFp);
-                    if (lzssExpandBuffer(compressedFile, fileEntry->storedLength,
-                                         uncompressedFile, fileEntry->realLength) == -1)
+                    if ((fileEntry->compressionType == BF_COMPRESSION_LZB ?
+                         lzbExpandBuffer(compressedFile, fileEntry->storedLength,
+                                         uncompressedFile, fileEntry->realLength) :
+                         lzssExpandBuffer(compressedFile, fileEntry->storedLength,
+                                          uncompressedFile, fileEntry->realLength)) == -1)
                     {
                         printf(" - DECOMPRESSION FAILED!\n");
                         
@@ -2478,74 +2885,399 @@ abort:
     return 1;
 }
 
-//
-//  the following routines are for in-game compilation only -- not for the command-line tool
-//
-#ifdef BF_HOMEWORLD
-
-bool bigOpenAllBigFiles(void)
+/*-----------------------------------------------------------------------------
+    Name        : bigBenchmark
+    Description : Compress every file in a bigfile with both LZSS and LZB and
+                  time how fast each one expands them again
+    Inputs      : bigFilename - filename of bigfile to benchmark
+                  consoleOutput - 1/0 = output to stdout (yes/no)
+    Outputs     : Output to stdout (if enabled).
+    Return      : 1 on success, 0 on failure
+----------------------------------------------------------------------------*/
+int bigBenchmark(char *bigFilename, int consoleOutput)
 {
-    udword bigfile_i = 0;
-    char bigFilePath[PATH_MAX] = "";
+    FILE *fp;
+    bigTOC toc;
+    bigTOCFileEntry *entry;
+    int f, repeat, lzssLength, lzbLength;
+    char *storedData, *realData, *lzssData, *lzbData, *checkData;
+    unsigned long totalReal = 0, totalLZSS = 0, totalLZB = 0;
+    clock_t start, lzssTicks = 0, lzbTicks = 0;
+    int mismatches = 0;
+    char pRealSize[32], pStoredSize[32];
 
-    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    toc.fileEntries = NULL;
+
+    // open bigfile
+    fp = fopen(bigFilename, "rb");
+    if (!fp)
     {
-        strcpy(bigFilePath,
-               filePathPrepend(bigFilePrecedence[bigfile_i].bigFileName, FF_HomeworldDataPath));
-        
-        if (!fileExists(bigFilePath, FF_IgnorePrepend))
+        if (consoleOutput)
+            printf("ERROR: Can't open %s\n", bigFilename);
+        return 0;
+    }
+    // ensure correct file type & version
+    if (!bigHeaderVerify(fp))
+    {
+        if (consoleOutput)
+            printf("ERROR: Incompatible file %s\n", bigFilename);
+        fclose(fp);
+        return 0;
+    }
+
+    bigTOCRead(fp, &toc);
+
+    for (f = 0; f < toc.numFiles; ++f)
+    {
+        entry = toc.fileEntries + f;
+        if (entry->realLength == 0)
         {
-            if (bigFilePrecedence[bigfile_i].required)
-            {
-                dbgFatalf(DBG_Loc, "Unable to find required .big file: %s", bigFilePath);
-            }
+            continue;
         }
-        
-        // can't fileOpen them because fileOpen wraps the .big archives themselves
-        bigFilePrecedence[bigfile_i].filePtr = fopen(bigFilePath, "rb");
-        
-        if (bigFilePrecedence[bigfile_i].filePtr == NULL)
+
+        storedData = malloc(entry->storedLength + 1);
+        realData   = malloc(entry->realLength);
+        checkData  = malloc(entry->realLength);
+        lzssData   = malloc(entry->realLength + entry->realLength / 8 + 64);  // 9 bits per literal worst case
+        lzbData    = malloc(lzbCompressBound(entry->realLength));
+        if (storedData == NULL || realData == NULL || checkData == NULL || lzssData == NULL || lzbData == NULL)
         {
-            if (bigFilePrecedence[bigfile_i].required)
-            {
-                dbgFatalf(DBG_Loc, "Unable to open required .big file: %s", filePathTempBuffer);
-            }
-            else
-            {
-                continue;
-            }
+            if (consoleOutput)
+                printf("ERROR: Can't allocate memory for file %d\n", f);
+            free(storedData); free(realData); free(checkData); free(lzssData); free(lzbData);
+            break;
         }
 
-        if (!bigHeaderVerify(bigFilePrecedence[bigfile_i].filePtr))
+        // get the original data back, however it was stored
+        fseek(fp, entry->offset + entry->nameLength + 1, SEEK_SET);
+        fread(storedData, 1, entry->storedLength, fp);
+        switch (entry->compressionType)
         {
-            if (bigFilePrecedence[bigfile_i].required)
-            {
-                dbgFatalf(DBG_Loc, "Incompatible version for required .big file: %s", filePathTempBuffer);
-            }
+            case BF_COMPRESSION_LZB:
+                lzbExpandBuffer(storedData, entry->storedLength, realData, entry->realLength);
+                break;
+            case BF_COMPRESSION_LZSS:
+                lzssExpandBuffer(storedData, entry->storedLength, realData, entry->realLength);
+                break;
+            default:
+                memcpy(realData, storedData, entry->realLength);
+                break;
         }
 
-        if (bigFilePrecedence[bigfile_i].filePtr != NULL)
+        lzssLength = lzssCompressBuffer(realData, entry->realLength, lzssData, entry->realLength + entry->realLength / 8 + 64);
+        lzbLength  = lzbCompressBuffer(realData, entry->realLength, lzbData, lzbCompressBound(entry->realLength));
+
+        start = clock();
+        for (repeat = 0; repeat < BENCHMARK_REPEATS; ++repeat)
         {
-            numOpenedBigFiles++;
+            lzssExpandBuffer(lzssData, lzssLength, checkData, entry->realLength);
+        }
+        lzssTicks += clock() - start;
+        mismatches += memcmp(realData, checkData, entry->realLength) != 0;
 
-            bigTOCRead(bigFilePrecedence[bigfile_i].filePtr,
+        start = clock();
+        for (repeat = 0; repeat < BENCHMARK_REPEATS; ++repeat)
+        {
+            lzbExpandBuffer(lzbData, lzbLength, checkData, entry->realLength);
+        }
+        lzbTicks += clock() - start;
+        mismatches += memcmp(realData, checkData, entry->realLength) != 0;
+
+        totalReal += entry->realLength;
+        totalLZSS += lzssLength;
+        totalLZB  += lzbLength;
+
+        free(storedData); free(realData); free(checkData); free(lzssData); free(lzbData);
+    }
+
+    if (consoleOutput)
+    {
+        printf("\nDecode benchmark of %s (%d files, %s bytes, %d passes):\n",
+            bigFilename, toc.numFiles, PrettyFilesize(totalReal, pRealSize), BENCHMARK_REPEATS);
+        printf("\nCodec   Stored Size  Ratio    MB/s\n");
+        printf("-----  ------------  -----  ------\n");
+        printf("lzss   %12s  %05.3f  %6.1f\n", PrettyFilesize(totalLZSS, pStoredSize),
+            totalReal ? (float)totalLZSS / (float)totalReal : 0.0,
+            lzssTicks ? (double)totalReal * BENCHMARK_REPEATS / (1024.0 * 1024.0) / ((double)lzssTicks / CLOCKS_PER_SEC) : 0.0);
+        printf("lzb    %12s  %05.3f  %6.1f\n", PrettyFilesize(totalLZB, pStoredSize),
+            totalReal ? (float)totalLZB / (float)totalReal : 0.0,
+            lzbTicks ? (double)totalReal * BENCHMARK_REPEATS / (1024.0 * 1024.0) / ((double)lzbTicks / CLOCKS_PER_SEC) : 0.0);
+        if (mismatches)
+            printf("\nERROR: %d files didn't expand back to the original\n", mismatches);
+    }
+
+    free(toc.fileEntries);
+    fclose(fp);
+
+    return mismatches == 0;
+}
+
+//
+//  the following routines are for in-game compilation only -- not for the command-line tool
+//
+#ifdef BF_HOMEWORLD
+
+//  read only mappings of the open bigfiles, same order as bigFilePrecedence;
+//  data is NULL where the platform couldn't map one
+static filemap bigFileMaps[NUMBER_CONFIGURED_BIG_FILES];
+
+//  one entry being expanded ahead of the loader, see bigPrefetchStart
+typedef struct
+{
+    udword bigFile;                 // index into bigFilePrecedence
+    udword fileNum;
+    udword prefix;                  // index into bigPrefetchPrefixes, for ordering
+    bool late;                      // texture, loaded after all the statics
+    ubyte *data;                    // expanded data (malloc'd), NULL for stored entries
+    udword state;                   // BP_XXX
+} bigprefetchitem;
+
+enum
+{
+    BP_Queued,                      // waiting for the worker
+    BP_Working,                     // being expanded
+    BP_Ready,                       // expanded (or paged in) and waiting for the loader
+    BP_Taken,                       // loader has it, or got there first and loaded it itself
+};
+
+#define BP_MaxPrefixes      512
+#define BP_MaxBytesAhead    (16 * 1024 * 1024)  // expanded data the worker may hold before the loader catches up
+#define BP_PageSize         4096                // stored entries are only touched, once a page
+#define BP_LateExtension    ".lif"              // textures, loaded by trRegistryRefresh after the statics
+
+//  directories the next bigPrefetchStart covers
+static char *bigPrefetchPrefixes[BP_MaxPrefixes];
+static udword bigPrefetchNumPrefixes = 0;
+
+//  the running prefetch; the worker only touches items past bigPrefetchNext
+//  and the item states, all under bigPrefetchLock
+static bigprefetchitem *bigPrefetchItems = NULL;
+static udword bigPrefetchNumItems = 0;
+static udword bigPrefetchNext = 0;
+static udword bigPrefetchBytesAhead = 0;
+static bool bigPrefetchQuit = FALSE;
+static udword *bigPrefetchSlots[NUMBER_CONFIGURED_BIG_FILES];   // fileNum -> item + 1, 0 if not queued
+static SDL_Thread *bigPrefetchThread = NULL;
+static SDL_mutex *bigPrefetchLock = NULL;
+static SDL_cond *bigPrefetchWake = NULL;    // for the worker: room freed up, or stop
+static SDL_cond *bigPrefetchDone = NULL;    // for the loader: an item has been expanded
+static bigprefetchstats bigPrefetchStats;
+static volatile udword bigPrefetchTouchSum;
+
+static bool bigPrefetchTake(bigTOCFileEntry *entry, void *address);
+
+//  one slot of bigIndex: the bigfile and entry a name CRC resolves to
+typedef struct
+{
+    crc32 nameCRC1, nameCRC2;
+    udword bigFile;                 // index into bigFilePrecedence, BF_IndexEmpty if the slot is unused
+    udword fileNum;
+} bigIndexSlot;
+
+#define BF_IndexEmpty       0xffffffff
+#define BF_IndexMinSize     64
+
+//  every entry of every open bigfile that isn't overridden by a newer local
+//  file, open addressed on the name CRCs so bigFindFile probes one table
+//  instead of searching each TOC in turn
+static bigIndexSlot *bigIndex = NULL;
+static udword bigIndexMask  = 0;
+static udword bigIndexShift = 32;
+
+static udword bigIndexHash(crc32 nameCRC1, crc32 nameCRC2)
+{
+    return ((nameCRC1 ^ (nameCRC2 * 0x9e3779b9u)) * 2654435761u) >> bigIndexShift;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigIndexFind
+    Description : Finds the bigIndex slot for a pair of name CRCs
+    Inputs      : nameCRC1, nameCRC2
+    Outputs     :
+    Return      : the slot holding those CRCs, or the empty slot they belong in
+----------------------------------------------------------------------------*/
+static bigIndexSlot *bigIndexFind(crc32 nameCRC1, crc32 nameCRC2)
+{
+    udword slot = bigIndexHash(nameCRC1, nameCRC2);
+
+    while (bigIndex[slot].bigFile != BF_IndexEmpty &&
+           (bigIndex[slot].nameCRC1 != nameCRC1 || bigIndex[slot].nameCRC2 != nameCRC2))
+    {
+        slot = (slot + 1) & bigIndexMask;
+    }
+    return &bigIndex[slot];
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigIndexBuild
+    Description : (Re)builds bigIndex from the open bigfiles.  Bigfiles are
+                  added in order of precedence so the first to have a file
+                  keeps it, as the search in bigFindFile used to.
+    Inputs      :
+    Outputs     : bigIndex
+    Return      :
+----------------------------------------------------------------------------*/
+static void bigIndexBuild(void)
+{
+    udword bigfile_i, numEntries = 0, size = BF_IndexMinSize;
+    sdword f;
+    bigIndexSlot *slot;
+    bigTOCFileEntry *entry;
+
+    free(bigIndex);
+    bigIndex = NULL;
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        if (bigFilePrecedence[bigfile_i].filePtr != NULL)
+        {
+            numEntries += bigFilePrecedence[bigfile_i].tableOfContents.numFiles;
+        }
+    }
+    bigIndexShift = 32 - 6;
+    while (size < numEntries * 2)           // at most half full
+    {
+        size *= 2;
+        bigIndexShift--;
+    }
+
+    bigIndex = malloc(size * sizeof(bigIndexSlot));
+    if (bigIndex == NULL)
+    {
+        return;                             // bigFindFile searches the TOCs instead
+    }
+    memset(bigIndex, 0xff, size * sizeof(bigIndexSlot));
+    bigIndexMask = size - 1;
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        if (bigFilePrecedence[bigfile_i].filePtr == NULL)
+        {
+            continue;
+        }
+        for (f = 0; f < bigFilePrecedence[bigfile_i].tableOfContents.numFiles; ++f)
+        {
+            if (bigFilePrecedence[bigfile_i].localFileRelativeAge[f] == LOCAL_FILE_IS_NEWER)
+            {
+                continue;
+            }
+            entry = bigFilePrecedence[bigfile_i].tableOfContents.fileEntries + f;
+            slot = bigIndexFind(entry->nameCRC1, entry->nameCRC2);
+            if (slot->bigFile == BF_IndexEmpty)
+            {
+                slot->nameCRC1 = entry->nameCRC1;
+                slot->nameCRC2 = entry->nameCRC2;
+                slot->bigFile  = bigfile_i;
+                slot->fileNum  = f;
+            }
+        }
+    }
+
+    dbgMessagef("%8d bigfile entries indexed", numEntries);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigRefreshOverrides
+    Description : Rescans the override directory for local files newer than
+                  their bigfile copies and rebuilds the index to match.  For
+                  development, when files are dropped into the override
+                  directory while the game is running.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bigRefreshOverrides(void)
+{
+    udword bigfile_i;
+
+    if (bigIndex == NULL)
+    {
+        return;                             // not open yet
+    }
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        if (bigFilePrecedence[bigfile_i].filePtr != NULL)
+        {
+            memset(bigFilePrecedence[bigfile_i].localFileRelativeAge,
+                0, bigFilePrecedence[bigfile_i].tableOfContents.numFiles * sizeof(bigLocalFileAgeComparison));  // 0 = LOCAL_FILE_DOES_NOT_EXIST
+        }
+    }
+    bigFilesystemCompare(fileOverrideBigPath, "");
+    bigIndexBuild();
+}
+
+bool bigOpenAllBigFiles(void)
+{
+    udword bigfile_i = 0;
+    char bigFilePath[PATH_MAX] = "";
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        strcpy(bigFilePath,
+               filePathPrepend(bigFilePrecedence[bigfile_i].bigFileName, FF_HomeworldDataPath));
+        
+        if (!fileExists(bigFilePath, FF_IgnorePrepend))
+        {
+            if (bigFilePrecedence[bigfile_i].required)
+            {
+                dbgFatalf(DBG_Loc, "Unable to find required .big file: %s", bigFilePath);
+            }
+        }
+        
+        // can't fileOpen them because fileOpen wraps the .big archives themselves
+        bigFilePrecedence[bigfile_i].filePtr = fopen(bigFilePath, "rb");
+        
+        if (bigFilePrecedence[bigfile_i].filePtr == NULL)
+        {
+            if (bigFilePrecedence[bigfile_i].required)
+            {
+                dbgFatalf(DBG_Loc, "Unable to open required .big file: %s", filePathTempBuffer);
+            }
+            else
+            {
+                continue;
+            }
+        }
+
+        if (!bigHeaderVerify(bigFilePrecedence[bigfile_i].filePtr))
+        {
+            if (bigFilePrecedence[bigfile_i].required)
+            {
+                dbgFatalf(DBG_Loc, "Incompatible version for required .big file: %s", filePathTempBuffer);
+            }
+        }
+
+        if (bigFilePrecedence[bigfile_i].filePtr != NULL)
+        {
+            numOpenedBigFiles++;
+
+            bigTOCRead(bigFilePrecedence[bigfile_i].filePtr,
                       &bigFilePrecedence[bigfile_i].tableOfContents);
+
+            // uncompressed entries can then be used in place, see bigFileMapped
+            if (!fileMapReadOnly(bigFilePath, FF_IgnorePrepend | FF_MapOnly, &bigFileMaps[bigfile_i]))
+            {
+                dbgMessagef("Unable to map %s, entries will be copied",
+                    bigFilePrecedence[bigfile_i].bigFileName);
+            }
             
             dbgMessagef("%8d files found in %s",
                 bigFilePrecedence[bigfile_i].tableOfContents.numFiles,
                 bigFilePrecedence[bigfile_i].bigFileName);
         
             bigFilePrecedence[bigfile_i].localFileRelativeAge
-                = memAlloc(bigFilePrecedence[bigfile_i].tableOfContents.numFiles,
+                = memAlloc(bigFilePrecedence[bigfile_i].tableOfContents.numFiles * sizeof(bigLocalFileAgeComparison),
                            "bigLocalFileRelativeAge", 0);                   // 0 => no memAlloc flags
                            
             memset(bigFilePrecedence[bigfile_i].localFileRelativeAge,
-                0, bigFilePrecedence[bigfile_i].tableOfContents.numFiles);  // 0 = LOCAL_FILE_DOES_NOT_EXIST
+                0, bigFilePrecedence[bigfile_i].tableOfContents.numFiles * sizeof(bigLocalFileAgeComparison));  // 0 = LOCAL_FILE_DOES_NOT_EXIST
         }
     }
     
     bigFilesystemCompare(fileOverrideBigPath, "");
 
+    bigIndexBuild();
+
     return TRUE;
 }
 
@@ -2559,8 +3291,6 @@ sdword bigFileLoadAlloc(bigTOC *toc, FILE *bigFP, char *filename, udword fileNum
     sdword length;
     bigTOCFileEntry *entry;
     char *memoryName;
-    int expandedSize, storedSize;
-    BitFile *bitFile;
 
     if (IgnoreBigfiles)
     {
@@ -2589,20 +3319,7 @@ sdword bigFileLoadAlloc(bigTOC *toc, FILE *bigFP, char *filename, udword fileNum
         dbgFatalf(DBG_Loc, "bigFileLoadAlloc: couldn't allocate %d bytes for %s", length, filename);
     }
     
-    if (entry->compressionType)
-    {
-        // expand compressed file data directly into memory
-        bitFile = bitioFileInputStart(bigFP);
-        expandedSize = lzssExpandFileToBuffer(bitFile, *address, length);
-        storedSize = bitioFileInputStop(bitFile);
-        dbgAssertOrIgnore(expandedSize == length);
-        dbgAssertOrIgnore(storedSize == entry->storedLength);
-    }
-    else
-    {
-        // load uncompressed file data
-        fread(*address, 1, length, bigFP);
-    }
+    bigFileExpand(entry, bigFP, *address);
 
     return length;
 }
@@ -2616,8 +3333,6 @@ sdword bigFileLoad(bigTOC *toc, FILE *bigFP, udword fileNum, void *address)
 {
     sdword length;
     bigTOCFileEntry *entry;
-    int expandedSize, storedSize;
-    BitFile *bitFile;
 
     if (IgnoreBigfiles)
     {
@@ -2631,22 +3346,56 @@ sdword bigFileLoad(bigTOC *toc, FILE *bigFP, udword fileNum, void *address)
     length = entry->realLength;
     dbgAssertOrIgnore(length > 0);
 
-    if (entry->compressionType)
-    {
-        // expand compressed file data directly into memory
-        bitFile = bitioFileInputStart(bigFP);
-        expandedSize = lzssExpandFileToBuffer(bitFile, address, length);
-        storedSize = bitioFileInputStop(bitFile);
-        dbgAssertOrIgnore(expandedSize == length);
-        dbgAssertOrIgnore(storedSize == entry->storedLength);
+    bigFileExpand(entry, bigFP, address);
+
+    return length;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigFileExpand
+    Description : Read a bigfile entry into memory, expanding it with whichever
+                  codec it was stored with
+    Inputs      : entry - TOC entry to read
+                  bigFP - bigfile, positioned at the entry's data
+                  address - where to read to, entry->realLength bytes
+    Outputs     : address is filled in
+    Return      : number of bytes read
+----------------------------------------------------------------------------*/
+sdword bigFileExpand(bigTOCFileEntry *entry, FILE *bigFP, void *address)
+{
+    sdword expandedSize, storedSize;
+    BitFile *bitFile;
+
+    if (bigPrefetchTake(entry, address))
+    {                                                       //already expanded in the background
+        fseek(bigFP, entry->storedLength, SEEK_CUR);
+        return entry->realLength;
     }
-    else
+
+    switch (entry->compressionType)
     {
-        // load uncompressed file data
-        fread(address, 1, length, bigFP);
+        case BF_COMPRESSION_LZB:
+            // one read of the stored data then a memory to memory expand
+            expandedSize = bigExpandLZB(entry, bigFP, address);
+            dbgAssertOrIgnore(expandedSize == (sdword)entry->realLength);
+            break;
+
+        case BF_COMPRESSION_LZSS:
+            // expand compressed file data directly into memory
+            bitFile = bitioFileInputStart(bigFP);
+            expandedSize = lzssExpandFileToBuffer(bitFile, address, entry->realLength);
+            storedSize = bitioFileInputStop(bitFile);
+            dbgAssertOrIgnore(expandedSize == (sdword)entry->realLength);
+            dbgAssertOrIgnore(storedSize == (sdword)entry->storedLength);
+            break;
+
+        default:
+            // load uncompressed file data
+            expandedSize = fread(address, 1, entry->realLength, bigFP);
+            break;
     }
 
-    return length;
+    return expandedSize;
 }
 
 //
@@ -2846,11 +3595,49 @@ void bigFilesystemCompare(char *baseDirectory, char *directory)
 bool bigFindFile(char *filename, bigFileConfiguration **whereFound, udword *fileIndex)
 {
     udword bigfile_i = 0;
+    char filenamei[PATH_MAX];
+    uword nameLength, halfFilenameLength;
+    bigIndexSlot *slot, *found;
+    udword i;
     
     if (IgnoreBigfiles)
     {
         return FALSE;
     }
+
+    if (bigIndex != NULL)
+    {
+        if ((filename == NULL) || (filename[0] == 0))
+        {
+            return FALSE;
+        }
+
+        // same name massaging and CRCs as bigTOCFileExists, the shipped
+        // bigfiles' broken CRC first then the fixed one
+        for (i = 0; (filenamei[i] = tolower(filename[i])); i++) { }
+        filenameSlashMassage(filenamei, FALSE);
+        nameLength = strlen(filenamei);
+        halfFilenameLength = nameLength / 2;
+
+        found = bigIndexFind(crc32Compute((ubyte *)filenamei, halfFilenameLength),
+                             crc32Compute((ubyte *)filenamei + halfFilenameLength, halfFilenameLength));
+        if (nameLength & 1)
+        {
+            slot = bigIndexFind(crc32Compute((ubyte *)filenamei, halfFilenameLength),
+                                crc32Compute((ubyte *)filenamei + halfFilenameLength, nameLength - halfFilenameLength));
+            if (slot->bigFile < found->bigFile)
+            {
+                found = slot;               // the earlier bigfile wins, whichever CRC matched
+            }
+        }
+        if (found->bigFile == BF_IndexEmpty)
+        {
+            return FALSE;
+        }
+        *whereFound = &bigFilePrecedence[found->bigFile];
+        *fileIndex  = found->fileNum;
+        return TRUE;
+    }
     
     for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
     {
@@ -2874,13 +3661,506 @@ void bigCloseAllBigFiles(void)
 {
     udword bigfile_i = 0;
     
+    bigPrefetchStop(NULL);                                  //before its mappings go
+
     for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
     {
         if (bigFilePrecedence[bigfile_i].filePtr != NULL)
         {
             fclose(bigFilePrecedence[bigfile_i].filePtr);
         }
+        fileUnmap(&bigFileMaps[bigfile_i]);
+    }
+
+    free(bigIndex);
+    bigIndex = NULL;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigFileMapped
+    Description : Finds an entry's data in the bigfile mapping, if it is
+                  stored uncompressed and the bigfile could be mapped.  The
+                  data is read only and at any byte alignment.
+    Inputs      : whereFound, fileNum - entry, as returned by bigFindFile
+    Outputs     : length - size of the entry
+    Return      : pointer to the entry's data, or NULL if it has to be loaded
+----------------------------------------------------------------------------*/
+void *bigFileMapped(bigFileConfiguration *whereFound, udword fileNum, sdword *length)
+{
+    filemap *map = &bigFileMaps[whereFound - bigFilePrecedence];
+    bigTOCFileEntry *entry = whereFound->tableOfContents.fileEntries + fileNum;
+    udword start = entry->offset + entry->nameLength + 1;
+
+    if (IgnoreBigfiles || map->data == NULL || entry->compressionType != BF_COMPRESSION_NONE ||
+        entry->realLength == 0 || start > (udword)map->length ||
+        entry->realLength > (udword)map->length - start)
+    {
+        return NULL;
+    }
+
+    *length = entry->realLength;
+    return map->data + start;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigFileMapContains
+    Description : Tells if an address points into one of the bigfile mappings
+    Inputs      : address
+    Outputs     :
+    Return      : TRUE if it does, so the memory mustn't be freed
+----------------------------------------------------------------------------*/
+bool bigFileMapContains(void *address)
+{
+    udword bigfile_i;
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        if (bigFileMaps[bigfile_i].data != NULL &&
+            (ubyte *)address >= bigFileMaps[bigfile_i].data &&
+            (ubyte *)address < bigFileMaps[bigfile_i].data + bigFileMaps[bigfile_i].length)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchAdd
+    Description : Ask for a directory to be covered by the next prefetch.
+    Inputs      : pathPrefix - file name without extension, as the statics
+                  load them; "R1/Interceptor" covers R1/Interceptor.* and
+                  everything under R1/Interceptor/
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bigPrefetchAdd(char *pathPrefix)
+{
+    char *prefix;
+    udword i;
+
+    if (bigPrefetchNumPrefixes >= BP_MaxPrefixes)
+    {
+        return;
+    }
+
+    //  same case and slashes as the names stored in the bigfile
+    prefix = malloc(strlen(pathPrefix) + 1);
+    for (i = 0; pathPrefix[i]; i++)
+    {
+        prefix[i] = (pathPrefix[i] == '/') ? '\\' : tolower(pathPrefix[i]);
+    }
+    prefix[i] = '\0';
+
+    bigPrefetchPrefixes[bigPrefetchNumPrefixes++] = prefix;
+}
+
+//  queue order: statics before textures, then in the order the directories
+//  were added, then in bigfile order (which is load order, see LogFileLoads)
+static int bigPrefetchCompare(const void *p1, const void *p2)
+{
+    const bigprefetchitem *a = p1, *b = p2;
+    udword offsetA, offsetB;
+
+    if (a->late != b->late)
+    {
+        return a->late ? 1 : -1;
+    }
+    if (a->prefix != b->prefix)
+    {
+        return (a->prefix < b->prefix) ? -1 : 1;
+    }
+    if (a->bigFile != b->bigFile)
+    {
+        return (a->bigFile < b->bigFile) ? -1 : 1;
+    }
+    offsetA = bigFilePrecedence[a->bigFile].tableOfContents.fileEntries[a->fileNum].offset;
+    offsetB = bigFilePrecedence[b->bigFile].tableOfContents.fileEntries[b->fileNum].offset;
+    return (offsetA < offsetB) ? -1 : (offsetA > offsetB);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchExpand
+    Description : Worker side of the prefetch: expand one entry from the
+                  bigfile mapping, or just touch its pages if it is stored.
+                  Only reads the mapping and TOC, and allocates with malloc,
+                  so it is safe off the main thread.
+    Inputs      : item - entry to expand
+    Outputs     :
+    Return      : the expanded data, or NULL for stored (or corrupt) entries
+----------------------------------------------------------------------------*/
+static ubyte *bigPrefetchExpand(bigprefetchitem *item)
+{
+    bigTOCFileEntry *entry = bigFilePrecedence[item->bigFile].tableOfContents.fileEntries + item->fileNum;
+    ubyte *stored = bigFileMaps[item->bigFile].data + entry->offset + entry->nameLength + 1;
+    ubyte *data;
+    sdword expandedSize = -1;
+    udword i, sum = 0;
+
+    if (entry->compressionType == BF_COMPRESSION_NONE)
+    {
+        //  nothing to expand, but getting it off the disk now is most of the wait
+        for (i = 0; i < entry->realLength; i += BP_PageSize)
+        {
+            sum += stored[i];
+        }
+        bigPrefetchTouchSum += sum;
+        return NULL;
+    }
+
+    data = malloc(entry->realLength);
+    if (data != NULL)
+    {
+        if (entry->compressionType == BF_COMPRESSION_LZB)
+        {
+            expandedSize = lzbExpandBuffer((char *)stored, entry->storedLength, (char *)data, entry->realLength);
+        }
+        else
+        {
+            expandedSize = lzssExpandBuffer((char *)stored, entry->storedLength, (char *)data, entry->realLength);
+        }
+    }
+    if (expandedSize != (sdword)entry->realLength)
+    {
+        //  leave it to the loader, which will report it
+        free(data);
+        return NULL;
     }
+    return data;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchWorker
+    Description : Thread that works through the prefetch queue in order,
+                  staying no more than BP_MaxBytesAhead ahead of the loader.
+    Inputs      : data - unused
+    Outputs     :
+    Return      : 0
+----------------------------------------------------------------------------*/
+static int bigPrefetchWorker(void *data)
+{
+    bigprefetchitem *item;
+    bigTOCFileEntry *entry;
+    ubyte *expanded;
+    udword startTicks;
+
+    (void)data;
+    SDL_LockMutex(bigPrefetchLock);
+    while (!bigPrefetchQuit && bigPrefetchNext < bigPrefetchNumItems)
+    {
+        item = &bigPrefetchItems[bigPrefetchNext];
+        if (item->state != BP_Queued)
+        {                                                   //loader got there first
+            bigPrefetchNext++;
+            continue;
+        }
+        entry = bigFilePrecedence[item->bigFile].tableOfContents.fileEntries + item->fileNum;
+        if (entry->compressionType != BF_COMPRESSION_NONE && bigPrefetchBytesAhead > 0 &&
+            bigPrefetchBytesAhead + entry->realLength > BP_MaxBytesAhead)
+        {                                                   //wait for the loader to take some
+            SDL_CondWait(bigPrefetchWake, bigPrefetchLock);
+            continue;
+        }
+        bigPrefetchNext++;
+        item->state = BP_Working;
+        SDL_UnlockMutex(bigPrefetchLock);
+
+        startTicks = SDL_GetTicks();
+        expanded = bigPrefetchExpand(item);
+
+        SDL_LockMutex(bigPrefetchLock);
+        bigPrefetchStats.busyTicks += SDL_GetTicks() - startTicks;
+        item->data = expanded;
+        item->state = BP_Ready;
+        if (expanded != NULL)
+        {
+            bigPrefetchBytesAhead += entry->realLength;
+        }
+        SDL_CondBroadcast(bigPrefetchDone);
+    }
+    SDL_UnlockMutex(bigPrefetchLock);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchStart
+    Description : Queue every bigfile entry under the directories given to
+                  bigPrefetchAdd and start expanding them on a background
+                  thread.  Loads go on as before on the calling thread;
+                  bigFileExpand hands over anything already expanded, so the
+                  loader's fixups and uploads overlap the decompression.
+                  Entries overridden by a newer local file, or in a bigfile
+                  that couldn't be mapped, are left alone.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bigPrefetchStart(void)
+{
+    udword bigfile_i, fileNum, i, maxItems = 0;
+    bigTOC *toc;
+    bigTOCFileEntry *entry;
+    filemap *map;
+    bigIndexSlot *slot;
+    char name[BF_MAX_FILENAME_LENGTH + 1];
+    udword nameLength, prefixLength;
+
+    bigPrefetchStop(NULL);
+    memset(&bigPrefetchStats, 0, sizeof(bigPrefetchStats));
+
+    if (PrefetchBigfiles && !IgnoreBigfiles && bigIndex != NULL)
+    {
+        for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+        {
+            toc = &bigFilePrecedence[bigfile_i].tableOfContents;
+            map = &bigFileMaps[bigfile_i];
+            if (bigFilePrecedence[bigfile_i].filePtr == NULL || map->data == NULL)
+            {
+                continue;
+            }
+
+            for (fileNum = 0; fileNum < (udword)toc->numFiles; fileNum++)
+            {
+                entry = toc->fileEntries + fileNum;
+                nameLength = entry->nameLength;
+                if (nameLength > BF_MAX_FILENAME_LENGTH || entry->realLength == 0 ||
+                    entry->offset > (udword)map->length ||
+                    nameLength + 1 + entry->storedLength > (udword)map->length - entry->offset)
+                {
+                    continue;
+                }
+
+                slot = bigIndexFind(entry->nameCRC1, entry->nameCRC2);
+                if (slot->bigFile != bigfile_i || slot->fileNum != fileNum)
+                {                                           //overridden, or in an earlier bigfile
+                    continue;
+                }
+
+                memcpy(name, map->data + entry->offset, nameLength + 1);
+                bigFilenameDecrypt(name, nameLength);
+                for (i = 0; i < nameLength; i++)
+                {
+                    name[i] = tolower(name[i]);
+                }
+
+                for (i = 0; i < bigPrefetchNumPrefixes; i++)
+                {
+                    prefixLength = strlen(bigPrefetchPrefixes[i]);
+                    if (prefixLength < nameLength &&
+                        (name[prefixLength] == '\\' || name[prefixLength] == '.') &&
+                        !memcmp(name, bigPrefetchPrefixes[i], prefixLength))
+                    {
+                        break;
+                    }
+                }
+                if (i == bigPrefetchNumPrefixes)
+                {
+                    continue;
+                }
+
+                if (bigPrefetchNumItems == maxItems)
+                {
+                    maxItems = max(maxItems * 2, 256);
+                    bigPrefetchItems = realloc(bigPrefetchItems, maxItems * sizeof(bigprefetchitem));
+                }
+                bigPrefetchItems[bigPrefetchNumItems].bigFile = bigfile_i;
+                bigPrefetchItems[bigPrefetchNumItems].fileNum = fileNum;
+                bigPrefetchItems[bigPrefetchNumItems].prefix  = i;
+                bigPrefetchItems[bigPrefetchNumItems].late    =
+                    nameLength > strlen(BP_LateExtension) &&
+                    !strcmp(name + nameLength - strlen(BP_LateExtension), BP_LateExtension);
+                bigPrefetchItems[bigPrefetchNumItems].data    = NULL;
+                bigPrefetchItems[bigPrefetchNumItems].state   = BP_Queued;
+                bigPrefetchNumItems++;
+            }
+        }
+    }
+
+    for (i = 0; i < bigPrefetchNumPrefixes; i++)
+    {
+        free(bigPrefetchPrefixes[i]);
+    }
+    bigPrefetchNumPrefixes = 0;
+
+    if (bigPrefetchNumItems == 0)
+    {
+        free(bigPrefetchItems);
+        bigPrefetchItems = NULL;
+        return;
+    }
+
+    qsort(bigPrefetchItems, bigPrefetchNumItems, sizeof(bigprefetchitem), bigPrefetchCompare);
+    for (i = 0; i < bigPrefetchNumItems; i++)
+    {
+        bigfile_i = bigPrefetchItems[i].bigFile;
+        if (bigPrefetchSlots[bigfile_i] == NULL)
+        {
+            bigPrefetchSlots[bigfile_i] = calloc(bigFilePrecedence[bigfile_i].tableOfContents.numFiles, sizeof(udword));
+        }
+        bigPrefetchSlots[bigfile_i][bigPrefetchItems[i].fileNum] = i + 1;
+    }
+
+    bigPrefetchStats.queued = bigPrefetchNumItems;
+    bigPrefetchNext = 0;
+    bigPrefetchBytesAhead = 0;
+    bigPrefetchQuit = FALSE;
+    bigPrefetchLock = SDL_CreateMutex();
+    bigPrefetchWake = SDL_CreateCond();
+    bigPrefetchDone = SDL_CreateCond();
+    bigPrefetchThread = SDL_CreateThread(bigPrefetchWorker, "bigprefetch", NULL);
+    if (bigPrefetchThread == NULL)
+    {
+        dbgMessagef("bigPrefetchStart: couldn't start a thread, loading as requested");
+        bigPrefetchStop(NULL);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchTake
+    Description : Loader side of the prefetch, called by bigFileExpand.  If
+                  the entry has been (or is being) expanded in the background,
+                  wait for it and copy it out.
+    Inputs      : entry - TOC entry being loaded
+                  address - where it is going, entry->realLength bytes
+    Outputs     : address is filled in if TRUE is returned
+    Return      : TRUE if the entry came from the prefetch
+----------------------------------------------------------------------------*/
+static bool bigPrefetchTake(bigTOCFileEntry *entry, void *address)
+{
+    bigTOC *toc;
+    bigprefetchitem *item = NULL;
+    ubyte *data;
+    udword bigfile_i, startTicks;
+
+    if (bigPrefetchThread == NULL)
+    {
+        return FALSE;
+    }
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        toc = &bigFilePrecedence[bigfile_i].tableOfContents;
+        if (bigPrefetchSlots[bigfile_i] != NULL &&
+            entry >= toc->fileEntries && entry < toc->fileEntries + toc->numFiles)
+        {
+            if (bigPrefetchSlots[bigfile_i][entry - toc->fileEntries] != 0)
+            {
+                item = &bigPrefetchItems[bigPrefetchSlots[bigfile_i][entry - toc->fileEntries] - 1];
+            }
+            break;
+        }
+    }
+    if (item == NULL)
+    {
+        return FALSE;
+    }
+
+    SDL_LockMutex(bigPrefetchLock);
+    switch (item->state)
+    {
+        case BP_Queued:
+            bigPrefetchStats.missed++;
+            break;
+
+        case BP_Working:
+            startTicks = SDL_GetTicks();
+            while (item->state == BP_Working)
+            {
+                SDL_CondWait(bigPrefetchDone, bigPrefetchLock);
+            }
+            bigPrefetchStats.waitTicks += SDL_GetTicks() - startTicks;
+            bigPrefetchStats.waited++;
+            break;
+
+        case BP_Ready:
+            bigPrefetchStats.ahead++;
+            break;
+
+        default:                                            //loaded more than once
+            SDL_UnlockMutex(bigPrefetchLock);
+            return FALSE;
+    }
+    data = item->data;
+    item->data = NULL;
+    item->state = BP_Taken;
+    if (data != NULL)
+    {
+        bigPrefetchBytesAhead -= entry->realLength;
+        bigPrefetchStats.bytesExpanded += entry->realLength;
+        SDL_CondSignal(bigPrefetchWake);
+    }
+    SDL_UnlockMutex(bigPrefetchLock);
+
+    if (data == NULL)
+    {
+        return FALSE;
+    }
+    memcpy(address, data, entry->realLength);
+    free(data);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bigPrefetchStop
+    Description : Stop the prefetch started by bigPrefetchStart and free
+                  whatever the loader didn't ask for.  Call when the level
+                  has finished loading; safe to call when none is running.
+    Inputs      :
+    Outputs     : stats - if not NULL, how well the prefetch kept ahead
+    Return      : TRUE if there was a prefetch running
+----------------------------------------------------------------------------*/
+bool bigPrefetchStop(bigprefetchstats *stats)
+{
+    udword bigfile_i, i;
+
+    if (bigPrefetchThread == NULL && bigPrefetchItems == NULL)
+    {
+        if (stats != NULL)
+        {
+            memset(stats, 0, sizeof(*stats));
+        }
+        return FALSE;
+    }
+
+    if (bigPrefetchThread != NULL)
+    {
+        SDL_LockMutex(bigPrefetchLock);
+        bigPrefetchQuit = TRUE;
+        SDL_CondSignal(bigPrefetchWake);
+        SDL_UnlockMutex(bigPrefetchLock);
+        SDL_WaitThread(bigPrefetchThread, NULL);
+        bigPrefetchThread = NULL;
+    }
+    SDL_DestroyCond(bigPrefetchDone);
+    SDL_DestroyCond(bigPrefetchWake);
+    SDL_DestroyMutex(bigPrefetchLock);
+    bigPrefetchDone = bigPrefetchWake = NULL;
+    bigPrefetchLock = NULL;
+
+    for (i = 0; i < bigPrefetchNumItems; i++)
+    {
+        if (bigPrefetchItems[i].state != BP_Taken)
+        {
+            bigPrefetchStats.unused++;
+        }
+        free(bigPrefetchItems[i].data);
+    }
+    free(bigPrefetchItems);
+    bigPrefetchItems = NULL;
+    bigPrefetchNumItems = 0;
+
+    for (bigfile_i = 0; bigfile_i < NUMBER_CONFIGURED_BIG_FILES; ++bigfile_i)
+    {
+        free(bigPrefetchSlots[bigfile_i]);
+        bigPrefetchSlots[bigfile_i] = NULL;
+    }
+
+    if (stats != NULL)
+    {
+        *stats = bigPrefetchStats;
+    }
+    return TRUE;
 }
 
 //
@@ -62,11 +62,18 @@
 //  1.23    1998/11/23  Darren Stone
 //          Fixed fast-create sorting bug.
 // Gary changed interface of bigCRC function
+//          Added compressionType 2 (LZB), a byte oriented codec that expands
+//          several times faster than LZSS; -c2 selects it in biggie.  The
+//          header version is unchanged so existing bigfiles still open, but
+//          older readers can't expand LZB entries.
+//          Fast-create reads and compresses files on several threads (-j);
+//          LZSS no longer carries its window over from one file to the next,
+//          so a file compresses the same however the bigfile is built.
 
 // keep these strings the same length
 #define BF_VERSION     "1.23"   // increment this when the file format changes
 
-#define BIGGIE_VERSION "3.00"   // biggie: .BIG file extractor tool (see /tools)
+#define BIGGIE_VERSION "3.02"   // biggie: .BIG file extractor tool (see /tools)
 
 // some things don't get compiled into the command line tool
 #if defined(HW_BUILD_FOR_DEBUGGING) || defined(HW_BUILD_FOR_DISTRIBUTION) 
@@ -78,6 +85,11 @@
 #define BF_MAX_FILENAME_LENGTH 128
 #define BF_FLAG_TOC_SORTED       1
 
+// bigTOCFileEntry.compressionType, also the optCompression argument
+#define BF_COMPRESSION_NONE      0
+#define BF_COMPRESSION_LZSS      1   // bit stream LZSS, small but slow to expand
+#define BF_COMPRESSION_LZB       2   // byte oriented LZ77 blocks, fast to expand
+
 #define bigCRC64EQ(a, b)  (((a)->nameCRC1 == (b)->nameCRC1) && ((a)->nameCRC2 == (b)->nameCRC2))
 #define bigCRC64GT(a, b)  (((a)->nameCRC1 > (b)->nameCRC1) || ((a)->nameCRC1 == (b)->nameCRC1 && (a)->nameCRC2 > (b)->nameCRC2))
 #define bigCRC64LT(a, b)  (((a)->nameCRC1 < (b)->nameCRC1) || ((a)->nameCRC1 == (b)->nameCRC1 && (a)->nameCRC2 < (b)->nameCRC2))
@@ -98,7 +110,7 @@ typedef struct
     udword offset;
 //    time_t timeStamp;
     udword timeStamp;
-    char compressionType;  // 0/1
+    char compressionType;  // BF_COMPRESSION_XXX
 } bigTOCFileEntry;
 
 typedef struct {
@@ -136,12 +148,13 @@ enum {
 
 
 int bigAdd(char *bigfilename, int numFiles, char *filenames[], int optCompression, int optNewer, int optMove, int optPathnames, int consoleOutput);
-int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCompression, int optNewer, int optMove, int optPathnames, int consoleOutput);
+int bigFastCreate(char *bigfilename, int numFiles, char *filenames[], int optCompression, int optNewer, int optMove, int optPathnames, int optThreads, int consoleOutput);
 int bigPatch(char *oldfilename, char *newfilename, char *patchfilename, int consoleOutput);
 int bigAddFile(char *bigFilename, char *filename, char *storedFilename, int optCompression, int optNewer, int consoleOutput);
 int bigDelete(char *bigfilename, int numFiles, char *filenames[], int consoleOutput);
 int bigView(char *bigfilename, int consoleOutput);
 int bigExtract(char *bigfilename, int numFiles, char *filenames[], int optFreshen, int optMove, int optPathnames, int optOverwrite, int consoleOutput);
+int bigBenchmark(char *bigfilename, int consoleOutput);
 bool bigTOCFileExists(bigTOC *toc, char *filename, udword *fileNum);
 int bigTOCFileExistsByCRC(bigTOC *toc, bigTOCFileEntry *target, udword *fileNum);
 void bigTOCSort(bigTOC *toc);
@@ -151,15 +164,37 @@ crc32 bigTOCCRC(bigTOC *toc);
 
 // not used in command line utility, only in the game
 #ifdef BF_HOMEWORLD
+    //  what bigPrefetchStop reports about a level load
+    typedef struct
+    {
+        udword queued;              // entries under the directories asked for
+        udword ahead;               // expanded (or paged in) before the loader asked for them
+        udword waited;              // loader asked while they were being expanded
+        udword missed;              // loader asked before the worker got to them
+        udword unused;              // never asked for
+        udword bytesExpanded;       // expanded in the background and handed over
+        udword busyTicks;           // ms the worker spent expanding
+        udword waitTicks;           // ms the loader spent waiting on the worker
+    } bigprefetchstats;
+
     bool bigOpenAllBigFiles(void);
     void bigCloseAllBigFiles(void);
     
     void bigCRC(udword *bigCRCArray, udword arraySize);
     void bigFilesystemCompare(char *baseDirectory, char *directory);
+    void bigRefreshOverrides(void);
     bool bigFindFile(char *filename, bigFileConfiguration **whereFound, udword *fileIndex);
 
     sdword bigFileLoadAlloc(bigTOC *toc, FILE *bigFP, char *filename, udword fileNum, void **address);
     sdword bigFileLoad(bigTOC *toc, FILE *bigFP, udword fileNum, void *address);
+    sdword bigFileExpand(bigTOCFileEntry *entry, FILE *bigFP, void *address);
+
+    void *bigFileMapped(bigFileConfiguration *whereFound, udword fileNum, sdword *length);
+    bool bigFileMapContains(void *address);
+
+    void bigPrefetchAdd(char *pathPrefix);
+    void bigPrefetchStart(void);
+    bool bigPrefetchStop(bigprefetchstats *stats);
 #endif
 
 #endif
@@ -11,6 +11,7 @@
 
 #include "Alliance.h"
 #include "Battle.h"
+#include "CollGrid.h"
 #include "Debug.h"
 #include "FastMath.h"
 #include "Memory.h"
@@ -73,6 +74,8 @@ static BlobProperties *BlobPropertiesPtr;
 
 real32 bobUpdateRadiusThreshold = BOB_UpdateRadiusThreshold;
 real32 bobUpdateCentreThreshold = BOB_UpdateCentreThreshold;
+
+BobUpdateStats bobUpdateStats;
 //vector bobOriginVector = {0.0f, 0.0f, 0.0f};
 
 /*=============================================================================
@@ -83,6 +86,9 @@ real32 bobUpdateCentreThreshold = BOB_UpdateCentreThreshold;
 
 void blobFree(blob *thisBlob);
 void blobFreeContents(blob *thisBlob);
+void blobFreeCollisionLists(blob *thisBlob);
+static void bobAddBulletsAndMissiles(LinkedList *list);
+void bobBlobItemize(blob *thisBlob, sdword sensorsLevel);
 
 extern real32 SINGLEPLAYER_BOBBIGGESTRADIUS_LEVEL6;
 extern BlobProperties collBlobProperties;
@@ -798,6 +804,137 @@ void bobAllObjectsUnflagDontUpdate(blob *thisBlob)
     bitClear(thisBlob->flags, (BTF_ClearObjectFlags));//flag the blob
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : bobObjectMass
+    Description : Returns the mass an object contributes to a blob.
+    Inputs      : obj
+    Outputs     :
+    Return      : mass of obj (mines count as 0.1)
+----------------------------------------------------------------------------*/
+static real32 bobObjectMass(SpaceObj *obj)
+{
+    if (obj->objtype == OBJ_MissileType)
+    {                                                       //only mines stay in blobs
+        return 0.1f;
+    }
+    return obj->staticinfo->staticheader.mass;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bobBlobSplitMovedObjects
+    Description : Incremental blob update.  Objects which have moved out past
+                    the blob's radius (plus hysteresis) are split off to be
+                    re-blobbed from scratch; the rest stay put.  A blob which
+                    lost nothing is flagged just like bobAllObjectsFlagDontUpdate
+                    so it's not re-processed or re-merged with other unchanged
+                    blobs.
+    Inputs      : thisBlob - blob to check
+    Outputs     : Objects remaining in the blob are flagged SOF_DontCreateBlob
+    Return      : TRUE if the blob was kept, FALSE if it should be deleted
+----------------------------------------------------------------------------*/
+static bool bobBlobSplitMovedObjects(blob *thisBlob)
+{
+    SpaceObjSelection *blobObjects = thisBlob->blobObjects;
+    SpaceObj *obj;
+    sdword index, nKept, nSplit = 0;
+    real32 hysteresis, keepRadius, objRadius, newRadius, mass;
+    vector difference;
+
+    hysteresis = BlobPropertiesPtr->bobIncrementalHysteresis;
+    if (hysteresis <= 0.0f)
+    {
+        hysteresis = BOB_IncrementalHysteresis;
+    }
+    keepRadius = thisBlob->radius * (1.0f + hysteresis);
+
+    //first pass: see if anything has wandered off
+    for (index = 0; index < blobObjects->numSpaceObjs; index++)
+    {
+        obj = blobObjects->SpaceObjPtr[index];
+        if (obj->objtype == OBJ_BulletType ||
+            (obj->objtype == OBJ_MissileType && ((Missile *)obj)->missileType != MISSILE_Mine))
+        {                                                   //these are re-added to the blobs later
+            continue;
+        }
+        objRadius = bitTest(obj->flags, SOF_Impactable) ? obj->staticinfo->staticheader.staticCollInfo.collspheresize : 0.0f;
+        vecSub(difference, obj->posinfo.position, thisBlob->centre);
+        if (vecMagnitudeSquared(difference) > (keepRadius - objRadius) * (keepRadius - objRadius) || objRadius > keepRadius)
+        {
+            nSplit++;
+        }
+    }
+
+    if (nSplit == 0 && !bitTest(thisBlob->flags, BTF_RecentDeath))
+    {                                                       //nothing's changed, keep the blob as-is
+        bobAllObjectsFlagDontUpdate(thisBlob);
+        bobUpdateStats.blobsKept++;
+        return TRUE;
+    }
+
+    //second pass: drop the objects that left, as well as bullets and missiles
+    nKept = 0;
+    mass = 0.0f;
+    for (index = 0; index < blobObjects->numSpaceObjs; index++)
+    {
+        obj = blobObjects->SpaceObjPtr[index];
+        if (obj->objtype == OBJ_BulletType ||
+            (obj->objtype == OBJ_MissileType && ((Missile *)obj)->missileType != MISSILE_Mine))
+        {
+            continue;
+        }
+        objRadius = bitTest(obj->flags, SOF_Impactable) ? obj->staticinfo->staticheader.staticCollInfo.collspheresize : 0.0f;
+        vecSub(difference, obj->posinfo.position, thisBlob->centre);
+        if (vecMagnitudeSquared(difference) > (keepRadius - objRadius) * (keepRadius - objRadius) || objRadius > keepRadius)
+        {                                                   //left the blob, will get a new sphere of its own
+            obj->collMyBlob = NULL;
+            continue;
+        }
+        blobObjects->SpaceObjPtr[nKept++] = obj;
+        mass += bobObjectMass(obj);
+    }
+    blobObjects->numSpaceObjs = nKept;
+    bobUpdateStats.objectsSplit += nSplit;
+
+    if (nKept == 0)
+    {
+        bobUpdateStats.blobsDissolved++;
+        return FALSE;
+    }
+
+    bobObjectListMedian(&thisBlob->centre, &newRadius, nKept, blobObjects->SpaceObjPtr);
+    if (newRadius > BlobPropertiesPtr->bobBiggestRadius)
+    {                                                       //remaining objects have spread out too far, start over
+        bobUpdateStats.blobsDissolved++;
+        return FALSE;
+    }
+
+    for (index = 0; index < nKept; index++)
+    {
+        dbgAssertOrIgnore(!bitTest(blobObjects->SpaceObjPtr[index]->flags, SOF_DontCreateBlob));
+        bitSet(blobObjects->SpaceObjPtr[index]->flags, SOF_DontCreateBlob);
+    }
+
+    thisBlob->radius = newRadius;
+    thisBlob->volume = sphereVolume(newRadius);
+    thisBlob->oneOverVolume = 1.0f / thisBlob->volume;
+    thisBlob->totalMass = mass;
+    thisBlob->sortDistance = vecMagnitudeSquared(thisBlob->centre);
+    thisBlob->sqrtSortDistance = 0.0f;
+
+    //the type-specific lists are rebuilt by bobUpdateExtraCollBobInfo
+    blobFreeCollisionLists(thisBlob);
+    if (thisBlob->subBlobs.num != BIT31)
+    {
+        bobListDelete(&thisBlob->subBlobs);
+        thisBlob->subBlobs.num = BIT31;
+    }
+
+    bitClear(thisBlob->flags, BTF_DontUpdate | BTF_RecentDeath);
+    bitSet(thisBlob->flags, BTF_ClearObjectFlags);
+    bobUpdateStats.blobsSplit++;
+    return TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : bobAllBlobsFlagObjects
     Description : Flag all objects in specified blobs as satisfying the current
@@ -817,19 +954,26 @@ void bobAllBlobsFlagObjects(LinkedList *list)
         nextNode = node->next;
         thisBlob = (blob *)listGetStructOfNode(node);
 
-        if (bobAllObjectsSatisfyBlob(thisBlob))
+        if (BlobPropertiesPtr->bobIncremental)
+        {                                                   //keep whatever's still in the blob
+            if (bobBlobSplitMovedObjects(thisBlob))
+            {
+                continue;
+            }
+        }
+        else if (bobAllObjectsSatisfyBlob(thisBlob))
         {                                                   //if this blob works in it's present state
             bobAllObjectsFlagDontUpdate(thisBlob);
+            continue;
         }
-        else
-        {                                                   //this blob is no good, proceed to update it as usual
-            listRemoveNode(node);
-            if (thisBlob->subBlobs.num != BIT31)
-            {                                               //if there is a sub-blob list
-                bobListDelete(&thisBlob->subBlobs);
-            }
-            blobFree(thisBlob);
+
+        //this blob is no good, proceed to update it as usual
+        listRemoveNode(node);
+        if (thisBlob->subBlobs.num != BIT31)
+        {                                                   //if there is a sub-blob list
+            bobListDelete(&thisBlob->subBlobs);
         }
+        blobFree(thisBlob);
     }
 }
 
@@ -853,10 +997,10 @@ void bobListCreate(BlobProperties *blobProperties, LinkedList *list, udword play
     udword usePreallocBlob = 0;
     blob *tblob;
     Node *nextnode;
-    TargetPtr target;
 
     dbgAssertOrIgnore(blobProperties);
     BlobPropertiesPtr = blobProperties;
+    memset(&bobUpdateStats, 0, sizeof(bobUpdateStats));
     //listInit(list);                                         //init the linked list
     if (list->num > 0)
     {                                                       //if there are already blobs in the blob list
@@ -1010,6 +1154,23 @@ void bobListCreate(BlobProperties *blobProperties, LinkedList *list, udword play
     //next pass: do blob itemizing needed only for collisions
     bobUpdateExtraCollBobInfo(list);
 
+    bobAddBulletsAndMissiles(list);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bobAddBulletsAndMissiles
+    Description : Adds all bullets and missiles to the collision blobs of their
+                  targets, or the nearest blob if they have none.
+    Inputs      : list - freshly created collision blob list
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bobAddBulletsAndMissiles(LinkedList *list)
+{
+    SpaceObj *spaceobj;
+    Node *node;
+    TargetPtr target;
+
     //add bullets and missiles to the collision blobs of their targets
     // put in bullets/missiles to nearest blobs
 
@@ -1058,6 +1219,85 @@ void bobListCreate(BlobProperties *blobProperties, LinkedList *list, udword play
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : bobGridClusterCB
+    Description : cgridClustersCreate callback which makes a blob out of one
+                  cluster of grid cells.
+    Inputs      : objects, numObjects - the objects in the cluster
+    Outputs     : adds a new blob to bobGridList
+    Return      :
+----------------------------------------------------------------------------*/
+static LinkedList *bobGridList;
+
+static void bobGridClusterCB(SpaceObj **objects, sdword numObjects)
+{
+    blob *newBlob;
+    sdword index;
+    real32 mass = 0.0f;
+
+    newBlob = memAlloc(sizeof(blob),"nb(newblob)",Pyrophoric);
+    memset(newBlob, 0, sizeof(blob));
+    newBlob->flags = BTF_FreeThisBlob | BTF_FreeBlobObjects;
+
+    newBlob->blobObjects = memAlloc(sizeofSelectCommand(numObjects),"nbo(newblobobj)",Pyrophoric);
+    newBlob->blobObjects->numSpaceObjs = numObjects;
+    memcpy(newBlob->blobObjects->SpaceObjPtr, objects, numObjects * sizeof(SpaceObj *));
+    newBlob->subBlobs.num = BIT31;                          //flag the sub-blob list not yet created
+
+    for (index = 0; index < numObjects; index++)
+    {
+        mass += bobObjectMass(objects[index]);
+    }
+
+    bobObjectListMedian(&newBlob->centre, &newBlob->radius, numObjects, newBlob->blobObjects->SpaceObjPtr);
+    newBlob->volume = sphereVolume(newBlob->radius);
+    newBlob->oneOverVolume = 1.0f / newBlob->volume;
+    newBlob->totalMass = mass;
+    newBlob->sortDistance = vecMagnitudeSquared(newBlob->centre);
+    newBlob->sqrtSortDistance = fsqrt(newBlob->sortDistance);
+
+    listAddNode(bobGridList, &newBlob->node, newBlob);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bobListCreateFromGrid
+    Description : Re-creates a list of collision blobs from the clusters of the
+                  collision grid (see CollGrid.c) instead of merging spheres.
+                  Every blob is rebuilt, but the cost is linear in the number
+                  of objects.
+    Inputs      : blobProperties - same as for bobListCreate
+                  list - blob list to re-create
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bobListCreateFromGrid(BlobProperties *blobProperties, LinkedList *list)
+{
+    Node *node;
+    blob *thisBlob;
+
+    dbgAssertOrIgnore(blobProperties);
+    BlobPropertiesPtr = blobProperties;
+
+    bobListDelete(list);
+
+    bobGridList = list;
+    cgridClustersCreate(blobProperties->bobBiggestRadius, bobGridClusterCB);
+    bobGridList = NULL;
+
+    //same ordering bobListCreate leaves the blobs in
+    listMergeSortGeneral(list, bobListSortCallback);
+
+    for (node = list->head; node != NULL; node = node->next)
+    {
+        thisBlob = (blob *)listGetStructOfNode(node);
+        bobBlobItemize(thisBlob, universe.curPlayerPtr->sensorLevel);
+    }
+
+    bobUpdateExtraCollBobInfo(list);
+
+    bobAddBulletsAndMissiles(list);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : bobObjetListMedian
     Description : Compute the median of a set of objects (average of greates and lowest).
@@ -1355,6 +1595,7 @@ void bobListUpdate(LinkedList *list)
     real32 bobSqrtOverlapFactor = BlobPropertiesPtr->bobSqrtOverlapFactor;
     real32 bobDensityHigh = BlobPropertiesPtr->bobDensityHigh;
     real32 bobBiggestRadius = BlobPropertiesPtr->bobBiggestRadius;
+    bool bobIncremental = BlobPropertiesPtr->bobIncremental;
 
     real32 checkdist;
 
@@ -1397,6 +1638,12 @@ void bobListUpdate(LinkedList *list)
                     break;
                 }
 
+                if (bobIncremental && bitTest(thisBlob->flags & otherBlob->flags, BTF_DontUpdate))
+                {                                           //neither blob has changed since they were last compared
+                    bobUpdateStats.pairsSkipped++;
+                    goto nextnode;
+                }
+
                 radius = thisBlob->radius + otherBlob->radius;
                 checkradius = radius * bobSqrtOverlapFactor;
                 if (checkdist > checkradius)
@@ -1437,11 +1684,13 @@ void bobListUpdate(LinkedList *list)
                     if (newDensity > max(thisBlob->totalMass * thisBlob->oneOverVolume, otherBlob->totalMass * otherBlob->oneOverVolume))
                     {                                       //if new sphere is denser than the greater of the two spheres
                         otherNode = bobBlobCombine(thisBlob, otherBlob, newRadius, newVolume);
+                        bobUpdateStats.combines++;
                         nHits++;
                     }
                     else if (newDensity > bobDensityHigh && newRadius < bobBiggestRadius)
                     {                                       //if combination will increase density
                         otherNode = bobBlobCombine(thisBlob, otherBlob, newRadius, newVolume);
+                        bobUpdateStats.combines++;
                         nHits++;
                     }
                     else
@@ -1509,6 +1758,39 @@ void blobFreeContents(blob *thisBlob)
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : blobFreeCollisionLists
+    Description : frees the collision-specific object lists of a blob, leaving
+                    the main object list alone
+    Inputs      : thisBlob
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void blobFreeCollisionLists(blob *thisBlob)
+{
+    if (thisBlob->blobShips != NULL) memFree(thisBlob->blobShips);
+    if (thisBlob->blobBigShips != NULL) memFree(thisBlob->blobBigShips);
+    if (thisBlob->blobSmallShips != NULL) memFree(thisBlob->blobSmallShips);
+    if (thisBlob->blobSmallTargets != NULL) memFree(thisBlob->blobSmallTargets);
+    if (thisBlob->blobBigTargets != NULL) memFree(thisBlob->blobBigTargets);
+    if (thisBlob->blobResources != NULL) memFree(thisBlob->blobResources);
+    if (thisBlob->blobDerelicts != NULL) memFree(thisBlob->blobDerelicts);
+    if (thisBlob->blobBullets != NULL) memFree(thisBlob->blobBullets);
+    if (thisBlob->blobMissileMissiles != NULL) memFree(thisBlob->blobMissileMissiles);
+    if (thisBlob->blobMissileMines != NULL) memFree(thisBlob->blobMissileMines);
+
+    thisBlob->blobShips = NULL;
+    thisBlob->blobBigShips = NULL;
+    thisBlob->blobSmallShips = NULL;
+    thisBlob->blobSmallTargets = NULL;
+    thisBlob->blobBigTargets = NULL;
+    thisBlob->blobResources = NULL;
+    thisBlob->blobDerelicts = NULL;
+    thisBlob->blobBullets = NULL;
+    thisBlob->blobMissileMissiles = NULL;
+    thisBlob->blobMissileMines = NULL;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : blobFree
     Description : frees a blob
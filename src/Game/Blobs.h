@@ -61,6 +61,7 @@
 
 #define BOB_UpdateRadiusThreshold   1.00f       //can grow by 2%
 #define BOB_UpdateCentreThreshold   0.10f       //can move by 10% of radius
+#define BOB_IncrementalHysteresis   0.10f       //objects can stray 10% past the radius before leaving a blob
 
 /*=============================================================================
     Type definitions:
@@ -146,8 +147,21 @@ typedef struct BlobProperties
     real32 bobOverlapFactor;
     real32 bobSqrtOverlapFactor;
     real32 bobRadiusCombineMargin;
+    bool bobIncremental;                        //keep blobs between updates, only splitting off objects which left
+    real32 bobIncrementalHysteresis;            //fraction of radius objects can stray past (0 = BOB_IncrementalHysteresis)
 } BlobProperties;
 
+//counts for the most recent bobListCreate
+typedef struct BobUpdateStats
+{
+    sdword blobsKept;                           //blobs carried over untouched
+    sdword blobsSplit;                          //blobs which lost objects but were kept
+    sdword blobsDissolved;                      //blobs thrown away and re-merged from scratch
+    sdword objectsSplit;                        //objects which left their blob
+    sdword pairsSkipped;                        //merge checks avoided between unchanged blobs
+    sdword combines;                            //merges actually done
+} BobUpdateStats;
+
 typedef bool (*subblobcallback)(blob *superblob, SpaceObj *obj);
 
 /*=============================================================================
@@ -165,6 +179,7 @@ typedef bool (*subblobcallback)(blob *superblob, SpaceObj *obj);
 =============================================================================*/
 
 void bobListCreate(BlobProperties *blobProperties, LinkedList *list, udword playerIndex);
+void bobListCreateFromGrid(BlobProperties *blobProperties, LinkedList *list);
 void bobSubBlobListCreate(BlobProperties *blobProperties, LinkedList *list, blob *superBlob, subblobcallback criteria);
 void bobListUpdate(LinkedList *list);
 void bobListDelete(LinkedList *list);
@@ -185,6 +200,8 @@ void bobObjectListMedian(vector *dest, real32 *destRadius, sdword nObjects, Spac
 void bobInitProperties();
 void bobResetProperties();
 
+extern BobUpdateStats bobUpdateStats;
+
 #if BOB_STATS
 typedef struct BobStats
 {
@@ -0,0 +1,419 @@
+// =============================================================================
+//  BulletStore.c
+//  - structure-of-arrays staging for bullet integration and hit tests
+// =============================================================================
+//
+//  Bullets stay ordinary SpaceObjs on universe.BulletList, so everything that
+//  holds a Bullet * keeps working.  For the two hot loops they're staged into
+//  contiguous arrays first:
+//
+//  - univUpdateAllPosVelBullets gathers plain projectile bullets BST_BATCH at
+//    a time, integrates the whole batch with SSE and writes the results back.
+//    The batch is small enough that the bullets are still in cache for the
+//    write back.
+//
+//  - collCheckBulletTargetColl gathers the collision spheres of a blob's
+//    target lists once, then tests each bullet's travel segment against four
+//    targets at a time before falling back to the per-target checks.
+//
+//  Both kernels do the same single precision operations in the same order as
+//  the scalar code they replace, so results are unchanged.
+// =============================================================================
+
+#include "BulletStore.h"
+
+#include <string.h>
+
+#if BST_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "Debug.h"
+#include "FastMath.h"
+#include "Memory.h"
+#include "Physics.h"
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+static BulletStore bstBatch;
+
+BulletTargetStore bstSmallTargets;
+BulletTargetStore bstBigTargets;
+
+#if BST_STATS
+BSTStats bstStats;
+#define bstStatsAdd(field, n)   (bstStats.field += (n))
+#else
+#define bstStatsAdd(field, n)
+#endif
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : bstBulletBatchable
+    Description : Returns TRUE if the bullet just travels in a straight line
+                  and can be integrated in a batch.
+    Inputs      : bullet
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static bool bstBulletBatchable(Bullet *bullet)
+{
+    return ((bullet->flags & SOF_DontApplyPhysics) == 0 &&
+            bullet->bulletType != BULLET_Beam &&
+            bullet->bulletType != BULLET_Laser);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstBatchIntegrate
+    Description : x = x + vt, timelived += t for the staged bullets
+    Inputs      : store, phystimeelapsed
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bstBatchIntegrate(BulletStore *store, real32 phystimeelapsed)
+{
+    sdword i = 0;
+    sdword num = store->numBullets;
+
+#if BST_USE_SSE
+    __m128 dt = _mm_set1_ps(phystimeelapsed);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        _mm_storeu_ps(&store->posx[i], _mm_add_ps(_mm_loadu_ps(&store->posx[i]), _mm_mul_ps(_mm_loadu_ps(&store->velx[i]), dt)));
+        _mm_storeu_ps(&store->posy[i], _mm_add_ps(_mm_loadu_ps(&store->posy[i]), _mm_mul_ps(_mm_loadu_ps(&store->vely[i]), dt)));
+        _mm_storeu_ps(&store->posz[i], _mm_add_ps(_mm_loadu_ps(&store->posz[i]), _mm_mul_ps(_mm_loadu_ps(&store->velz[i]), dt)));
+        _mm_storeu_ps(&store->timelived[i], _mm_add_ps(_mm_loadu_ps(&store->timelived[i]), dt));
+    }
+#endif
+
+    for (; i < num; i++)
+    {
+        store->posx[i] += store->velx[i] * phystimeelapsed;
+        store->posy[i] += store->vely[i] * phystimeelapsed;
+        store->posz[i] += store->velz[i] * phystimeelapsed;
+        store->timelived[i] += phystimeelapsed;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstBatchFill
+    Description : Stages and integrates the next BST_BATCH batchable bullets
+                  starting at bulletnode.
+    Inputs      : bulletnode - node of the first bullet to stage
+                  phystimeelapsed - time step
+    Outputs     : positions and timelived of the staged bullets are updated
+    Return      :
+----------------------------------------------------------------------------*/
+static void bstBatchFill(Node *bulletnode, real32 phystimeelapsed)
+{
+    BulletStore *store = &bstBatch;
+    Bullet *bullet;
+    sdword i;
+
+    store->numBullets = 0;
+    store->cursor = 0;
+
+    while (bulletnode != NULL && store->numBullets < BST_BATCH)
+    {
+        bullet = (Bullet *)listGetStructOfNode(bulletnode);
+        bulletnode = bulletnode->next;
+
+        if (!bstBulletBatchable(bullet))
+        {
+            continue;
+        }
+        i = store->numBullets++;
+        store->bullet[i] = bullet;
+        store->posx[i] = bullet->posinfo.position.x;
+        store->posy[i] = bullet->posinfo.position.y;
+        store->posz[i] = bullet->posinfo.position.z;
+        store->velx[i] = bullet->posinfo.velocity.x;
+        store->vely[i] = bullet->posinfo.velocity.y;
+        store->velz[i] = bullet->posinfo.velocity.z;
+        store->timelived[i] = bullet->timelived;
+    }
+
+    bstBatchIntegrate(store, phystimeelapsed);
+
+    for (i = 0; i < store->numBullets; i++)
+    {
+        bullet = store->bullet[i];
+        bullet->posinfo.position.x = store->posx[i];
+        bullet->posinfo.position.y = store->posy[i];
+        bullet->posinfo.position.z = store->posz[i];
+        bullet->timelived = store->timelived[i];
+        SET_MOVING_LINEARLY(bullet->posinfo.isMoving);
+    }
+
+    bstStatsAdd(numBatches, 1);
+    bstStatsAdd(numIntegrated, store->numBullets);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstTargetsGrow
+    Description : Makes sure the target store can hold numTargets targets,
+                  rounded up so the 4-wide tests can read past the end.
+    Inputs      : store, numTargets
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bstTargetsGrow(BulletTargetStore *store, sdword numTargets)
+{
+    sdword maxTargets;
+
+    if (numTargets + 4 <= store->maxTargets)
+    {
+        return;
+    }
+
+    maxTargets = (numTargets + 4 + BST_TARGET_BATCH - 1) & ~(BST_TARGET_BATCH - 1);
+    store->optimizeDist = memRealloc(store->optimizeDist, maxTargets * sizeof(real32), "bstOptimizeDist", NonVolatile);
+    store->posx = memRealloc(store->posx, maxTargets * sizeof(real32), "bstTargetPosX", NonVolatile);
+    store->posy = memRealloc(store->posy, maxTargets * sizeof(real32), "bstTargetPosY", NonVolatile);
+    store->posz = memRealloc(store->posz, maxTargets * sizeof(real32), "bstTargetPosZ", NonVolatile);
+    store->collSize = memRealloc(store->collSize, maxTargets * sizeof(real32), "bstTargetSize", NonVolatile);
+    store->collSizeSqr = memRealloc(store->collSizeSqr, maxTargets * sizeof(real32), "bstTargetSizeSqr", NonVolatile);
+    store->special = memRealloc(store->special, maxTargets * sizeof(ubyte), "bstTargetSpecial", NonVolatile);
+    store->maxTargets = maxTargets;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstTargetsFree
+    Description : Frees the arrays of a target store
+    Inputs      : store
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void bstTargetsFree(BulletTargetStore *store)
+{
+    if (store->maxTargets != 0)
+    {
+        memFree(store->optimizeDist);
+        memFree(store->posx);
+        memFree(store->posy);
+        memFree(store->posz);
+        memFree(store->collSize);
+        memFree(store->collSizeSqr);
+        memFree(store->special);
+    }
+    memset(store, 0, sizeof(BulletTargetStore));
+}
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : bstShutdown
+    Description : Frees all memory used by the bullet store
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bstShutdown(void)
+{
+    bstTargetsFree(&bstSmallTargets);
+    bstTargetsFree(&bstBigTargets);
+    bstBatch.numBullets = 0;
+    bstBatch.cursor = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstBeginUpdate
+    Description : Call before walking the bullet list with
+                  bstUpdateBulletPosVel.  Forgets the previous batch, whose
+                  bullets may have been freed since.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bstBeginUpdate(void)
+{
+    bstBatch.numBullets = 0;
+    bstBatch.cursor = 0;
+#if BST_STATS
+    bstStats.numBatches = 0;
+    bstStats.numIntegrated = 0;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstUpdateBulletPosVel
+    Description : Drop-in for physUpdateBulletPosVel while walking
+                  universe.BulletList in order.  Plain projectiles are
+                  integrated a batch at a time; beams and lasers go through
+                  physUpdateBulletPosVel as before.
+    Inputs      : bullet - bullet to update
+                  bulletnode - its node in universe.BulletList
+                  phystimeelapsed - time step
+    Outputs     :
+    Return      : TRUE if the bullet has expired
+----------------------------------------------------------------------------*/
+bool bstUpdateBulletPosVel(Bullet *bullet, Node *bulletnode, real32 phystimeelapsed)
+{
+    BulletStore *store = &bstBatch;
+
+    if (!bstBulletBatchable(bullet))
+    {
+        return physUpdateBulletPosVel(bullet, phystimeelapsed);
+    }
+
+    //bullets are staged in list order, skip any that were deleted since
+    while (store->cursor < store->numBullets && store->bullet[store->cursor] != bullet)
+    {
+        store->cursor++;
+    }
+    if (store->cursor >= store->numBullets)
+    {                                                       //ran off the end of the batch
+        bstBatchFill(bulletnode, phystimeelapsed);
+        dbgAssertOrIgnore(store->numBullets > 0 && store->bullet[0] == bullet);
+    }
+    store->cursor++;
+
+    return (bullet->timelived > bullet->totallifetime);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstTargetsGather
+    Description : Copies the collision spheres of a blob target list into a
+                  target store, keeping the list's order.
+    Inputs      : store - where to put them
+                  targets - blobSmallTargets or blobBigTargets
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bstTargetsGather(BulletTargetStore *store, SelectAnyCommand *targets)
+{
+    sdword i, numTargets = targets->numTargets;
+    SpaceObjRotImpTarg *target;
+    StaticCollInfo *collInfo;
+
+    bstTargetsGrow(store, numTargets);
+    store->numTargets = numTargets;
+
+    for (i = 0; i < numTargets; i++)
+    {
+        target = targets->TargetPtr[i];
+        collInfo = &target->staticinfo->staticheader.staticCollInfo;
+
+        store->optimizeDist[i] = target->collOptimizeDist;
+        store->posx[i] = target->collInfo.collPosition.x;
+        store->posy[i] = target->collInfo.collPosition.y;
+        store->posz[i] = target->collInfo.collPosition.z;
+        store->collSize[i] = collInfo->collspheresize;
+        store->collSizeSqr[i] = collInfo->collspheresizeSqr;
+        store->special[i] = (ubyte)(target->objtype == OBJ_ShipType &&
+                                    (((Ship *)target)->shiptype == DFGFrigate || ((Ship *)target)->shiptype == DefenseFighter));
+    }
+
+    //pad so the last group of four reads harmless values
+    for (; i < numTargets + 4 && i < store->maxTargets; i++)
+    {
+        store->optimizeDist[i] = 0.0f;
+        store->posx[i] = store->posy[i] = store->posz[i] = 0.0f;
+        store->collSize[i] = store->collSizeSqr[i] = 0.0f;
+        store->special[i] = FALSE;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstTargetsRefresh
+    Description : Re-gathers a target store if targets have been removed from
+                  its list since it was gathered.  A hit can kill its target,
+                  and bobObjectDied takes it out of the blob's target lists
+                  straight away, which would leave the store out of step with
+                  TargetPtr[].
+    Inputs      : store - store gathered from targets
+                  targets - blobSmallTargets or blobBigTargets
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void bstTargetsRefresh(BulletTargetStore *store, SelectAnyCommand *targets)
+{
+    if (store->numTargets != targets->numTargets)
+    {
+        bstTargetsGather(store, targets);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : bstSegmentSphereTest4
+    Description : Line-sphere test of the bullet's travel this frame against
+                  targets first..first+3, the same test collCheckBulletTargetColl
+                  does one target at a time.
+    Inputs      : store - targets, from bstTargetsGather
+                  first - index of the first target (a multiple of 4)
+                  bullet - bullet to test
+    Outputs     :
+    Return      : bit n set if target first+n may be hit
+----------------------------------------------------------------------------*/
+udword bstSegmentSphereTest4(BulletTargetStore *store, sdword first, Bullet *bullet)
+{
+    udword mask = 0;
+    sdword num;
+
+    dbgAssertOrIgnore((first & 3) == 0);
+    dbgAssertOrIgnore(first + 4 <= store->maxTargets);
+
+    num = store->numTargets - first;
+    if (num > 4)
+    {
+        num = 4;
+    }
+
+#if BST_USE_SSE
+    {
+        __m128 dx, dy, dz, distsq, v, dsqr, zero;
+
+        dx = _mm_sub_ps(_mm_loadu_ps(&store->posx[first]), _mm_set1_ps(bullet->posinfo.position.x));
+        dy = _mm_sub_ps(_mm_loadu_ps(&store->posy[first]), _mm_set1_ps(bullet->posinfo.position.y));
+        dz = _mm_sub_ps(_mm_loadu_ps(&store->posz[first]), _mm_set1_ps(bullet->posinfo.position.z));
+
+        distsq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(bullet->bulletheading.x)),
+                                  _mm_mul_ps(dy, _mm_set1_ps(bullet->bulletheading.y))),
+                                  _mm_mul_ps(dz, _mm_set1_ps(bullet->bulletheading.z)));
+
+        dsqr = _mm_sub_ps(_mm_loadu_ps(&store->collSizeSqr[first]), _mm_sub_ps(distsq, _mm_mul_ps(v, v)));
+
+        zero = _mm_setzero_ps();
+        mask = (udword)_mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(dsqr, zero),
+                                                  _mm_cmplt_ps(_mm_sub_ps(v, _mm_sqrt_ps(_mm_max_ps(dsqr, zero))),
+                                                               _mm_set1_ps(bullet->traveldist))));
+        mask &= (1 << num) - 1;
+    }
+#else
+    sdword i;
+
+    for (i = 0; i < num; i++)
+    {
+        vector distvector;
+        real32 distsquared, v, dsqr;
+
+        distvector.x = store->posx[first + i] - bullet->posinfo.position.x;
+        distvector.y = store->posy[first + i] - bullet->posinfo.position.y;
+        distvector.z = store->posz[first + i] - bullet->posinfo.position.z;
+        distsquared = vecMagnitudeSquared(distvector);
+        v = vecDotProduct(distvector, bullet->bulletheading);
+
+        dsqr = store->collSizeSqr[first + i] - (distsquared - (v*v));
+        if (dsqr > 0 && (v - fsqrt(dsqr)) < bullet->traveldist)
+        {
+            mask |= 1 << i;
+        }
+    }
+#endif
+
+#if BST_STATS
+    bstStats.numSphereTests++;
+    bstStats.numSphereHits += ((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+#endif
+
+    return mask;
+}
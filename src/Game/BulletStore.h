@@ -0,0 +1,95 @@
+// =============================================================================
+//  BulletStore.h
+//  - structure-of-arrays staging for bullet integration and hit tests
+// =============================================================================
+
+#ifndef ___BULLETSTORE_H
+#define ___BULLETSTORE_H
+
+#include "LinkedList.h"
+#include "ShipSelect.h"
+#include "SpaceObj.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BST_USE_SSE                 1
+#else
+#define BST_USE_SSE                 0
+#endif
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define BST_STATS                   1
+#else
+#define BST_STATS                   0
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define BST_BATCH                   256         // bullets staged at a time, small enough to stay in cache
+#define BST_TARGET_BATCH            64          // granularity the target arrays grow by
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+// kinematic state of a batch of bullets, handles point back at the Bullet
+typedef struct BulletStore
+{
+    sdword numBullets;
+    sdword cursor;                              // next handle to match
+    Bullet *bullet[BST_BATCH];
+    real32 posx[BST_BATCH], posy[BST_BATCH], posz[BST_BATCH];
+    real32 velx[BST_BATCH], vely[BST_BATCH], velz[BST_BATCH];
+    real32 timelived[BST_BATCH];
+} BulletStore;
+
+// collision state of a blob's small or big target list
+typedef struct BulletTargetStore
+{
+    sdword numTargets;
+    sdword maxTargets;
+    real32 *optimizeDist;                       // collOptimizeDist, sorted ascending
+    real32 *posx, *posy, *posz;                 // collInfo.collPosition
+    real32 *collSize;                           // collspheresize
+    real32 *collSizeSqr;                        // collspheresizeSqr
+    ubyte *special;                             // TRUE for ships which react to nearby bullets
+} BulletTargetStore;
+
+#if BST_STATS
+typedef struct BSTStats
+{
+    sdword numBatches;                          // batches integrated this frame
+    sdword numIntegrated;                       // bullets integrated in batches
+    sdword numSphereTests;                      // 4-wide sphere tests run
+    sdword numSphereHits;                       // targets passing the sphere test
+} BSTStats;
+
+extern BSTStats bstStats;
+#endif
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+extern BulletTargetStore bstSmallTargets;
+extern BulletTargetStore bstBigTargets;
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void bstShutdown(void);
+
+void bstBeginUpdate(void);
+bool bstUpdateBulletPosVel(Bullet *bullet, Node *bulletnode, real32 phystimeelapsed);
+
+void bstTargetsGather(BulletTargetStore *store, SelectAnyCommand *targets);
+void bstTargetsRefresh(BulletTargetStore *store, SelectAnyCommand *targets);
+udword bstSegmentSphereTest4(BulletTargetStore *store, sdword first, Bullet *bullet);
+
+#endif
@@ -0,0 +1,910 @@
+// =============================================================================
+//  CollGrid.c
+//  - sparse uniform grid broadphase for the collision blobs
+//
+//  Every object which can go into a collision blob keeps an entry in a sparse
+//  grid of cells, updated as the object moves in univUpdateAllPosVel*.  Most
+//  frames an object stays within the cells it already overlaps, so keeping the
+//  grid current costs a lookup and a compare per object.  When the collision
+//  blobs are refreshed, connected runs of occupied cells are handed out as
+//  clusters, which replaces the pairwise sphere merging in bobListUpdate.
+//  Bump collisions are only checked within a blob, so clusters whose objects
+//  overlap across a seam are joined before they are handed out.
+// =============================================================================
+
+#include "CollGrid.h"
+
+#include <string.h>
+
+#include "Debug.h"
+#include "Memory.h"
+#include "Tweak.h"
+#include "Universe.h"
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+#if CGRID_STATS
+CGridStats cgridStats;
+#define cgridStatsMoved()           cgridStats.numMoved++
+#define cgridStatsUnchanged()       cgridStats.numUnchanged++
+#define cgridStatsCluster()         cgridStats.numClusters++
+#else
+#define cgridStatsMoved()
+#define cgridStatsUnchanged()
+#define cgridStatsCluster()
+#endif
+
+#define CGRID_CELL_BATCH            8           // entries added to a cell at a time
+#define CGRID_ENTRYTABLE_MIN        1024        // minimum size of the object lookup table
+
+// one connected run of cells found by cgridClustersCreate
+typedef struct cgridcluster
+{
+    sdword first;                               // first object in cgridClusterObjs
+    sdword numObjs;
+    sdword root;                                // lowest numbered cluster this one is joined with
+    sdword numJoined;                           // objects in all the clusters joined to a root
+    sdword nextJoined;                          // where the next joined object goes in cgridJoinedObjs
+} cgridcluster;
+
+// occupied cells, hashed on their coordinates
+static cgridcell *cgridHash[CGRID_HASH_SIZE];
+static cgridcell *cgridFreeCells = NULL;
+static sdword cgridNumCells = 0;
+
+// object -> entry lookup, open addressed on the object pointer.  Only used to
+// find entries; nothing ever walks this table so pointer values can't affect
+// the (deterministic) order of the clusters.
+static cgridentry **cgridEntryTable = NULL;
+static sdword cgridEntryTableSize = 0;
+static sdword cgridNumEntries = 0;
+static sdword cgridNumClamped = 0;              // entries with clamped set
+
+// scratch space for building clusters
+static cgridcell **cgridQueue = NULL;
+static sdword cgridQueueMax = 0;
+static SpaceObj **cgridClusterObjs = NULL;
+static SpaceObj **cgridJoinedObjs = NULL;
+static sdword cgridClusterObjsMax = 0;
+static cgridcluster *cgridClusters = NULL;
+static udword cgridVisitStamp = 0;
+
+static bool cgridNeedsSync = TRUE;
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+#define cgridCellHash(x,y,z)        ((((udword)(x) * 73856093u) ^ ((udword)(y) * 19349663u) ^ ((udword)(z) * 83492791u)) & (CGRID_HASH_SIZE - 1))
+#define cgridPointerHash(p)         ((udword)(((memsize)(p)) >> 4) * 2654435761u)
+
+static sdword cgridCoord(real32 val, real32 oneOverCellSize)
+{
+    real32 scaled = val * oneOverCellSize;
+    sdword coord = (sdword)scaled;
+
+    if ((real32)coord > scaled)
+    {                                                       //round towards negative infinity
+        coord--;
+    }
+    return coord;
+}
+
+static real32 cgridObjectRadius(SpaceObj *obj)
+{
+    if (bitTest(obj->flags, SOF_Impactable))
+    {
+        return obj->staticinfo->staticheader.staticCollInfo.collspheresize;
+    }
+    return 0.0f;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridObjectRange
+    Description : Computes the range of cells overlapped by an object's
+                  collision sphere.
+    Inputs      : obj
+    Outputs     : range - min/max cell coordinates and clamped filled in
+    Return      :
+----------------------------------------------------------------------------*/
+static void cgridObjectRange(SpaceObj *obj, cgridentry *range)
+{
+    real32 oneOverCellSize = 1.0f / COLLGRID_CELL_SIZE;
+    real32 radius = cgridObjectRadius(obj);
+    vector *pos = &obj->posinfo.position;
+
+    range->minx = cgridCoord(pos->x - radius, oneOverCellSize);
+    range->miny = cgridCoord(pos->y - radius, oneOverCellSize);
+    range->minz = cgridCoord(pos->z - radius, oneOverCellSize);
+    range->maxx = cgridCoord(pos->x + radius, oneOverCellSize);
+    range->maxy = cgridCoord(pos->y + radius, oneOverCellSize);
+    range->maxz = cgridCoord(pos->z + radius, oneOverCellSize);
+
+    // really big objects only occupy the cells nearest their minimum corner
+    range->clamped = (range->maxx - range->minx >= CGRID_MAX_CELL_SPAN ||
+                      range->maxy - range->miny >= CGRID_MAX_CELL_SPAN ||
+                      range->maxz - range->minz >= CGRID_MAX_CELL_SPAN);
+    range->maxx = min(range->maxx, range->minx + CGRID_MAX_CELL_SPAN - 1);
+    range->maxy = min(range->maxy, range->miny + CGRID_MAX_CELL_SPAN - 1);
+    range->maxz = min(range->maxz, range->minz + CGRID_MAX_CELL_SPAN - 1);
+}
+
+static cgridcell *cgridCellFind(sdword x, sdword y, sdword z)
+{
+    cgridcell *cell = cgridHash[cgridCellHash(x, y, z)];
+
+    while (cell != NULL)
+    {
+        if (cell->x == x && cell->y == y && cell->z == z)
+        {
+            return cell;
+        }
+        cell = cell->next;
+    }
+    return NULL;
+}
+
+static void cgridCellAddEntry(sdword x, sdword y, sdword z, cgridentry *entry)
+{
+    udword bucket = cgridCellHash(x, y, z);
+    cgridcell *cell = cgridCellFind(x, y, z);
+
+    if (cell == NULL)
+    {
+        if (cgridFreeCells != NULL)
+        {
+            cell = cgridFreeCells;
+            cgridFreeCells = cell->next;
+        }
+        else
+        {
+            cell = memAlloc(sizeof(cgridcell), "cgridcell", NonVolatile);
+            cell->maxEntries = 0;
+            cell->entries = NULL;
+        }
+        cell->x = x;
+        cell->y = y;
+        cell->z = z;
+        cell->visitStamp = 0;
+        cell->numEntries = 0;
+        cell->next = cgridHash[bucket];
+        cgridHash[bucket] = cell;
+        cgridNumCells++;
+    }
+
+    if (cell->numEntries >= cell->maxEntries)
+    {
+        cell->maxEntries += CGRID_CELL_BATCH;
+        cell->entries = memRealloc(cell->entries, sizeof(cgridentry *) * cell->maxEntries, "cgridentries", NonVolatile);
+    }
+    cell->entries[cell->numEntries++] = entry;
+}
+
+static void cgridCellRemoveEntry(sdword x, sdword y, sdword z, cgridentry *entry)
+{
+    udword bucket = cgridCellHash(x, y, z);
+    cgridcell *cell, *prev = NULL;
+    sdword index;
+
+    for (cell = cgridHash[bucket]; cell != NULL; prev = cell, cell = cell->next)
+    {
+        if (cell->x == x && cell->y == y && cell->z == z)
+        {
+            break;
+        }
+    }
+    dbgAssertOrIgnore(cell != NULL);
+    if (cell == NULL)
+    {
+        return;
+    }
+
+    for (index = 0; index < cell->numEntries; index++)
+    {
+        if (cell->entries[index] == entry)
+        {
+            cell->entries[index] = cell->entries[--cell->numEntries];
+            break;
+        }
+    }
+
+    if (cell->numEntries == 0)
+    {                                                       //cell is empty, recycle it
+        if (prev == NULL)
+        {
+            cgridHash[bucket] = cell->next;
+        }
+        else
+        {
+            prev->next = cell->next;
+        }
+        cell->next = cgridFreeCells;
+        cgridFreeCells = cell;
+        cgridNumCells--;
+    }
+}
+
+static void cgridEntryLink(cgridentry *entry)
+{
+    sdword x, y, z;
+
+    for (x = entry->minx; x <= entry->maxx; x++)
+    {
+        for (y = entry->miny; y <= entry->maxy; y++)
+        {
+            for (z = entry->minz; z <= entry->maxz; z++)
+            {
+                cgridCellAddEntry(x, y, z, entry);
+            }
+        }
+    }
+}
+
+static void cgridEntryUnlink(cgridentry *entry)
+{
+    sdword x, y, z;
+
+    for (x = entry->minx; x <= entry->maxx; x++)
+    {
+        for (y = entry->miny; y <= entry->maxy; y++)
+        {
+            for (z = entry->minz; z <= entry->maxz; z++)
+            {
+                cgridCellRemoveEntry(x, y, z, entry);
+            }
+        }
+    }
+}
+
+static sdword cgridEntrySlot(SpaceObj *obj)
+{
+    udword mask = cgridEntryTableSize - 1;
+    udword slot = cgridPointerHash(obj) & mask;
+
+    while (cgridEntryTable[slot] != NULL && cgridEntryTable[slot]->obj != obj)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return (sdword)slot;
+}
+
+static void cgridEntryTableGrow(void)
+{
+    cgridentry **oldTable = cgridEntryTable;
+    sdword oldSize = cgridEntryTableSize;
+    sdword index;
+
+    cgridEntryTableSize = (oldSize == 0) ? CGRID_ENTRYTABLE_MIN : oldSize * 2;
+    cgridEntryTable = memAlloc(sizeof(cgridentry *) * cgridEntryTableSize, "cgridtable", NonVolatile);
+    memset(cgridEntryTable, 0, sizeof(cgridentry *) * cgridEntryTableSize);
+
+    for (index = 0; index < oldSize; index++)
+    {
+        if (oldTable[index] != NULL)
+        {
+            cgridEntryTable[cgridEntrySlot(oldTable[index]->obj)] = oldTable[index];
+        }
+    }
+    if (oldTable != NULL)
+    {
+        memFree(oldTable);
+    }
+}
+
+static cgridentry *cgridEntryFind(SpaceObj *obj)
+{
+    if (cgridNumEntries == 0)
+    {
+        return NULL;
+    }
+    return cgridEntryTable[cgridEntrySlot(obj)];
+}
+
+static void cgridEntryTableRemove(SpaceObj *obj)
+{
+    udword mask = cgridEntryTableSize - 1;
+    udword hole = (udword)cgridEntrySlot(obj);
+    udword slot = hole, home;
+
+    cgridEntryTable[hole] = NULL;
+    for (;;)
+    {                                                       //shift back anything that probed past the hole
+        slot = (slot + 1) & mask;
+        if (cgridEntryTable[slot] == NULL)
+        {
+            break;
+        }
+        home = cgridPointerHash(cgridEntryTable[slot]->obj) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            cgridEntryTable[hole] = cgridEntryTable[slot];
+            cgridEntryTable[slot] = NULL;
+            hole = slot;
+        }
+    }
+    cgridNumEntries--;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridClusterRoot
+    Description : Finds the cluster a cluster has been joined into, which is
+                  always the lowest numbered one, so the result doesn't depend
+                  on the order clusters were joined in.
+    Inputs      : index - cluster
+    Outputs     : shortens the root chains on the way
+    Return      : index of the root cluster
+----------------------------------------------------------------------------*/
+static sdword cgridClusterRoot(sdword index)
+{
+    while (cgridClusters[index].root != index)
+    {
+        cgridClusters[index].root = cgridClusters[cgridClusters[index].root].root;
+        index = cgridClusters[index].root;
+    }
+    return index;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridClustersJoinIfTouching
+    Description : Joins the clusters of two grid entries if they are in
+                  different clusters and their collision spheres overlap.
+    Inputs      : entry0, entry1 - entries to check
+    Outputs     :
+    Return      : TRUE if two clusters were joined
+----------------------------------------------------------------------------*/
+static bool cgridClustersJoinIfTouching(cgridentry *entry0, cgridentry *entry1)
+{
+    sdword root0, root1;
+    real32 reach;
+    vector difference;
+
+    if (entry0->cluster == entry1->cluster)
+    {
+        return FALSE;
+    }
+    root0 = cgridClusterRoot(entry0->cluster);
+    root1 = cgridClusterRoot(entry1->cluster);
+    if (root0 == root1)
+    {
+        return FALSE;
+    }
+
+    reach = cgridObjectRadius(entry0->obj) + cgridObjectRadius(entry1->obj);
+    vecSub(difference, entry0->obj->posinfo.position, entry1->obj->posinfo.position);
+    if (vecMagnitudeSquared(difference) > reach * reach)
+    {
+        return FALSE;
+    }
+
+    if (root0 < root1)
+    {
+        cgridClusters[root1].root = root0;
+    }
+    else
+    {
+        cgridClusters[root0].root = root1;
+    }
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridClustersJoin
+    Description : Joins every pair of clusters which have objects overlapping
+                  each other.  Overlapping objects always share a cell unless
+                  one of them is clamped, so it's enough to check the objects
+                  within each cell, plus clamped objects against everything.
+    Inputs      :
+    Outputs     : root of the clusters updated
+    Return      : number of joins made
+----------------------------------------------------------------------------*/
+static sdword cgridClustersJoin(void)
+{
+    sdword bucket, index, other, numJoins = 0;
+    cgridcell *cell;
+    cgridentry *entry;
+
+    for (bucket = 0; bucket < CGRID_HASH_SIZE; bucket++)
+    {
+        for (cell = cgridHash[bucket]; cell != NULL; cell = cell->next)
+        {
+            for (index = 0; index < cell->numEntries - 1; index++)
+            {
+                for (other = index + 1; other < cell->numEntries; other++)
+                {
+                    numJoins += cgridClustersJoinIfTouching(cell->entries[index], cell->entries[other]);
+                }
+            }
+        }
+    }
+
+    if (cgridNumClamped > 0)
+    {
+        for (index = 0; index < cgridEntryTableSize; index++)
+        {
+            entry = cgridEntryTable[index];
+            if (entry == NULL || !entry->clamped)
+            {
+                continue;
+            }
+            for (other = 0; other < cgridEntryTableSize; other++)
+            {
+                if (other != index && cgridEntryTable[other] != NULL)
+                {
+                    numJoins += cgridClustersJoinIfTouching(entry, cgridEntryTable[other]);
+                }
+            }
+        }
+    }
+    return numJoins;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridClustersCallJoined
+    Description : Gathers the objects of joined clusters together and calls
+                  back once per root cluster, in cluster order.  Objects keep
+                  the order of the clusters they came from.
+    Inputs      : numClusters - clusters built
+                  callback - called once per root cluster with objects
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void cgridClustersCallJoined(sdword numClusters, cgridclustercallback callback)
+{
+    sdword index, root, next = 0;
+    cgridcluster *cluster;
+
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        cluster->numJoined = 0;
+    }
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        cgridClusters[cgridClusterRoot(index)].numJoined += cluster->numObjs;
+    }
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        if (cluster->root == index)
+        {
+            cluster->nextJoined = next;
+            next += cluster->numJoined;
+        }
+    }
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        root = cgridClusterRoot(index);
+        memcpy(&cgridJoinedObjs[cgridClusters[root].nextJoined], &cgridClusterObjs[cluster->first], sizeof(SpaceObj *) * cluster->numObjs);
+        cgridClusters[root].nextJoined += cluster->numObjs;
+    }
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        if (cluster->root == index && cluster->numJoined > 0)
+        {
+            callback(&cgridJoinedObjs[cluster->nextJoined - cluster->numJoined], cluster->numJoined);
+            cgridStatsCluster();
+        }
+    }
+}
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridReset
+    Description : Removes all objects from the grid.  The grid will be filled
+                  again from the universe next time clusters are created.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridReset(void)
+{
+    sdword index;
+    cgridcell *cell, *next;
+
+    for (index = 0; index < cgridEntryTableSize; index++)
+    {
+        if (cgridEntryTable[index] != NULL)
+        {
+            memFree(cgridEntryTable[index]);
+            cgridEntryTable[index] = NULL;
+        }
+    }
+    cgridNumEntries = 0;
+    cgridNumClamped = 0;
+
+    for (index = 0; index < CGRID_HASH_SIZE; index++)
+    {
+        for (cell = cgridHash[index]; cell != NULL; cell = next)
+        {
+            next = cell->next;
+            cell->next = cgridFreeCells;
+            cgridFreeCells = cell;
+        }
+        cgridHash[index] = NULL;
+    }
+    cgridNumCells = 0;
+    cgridNeedsSync = TRUE;
+#if CGRID_STATS
+    memset(&cgridStats, 0, sizeof(cgridStats));
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridShutdown
+    Description : Frees all memory used by the collision grid
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridShutdown(void)
+{
+    cgridcell *cell;
+
+    cgridReset();
+
+    while (cgridFreeCells != NULL)
+    {
+        cell = cgridFreeCells;
+        cgridFreeCells = cell->next;
+        if (cell->entries != NULL)
+        {
+            memFree(cell->entries);
+        }
+        memFree(cell);
+    }
+
+    if (cgridEntryTable != NULL)
+    {
+        memFree(cgridEntryTable);
+        cgridEntryTable = NULL;
+    }
+    cgridEntryTableSize = 0;
+
+    if (cgridQueue != NULL)
+    {
+        memFree(cgridQueue);
+        memFree(cgridClusters);
+        cgridQueue = NULL;
+        cgridClusters = NULL;
+    }
+    cgridQueueMax = 0;
+
+    if (cgridClusterObjs != NULL)
+    {
+        memFree(cgridClusterObjs);
+        memFree(cgridJoinedObjs);
+        cgridClusterObjs = NULL;
+        cgridJoinedObjs = NULL;
+    }
+    cgridClusterObjsMax = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridObjectWanted
+    Description : Decides if an object belongs in the grid.  These are the same
+                  objects bobListCreate makes starting spheres for.
+    Inputs      : obj
+    Outputs     :
+    Return      : TRUE if the object should be in the grid
+----------------------------------------------------------------------------*/
+bool cgridObjectWanted(SpaceObj *obj)
+{
+    if (obj->flags & SOF_Dead)
+    {
+        return FALSE;
+    }
+
+    switch (obj->objtype)
+    {
+        case OBJ_ShipType:
+        case OBJ_NebulaType:
+        case OBJ_GasType:
+        case OBJ_DustType:
+            return TRUE;
+        case OBJ_AsteroidType:
+            return (((Asteroid *)obj)->asteroidtype != Asteroid0);
+        case OBJ_DerelictType:
+            return !((Derelict *)obj)->staticinfo->worldRender;
+        case OBJ_MissileType:
+            return (((Missile *)obj)->missileType == MISSILE_Mine);
+        default:
+            return FALSE;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridObjectMoved
+    Description : Brings an object's grid entry up to date with its current
+                  position, adding it to the grid if needed.
+    Inputs      : obj
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridObjectMoved(SpaceObj *obj)
+{
+    cgridentry *entry;
+    cgridentry range;
+
+    if (!COLLGRID_ENABLED)
+    {
+        return;
+    }
+
+    entry = cgridEntryFind(obj);
+    if (entry == NULL)
+    {
+        if (!cgridObjectWanted(obj))
+        {
+            return;
+        }
+        if ((cgridNumEntries + 1) * 2 > cgridEntryTableSize)
+        {
+            cgridEntryTableGrow();
+        }
+        entry = memAlloc(sizeof(cgridentry), "cgridentry", NonVolatile);
+        entry->obj = obj;
+        cgridObjectRange(obj, entry);
+        cgridEntryTable[cgridEntrySlot(obj)] = entry;
+        cgridNumEntries++;
+        if (entry->clamped)
+        {
+            cgridNumClamped++;
+        }
+        cgridEntryLink(entry);
+        cgridStatsMoved();
+        return;
+    }
+
+    cgridObjectRange(obj, &range);
+    if (range.clamped != entry->clamped)
+    {                                                       //may change without the range changing
+        cgridNumClamped += range.clamped ? 1 : -1;
+        entry->clamped = range.clamped;
+    }
+    if (range.minx == entry->minx && range.miny == entry->miny && range.minz == entry->minz &&
+        range.maxx == entry->maxx && range.maxy == entry->maxy && range.maxz == entry->maxz)
+    {                                                       //still in the same cells
+        cgridStatsUnchanged();
+        return;
+    }
+
+    cgridEntryUnlink(entry);
+    entry->minx = range.minx; entry->miny = range.miny; entry->minz = range.minz;
+    entry->maxx = range.maxx; entry->maxy = range.maxy; entry->maxz = range.maxz;
+    cgridEntryLink(entry);
+    cgridStatsMoved();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridObjectDied
+    Description : Removes an object from the grid, if it is in there.
+    Inputs      : obj
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridObjectDied(SpaceObj *obj)
+{
+    cgridentry *entry;
+
+    if (!COLLGRID_ENABLED)
+    {
+        return;
+    }
+
+    entry = cgridEntryFind(obj);
+    if (entry == NULL)
+    {
+        return;
+    }
+    cgridEntryUnlink(entry);
+    cgridEntryTableRemove(obj);
+    if (entry->clamped)
+    {
+        cgridNumClamped--;
+    }
+    memFree(entry);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridSyncAll
+    Description : Updates the grid entry of every object in the universe.  Only
+                  needed after the grid has been reset, since objects are
+                  normally kept up to date as they move.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridSyncAll(void)
+{
+    Node *node = universe.SpaceObjList.head;
+    SpaceObj *obj;
+
+    while (node != NULL)
+    {
+        obj = (SpaceObj *)listGetStructOfNode(node);
+        node = node->next;
+
+        if (cgridObjectWanted(obj))
+        {
+            cgridObjectMoved(obj);
+        }
+    }
+    cgridNeedsSync = FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : cgridClustersCreate
+    Description : Walks the occupied cells of the grid, grouping cells that
+                  touch (including diagonally) into clusters and passing the
+                  objects of each cluster to callback.  Objects overlapping
+                  several cells are passed once, with the cluster containing
+                  their minimum corner cell.  A cluster stops taking in
+                  neighbouring cells once it spans about 2 * maxRadius, but
+                  clusters with objects overlapping each other across the
+                  seam are then joined into one, however big, since bump
+                  collisions are only checked between objects in a blob.
+    Inputs      : maxRadius - clusters stop growing when they are about this
+                    radius, to keep blob sizes in line with bobBiggestRadius
+                  callback - called once per cluster
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void cgridClustersCreate(real32 maxRadius, cgridclustercallback callback)
+{
+    sdword bucket, head, tail, index, numObjs;
+    sdword dx, dy, dz;
+    sdword minx, miny, minz, maxx, maxy, maxz;
+    sdword maxCells, numClusters, numJoins;
+    cgridcell *seed, *cell, *neighbour;
+    cgridentry *entry;
+    cgridcluster *cluster;
+
+    if (cgridNeedsSync)
+    {
+        cgridSyncAll();
+    }
+
+    maxCells = (sdword)(maxRadius * 2.0f / COLLGRID_CELL_SIZE) + 1;
+    if (maxCells < 1)
+    {
+        maxCells = 1;
+    }
+
+    if (cgridQueueMax < cgridNumCells)
+    {
+        cgridQueueMax = cgridNumCells + CGRID_HASH_SIZE;
+        if (cgridQueue != NULL)
+        {
+            memFree(cgridQueue);
+            memFree(cgridClusters);
+        }
+        cgridQueue = memAlloc(sizeof(cgridcell *) * cgridQueueMax, "cgridqueue", NonVolatile);
+        cgridClusters = memAlloc(sizeof(cgridcluster) * cgridQueueMax, "cgridclusters", NonVolatile);
+    }
+    if (cgridClusterObjsMax < cgridNumEntries)
+    {
+        cgridClusterObjsMax = cgridNumEntries + CGRID_HASH_SIZE;
+        if (cgridClusterObjs != NULL)
+        {
+            memFree(cgridClusterObjs);
+            memFree(cgridJoinedObjs);
+        }
+        cgridClusterObjs = memAlloc(sizeof(SpaceObj *) * cgridClusterObjsMax, "cgridcluster", NonVolatile);
+        cgridJoinedObjs = memAlloc(sizeof(SpaceObj *) * cgridClusterObjsMax, "cgridjoined", NonVolatile);
+    }
+
+    cgridVisitStamp++;
+    if (cgridVisitStamp == 0)
+    {                                                       //stamp wrapped, clear out old stamps
+        for (bucket = 0; bucket < CGRID_HASH_SIZE; bucket++)
+        {
+            for (cell = cgridHash[bucket]; cell != NULL; cell = cell->next)
+            {
+                cell->visitStamp = 0;
+            }
+        }
+        cgridVisitStamp = 1;
+    }
+
+    //1. break the cells up into clusters of limited size
+    numClusters = 0;
+    numObjs = 0;
+    for (bucket = 0; bucket < CGRID_HASH_SIZE; bucket++)
+    {
+        for (seed = cgridHash[bucket]; seed != NULL; seed = seed->next)
+        {
+            if (seed->visitStamp == cgridVisitStamp)
+            {
+                continue;
+            }
+
+            cluster = &cgridClusters[numClusters];
+            cluster->first = numObjs;
+            cluster->root = numClusters;
+
+            //breadth-first walk of the cells connected to seed
+            seed->visitStamp = cgridVisitStamp;
+            cgridQueue[0] = seed;
+            head = 0;
+            tail = 1;
+            minx = maxx = seed->x;
+            miny = maxy = seed->y;
+            minz = maxz = seed->z;
+
+            while (head < tail)
+            {
+                cell = cgridQueue[head++];
+
+                for (index = 0; index < cell->numEntries; index++)
+                {
+                    entry = cell->entries[index];
+                    if (entry->minx == cell->x && entry->miny == cell->y && entry->minz == cell->z)
+                    {                                       //this is the object's home cell
+                        entry->cluster = numClusters;
+                        cgridClusterObjs[numObjs++] = entry->obj;
+                    }
+                }
+
+                for (dx = -1; dx <= 1; dx++)
+                {
+                    for (dy = -1; dy <= 1; dy++)
+                    {
+                        for (dz = -1; dz <= 1; dz++)
+                        {
+                            if ((dx | dy | dz) == 0)
+                            {
+                                continue;
+                            }
+                            neighbour = cgridCellFind(cell->x + dx, cell->y + dy, cell->z + dz);
+                            if (neighbour == NULL || neighbour->visitStamp == cgridVisitStamp)
+                            {
+                                continue;
+                            }
+                            if (max(maxx, neighbour->x) - min(minx, neighbour->x) >= maxCells ||
+                                max(maxy, neighbour->y) - min(miny, neighbour->y) >= maxCells ||
+                                max(maxz, neighbour->z) - min(minz, neighbour->z) >= maxCells)
+                            {                               //cluster is big enough, leave this cell for another one
+                                continue;
+                            }
+                            minx = min(minx, neighbour->x); maxx = max(maxx, neighbour->x);
+                            miny = min(miny, neighbour->y); maxy = max(maxy, neighbour->y);
+                            minz = min(minz, neighbour->z); maxz = max(maxz, neighbour->z);
+                            neighbour->visitStamp = cgridVisitStamp;
+                            cgridQueue[tail++] = neighbour;
+                        }
+                    }
+                }
+            }
+
+            cluster->numObjs = numObjs - cluster->first;
+            numClusters++;
+        }
+    }
+
+    //2. join clusters which were split between touching objects
+    numJoins = cgridClustersJoin();
+
+    //3. hand them out
+#if CGRID_STATS
+    cgridStats.numEntries = cgridNumEntries;
+    cgridStats.numCells = cgridNumCells;
+    cgridStats.numClusters = 0;
+    cgridStats.numJoins = numJoins;
+#endif
+    if (numJoins > 0)
+    {
+        cgridClustersCallJoined(numClusters, callback);
+        return;
+    }
+    for (index = 0, cluster = cgridClusters; index < numClusters; index++, cluster++)
+    {
+        if (cluster->numObjs > 0)
+        {
+            callback(&cgridClusterObjs[cluster->first], cluster->numObjs);
+            cgridStatsCluster();
+        }
+    }
+}
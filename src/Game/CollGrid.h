@@ -0,0 +1,84 @@
+// =============================================================================
+//  CollGrid.h
+//  - sparse uniform grid broadphase for the collision blobs
+// =============================================================================
+
+#ifndef ___COLLGRID_H
+#define ___COLLGRID_H
+
+#include "SpaceObj.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define CGRID_STATS                 1
+#else
+#define CGRID_STATS                 0
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define CGRID_HASH_SIZE             4096        // buckets in the cell hash, power of 2
+#define CGRID_MAX_CELL_SPAN         8           // biggest object is this many cells wide per axis
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+// one entry in the grid per object, which may overlap several cells
+typedef struct cgridentry
+{
+    SpaceObj *obj;
+    sdword minx, miny, minz;                    // inclusive range of cells overlapped
+    sdword maxx, maxy, maxz;
+    bool clamped;                               // range was cut down to CGRID_MAX_CELL_SPAN
+    sdword cluster;                             // cluster of the home cell, while building clusters
+} cgridentry;
+
+// one occupied cell of the grid
+typedef struct cgridcell
+{
+    struct cgridcell *next;                     // next cell in this hash bucket
+    sdword x, y, z;                             // cell coordinates
+    udword visitStamp;                          // for walking connected cells
+    sdword numEntries;
+    sdword maxEntries;
+    cgridentry **entries;
+} cgridcell;
+
+// called once per cluster of connected cells with the objects in the cluster
+typedef void (*cgridclustercallback)(SpaceObj **objects, sdword numObjects);
+
+#if CGRID_STATS
+typedef struct CGridStats
+{
+    sdword numEntries;                          // objects in the grid
+    sdword numCells;                            // occupied cells
+    sdword numMoved;                            // updates which changed an object's cells
+    sdword numUnchanged;                        // updates which left an object in the same cells
+    sdword numClusters;                         // clusters built last time
+    sdword numJoins;                            // clusters joined last time because their objects overlapped
+} CGridStats;
+
+extern CGridStats cgridStats;
+#endif
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void cgridShutdown(void);
+void cgridReset(void);
+
+bool cgridObjectWanted(SpaceObj *obj);
+void cgridObjectMoved(SpaceObj *obj);
+void cgridObjectDied(SpaceObj *obj);
+void cgridSyncAll(void);
+
+void cgridClustersCreate(real32 maxRadius, cgridclustercallback callback);
+
+#endif
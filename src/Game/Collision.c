@@ -9,13 +9,16 @@
 #include "Collision.h"
 
 #include "Alliance.h"
+#include "BulletStore.h"
 #include "Debug.h"
 #include "FastMath.h"
 #include "NIS.h"
 #include "prim3d.h"
+#include "RefIndex.h"
 #include "Ships.h"
 #include "SinglePlayer.h"
 #include "Tactics.h"
+#include "Tweak.h"
 #include "Universe.h"
 #include "UnivUpdate.h"
 
@@ -553,6 +556,13 @@ void collDrawCollisionInfo(SpaceObjRotImp *irobj)
 ----------------------------------------------------------------------------*/
 void collUpdateCollBlobs(void)
 {
+    if (COLLGRID_ENABLED)
+    {                                                       //grid clusters are always built from scratch
+        universe.collUpdateAllBlobs = FALSE;
+        bobListCreateFromGrid(&collBlobProperties, &universe.collBlobList);
+        return;
+    }
+
     if (universe.collUpdateAllBlobs)
     {
         universe.collUpdateAllBlobs = FALSE;
@@ -1974,10 +1984,24 @@ void collCheckBulletTargetColl(blob *thisBlob)
 
     sdword pass;
 
+    BulletTargetStore *targetstore;
+    sdword maskbase;
+    udword mask = 0;
+    bool special;
+
 #ifdef HW_BUILD_FOR_DEBUGGING
 //    thisBlob->debugFlag = 1;
 #endif
 
+    if (bulletselection->numBullets == 0)
+    {
+        return;
+    }
+
+    //stage the target collision spheres for the 4-wide sphere tests
+    bstTargetsGather(&bstSmallTargets, thisBlob->blobSmallTargets);
+    bstTargetsGather(&bstBigTargets, thisBlob->blobBigTargets);
+
     while (bulletindex < bulletselection->numBullets)
     {
         bullet = bulletselection->BulletPtr[bulletindex];
@@ -2043,6 +2067,7 @@ passagain:
                 if (pass == 0)
                 {
                     targetselection = thisBlob->blobSmallTargets;
+                    targetstore = &bstSmallTargets;
                     numTargets = targetselection->numTargets;
 
                     if (numTargets == 0)
@@ -2059,7 +2084,7 @@ passagain:
                     while (top >= bottom)
                     {
                         targetindex = (bottom+top)>>1;
-                        if ((bullet->collOptimizeDist - targetselection->TargetPtr[targetindex]->collOptimizeDist) > maxTargetCollSphereSizePlusBulletTravelDist)
+                        if ((bullet->collOptimizeDist - targetstore->optimizeDist[targetindex]) > maxTargetCollSphereSizePlusBulletTravelDist)
                         {
                             // targetindex is too small
                             bottom = targetindex+1;
@@ -2077,35 +2102,48 @@ passagain:
                 {
                     dbgAssertOrIgnore(pass == 1);
                     targetselection = thisBlob->blobBigTargets;
+                    targetstore = &bstBigTargets;
                     numTargets = targetselection->numTargets;
                     targetindex = 0;
                     maxTargetCollSphereSizePlusBulletTravelDist = thisBlob->blobMaxBTargetCollSphereSize + bullet->traveldist;
                 }
 
+                maskbase = -1;
                 while (targetindex < numTargets)
                 {
-                    target = targetselection->TargetPtr[targetindex];
-                    targetstaticheader = &target->staticinfo->staticheader;
-
 #if COLLISION_CHECK_STATS
             bulletwalks++;
 #endif
 
-                    distcheck = target->collOptimizeDist - bullet->collOptimizeDist;
+                    distcheck = targetstore->optimizeDist[targetindex] - bullet->collOptimizeDist;
 
                     if (distcheck > maxTargetCollSphereSizePlusBulletTravelDist)
                     {
                         goto nextpass;
                     }
 
-                    if ((target->objtype != OBJ_ShipType) || (((Ship *)target)->shiptype != DFGFrigate && ((Ship *)target)->shiptype != DefenseFighter))
-                    {
-                        if (ABS(distcheck) > (targetstaticheader->staticCollInfo.collspheresize+bullet->traveldist))
+                    special = targetstore->special[targetindex];
+                    if (!special)
+                    {                                       //DFG frigates and defense fighters see all nearby bullets
+                        if (ABS(distcheck) > (targetstore->collSize[targetindex]+bullet->traveldist))
+                        {
+                            goto nexttarget;
+                        }
+
+                        if ((targetindex & ~3) != maskbase)
+                        {                                   //sphere test the next four targets at once
+                            maskbase = targetindex & ~3;
+                            mask = bstSegmentSphereTest4(targetstore, maskbase, bullet);
+                        }
+                        if (!bitTest(mask, 1 << (targetindex & 3)))
                         {
                             goto nexttarget;
                         }
                     }
 
+                    target = targetselection->TargetPtr[targetindex];
+                    targetstaticheader = &target->staticinfo->staticheader;
+
                     if (bullet->owner == (Ship *)target)
                     {
                         goto nexttarget;
@@ -2123,6 +2161,17 @@ passagain:
             bulletchecks++;
 #endif
 
+                    if (!special)
+                    {                                       //already passed the sphere test
+                        if ((collideLineDist = collCheckRectLine((SpaceObjRotImp *)target,&bullet->posinfo.position,&bullet->bulletheading,bullet->traveldist,&collSide)) >= 0.0f)
+                        {
+                            univBulletCollidedWithTarget(target,targetstaticheader,bullet,collideLineDist,collSide);
+                            deletebulletflag = TRUE;
+                            goto nextbullet;
+                        }
+                        goto nexttarget;
+                    }
+
                     vecSub(distvector,target->collInfo.collPosition,bullet->posinfo.position);
                     distsquared = vecMagnitudeSquared(distvector);
                     v = vecDotProduct(distvector,bullet->bulletheading);
@@ -2137,6 +2186,7 @@ passagain:
                             if(distsquared < DFGFstatics->DFGFrigateFieldRadiusSqr)
                             {   //and bullet is within its field radius...affect the bullet
                                 univDFGFieldEffect((Ship *)target,bullet,universe.totaltimeelapsed);
+                                maskbase = -1;                  //bullet may have been deflected
                             }
                         }
                         if(((Ship *)target)->shiptype == DefenseFighter)
@@ -2195,6 +2245,7 @@ nextbullet:
             }
 
             bobObjectDied((SpaceObj *)bullet,&universe.collBlobList);
+            refReferrerDied((SpaceObj *)bullet);
             listRemoveNode(&bullet->bulletlink);
             univRemoveObjFromRenderList((SpaceObj *)bullet);
             listDeleteNode(&bullet->objlink);
@@ -2203,6 +2254,10 @@ nextbullet:
         {
             bulletindex++;
         }
+
+        //a hit may have killed a target and removed it from the blob
+        bstTargetsRefresh(&bstSmallTargets, thisBlob->blobSmallTargets);
+        bstTargetsRefresh(&bstBigTargets, thisBlob->blobBigTargets);
     }
 }
 
@@ -2912,6 +2967,10 @@ void collCheckAllBulletMissileCollisions(void)
     udword savemissilewalks;
     udword savemissilechecks;
 
+#if BST_STATS
+    bstStats.numSphereTests = 0;
+    bstStats.numSphereHits = 0;
+#endif
 #if COLLISION_CHECK_STATS
     bulletwalks = 0;
     bulletchecks = 0;
@@ -23,11 +23,13 @@
 #include "File.h"
 #include "glinc.h"
 #include "HorseRace.h"
+#include "Job.h"
 #include "mainrgn.h"
 #include "Memory.h"
 #include "Mesh.h"
 #include "MEX.h"
 #include "Particle.h"
+#include "ParticleUpdate.h"
 #include "Randy.h"
 #include "render.h"
 #include "Select.h"
@@ -70,6 +72,61 @@ etgevent etgEventTable[ETG_EventListLength];
 sdword etgEventLoadCount = 0;
 //sdword etgEventIndex = 0;
 
+/*-----------------------------------------------------------------------------
+    Particle systems of the effects about to be drawn, updated on the job
+    threads by etgEffectsUpdateParticles.  etgEffectDraw reaches them in the
+    same order and skips their update.
+-----------------------------------------------------------------------------*/
+#define ETG_PartJobGrain        8               //particle systems per job
+#define ETG_PartGrowBy          64              //grow the staging array by this many spare entries
+
+typedef struct etgpartupdate
+{
+    psysPtr psys;
+    real32 timeElapsed;
+}
+etgpartupdate;
+
+static etgpartupdate *etgPartUpdates = NULL;
+static sdword etgPartUpdatesMax = 0;
+static sdword etgNumPartUpdates = 0;
+static sdword etgPartUpdateCursor = 0;          //next entry etgEffectDraw will reach
+static real32 etgPartUpdateTime;                //universe.totaltimeelapsed they were updated at
+
+/*-----------------------------------------------------------------------------
+    Effects grouped by type for etgEffectsUpdate.
+-----------------------------------------------------------------------------*/
+#define ETG_BatchGrowBy         64              //grow the batch arrays by this many spare entries
+
+#if defined(__GNUC__)
+#define etgPrefetch(p)          __builtin_prefetch((p))
+#else
+#define etgPrefetch(p)
+#endif
+
+static Effect **etgBatch = NULL;                //effects to update, each type's in a run
+static sdword etgBatchMax = 0;
+static etgeffectstatic **etgBatchTypes = NULL;  //types in the order first found
+static sdword etgBatchTypesMax = 0;
+static Effect **etgBatchDeletes = NULL;         //effects to delete once all are updated
+static sdword etgBatchDeletesMax = 0;
+static sdword etgNumBatchDeletes = 0;
+
+#if ETG_EXEC_STATS
+/*-----------------------------------------------------------------------------
+    Effect code execution counters.  etgExecCount accumulates during a
+    universe update and etgExecStatsReset copies it over for display.
+-----------------------------------------------------------------------------*/
+#define ETG_ExecNameLength      48
+
+etgexecstats etgExecStats;
+udword etgExecTypes;
+static udword etgExecTypeCount;
+char etgExecBusiestName[ETG_ExecNameLength] = "";
+etgexecstats etgExecBusiestStats;
+static etgexecstats etgExecCount;
+#endif
+
 //data for error recovery during ETG parsing
 bool etgErrorRecoverable = FALSE;
 bool etgErrorEncountered = FALSE;
@@ -79,6 +136,7 @@ bool etgErrorEncountered = FALSE;
     Master dispatch table for processing effects:
 -----------------------------------------------------------------------------*/
 sdword etgNOP(Effect *effect, etgeffectstatic *stat, ubyte *opcode);
+sdword etgBadOpcode(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode);
 sdword etgVarCopy(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode);
 sdword etgVarAssign(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode);
 sdword etgFunctionCall(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode);
@@ -1783,6 +1841,30 @@ void etgShutdown(void)
     {
         memFree(etgHyperspaceEffect);
     }
+    if (etgPartUpdates != NULL)
+    {
+        memFree(etgPartUpdates);
+        etgPartUpdates = NULL;
+        etgPartUpdatesMax = etgNumPartUpdates = 0;
+    }
+    if (etgBatch != NULL)
+    {
+        memFree(etgBatch);
+        etgBatch = NULL;
+        etgBatchMax = 0;
+    }
+    if (etgBatchTypes != NULL)
+    {
+        memFree(etgBatchTypes);
+        etgBatchTypes = NULL;
+        etgBatchTypesMax = 0;
+    }
+    if (etgBatchDeletes != NULL)
+    {
+        memFree(etgBatchDeletes);
+        etgBatchDeletes = NULL;
+        etgBatchDeletesMax = etgNumBatchDeletes = 0;
+    }
 #if ETG_TESTING
     //free all the test keys
     for (index = 0; index < etgTestKeyIndex; index++)
@@ -1919,15 +2001,6 @@ void etgReset(void)
     }
 }
 
-/*-----------------------------------------------------------------------------
-    Name        : etgEffectCodeExecute
-    Description : Execute a block of code.
-    Inputs      : stat - static info for the effect
-                  effect - local effect who has all the goods
-                  codeBlock - which code block to execute
-    Outputs     : Executes the specified p-code
-    Return      : void
-----------------------------------------------------------------------------*/
 //#define ETG_ExecStackDepth   4
 //global variables for execution of a chunk of code
 typedef struct
@@ -1943,12 +2016,94 @@ typedef struct
 etgeffectstack;
 etgeffectstack etgExecStack;//[ETG_ExecStackDepth];
 //sdword etgExecStackIndex = -1;
-void etgEffectCodeExecute(etgeffectstatic *stat, Effect *effect, udword codeBlock)
+
+/*-----------------------------------------------------------------------------
+    Name        : etgThreadOpAt
+    Description : Find the pre-decoded opcode at a code offset.
+    Inputs      : thread - pre-decoded code block
+                  offset - offset in the code block
+    Outputs     :
+    Return      : opcode at that offset, or the end marker if past the end
+----------------------------------------------------------------------------*/
+static inline etgthreadop *etgThreadOpAt(etgthread *thread, udword offset)
 {
-    udword opcode;
+    etgthreadop *op;
+
+    if (offset >= thread->length)
+    {
+        return(thread->op + thread->index[thread->length / sizeof(udword)]);
+    }
+    op = thread->op + thread->index[offset / sizeof(udword)];
+#if ETG_ERROR_CHECKING
+    if ((offset & (sizeof(udword) - 1)) || op->opcode != thread->op[0].opcode + offset)
+    {
+        dbgFatalf(DBG_Loc, "etgThreadOpAt: offset %d is not the start of an opcode", offset);
+    }
+#endif
+    return(op);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : etgCodeThreadExecute
+    Description : Run the pre-decoded code of an effect, starting at the
+                    current code block and offset of etgExecStack.
+    Inputs      : stat - static info for the effect
+                  effect - effect being executed
+    Outputs     : Keeps the code block index and offset of etgExecStack
+                    current for the handlers which branch or read them.
+    Return      : void
+    Note        : Handlers which skip or branch are detected by the size they
+                    return or by their having moved etgExecStack; all other
+                    opcodes go straight on to the next pre-decoded entry.
+----------------------------------------------------------------------------*/
+static void etgCodeThreadExecute(etgeffectstatic *stat, Effect *effect)
+{
+    udword codeBlock = etgExecStack.etgCodeBlockIndex;
+    udword offset = etgExecStack.etgCodeBlock[codeBlock].offset;
+    etgthreadop *op = etgThreadOpAt(&stat->thread[codeBlock], offset);
     sdword size;
-    ubyte *pOpcode;
+#if ETG_EXEC_STATS
+    udword nOpcodes = 0;
+#endif
+
+    while (op->function != NULL)
+    {
+        size = op->function(effect, stat, op->opcode);
+#if ETG_EXEC_STATS
+        nOpcodes++;
+#endif
+        if (etgExecStack.etgCodeBlockIndex == codeBlock &&
+            etgExecStack.etgCodeBlock[codeBlock].offset == offset &&
+            (udword)size == op->length)
+        {                                                   //on to the next opcode
+            offset += size;
+            op++;
+        }
+        else
+        {                                                   //skipped or branched
+            codeBlock = etgExecStack.etgCodeBlockIndex;
+            offset = etgExecStack.etgCodeBlock[codeBlock].offset + size;
+            op = etgThreadOpAt(&stat->thread[codeBlock], offset);
+        }
+        etgExecStack.etgCodeBlock[codeBlock].offset = offset;
+    }
+#if ETG_EXEC_STATS
+    etgExecCount.nOpcodes += nOpcodes;
+    stat->execStats.nOpcodes += nOpcodes;
+#endif
+}
 
+/*-----------------------------------------------------------------------------
+    Name        : etgEffectCodeExecute
+    Description : Execute a block of code.
+    Inputs      : stat - static info for the effect
+                  effect - local effect who has all the goods
+                  codeBlock - which code block to execute
+    Outputs     : Executes the specified p-code
+    Return      : void
+----------------------------------------------------------------------------*/
+void etgEffectCodeExecute(etgeffectstatic *stat, Effect *effect, udword codeBlock)
+{
 
 	//this function does not interface well with optimized code which assumes 
 	//certain variables will not get stomped, hence the pushes
@@ -2005,34 +2160,12 @@ void etgEffectCodeExecute(etgeffectstatic *stat, Effect *effect, udword codeBloc
 */
 
     etgExecStack.etgCodeBlockIndex = codeBlock;
-    //set the proper code block and code length
-    //start at beginning of code.  !!!We may want to implement the yield() function.
-//    etgCodeOffset = 0;
+    //start at beginning of code.
     //!!! this does not support the yield function
     etgExecStack.etgCodeBlock[EPM_Startup].offset = etgExecStack.etgCodeBlock[EPM_EachFrame].offset = etgExecStack.etgCodeBlock[EPM_TimeIndex].offset = 0;
     etgExecStack.etgVariables = effect->variable;
 
-    while (etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset <
-           etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].length)
-    {
-		
-        pOpcode = etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].code + etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset;
-        opcode = *((udword *)pOpcode);                      //get an opcode
-#if ETG_ERROR_CHECKING
-        if (opcode < 0 || opcode >= EOP_LastOp)
-        {
-            dbgFatalf(DBG_Loc, "Effect '%s' has a bad opcode in code segment %d offset %d", stat->name, etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].code, etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset);
-        }
-        if (etgHandleTable[opcode].function == NULL)
-        {
-            dbgFatalf(DBG_Loc, "etgEffectCodeExecute: NULL opcode %d", opcode);
-        }
-#endif
-        //execute the opcode
-        size = etgHandleTable[opcode].function(effect, stat, pOpcode);
-        etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset += size;
-		
-    }
+    etgCodeThreadExecute(stat, effect);
 //    etgExecStackIndex--;
 	//this function does not interface well with optimized code which assumes 
 	//certain variables will not get stomped, hence the pushes
@@ -2077,19 +2210,6 @@ void etgEffectCodeExecute(etgeffectstatic *stat, Effect *effect, udword codeBloc
 #endif
 }
 
-/*-----------------------------------------------------------------------------
-    Name        : etgCodeMakeCurrent
-    Description : Make a particular efect static's code blocks current
-    Inputs      : stat - code static to make current
-    Outputs     : Copies the etgcodeblock structures from the effect static to
-                    etgCodeBlocks.
-    Return      : void
-----------------------------------------------------------------------------*/
-void etgCodeMakeCurrent(etgeffectstatic *stat)
-{
-    memcpy(etgExecStack.etgCodeBlock, stat->codeBlock, sizeof(etgcodeblock) * ETG_NumberCodeBlocks);
-}
-
 /*-----------------------------------------------------------------------------
     Name        : etgEffectCodeStart
     Description : Starts up the code, variables etc. of an effect in a useable form.
@@ -2185,6 +2305,8 @@ void etgEffectDelete(Effect *effect)
 ----------------------------------------------------------------------------*/
 void etgEffectCodeDelete(etgeffectstatic *stat, bool bFullDelete)
 {
+    sdword index;
+
     if (bFullDelete)
     {
         memFree(stat->name);
@@ -2236,6 +2358,14 @@ void etgEffectCodeDelete(etgeffectstatic *stat, bool bFullDelete)
         memFree(stat->codeBlock[EPM_TimeIndex].code);
         stat->codeBlock[EPM_TimeIndex].code = 0;
     }
+    for (index = 0; index < ETG_NumberCodeBlocks; index++)
+    {
+        if (stat->thread[index].op != NULL)
+        {
+            memFree(stat->thread[index].op);
+            stat->thread[index].op = NULL;
+        }
+    }
     if (stat->nHistoryList > 0)
     {
         memFree(stat->historyList);
@@ -2271,7 +2401,10 @@ bool etgEffectUpdate(Effect *effect, real32 timeElapsed)
     {                                                       //if effect still waiting to start
         return(FALSE);
     }
-    etgCodeMakeCurrent(stat);
+#if ETG_EXEC_STATS
+    etgExecCount.nEffects++;
+    stat->execStats.nEffects++;
+#endif
     if (etgTotalTimeElapsed <= timeElapsed + 0.005)
     {                                                       //if effect just started
         etgEffectCodeExecute(stat, effect, EPM_Startup);
@@ -2339,6 +2472,290 @@ bool etgEffectUpdate(Effect *effect, real32 timeElapsed)
     return(FALSE);
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : etgBatchDeleteAdd
+    Description : Queue an effect for deletion at the end of etgEffectsUpdate.
+    Inputs      : effect - effect whose update said it is finished
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void etgBatchDeleteAdd(Effect *effect)
+{
+    if (etgNumBatchDeletes >= etgBatchDeletesMax)
+    {
+        etgBatchDeletesMax += ETG_BatchGrowBy;
+        etgBatchDeletes = memRealloc(etgBatchDeletes, etgBatchDeletesMax * sizeof(Effect *), "etgBatchDeletes", NonVolatile);
+    }
+    etgBatchDeletes[etgNumBatchDeletes++] = effect;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : etgEffectsUpdate
+    Description : Update all the effects in the effect list one effect type
+                    at a time, so each type's code stays in the cache while
+                    all of its effects are run.
+    Inputs      : timeElapsed - time elapsed since effects last updated
+    Outputs     : Deletes the effects which have finished.
+    Return      : void
+    Note        : Effects spawned while updating are added to the end of the
+                    effect list.  They are updated afterwards, in list order,
+                    as the list walk in univUpdateAllPosVelEffects would have.
+                    Deletions wait until then so the list can be picked up
+                    where it left off.
+----------------------------------------------------------------------------*/
+void etgEffectsUpdate(real32 timeElapsed)
+{
+    Node *objnode, *lastnode = universe.effectList.tail;
+    Effect *effect;
+    etgeffectstatic *stat;
+    sdword index, start, nEffects = 0, nTypes = 0;
+
+    //count the effects of each type
+    for (objnode = universe.effectList.head; objnode != NULL; objnode = objnode->next)
+    {
+        effect = (Effect *)listGetStructOfNode(objnode);
+        if (effect->flags & SOF_DontApplyPhysics)
+        {
+            continue;
+        }
+        stat = (etgeffectstatic *)effect->staticinfo;
+        if (stat->batchIndex == 0)
+        {                                                   //first effect of this type
+            if (nTypes >= etgBatchTypesMax)
+            {
+                etgBatchTypesMax += ETG_BatchGrowBy;
+                etgBatchTypes = memRealloc(etgBatchTypes, etgBatchTypesMax * sizeof(etgeffectstatic *), "etgBatchTypes", NonVolatile);
+            }
+            etgBatchTypes[nTypes++] = stat;
+        }
+        stat->batchIndex++;
+        nEffects++;
+    }
+    if (nEffects > etgBatchMax)
+    {
+        etgBatchMax = nEffects + ETG_BatchGrowBy;
+        etgBatch = memRealloc(etgBatch, etgBatchMax * sizeof(Effect *), "etgBatch", NonVolatile);
+    }
+    //give each type a run of the batch, then fill them in list order
+    for (start = index = 0; index < nTypes; index++)
+    {
+        stat = etgBatchTypes[index];
+        start += stat->batchIndex;
+        stat->batchIndex = start - stat->batchIndex;
+    }
+    for (objnode = universe.effectList.head; objnode != NULL; objnode = objnode->next)
+    {
+        effect = (Effect *)listGetStructOfNode(objnode);
+        if (effect->flags & SOF_DontApplyPhysics)
+        {
+            continue;
+        }
+        stat = (etgeffectstatic *)effect->staticinfo;
+        etgBatch[stat->batchIndex++] = effect;
+    }
+    for (index = 0; index < nTypes; index++)
+    {
+        etgBatchTypes[index]->batchIndex = 0;
+    }
+#if ETG_EXEC_STATS
+    etgExecTypeCount += nTypes;
+#endif
+
+    //update them, fetching the next effect's variables while this one runs
+    etgNumBatchDeletes = 0;
+    for (index = 0; index < nEffects; index++)
+    {
+        effect = etgBatch[index];
+        if (index + 1 < nEffects)
+        {
+            etgPrefetch(etgBatch[index + 1]->variable);
+        }
+        if (index + 2 < nEffects)
+        {
+            etgPrefetch(etgBatch[index + 2]);
+        }
+        if (etgEffectUpdate(effect, timeElapsed))
+        {
+            etgBatchDeleteAdd(effect);
+        }
+    }
+
+    //now anything spawned along the way
+    for (objnode = (lastnode != NULL) ? lastnode->next : universe.effectList.head; objnode != NULL; objnode = objnode->next)
+    {
+        effect = (Effect *)listGetStructOfNode(objnode);
+        if ((effect->flags & SOF_DontApplyPhysics) == 0)
+        {
+            if (etgEffectUpdate(effect, timeElapsed))
+            {
+                etgBatchDeleteAdd(effect);
+            }
+        }
+    }
+
+    for (index = 0; index < etgNumBatchDeletes; index++)
+    {
+        effect = etgBatchDeletes[index];
+        etgEffectDelete(effect);
+        univRemoveObjFromRenderList((SpaceObj *)effect);
+        listDeleteNode(&effect->objlink);
+    }
+}
+
+#if ETG_EXEC_STATS
+/*-----------------------------------------------------------------------------
+    Name        : etgExecStatsReset
+    Description : Make the execution counters of the last universe update
+                    available for display and start counting again.
+    Inputs      :
+    Outputs     : Sets etgExecStats and finds the effect type which executed
+                    the most opcodes.
+    Return      :
+----------------------------------------------------------------------------*/
+void etgExecStatsReset(void)
+{
+    sdword index;
+    etgeffectstatic *stat;
+
+    etgExecStats = etgExecCount;
+    etgExecTypes = etgExecTypeCount;
+    memset(&etgExecCount, 0, sizeof(etgExecCount));
+    etgExecTypeCount = 0;
+    memset(&etgExecBusiestStats, 0, sizeof(etgExecBusiestStats));
+    etgExecBusiestName[0] = 0;
+    for (index = 0; index < ETG_EventListLength; index++)
+    {
+        stat = etgEventTable[index].effectStatic;
+        if (stat == NULL)
+        {
+            continue;
+        }
+        if (stat->execStats.nOpcodes > etgExecBusiestStats.nOpcodes)
+        {
+            etgExecBusiestStats = stat->execStats;
+            strncpy(etgExecBusiestName, stat->name, ETG_ExecNameLength - 1);
+            etgExecBusiestName[ETG_ExecNameLength - 1] = 0;
+        }
+        stat->execLast = stat->execStats;
+        memset(&stat->execStats, 0, sizeof(stat->execStats));
+    }
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+    Name        : etgEffectParticlesDeferrable
+    Description : Returns TRUE if etgEffectDraw will update this effect's
+                  particle systems without running any effect code first,
+                  so etgEffectsUpdateParticles may do it for it.  Must match
+                  the tests the render list walk makes in rndDrawScene.
+    Inputs      : effect
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static bool etgEffectParticlesDeferrable(Effect *effect)
+{
+    Bullet *bullet;
+
+    if (effect->timeElapsed < 0.0f)
+    {                                                       //not started, won't be drawn
+        return FALSE;
+    }
+    if (effect->owner != NULL && effect->owner->objtype == OBJ_BulletType)
+    {
+        bullet = (Bullet *)effect->owner;
+        if (bullet->bulletType == BULLET_Laser)
+        {                                                   //effect is updated again just before it's drawn
+            return FALSE;
+        }
+        if (bullet->bulletType == BULLET_Beam && bullet->timelived <= UNIVERSE_UPDATE_PERIOD)
+        {                                                   //beam isn't drawn yet
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : etgParticleUpdateJob
+    Description : Job to update a range of the staged particle systems.
+    Inputs      : data - etgPartUpdates
+                  first, last - range to update
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void etgParticleUpdateJob(void *data, sdword first, sdword last)
+{
+    etgpartupdate *entry = (etgpartupdate *)data + first;
+
+    for (; first < last; first++, entry++)
+    {                                                       //velvec isn't used
+        partUpdateSystem(entry->psys, entry->timeElapsed, NULL);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : etgEffectsUpdateParticles
+    Description : Updates the particle systems of the effects on a render
+                  list on the job threads, before the render list is drawn.
+                  Particles are only for show and a system only touches its
+                  own memory when updated, so the systems may be updated in
+                  any order.  Switched off by ETG_PARTICLES_PARALLEL, in
+                  which case etgEffectDraw updates each system as before.
+    Inputs      : objnode - head of the render list about to be drawn
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void etgEffectsUpdateParticles(Node *objnode)
+{
+    Effect *effect;
+    pointSystem *part;
+    real32 timeElapsed;
+    sdword index;
+
+    pupBeginUpdate();
+    etgNumPartUpdates = 0;
+    etgPartUpdateCursor = 0;
+    etgPartUpdateTime = universe.totaltimeelapsed;
+
+    if (!ETG_PARTICLES_PARALLEL)
+    {
+        return;
+    }
+
+    for (; objnode != NULL; objnode = objnode->next)
+    {
+        effect = (Effect *)listGetStructOfNode(objnode);
+        if (effect->objtype != OBJ_EffectType || !etgEffectParticlesDeferrable(effect))
+        {
+            continue;
+        }
+        for (index = 0; index < effect->iParticleBlock; index++)
+        {
+            part = (pointSystem *)effect->particleBlock[index];
+            if (part == NULL)
+            {
+                continue;
+            }
+            timeElapsed = universe.totaltimeelapsed - part->lastUpdated;
+            if (timeElapsed < 0)
+            {
+                continue;
+            }
+            if (etgNumPartUpdates >= etgPartUpdatesMax)
+            {
+                etgPartUpdatesMax += ETG_PartGrowBy;
+                etgPartUpdates = memRealloc(etgPartUpdates, etgPartUpdatesMax * sizeof(etgpartupdate), "etgPartUpdates", NonVolatile);
+            }
+            etgPartUpdates[etgNumPartUpdates].psys = (psysPtr)part;
+            etgPartUpdates[etgNumPartUpdates].timeElapsed = timeElapsed;
+            etgNumPartUpdates++;
+            part->lastUpdated = universe.totaltimeelapsed;
+        }
+    }
+
+    jobParallelFor(etgNumPartUpdates, ETG_PartJobGrain, etgParticleUpdateJob, NULL, etgPartUpdates);
+}
+
 /*-----------------------------------------------------------------------------
     Name        : etgEffectDraw
     Description : Draw an effect
@@ -2383,11 +2800,20 @@ void etgEffectDraw(Effect *effect)
         if (effect->particleBlock[index] != NULL)
         {
             part = (pointSystem *)effect->particleBlock[index];
-            timeElapsed = universe.totaltimeelapsed - part->lastUpdated;
-            if (timeElapsed >= 0)
+            if (etgPartUpdateCursor < etgNumPartUpdates &&
+                etgPartUpdates[etgPartUpdateCursor].psys == (psysPtr)part &&
+                etgPartUpdateTime == universe.totaltimeelapsed)
+            {                                               //already updated by etgEffectsUpdateParticles
+                etgPartUpdateCursor++;
+            }
+            else
             {
-				partUpdateSystem((psysPtr)effect->particleBlock[index], timeElapsed, &velInverse); //update the particle
-                part->lastUpdated = universe.totaltimeelapsed;
+                timeElapsed = universe.totaltimeelapsed - part->lastUpdated;
+                if (timeElapsed >= 0)
+                {
+                    partUpdateSystem((psysPtr)effect->particleBlock[index], timeElapsed, &velInverse); //update the particle
+                    part->lastUpdated = universe.totaltimeelapsed;
+                }
             }
 
             if (bitTest(part->flags, PART_WORLDSPACE))
@@ -2745,6 +3171,12 @@ etgeffectstatic *etgEffectStaticFind(char *name, bool bRegister)
     newStatic = memAlloc(sizeof(etgeffectstatic), "EffectStatic", NonVolatile);
     newStatic->name = memStringDupeNV(name);
     newStatic->nParticleBlocks = 0xffffffff;                //mark as not yet allocated
+    memset(newStatic->thread, 0, sizeof(newStatic->thread));//not pre-decoded yet
+    newStatic->batchIndex = 0;
+#if ETG_EXEC_STATS
+    memset(&newStatic->execStats, 0, sizeof(newStatic->execStats));
+    memset(&newStatic->execLast, 0, sizeof(newStatic->execLast));
+#endif
     free->effectStatic = newStatic;                         //store the effect reference
     free->loadCount = etgEventLoadCount;                    //store the effect load counter
 //    etgEventIndex++;
@@ -3484,6 +3916,108 @@ void etgForwardReferenceFix(ubyte *codeSegment, sdword segmentLength)
     }
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : etgOpcodeLength
+    Description : Find the length of an opcode in a code block.
+    Inputs      : opcode - opcode to find length of
+                  remaining - bytes left in the code block
+    Outputs     :
+    Return      : length of opcode, or all that is left if it is not valid
+----------------------------------------------------------------------------*/
+udword etgOpcodeLength(ubyte *opcode, udword remaining)
+{
+    udword op = *((udword *)opcode);
+
+    if (op == EOP_Function)
+    {
+        return(etgFunctionSize(((etgfunctioncall *)opcode)->nParameters));
+    }
+    if (op >= EOP_LastOp)
+    {
+        return(remaining);
+    }
+    return(etgHandleTable[op].length);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : etgCodeThreadCreate
+    Description : Pre-decode a code block of an effect static so it can be run
+                    without looking up each opcode's handler and length.
+    Inputs      : stat - effect static, with code blocks and constant data
+                    already distilled
+                  codeBlock - which code block (EPM_Startup etc.)
+    Outputs     : Allocates stat->thread[codeBlock].  Function calls in the
+                    code block have their wrapper function looked up and
+                    constant labels turned into pointers into stat->constData.
+    Return      : void
+----------------------------------------------------------------------------*/
+void etgCodeThreadCreate(etgeffectstatic *stat, sdword codeBlock)
+{
+    ubyte *code = stat->codeBlock[codeBlock].code;
+    udword length = stat->codeBlock[codeBlock].length;
+    etgthread *thread = &stat->thread[codeBlock];
+    udword offset, opLength, op, nOps, index, param;
+    etgfunctioncall *call;
+#ifdef GENERIC_ETGCALLFUNCTION
+    opfunctionentry *entry;
+#endif
+
+    for (nOps = offset = 0; offset < length; nOps++)
+    {                                                       //count the opcodes
+        offset += etgOpcodeLength(code + offset, length - offset);
+    }
+    thread->op = memAlloc(sizeof(etgthreadop) * (nOps + 1) +
+                          sizeof(uword) * (length / sizeof(udword) + 1), "EffectThread", NonVolatile);
+    thread->index = (uword *)(thread->op + nOps + 1);
+    thread->length = length;
+    for (index = 0; index <= length / sizeof(udword); index++)
+    {                                                       //offsets not at an opcode end execution
+        thread->index[index] = (uword)nOps;
+    }
+
+    for (index = offset = 0; offset < length; index++, offset += opLength)
+    {
+        op = *((udword *)(code + offset));
+        opLength = etgOpcodeLength(code + offset, length - offset);
+        dbgAssertOrIgnore((offset & (sizeof(udword) - 1)) == 0);
+        thread->index[offset / sizeof(udword)] = (uword)index;
+        thread->op[index].opcode = code + offset;
+        thread->op[index].length = opLength;
+        if (op >= EOP_LastOp || etgHandleTable[op].function == NULL)
+        {                                                   //report it only if it's reached
+            thread->op[index].function = etgBadOpcode;
+            continue;
+        }
+        thread->op[index].function = etgHandleTable[op].function;
+        if (op == EOP_Function)
+        {
+            call = (etgfunctioncall *)(code + offset);
+#ifdef GENERIC_ETGCALLFUNCTION
+            for (entry = etgFunctionTable; entry->name != NULL; entry++)
+            {                                               //use the table's wrapper if it has one
+                if (entry->function == call->function)
+                {
+                    call->wrap_function = entry->wrap_function;
+                    break;
+                }
+            }
+#endif
+            for (param = 0; param < call->nParameters; param++)
+            {                                               //fold constant labels to pointers
+                if (call->parameter[param].type == EVT_ConstLabel)
+                {
+                    call->parameter[param].param += (memsize)stat->constData;
+                    call->parameter[param].type = EVT_Constant;
+                }
+            }
+        }
+    }
+    //end marker
+    thread->op[nOps].function = NULL;
+    thread->op[nOps].opcode = code + length;
+    thread->op[nOps].length = 0;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : etgEffectCodeLoad
     Description : Load in an effect from a .etg file.
@@ -3670,6 +4204,10 @@ foundThisNewEffect:;
         newStatic->constData = memAlloc(newStatic->constLength, "ConstData", NonVolatile);
         memcpy(newStatic->constData, etgConstData, newStatic->constLength);
     }
+    //pre-decode the code blocks, now that the constant data has found its home
+    etgCodeThreadCreate(newStatic, EPM_Startup);
+    etgCodeThreadCreate(newStatic, EPM_EachFrame);
+    etgCodeThreadCreate(newStatic, EPM_TimeIndex);
     //create a history list, if applicable
     if (newStatic->nHistoryList > 0)
     {
@@ -5491,9 +6029,6 @@ sdword etgSpawnParse(struct etgeffectstatic *stat, ubyte *dest, char *opcodeStri
 void etgCreationCallback(sdword userValue, ubyte *userData)
 {
     sdword codeBlock, offset;
-    udword opcode;
-    sdword size;
-    ubyte *pOpcode;
 #define effect          ((Effect *)userData)
     etgeffectstatic *stat = (etgeffectstatic *)effect->staticinfo;
 
@@ -5503,25 +6038,7 @@ void etgCreationCallback(sdword userValue, ubyte *userData)
     //set the current code offset to the start of the callback code block
     etgExecStack.etgCodeBlock[codeBlock].offset = (udword)userValue;
     //execute this little chunk of code until we find an end code
-    while (etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset <
-           etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].length)
-    {
-        pOpcode = etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].code + etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset;
-        opcode = *((udword *)pOpcode);                      //get an opcode
-#if ETG_ERROR_CHECKING
-        if (opcode < 0 || opcode >= EOP_LastOp)
-        {
-            dbgFatalf(DBG_Loc, "Effect '%s' has a bad opcode in code segment %d offset %d", stat->name, etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].code, etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset);
-        }
-        if (etgHandleTable[opcode].function == NULL)
-        {
-            dbgFatalf(DBG_Loc, "etgEffectCodeExecute: NULL opcode %d", opcode);
-        }
-#endif
-        //execute the opcode
-        size = etgHandleTable[opcode].function(effect, stat, pOpcode);
-        etgExecStack.etgCodeBlock[etgExecStack.etgCodeBlockIndex].offset += size;
-    }
+    etgCodeThreadExecute(stat, effect);
     //restore the code block info
     etgExecStack.etgCodeBlockIndex = codeBlock;
     etgExecStack.etgCodeBlock[codeBlock].offset = offset;
@@ -5789,6 +6306,15 @@ sdword etgNOP(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode)
     return(sizeof(etgnop));
 }
 
+//stands in for opcodes with no handler when a code block is pre-decoded
+sdword etgBadOpcode(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode)
+{
+#if ETG_ERROR_CHECKING
+    dbgFatalf(DBG_Loc, "Effect '%s' has a bad opcode %d", stat->name, *((udword *)opcode));
+#endif
+    return(0x100000);                                       //stop execution as 'end' does
+}
+
 //handle variable copy
 sdword etgVarCopy(Effect *effect, struct etgeffectstatic *stat, ubyte *opcode)
 {
@@ -5814,25 +6340,8 @@ sdword etgFunctionCall(Effect *effect, struct etgeffectstatic *stat, ubyte *opco
     udword nParams = opptr->nParameters;
     memsize returnValue = opptr->returnValue;
 
-    opfunctionentry *entry = NULL;
-    udword currEntry = 0;
-    while ((entry = &etgFunctionTable[currEntry++])->name != NULL)
-    {
-        if (entry->function == opptr->function)
-        {
-            break;
-        }
-    }
-
-	if (entry->name == NULL)
-	{
-		entry = NULL;
-	}
-
-    if (entry)
-        param = entry->wrap_function(effect, stat, opptr);		//call the function
-    else
-        param = opptr->wrap_function(effect, stat, opptr);
+    //wrapper was looked up when the code block was pre-decoded
+    param = opptr->wrap_function(effect, stat, opptr);		//call the function
 
     if (returnValue != MINUS1)                           //if a return value is desired
     {
@@ -7632,7 +8141,7 @@ void etgCreateEffects(Effect *effect, etgeffectstatic *stat, sdword number, sdwo
             continue;
         }
         size = stat->effectSize;
-        newEffect = memAlloc(size, "Ef(Effect)", Pyrophoric);   //allocate the new effect
+        newEffect = memSlabAlloc(MSP_Effect, size, "Ef(Effect)");   //allocate the new effect
         newEffect->objtype = OBJ_EffectType;
         newEffect->flags = SOF_Rotatable;
         newEffect->staticinfo = (StaticInfo *)stat;
@@ -7740,7 +8249,7 @@ void *etgEffectCreate(etgeffectstatic *stat, void *owner, vector *pos, vector *v
     smemsize arg[ETG_NumberParameters];
     Effect *newEffect;
 
-    newEffect = memAlloc(stat->effectSize, "GE(GenEffect)", Pyrophoric);//allocate the new effect
+    newEffect = memSlabAlloc(MSP_Effect, stat->effectSize, "GE(GenEffect)");//allocate the new effect
 
     newEffect->objtype = OBJ_EffectType;                    //type of spaceobj
     newEffect->flags = SOF_Rotatable | flags;               //basic flags
@@ -7950,7 +8459,7 @@ memsize etgSpawnNewEffect(Effect *effect, etgeffectstatic *stat, sdword nParams,
 
 //    size = etgEffectSize(stat->nParticleBlocks);            //compute size of effect
     size = stat->effectSize;
-    newEffect = memAlloc(size, "Ef(Effect)", Pyrophoric);       //allocate the new effect
+    newEffect = memSlabAlloc(MSP_Effect, size, "Ef(Effect)");       //allocate the new effect
     newEffect->objtype = OBJ_EffectType;
     if (etgEffOffset.attachParent && effect->owner != NULL)
     {
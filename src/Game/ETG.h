@@ -12,6 +12,7 @@
 
 #include "ClassDefs.h"
 #include "Color.h"
+#include "LinkedList.h"
 #include "ObjTypes.h"
 #include "Matrix.h"
 #include "Mesh.h"
@@ -32,6 +33,7 @@
 #define ETG_RELOAD_KEY              RKEY        //reload all effects key
 #define ETG_DISABLEABLE             1           //disable effects
 #define ETG_DETATCH_STATS           1           //display special owner detachment stats
+#define ETG_EXEC_STATS              1           //count opcodes executed per effect type
 
 #else
 
@@ -41,6 +43,7 @@
 #define ETG_RELOAD_KEY              0
 #define ETG_DISABLEABLE             0           //disable effects
 #define ETG_DETATCH_STATS           0           //display special owner detachment stats
+#define ETG_EXEC_STATS              0           //count opcodes executed per effect type
 
 #endif
 
@@ -515,6 +518,34 @@ typedef struct
 }
 etgcodeblock;
 
+//pre-decoded opcode, built from a code block when the effect is loaded
+typedef struct
+{
+    ophandlefunction function;                  //handler for this opcode
+    ubyte *opcode;                              //opcode structure in the shared code block
+    udword length;                              //offset to the following opcode
+}
+etgthreadop;
+
+//pre-decoded form of a code block
+typedef struct
+{
+    etgthreadop *op;                            //opcodes in code order, ending with a NULL function
+    uword *index;                               //op index by (code offset / sizeof(udword))
+    udword length;                              //length of the code block
+}
+etgthread;
+
+#if ETG_EXEC_STATS
+//execution counters, reset every universe update
+typedef struct
+{
+    udword nEffects;                            //effects updated
+    udword nOpcodes;                            //opcodes executed
+}
+etgexecstats;
+#endif
+
 //structure for making an alternate decision
 typedef struct
 {
@@ -549,12 +580,18 @@ typedef struct etgeffectstatic
     etgalternate *decisions;
     udword *alternateOffsets;                   //offset tables for alternates
     etgcodeblock codeBlock[ETG_NumberCodeBlocks];//startup, eachframe and time index
+    etgthread thread[ETG_NumberCodeBlocks];     //pre-decoded form of the above
     sdword nHistoryList;                        //length of history list
     sdword iHistoryList;                        //index into history list
     real32 *historyList;                        //actual history list
 //    bool8  bSelfDeleting;                       //has a delete() opcode
 //    char   pad[3];                              //round the size up
     udword specialOps;                          //special operations this effect does
+    sdword batchIndex;                          //used by etgEffectsUpdate to group effects by type
+#if ETG_EXEC_STATS
+    etgexecstats execStats;                     //this update's counters for this effect type
+    etgexecstats execLast;                      //counters from the last universe update
+#endif
 }
 etgeffectstatic;
 
@@ -616,6 +653,12 @@ extern ubyte etgDeathModeByGunType[];
 extern sdword etgEffectsEnabled;
 extern bool etgErrorRecoverable;
 extern bool etgErrorEncountered;
+#if ETG_EXEC_STATS
+extern etgexecstats etgExecStats;               //totals for the last universe update
+extern udword etgExecTypes;                     //effect types updated in the last universe update
+extern char etgExecBusiestName[];                //effect type which executed the most opcodes
+extern etgexecstats etgExecBusiestStats;
+#endif
 
 
 //variables for ETG user tweaks:
@@ -668,8 +711,13 @@ void etgHistoryRegisterFunction(etgeffectstatic *stat);
 
 //update effects
 bool etgEffectUpdate(struct Effect *effect, real32 timeElapsed);
+void etgEffectsUpdate(real32 timeElapsed);
 void etgEffectDraw(struct Effect *effect);
+void etgEffectsUpdateParticles(Node *objnode);
 void etgShipDied(struct Ship *deadDuck);
+#if ETG_EXEC_STATS
+void etgExecStatsReset(void);
+#endif
 sdword etgDeleteEffectsOwnedBy(struct Ship *owner);
 
 //mesh registry stuff
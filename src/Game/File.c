@@ -12,10 +12,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-#include "BitIO.h"
 #include "Debug.h"
 #include "File.h"
-#include "LZSS.h"
 #include "Memory.h"
 
 #ifdef _WIN32
@@ -25,6 +23,9 @@
 #else
     #include <dirent.h>
     #include <ctype.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
 #endif
 
 #if defined _MSC_VER
@@ -39,14 +40,28 @@
     #define FILE_SEEK_WARNING       1       // display warnings as seeks are required
     #define FILE_TEST               0       // test the file module
     #define FILE_VERBOSE_LEVEL      1       // control level of verbose info
+    #define FILE_LOOKUP_STATS       0       // count lookup cache hits and misses
 #else
     #define FILE_ERROR_CHECKING     0
     #define FILE_OPEN_LOGGING       0
     #define FILE_SEEK_WARNING       0
     #define FILE_TEST               0
     #define FILE_VERBOSE_LEVEL      0
+    #define FILE_LOOKUP_STATS       0
 #endif
 
+#define FILE_LookupMinSize          256     // lookup cache slots, power of 2
+#define FILE_LookupMaxLoadNumer     3       // grow when more than 3/4 of the slots are used
+#define FILE_LookupMaxLoadDenom     4
+
+//  one disk search done by fileNameCorrectCase, hash 0 is an empty slot
+typedef struct
+{
+    udword hash;
+    char  *key;                     // path as asked for, case folded
+    char  *path;                    // path with its on-disk case, NULL if it doesn't exist
+} filelookupslot;
+
 
 struct stat fileStat;
 
@@ -91,6 +106,16 @@ static char  *decompWorkspaceP     = NULL;
 static sdword decompWorkspaceSize  = 0;
 static sdword decompWorkspaceInUse = FALSE;
 
+//  disk searches already done, so startup doesn't walk the same directories
+//  hundreds of times; open addressed, see fileNameCorrectCase
+static filelookupslot *fileLookupSlots = NULL;
+static udword fileLookupSize  = 0;
+static udword fileLookupCount = 0;
+#if FILE_LOOKUP_STATS
+static udword fileLookupHits   = 0;
+static udword fileLookupMisses = 0;
+#endif
+
 
 /*=============================================================================
     Functions:
@@ -329,10 +354,11 @@ static void fileNameReducePath (char* pathName)
 
 
 /*-----------------------------------------------------------------------------
-    Name        : fileNameCorrectCase
+    Name        : fileNameSearchCase
     Description : Perform a case-insensitive search for the given file or
                   directory, modifying the path string to represent its case
-                  on the filesystem.
+                  on the filesystem.  Goes to the disk every time, use
+                  fileNameCorrectCase instead.
     Inputs      : fileName - Path and name of file.
     Outputs     : fileName - The modified file name.  This will not be
                     modified if the file is not found.
@@ -340,7 +366,7 @@ static void fileNameReducePath (char* pathName)
 ----------------------------------------------------------------------------*/
 #if FILE_CASE_INSENSITIVE_SEARCH
 
-static bool8 fileNameCorrectCase (char* fileName)
+static bool8 fileNameSearchCase (char* fileName)
 {
 	char fileNameCopy[PATH_MAX + 1];
 	char* pChar;
@@ -628,7 +654,7 @@ static bool8 fileNameCorrectCase (char* fileName)
    when we don't want to manually perform case-insensitive searches yet still
    give the same results on platforms that use case-insensitive file
    systems. */
-static bool8 fileNameCorrectCase (char* fileName)
+static bool8 fileNameSearchCase (char* fileName)
 {
 	char fileNameCopy[PATH_MAX + 1];
 	struct stat fileInfo;
@@ -660,6 +686,200 @@ static bool8 fileNameCorrectCase (char* fileName)
 
 #endif  /* FILE_CASE_INSENSITIVE_SEARCH */
 
+/*-----------------------------------------------------------------------------
+    Name        : fileLookupHash
+    Description : Case folds a path and hashes it, for the lookup cache
+    Inputs      : fileName - path to fold
+    Outputs     : key - the folded path, PATH_MAX + 1 characters
+    Return      : hash of key, never 0
+----------------------------------------------------------------------------*/
+static udword fileLookupHash(char *fileName, char *key)
+{
+    udword i;
+    udword hash;
+
+    for (i = 0; i < PATH_MAX && (key[i] = tolower(fileName[i])); i++)
+    {
+        if (key[i] == '\\')
+        {
+            key[i] = '/';
+        }
+    }
+    key[i] = '\0';
+
+    hash = crc32Compute((ubyte *)key, i);
+    return hash ? hash : 1;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileLookupFind
+    Description : Finds a path in the lookup cache
+    Inputs      : key, hash - as returned by fileLookupHash
+    Outputs     :
+    Return      : the slot holding key, or the empty slot it belongs in
+----------------------------------------------------------------------------*/
+static filelookupslot *fileLookupFind(char *key, udword hash)
+{
+    udword mask = fileLookupSize - 1;
+    udword slot = hash & mask;
+
+    while (fileLookupSlots[slot].hash != 0 &&
+           (fileLookupSlots[slot].hash != hash || strcmp(fileLookupSlots[slot].key, key) != 0))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return &fileLookupSlots[slot];
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileLookupClear
+    Description : Empties the lookup cache, after something on disk changed
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void fileLookupClear(void)
+{
+    udword i;
+
+    for (i = 0; i < fileLookupSize; i++)
+    {
+        if (fileLookupSlots[i].hash != 0)
+        {
+            free(fileLookupSlots[i].key);
+            free(fileLookupSlots[i].path);
+        }
+    }
+    free(fileLookupSlots);
+    fileLookupSlots = NULL;
+    fileLookupSize  = 0;
+    fileLookupCount = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileLookupInsert
+    Description : Remembers the outcome of a disk search, growing the cache as
+                  needed.  If memory runs out the result just isn't cached.
+    Inputs      : key, hash - as returned by fileLookupHash
+                  path - path with its on-disk case, or NULL if not found
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void fileLookupInsert(char *key, udword hash, char *path)
+{
+    filelookupslot *slot;
+
+    if ((fileLookupCount + 1) * FILE_LookupMaxLoadDenom > fileLookupSize * FILE_LookupMaxLoadNumer)
+    {
+        filelookupslot *oldSlots = fileLookupSlots;
+        udword oldSize = fileLookupSize, i;
+        udword newSize = max(oldSize * 2, FILE_LookupMinSize);
+        filelookupslot *newSlots = calloc(newSize, sizeof(filelookupslot));
+
+        if (newSlots == NULL)
+        {
+            return;
+        }
+        fileLookupSlots = newSlots;
+        fileLookupSize  = newSize;
+        for (i = 0; i < oldSize; i++)
+        {
+            if (oldSlots[i].hash != 0)
+            {
+                *fileLookupFind(oldSlots[i].key, oldSlots[i].hash) = oldSlots[i];
+            }
+        }
+        free(oldSlots);
+    }
+
+    slot = fileLookupFind(key, hash);
+    dbgAssertOrIgnore(slot->hash == 0);
+    slot->key  = strdup(key);
+    slot->path = path != NULL ? strdup(path) : NULL;
+    if (slot->key == NULL || (path != NULL && slot->path == NULL))
+    {
+        free(slot->key);
+        free(slot->path);
+        slot->key  = NULL;
+        slot->path = NULL;
+        return;
+    }
+    slot->hash = hash;
+    fileLookupCount++;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileNameCorrectCase
+    Description : Perform a case-insensitive search for the given file or
+                  directory, modifying the path string to represent its case
+                  on the filesystem.  Results are cached, so a name is only
+                  searched for on disk once; the user settings area, where
+                  the game writes, is always searched.
+    Inputs      : fileName - Path and name of file.
+    Outputs     : fileName - The modified file name.  This will not be
+                    modified if the file is not found.
+    Return      : TRUE if the file was found, FALSE if not.
+----------------------------------------------------------------------------*/
+static bool8 fileNameCorrectCase (char* fileName)
+{
+    char key[PATH_MAX + 1];
+    udword hash;
+    filelookupslot *slot;
+    bool8 found;
+
+    if (fileUserSettingsPath[0] != '\0' &&
+        strncmp(fileName, fileUserSettingsPath, strlen(fileUserSettingsPath)) == 0)
+    {
+        return fileNameSearchCase(fileName);
+    }
+
+    hash = fileLookupHash(fileName, key);
+    if (fileLookupSize != 0)
+    {
+        slot = fileLookupFind(key, hash);
+        if (slot->hash != 0)
+        {
+#if FILE_LOOKUP_STATS
+            fileLookupHits++;
+#endif
+            if (slot->path == NULL)
+            {
+                return FALSE;
+            }
+            dbgAssertOrIgnore(strlen(slot->path) <= strlen(fileName));
+            strcpy(fileName, slot->path);
+            return TRUE;
+        }
+    }
+
+#if FILE_LOOKUP_STATS
+    fileLookupMisses++;
+#endif
+    found = fileNameSearchCase(fileName);
+    fileLookupInsert(key, hash, found ? fileName : NULL);
+    return found;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileLookupInvalidate
+    Description : Forgets every cached disk lookup and rescans the override
+                  directory against the bigfiles.  Call after files are added
+                  to or removed from the data or override directories while
+                  the game is running.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void fileLookupInvalidate(void)
+{
+#if FILE_LOOKUP_STATS
+    dbgMessagef("fileLookupInvalidate: %d paths cached, %d hits, %d misses",
+                fileLookupCount, fileLookupHits, fileLookupMisses);
+#endif
+    fileLookupClear();
+    bigRefreshOverrides();
+}
+
 
 /*-----------------------------------------------------------------------------
     Name        : fileMakeDirectory
@@ -736,6 +956,9 @@ bool8 fileMakeDirectory (const char* directoryName)
 		}
 	}
 
+	/* Any of these may be cached as missing. */
+	fileLookupClear();
+
 	/* Create each directory as needed. */
 	while (pChar)
 	{
@@ -840,6 +1063,21 @@ sdword fileLoadAlloc(char *_fileName, void **address, udword flags)
     {
         if (bigFindFile(_fileName, &whereFound, &bigFileIndex))
         {
+#if !FIX_ENDIAN                                             // big endian callers swap the data in place
+            if (bitTest(flags, FF_ZeroCopy))
+            {                                               //read only and stored uncompressed: use it where it lies
+                *address = bigFileMapped(whereFound, bigFileIndex, &bigfileResult);
+                if (*address != NULL)
+                {
+                    if (LogFileLoads)
+                    {
+                        logfileLogf(FILELOADSLOG, "%s | %s (mapped)\n", whereFound->bigFileName, _fileName);
+                    }
+
+                    return bigfileResult;
+                }
+            }
+#endif
             bigfileResult = bigFileLoadAlloc(&(whereFound->tableOfContents), whereFound->filePtr, _fileName, bigFileIndex, address);
             if (bigfileResult != -1)
             {
@@ -905,6 +1143,23 @@ sdword fileLoadAlloc(char *_fileName, void **address, udword flags)
     return length;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : fileLoadFree
+    Description : Frees a file loaded with fileLoadAlloc.  Use this instead of
+                  memFree for anything loaded with FF_ZeroCopy, as it may point
+                  into a mapped .BIG file.
+    Inputs      : address - pointer returned by fileLoadAlloc
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void fileLoadFree(void *address)
+{
+    if (!bigFileMapContains(address))
+    {
+        memFree(address);
+    }
+}
+
 /*-----------------------------------------------------------------------------
     Name        : fileLoad
     Description : Loads named file into specified address.
@@ -1009,6 +1264,8 @@ sdword fileSave(char *_fileName, void *address, sdword length)
         dbgFatalf(DBG_Loc, "fileSave: couldn't open file %s", fileName);
     }
 
+    fileLookupClear();                                       //it exists now
+
     lengthWrote = fwrite(address,1,length,outFile);
 
 #if FILE_ERROR_CHECKING
@@ -1129,6 +1386,135 @@ void fileDelete(char *_fileName)
     fileNameReplaceSlashesInPlace(fileName);
 
     remove(fileName);
+    fileLookupClear();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileMapReadOnly
+    Description : Maps a whole file on disk into memory, read only.  Where
+                  the platform can't map it the file is read into malloc'd
+                  memory instead, so callers always get one contiguous view.
+                  Files inside .BIG archives are not handled.
+    Inputs      : fileName - name of file to map
+                  flags - path flags, as for fileOpen; FF_MapOnly to fail
+                      instead of reading the file in
+    Outputs     : map - filled in on success, close it with fileUnmap
+    Return      : TRUE on success
+----------------------------------------------------------------------------*/
+bool fileMapReadOnly(char *_fileName, udword flags, filemap *map)
+{
+    char *fileName;
+    FILE *file;
+
+    memset(map, 0, sizeof(filemap));
+
+    fileName = filePathPrepend(_fileName, flags);            //get full path
+    fileNameCorrectCase(fileName);
+
+#ifdef _WIN32
+    {
+        HANDLE fileHandle = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return FALSE;
+        }
+        map->length = (sdword)GetFileSize(fileHandle, NULL);
+        if (map->length > 0)
+        {
+            map->mapping = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (map->mapping != NULL)
+            {
+                map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+                if (map->data == NULL)
+                {
+                    CloseHandle(map->mapping);
+                    map->mapping = NULL;
+                }
+            }
+        }
+        CloseHandle(fileHandle);
+    }
+#else
+    {
+        struct stat mapStat;
+        int fd = open(fileName, O_RDONLY);
+
+        if (fd < 0)
+        {
+            return FALSE;
+        }
+        if (fstat(fd, &mapStat) == 0 && mapStat.st_size > 0 && mapStat.st_size <= SDWORD_Max)
+        {
+            void *data = mmap(NULL, (size_t)mapStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            map->length = (sdword)mapStat.st_size;
+            if (data != MAP_FAILED)
+            {
+                map->data = data;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (map->data != NULL)
+    {
+        map->mapped = TRUE;
+        return TRUE;
+    }
+    if (bitTest(flags, FF_MapOnly))
+    {
+        memset(map, 0, sizeof(filemap));
+        return FALSE;
+    }
+
+    // no mapping, read it in instead
+    if ((file = fopen(fileName, "rb")) == NULL)
+    {
+        return FALSE;
+    }
+    fseek(file, 0, SEEK_END);
+    map->length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    map->data = malloc(max(map->length, 1));
+    if (map->data == NULL || (sdword)fread(map->data, 1, map->length, file) != map->length)
+    {
+        fclose(file);
+        free(map->data);
+        memset(map, 0, sizeof(filemap));
+        return FALSE;
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : fileUnmap
+    Description : Releases a file mapped with fileMapReadOnly
+    Inputs      : map
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void fileUnmap(filemap *map)
+{
+    if (map->data == NULL)
+    {
+        return;
+    }
+    if (map->mapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+        CloseHandle(map->mapping);
+#else
+        munmap(map->data, (size_t)map->length);
+#endif
+    }
+    else
+    {
+        free(map->data);
+    }
+    memset(map, 0, sizeof(filemap));
 }
 
 /*-----------------------------------------------------------------------------
@@ -1149,8 +1535,6 @@ filehandle fileOpen(char *_fileName, udword flags)
     bool usingBigfile    = FALSE;
     bool firstBufUse     = FALSE;
     bool localFileExists = FALSE;
-    int expandedSize, storedSize;
-    BitFile *bitFile;
 
     //  find next available filehandle
     fh = 1;
@@ -1270,11 +1654,7 @@ filehandle fileOpen(char *_fileName, udword flags)
                 }
                 // decompress from file directly into workspace
                 fseek(filesOpen[fh].bigFP, filesOpen[fh].offsetStart, SEEK_SET);
-                bitFile = bitioFileInputStart(filesOpen[fh].bigFP);
-                expandedSize = lzssExpandFileToBuffer(bitFile, filesOpen[fh].decompBuf, filesOpen[fh].length);
-                storedSize = bitioFileInputStop(bitFile);
-                dbgAssertOrIgnore(expandedSize == filesOpen[fh].length);
-                dbgAssertOrIgnore(storedSize == (filesOpen[fh].bigTOC->fileEntries + fileIndex)->storedLength);
+                bigFileExpand(filesOpen[fh].bigTOC->fileEntries + fileIndex, filesOpen[fh].bigFP, filesOpen[fh].decompBuf);
             }
             else
             {
@@ -1343,6 +1723,11 @@ filehandle fileOpen(char *_fileName, udword flags)
         return 0;
     }
 
+    if (bitTest(flags, FF_AppendMode | FF_WriteMode))
+    {
+        fileLookupClear();                                   //may be creating it
+    }
+
     if ((file = fopen(fileName, access)) == NULL)
     {
         if (bitTest(flags, FF_ReturnNULLOnFail))
@@ -1928,6 +2313,7 @@ void fileHomeworldDataPathSet(char *path)
 bool fileOverrideBigPathSet(char *path)
 {
     filePathMaxBufferSet(fileOverrideBigPath, path);
+    fileLookupInvalidate();
     return TRUE;
 }
 
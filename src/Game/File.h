@@ -56,6 +56,8 @@
 #define FF_IgnorePrepend        0x0200          // don't environment root path to beginning of file names
 #define FF_UserSettingsPath     0x0400          // use user configuration root as the base path
 #define FF_HomeworldDataPath    0x0800          // where the main data files are located
+#define FF_ZeroCopy             0x1000          // fileLoadAlloc: caller won't modify the data, so it may point into a mapped .BIG (release with fileLoadFree)
+#define FF_MapOnly              0x2000          // fileMapReadOnly: fail rather than read the file into memory if it can't be mapped
 
 //names of log files
 #define FN_OpenLog              "open.log"
@@ -96,6 +98,16 @@ typedef struct {
     long length;            // length of file in bigfile (uncompressed length)
 } fileOpenInfo;
 
+// read only view of a whole file on disk, see fileMapReadOnly
+typedef struct {
+    ubyte *data;
+    sdword length;
+    bool mapped;            // FALSE if the platform couldn't map it and data was malloc'd instead
+#ifdef _WIN32
+    void *mapping;          // file mapping object
+#endif
+} filemap;
+
 extern char fileHomeworldDataPath [];
 extern char fileUserSettingsPath  [];
 extern char fileOverrideBigPath   [];
@@ -119,6 +131,10 @@ bool fileUserSettingsPathSet(char *path);
 //load files directly into memory
 sdword fileLoadAlloc(char *fileName, void **address, udword flags);
 sdword fileLoad(char *fileName, void *address, udword flags);
+void fileLoadFree(void *address);
+
+//forget cached file lookups, after data or override files change on disk
+void fileLookupInvalidate(void);
 
 //save files, if you want stream saving, use the ANSI C stream functions
 sdword fileSave(char *fileName, void *address, sdword length);
@@ -126,6 +142,10 @@ sdword fileSave(char *fileName, void *address, sdword length);
 //delete a file
 void fileDelete(char *fileName);
 
+//map a whole file on disk (not in a bigfile) into memory, read only
+bool fileMapReadOnly(char *fileName, udword flags, filemap *map);
+void fileUnmap(filemap *map);
+
 //load files like ANSI C streams (fopen, fread etc)
 filehandle fileOpen(char *fileName, udword flags);
 void fileClose(filehandle handle);
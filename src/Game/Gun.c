@@ -32,6 +32,7 @@
 #include "Physics.h"
 #include "prim3d.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "render.h"
 #include "Ships.h"
 #include "SoundEvent.h"
@@ -517,7 +518,7 @@ void missileShoot(Ship *ship,Gun *gun,SpaceObjRotImpTarg *target)
     gun->numMissiles--;
     gun->lasttimefired = universe.totaltimeelapsed;
 
-    missile = memAlloc(sizeof(Missile),"Missile",0);
+    missile = memSlabAlloc(MSP_Missile, sizeof(Missile), "Missile");
     memset(missile,0,sizeof(Missile));
 
     missile->objtype = OBJ_MissileType;
@@ -598,6 +599,8 @@ void missileShoot(Ship *ship,Gun *gun,SpaceObjRotImpTarg *target)
     missile->playerowner = ship->playerowner;
     missile->owner = ship;
     missile->target = target;
+    refSet((SpaceObj *)missile, REF_Owner, (SpaceObj *)missile->owner);
+    refSet((SpaceObj *)missile, REF_Target, (SpaceObj *)missile->target);
 
     if(missile->FORCE_DROPPED == TRUE)
     {   //force dropped mine only!
@@ -754,6 +757,7 @@ void missileShoot(Ship *ship,Gun *gun,SpaceObjRotImpTarg *target)
     if (target != NULL && target->objtype == OBJ_ShipType)
     {                                                       //if we succeeded in shooting at enemy
         ((Ship *)target)->firingAtUs = ship;
+        refSet((SpaceObj *)target, REF_FiringAtUs, (SpaceObj *)ship);
         ((Ship *)target)->recentlyFiredUpon = RECENT_ATTACK_DURATION;
     }
 }
@@ -895,7 +899,7 @@ void gunShoot(Ship *ship, Gun *gun, SpaceObjRotImpTarg *target)
 
     gun->lasttimefired = universe.totaltimeelapsed;
 
-    bullet = memAlloc(sizeof(Bullet),"Bu(Bullet)",Pyrophoric);
+    bullet = memSlabAlloc(MSP_Bullet, sizeof(Bullet), "Bu(Bullet)");
 
     bullet->objtype = OBJ_BulletType;
     bullet->flags = 0;
@@ -978,6 +982,8 @@ void gunShoot(Ship *ship, Gun *gun, SpaceObjRotImpTarg *target)
     {
         bullet->target = NULL;
     }
+    refSet((SpaceObj *)bullet, REF_Owner, (SpaceObj *)bullet->owner);
+    refSet((SpaceObj *)bullet, REF_Target, (SpaceObj *)bullet->target);
     bullet->bulletColor = etgBulletColor[shipstatic->shiprace][bullet->soundType];
     bullet->bulletmass = gunstatic->bulletmass;
     bullet->lengthmag = gunstatic->bulletlength;
@@ -1217,6 +1223,7 @@ void gunShoot(Ship *ship, Gun *gun, SpaceObjRotImpTarg *target)
     if (target != NULL && target->objtype == OBJ_ShipType)
     {                                                       //if we succeeded in shooting at enemy
         ((Ship *)target)->firingAtUs = ship;
+        refSet((SpaceObj *)target, REF_FiringAtUs, (SpaceObj *)ship);
         ((Ship *)target)->recentlyFiredUpon = RECENT_ATTACK_DURATION;
     }
 }
@@ -1360,6 +1367,7 @@ bool gunShootGunsAtTarget(Ship *ship,SpaceObjRotImpTarg *target,real32 range,vec
     if (shotguns && target->objtype == OBJ_ShipType)
     {                                                       //if we succeeded in shooting at enemy
         ((Ship *)target)->firingAtUs = ship;
+        refSet((SpaceObj *)target, REF_FiringAtUs, (SpaceObj *)ship);
         ((Ship *)target)->recentlyFiredUpon = RECENT_ATTACK_DURATION;
     }
     */
@@ -1486,6 +1494,7 @@ bool gunShootGunsAtMultipleTargets(Ship *ship)
     if (shotguns && target->objtype == OBJ_ShipType)
     {                                                       //if we succeeded in shooting at enemy
         ((Ship *)target)->firingAtUs = ship;
+        refSet((SpaceObj *)target, REF_FiringAtUs, (SpaceObj *)ship);
         ((Ship *)target)->recentlyFiredUpon = RECENT_ATTACK_DURATION;
     }
 */
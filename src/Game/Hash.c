@@ -8,70 +8,221 @@
 
 #include "Hash.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #include "Debug.h"
 #include "Memory.h"
 
+#if HASH_TEST
+#include "SDL.h"
+#include "CRC32.h"
+#endif
+
+#define HASH_BatchSize          8               // lookups in flight at once in hashLookupBatch
+
+#if defined(__GNUC__)
+#define hashPrefetch(p)         __builtin_prefetch((p))
+#else
+#define hashPrefetch(p)
+#endif
+
+// home slot of a key: Fibonacci hashing spreads sequential keys and
+// aligned pointers over the whole table, which key % size did not
+#define hashHome(t, k)          (((k) * 2654435761u) >> (t)->shift)
+#define hashDistance(t, k, pos) (((pos) - hashHome((t), (k))) & (t)->mask)
+
+/*-----------------------------------------------------------------------------
+    Name        : hashSlotsSet
+    Description : allocates an empty slot array of the given size
+    Inputs      : table - the hashtable
+                  size - number of slots, power of 2
+    Outputs     : table->table, size, mask and shift are set
+    Return      :
+----------------------------------------------------------------------------*/
+static void hashSlotsSet(hashtable* table, udword size)
+{
+    udword shift = 32;
+    udword bits;
+
+    for (bits = size; bits > 1; bits >>= 1)
+    {
+        shift--;
+    }
+
+    table->table = (hash_t*)memAlloc(size * sizeof(hash_t), "hash slots", NonVolatile);
+    memset(table->table, 0, size * sizeof(hash_t));
+    table->size = size;
+    table->mask = size - 1;
+    table->shift = shift;
+    table->count = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hashPlace
+    Description : puts a key into the table without checking the load.
+                  Each probe passes any entry which is closer to its home
+                  than we are to ours, carrying the displaced entry on.
+    Inputs      : table - the hashtable
+                  key, data - the entry
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void hashPlace(hashtable* table, udword key, void* data)
+{
+    udword pos = hashHome(table, key);
+    udword dist = 0, slotdist, tempkey;
+    hash_t* slot;
+    void* tempdata;
+
+    for (;;)
+    {
+        slot = &table->table[pos];
+        if (slot->key == 0)
+        {
+            slot->key = key;
+            slot->data = data;
+            table->count++;
+            return;
+        }
+        if (slot->key == key)
+        {
+            /* replace entry's data.  user should really avoid this
+               and free collisions manually before inserting to avoid
+               unreferenced but allocated memory.  A key can only
+               match before the first swap: an entry carried on after
+               a swap is already unique in the table */
+            slot->data = data;
+            return;
+        }
+        slotdist = hashDistance(table, slot->key, pos);
+        if (slotdist < dist)
+        {                                                   //rich entry, take its place
+            tempkey = slot->key;
+            tempdata = slot->data;
+            slot->key = key;
+            slot->data = data;
+            key = tempkey;
+            data = tempdata;
+            dist = slotdist;
+        }
+        pos = (pos + 1) & table->mask;
+        dist++;
+    }
+}
+
+#if HASH_ERROR_CHECKING
+/*-----------------------------------------------------------------------------
+    Name        : hashVerify
+    Description : checks the count and that no entry is further from home
+                  than the run leading up to it allows
+    Inputs      : table - the hashtable
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void hashVerify(hashtable const* table)
+{
+    udword index, count = 0, dist;
+    udword prev = table->mask;
+
+    for (index = 0; index < table->size; prev = index, index++)
+    {
+        if (table->table[index].key == 0)
+        {
+            continue;
+        }
+        count++;
+        dist = hashDistance(table, table->table[index].key, index);
+        if (dist > 0 && table->table[prev].key == 0)
+        {
+            dbgFatalf(DBG_Loc, "hashVerify: key %u is %u slots from home after an empty slot", table->table[index].key, dist);
+        }
+        if (dist > 0 && hashDistance(table, table->table[prev].key, prev) + 1 < dist)
+        {
+            dbgFatalf(DBG_Loc, "hashVerify: key %u is %u slots from home, out of order", table->table[index].key, dist);
+        }
+    }
+    if (count != table->count)
+    {
+        dbgFatalf(DBG_Loc, "hashVerify: %u keys found, count is %u", count, table->count);
+    }
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+    Name        : hashGrow
+    Description : doubles the number of slots and reinserts every entry
+    Inputs      : table - the hashtable
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void hashGrow(hashtable* table)
+{
+    hash_t* oldslots = table->table;
+    udword oldsize = table->size;
+    udword index;
+
+    hashSlotsSet(table, oldsize * 2);
+    for (index = 0; index < oldsize; index++)
+    {
+        if (oldslots[index].key != 0)
+        {
+            hashPlace(table, oldslots[index].key, oldslots[index].data);
+        }
+    }
+    memFree(oldslots);
+#if HASH_ERROR_CHECKING
+    hashVerify(table);
+#endif
+}
+
 /*-----------------------------------------------------------------------------
     Name        : hashNewTable
-    Description : creates a new hashtable structure and initializes
-                  all entries to NULL, sets maxkey to 0
-    Inputs      : size - number of distinct entries in the hash table
+    Description : creates a new, empty hashtable structure, sets maxkey to 0
+    Inputs      : size - number of entries expected.  The table grows as
+                  needed, this just saves growing it early on.
     Outputs     :
     Return      : a freshly allocated hashtable structure
 ----------------------------------------------------------------------------*/
 hashtable* hashNewTable(udword size)
 {
-    int i;
     hashtable* table;
+    udword slots = HASH_MinSize;
 
-    table = (hashtable*)memAlloc((size-1) * sizeof(hash_t) + sizeof(hashtable),
-                                 "hashtable", NonVolatile);
-
-    table->size = size;
-    table->maxkey = 0;
-
-    for (i = 0; i < size; i++)
+    while (slots * HASH_MaxLoadNumer < size * HASH_MaxLoadDenom)
     {
-        table->table[i] = NULL;
+        slots *= 2;
     }
 
+    table = (hashtable*)memAlloc(sizeof(hashtable), "hashtable", NonVolatile);
+    hashSlotsSet(table, slots);
+    table->maxkey = 0;
+
     return table;
 }
 
 /*-----------------------------------------------------------------------------
     Name        : hashDeleteTable
     Description : deletes a hashtable structure, freeing the memory
-                  used by the entry blocks but not what the blocks
-                  contain (because this is a generic hash)
+                  used by the slots but not what the entries point to
+                  (because this is a generic hash)
     Inputs      : table - the hashtable to delete
     Outputs     :
     Return      :
 ----------------------------------------------------------------------------*/
 void hashDeleteTable(hashtable* table)
 {
-    udword i;
-    hash_t* entry;
-    hash_t* next;
-
     dbgAssertOrIgnore(table != NULL);
 
-    for (i = 0; i < table->size; i++)
-    {
-        entry = table->table[i];
-        while (entry)
-        {
-            next = entry->next;
-            memFree(entry);
-            entry = next;
-        }
-    }
-
+    memFree(table->table);
     memFree(table);
 }
 
 /*-----------------------------------------------------------------------------
     Name        : hashLookup
-    Description : lookup given key in given hashtable
+    Description : lookup given key in given hashtable.  The probe stops at
+                  an empty slot or at an entry closer to home than the key
+                  would be, since the key would have displaced it.
     Inputs      : table - the hashtable to search
                   key - the key to search for
     Outputs     :
@@ -79,31 +230,88 @@ void hashDeleteTable(hashtable* table)
 ----------------------------------------------------------------------------*/
 void* hashLookup(hashtable const* table, udword key)
 {
-    udword pos;
-    hash_t* entry;
+    udword pos, dist;
+    hash_t const* slot;
 
     dbgAssertOrIgnore(table != NULL);
 
     if (key == 0)
         return NULL;
 
-    pos = key % table->size;
-    entry = table->table[pos];
-    while (entry)
+    pos = hashHome(table, key);
+    for (dist = 0; ; dist++)
     {
-        if (entry->key == key)
+        slot = &table->table[pos];
+        if (slot->key == key)
         {
-            return entry->data;
+            return slot->data;
         }
-        entry = entry->next;
+        if (slot->key == 0 || hashDistance(table, slot->key, pos) < dist)
+        {
+            return NULL;
+        }
+        pos = (pos + 1) & table->mask;
     }
+}
 
-    return NULL;
+/*-----------------------------------------------------------------------------
+    Name        : hashLookupBatch
+    Description : looks up a list of keys.  The home slots of a few keys are
+                  fetched at once so their cache misses overlap.
+    Inputs      : table - the hashtable to search
+                  keys - the keys to search for
+                  numkeys - length of keys
+    Outputs     : results - filled in with the entry for each key, or NULL
+    Return      :
+----------------------------------------------------------------------------*/
+void hashLookupBatch(hashtable const* table, udword const* keys, udword numkeys, void** results)
+{
+    udword first, index, last;
+    udword home[HASH_BatchSize];
+    udword pos, dist, key;
+    hash_t const* slot;
+
+    dbgAssertOrIgnore(table != NULL);
+
+    for (first = 0; first < numkeys; first += HASH_BatchSize)
+    {
+        last = min(first + HASH_BatchSize, numkeys);
+        for (index = first; index < last; index++)
+        {
+            home[index - first] = hashHome(table, keys[index]);
+            hashPrefetch(&table->table[home[index - first]]);
+        }
+        for (index = first; index < last; index++)
+        {
+            key = keys[index];
+            results[index] = NULL;
+            if (key == 0)
+            {
+                continue;
+            }
+            pos = home[index - first];
+            for (dist = 0; ; dist++)
+            {
+                slot = &table->table[pos];
+                if (slot->key == key)
+                {
+                    results[index] = slot->data;
+                    break;
+                }
+                if (slot->key == 0 || hashDistance(table, slot->key, pos) < dist)
+                {
+                    break;
+                }
+                pos = (pos + 1) & table->mask;
+            }
+        }
+    }
 }
 
 /*-----------------------------------------------------------------------------
     Name        : hashInsert
-    Description : insert an entry into given hashtable with given key
+    Description : insert an entry into given hashtable with given key,
+                  growing the table if it is getting full
     Inputs      : table - the hashtable
                   key - the hash key (index)
                   data - the data to be stored
@@ -112,9 +320,6 @@ void* hashLookup(hashtable const* table, udword key)
 ----------------------------------------------------------------------------*/
 void hashInsert(hashtable* table, udword key, void* data)
 {
-    udword pos;
-    hash_t* entry;
-
     dbgAssertOrIgnore(table != NULL);
 
     if (key == 0)
@@ -123,27 +328,14 @@ void hashInsert(hashtable* table, udword key, void* data)
     if (key > table->maxkey)
         table->maxkey = key;
 
-    pos = key % table->size;
-    entry = table->table[pos];
-    while (entry)
+    if ((table->count + 1) * HASH_MaxLoadDenom > table->size * HASH_MaxLoadNumer)
     {
-        if (entry->key == key)
-        {
-            /* replace entry's data.  user should really avoid this
-               and free collisions manually before inserting to avoid
-               unreferenced but allocated memory */
-	        entry->data = data;
-	        return;
-        }
-        entry = entry->next;
+        hashGrow(table);
     }
-
-    /* alloc and insert new table entry */
-    entry = (hash_t*)memAlloc(sizeof(hash_t), "hash entry", NonVolatile);
-    entry->key = key;
-    entry->data = data;
-    entry->next = table->table[pos];
-    table->table[pos] = entry;
+    hashPlace(table, key, data);
+#if HASH_ERROR_CHECKING
+    hashVerify(table);
+#endif
 }
 
 /*-----------------------------------------------------------------------------
@@ -151,40 +343,50 @@ void hashInsert(hashtable* table, udword key, void* data)
     Description : remove an entry from given hashtable
     Inputs      : table - the hashtable
                   key - the key of the entry to remove
-    Outputs     : table is modified to not contain the entry if it
-                  was found, and the entry block is freed (but not
-                  the data it contains)
+    Outputs     : table is modified to not contain the entry if it was
+                  found.  The entries after it which aren't at home are
+                  shifted back a slot, so no tombstone is left behind.
     Return      :
 ----------------------------------------------------------------------------*/
 void hashRemove(hashtable* table, udword key)
 {
-    udword pos;
-    hash_t *entry, *prev;
+    udword pos, next, dist;
+    hash_t* slot;
 
     dbgAssertOrIgnore(table != NULL);
     dbgAssertOrIgnore(key != 0);
 
-    pos = key % table->size;
-    prev = NULL;
-    entry = table->table[pos];
-    while (entry)
+    pos = hashHome(table, key);
+    for (dist = 0; ; dist++)
     {
-        if (entry->key == key)
+        slot = &table->table[pos];
+        if (slot->key == key)
         {
-            if (prev)
-            {
-                prev->next = entry->next;
-            }
-            else
-            {
-                table->table[pos] = entry->next;
-            }
-            memFree(entry);
-	        return;
+            break;
         }
-        prev = entry;
-        entry = entry->next;
+        if (slot->key == 0 || hashDistance(table, slot->key, pos) < dist)
+        {
+            return;                                         //not in the table
+        }
+        pos = (pos + 1) & table->mask;
     }
+
+    for (;;)
+    {
+        next = (pos + 1) & table->mask;
+        if (table->table[next].key == 0 || hashDistance(table, table->table[next].key, next) == 0)
+        {
+            break;
+        }
+        table->table[pos] = table->table[next];
+        pos = next;
+    }
+    table->table[pos].key = 0;
+    table->table[pos].data = NULL;
+    table->count--;
+#if HASH_ERROR_CHECKING
+    hashVerify(table);
+#endif
 }
 
 /*-----------------------------------------------------------------------------
@@ -235,3 +437,184 @@ udword hashFindFreeKeyBlock(hashtable* table, udword numkeys)
         return 0;
     }
 }
+
+#if HASH_TEST
+/*-----------------------------------------------------------------------------
+    Test and benchmark functions.  The old chained table is kept here to
+    compare against.
+-----------------------------------------------------------------------------*/
+#define HASH_TestKeys           4096
+#define HASH_TestBuckets        1024
+#define HASH_TestLookups        (HASH_TestKeys * 64)
+
+typedef struct hashchain
+{
+    udword key;
+    void* data;
+    struct hashchain* next;
+}
+hashchain;
+
+static hashchain* hashChainTable[HASH_TestBuckets];
+
+static void hashChainInsert(udword key, void* data)
+{
+    hashchain* entry = (hashchain*)memAlloc(sizeof(hashchain), "hash entry", NonVolatile);
+
+    entry->key = key;
+    entry->data = data;
+    entry->next = hashChainTable[key % HASH_TestBuckets];
+    hashChainTable[key % HASH_TestBuckets] = entry;
+}
+
+static void* hashChainLookup(udword key)
+{
+    hashchain* entry;
+
+    for (entry = hashChainTable[key % HASH_TestBuckets]; entry != NULL; entry = entry->next)
+    {
+        if (entry->key == key)
+        {
+            return entry->data;
+        }
+    }
+    return NULL;
+}
+
+static void hashChainDelete(void)
+{
+    hashchain *entry, *next;
+    udword index;
+
+    for (index = 0; index < HASH_TestBuckets; index++)
+    {
+        for (entry = hashChainTable[index]; entry != NULL; entry = next)
+        {
+            next = entry->next;
+            memFree(entry);
+        }
+        hashChainTable[index] = NULL;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hashTestKeys
+    Description : benchmarks both tables on one set of keys, after checking
+                  removal and batch lookup give the same answers
+    Inputs      : name - name of the key distribution
+                  keys - HASH_TestKeys distinct keys
+    Outputs     : results printed with dbgMessagef
+    Return      :
+----------------------------------------------------------------------------*/
+static void hashTestKeys(char* name, udword* keys)
+{
+    static udword probes[HASH_TestLookups];
+    static void* results[HASH_TestLookups];
+    hashtable* table = hashNewTable(HASH_MinSize);
+    udword index, sum;
+    Uint64 timeStart, timeChain, timeOpen, timeBatch;
+
+    //half the lookups hit, half are keys one past a real one
+    for (index = 0; index < HASH_TestLookups; index++)
+    {
+        probes[index] = keys[(index * 2654435761u) % HASH_TestKeys] + (index & 1);
+    }
+
+    for (index = 0; index < HASH_TestKeys; index++)
+    {
+        hashInsert(table, keys[index], (void*)&keys[index]);
+        hashChainInsert(keys[index], (void*)&keys[index]);
+    }
+
+    //remove and put back every third key
+    for (index = 0; index < HASH_TestKeys; index += 3)
+    {
+        hashRemove(table, keys[index]);
+        if (hashLookup(table, keys[index]) != NULL)
+        {
+            dbgFatalf(DBG_Loc, "hashTest(%s): key %u found after removal", name, keys[index]);
+        }
+    }
+#if HASH_ERROR_CHECKING
+    hashVerify(table);
+#endif
+    for (index = 0; index < HASH_TestKeys; index += 3)
+    {
+        hashInsert(table, keys[index], (void*)&keys[index]);
+    }
+
+    hashLookupBatch(table, probes, HASH_TestLookups, results);
+    for (index = 0; index < HASH_TestLookups; index++)
+    {
+        if (results[index] != hashChainLookup(probes[index]) ||
+            hashLookup(table, probes[index]) != results[index])
+        {
+            dbgFatalf(DBG_Loc, "hashTest(%s): lookups of key %u differ", name, probes[index]);
+        }
+    }
+
+    timeStart = SDL_GetPerformanceCounter();
+    for (sum = 0, index = 0; index < HASH_TestLookups; index++)
+    {
+        sum += (hashChainLookup(probes[index]) != NULL);
+    }
+    timeChain = SDL_GetPerformanceCounter() - timeStart;
+
+    timeStart = SDL_GetPerformanceCounter();
+    for (index = 0; index < HASH_TestLookups; index++)
+    {
+        sum += (hashLookup(table, probes[index]) != NULL);
+    }
+    timeOpen = SDL_GetPerformanceCounter() - timeStart;
+
+    timeStart = SDL_GetPerformanceCounter();
+    hashLookupBatch(table, probes, HASH_TestLookups, results);
+    timeBatch = SDL_GetPerformanceCounter() - timeStart;
+
+    dbgMessagef("hashTest(%s): %u slots, ns per lookup chained %.1f, open %.1f, batch %.1f (%u hits)",
+                name, table->size,
+                (real64)timeChain * 1.0e9 / SDL_GetPerformanceFrequency() / HASH_TestLookups,
+                (real64)timeOpen * 1.0e9 / SDL_GetPerformanceFrequency() / HASH_TestLookups,
+                (real64)timeBatch * 1.0e9 / SDL_GetPerformanceFrequency() / HASH_TestLookups,
+                sum / 2);
+
+    hashChainDelete();
+    hashDeleteTable(table);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hashTest
+    Description : compares the chained and open-addressed tables on the
+                  kinds of keys the registries produce: handles handed out
+                  in sequence, CRCs of texture names and addresses of
+                  equally sized particle system blocks
+    Inputs      :
+    Outputs     : results printed with dbgMessagef
+    Return      :
+----------------------------------------------------------------------------*/
+void hashTest(void)
+{
+    static udword keys[HASH_TestKeys];
+    char texname[32];
+    udword index;
+
+    for (index = 0; index < HASH_TestKeys; index++)
+    {
+        keys[index] = (index + 1) * 2;                      //every other key, so key + 1 misses
+    }
+    hashTestKeys("handles", keys);
+
+    for (index = 0; index < HASH_TestKeys; index++)
+    {
+        sprintf(texname, "R1\\Mothership\\rl%04d\\Tex%u", index & 7, index);
+        keys[index] = (crc32Compute((ubyte*)texname, strlen(texname)) & ~3u) | 2;
+    }
+    hashTestKeys("texture names", keys);
+
+    for (index = 0; index < HASH_TestKeys; index++)
+    {
+        keys[index] = 0x08000000 + index * 2048;            //particle system slab blocks
+    }
+    hashTestKeys("particle systems", keys);
+}
+#endif //HASH_TEST
@@ -11,27 +11,54 @@
 
 #include "Types.h"
 
+// SWITCHES --------------------------------------------------------------------
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define HASH_ERROR_CHECKING     1               // verify the table after every change
+#define HASH_TEST               0               // test and benchmark against chaining at startup
+#else
+#define HASH_ERROR_CHECKING     0
+#define HASH_TEST               0
+#endif
+
+// DEFINITIONS -----------------------------------------------------------------
+
+#define HASH_MinSize            8               // smallest number of slots, power of 2
+#define HASH_MaxLoadNumer       7               // grow when more than 7/8 of the slots are used
+#define HASH_MaxLoadDenom       8
+
 // INTERFACE -------------------------------------------------------------------
 
+// one slot of the table, key 0 is an empty slot
 typedef struct hash_s
 {
     udword key;
     void*  data;
-    struct hash_s* next;
 } hash_t;
 
+// open addressed with Robin Hood probing: an entry never sits further from
+// its home slot than the one it displaced, and removal shifts the following
+// run back instead of leaving a tombstone.
 typedef struct
 {
-    udword  size;
+    udword  size;                               // slots, power of 2
+    udword  mask;                               // size - 1
+    udword  shift;                              // 32 - log2(size), for the multiplicative hash
+    udword  count;                              // slots in use
     udword  maxkey;
-    hash_t* table[1];
+    hash_t* table;
 } hashtable;
 
 hashtable* hashNewTable(udword size);
 void  hashDeleteTable(hashtable* table);
 void* hashLookup(hashtable const* table, udword key);
+void  hashLookupBatch(hashtable const* table, udword const* keys, udword numkeys, void** results);
 void  hashInsert(hashtable* table, udword key, void* data);
 void  hashRemove(hashtable* table, udword key);
 udword hashFindFreeKeyBlock(hashtable* table, udword numkeys);
 
+#if HASH_TEST
+void hashTest(void);
+#endif
+
 #endif
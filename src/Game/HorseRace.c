@@ -80,6 +80,12 @@ extern udword gDevcaps2;
 #define MAX_CHAT_TEXT       64
 #define NUM_CHAT_LINES      10
 
+#ifdef HW_BUILD_FOR_DEBUGGING
+    #define HR_LOAD_STATS       1           // report time per bar and background prefetch overlap
+#else
+    #define HR_LOAD_STATS       0
+#endif
+
 real32 HorseRacePlayerDropoutTime = 10.0f;     // tweakable
 color HorseRaceDropoutColor = colRGB(75,75,75);
 
@@ -95,6 +101,11 @@ static color hrSinglePlayerLoadingBarColor = colRGB(255,63,63);  // pastel red
 static sdword JustInit;
 static sdword localbar;
 
+#if HR_LOAD_STATS
+static Uint32 hrBarStartTicks[MAX_POSSIBLE_NUM_BARS];
+static sdword hrBarsBegun;
+#endif
+
 // Pixels and info about the background image chosen
 static bool hrBackgroundInitFrame = 0;
 static long hrBackgroundDirty = 0;
@@ -1107,6 +1118,9 @@ void horseRaceInit()
     listInit(&horseCrapRegion.cutouts);
 
     JustInit = TRUE;
+#if HR_LOAD_STATS
+    hrBarsBegun = 0;
+#endif
 
     if (!hrScreensHandle)
     {
@@ -1133,9 +1147,48 @@ void horseRaceInit()
     hrBackgroundReinit = FALSE;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : hrLoadStatsReport
+    Description : Log how long each loading bar took and how much of the
+                  level's decompression the prefetch thread got done while
+                  the loader was busy with something else.
+    Inputs      : prefetch - what the prefetch thread did this load
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+#if HR_LOAD_STATS
+static void hrLoadStatsReport(bigprefetchstats *prefetch)
+{
+    sdword i;
+    Uint32 now = SDL_GetTicks(), end;
+
+    for (i = 0; i < hrBarsBegun; i++)
+    {
+        end = (i + 1 < hrBarsBegun) ? hrBarStartTicks[i + 1] : now;
+        dbgMessagef("Load bar %d: %d ms", i, end - hrBarStartTicks[i]);
+    }
+    if (prefetch->queued)
+    {
+        dbgMessagef("Prefetch: %d/%d entries ready ahead, %d waited on (%d ms), %d missed, %d unused",
+                    prefetch->ahead, prefetch->queued, prefetch->waited,
+                    prefetch->waitTicks, prefetch->missed, prefetch->unused);
+        dbgMessagef("Prefetch: %dKB expanded in %d ms, %d ms overlapped with loading",
+                    prefetch->bytesExpanded / 1024, prefetch->busyTicks,
+                    prefetch->busyTicks - min(prefetch->busyTicks, prefetch->waitTicks));
+    }
+}
+#endif
+
 void horseRaceShutdown()
 {
     sdword i;
+    bigprefetchstats prefetchStats;
+
+    //whatever wasn't asked for by now won't be
+    bigPrefetchStop(&prefetchStats);
+#if HR_LOAD_STATS
+    hrLoadStatsReport(&prefetchStats);
+#endif
 
     if (!ShouldHaveMousePtr) mouseCursorShow();
 
@@ -1187,6 +1240,13 @@ void HorseRaceBeginBar(uword barnum)
     {
         localbar++;
     }
+#if HR_LOAD_STATS
+    if (localbar < MAX_POSSIBLE_NUM_BARS)
+    {
+        hrBarStartTicks[localbar] = SDL_GetTicks();
+        hrBarsBegun = localbar + 1;
+    }
+#endif
 
     //send packet
     packet.packetheader.type = PACKETTYPE_HORSERACE;
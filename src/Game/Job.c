@@ -0,0 +1,671 @@
+/*=============================================================================
+    Name    : Job.c
+    Purpose : Work-stealing job system for spreading work over worker threads
+
+    Each thread which runs jobs owns a queue.  The owner pushes and pops at
+    the bottom so it works depth first on its most recent jobs; thieves take
+    from the top, where the oldest and usually biggest jobs are.  Queues are
+    guarded by spin locks which are held for a handful of instructions.
+
+    Thread 0 is the game thread (and any other thread which isn't one of
+    ours); threads 1..jobWorkerCount are the workers.
+=============================================================================*/
+
+#include "Job.h"
+
+#include <string.h>
+
+#include "Debug.h"
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+typedef struct job
+{
+    jobfunction function;
+    void *data;
+    sdword first, last;
+    jobcounter *counter;
+}
+job;
+
+typedef struct jobqueue
+{
+    SDL_SpinLock lock;
+    sdword top;                                 //next job to steal
+    sdword bottom;                              //next free slot
+    job jobs[JOB_QueueSize];
+#if JOB_STATS
+    sdword numJobs;
+    sdword numStolen;
+    sdword numInline;
+#endif
+}
+jobqueue;
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+sdword jobNumWorkers = JOB_WorkersAuto;
+
+#if JOB_STATS
+jobstats jobStats;
+#endif
+
+static bool jobModuleInit = FALSE;
+static sdword jobWorkerCount = 0;
+static SDL_Thread *jobThreads[JOB_MaxWorkers];
+static jobqueue jobQueues[JOB_MaxWorkers + 1];
+static SDL_sem *jobWake = NULL;
+static SDL_atomic_t jobQuit;
+static SDL_TLSID jobThreadIndexTLS = 0;
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : jobThreadIndex
+    Description : Returns the index of the queue belonging to this thread
+    Inputs      :
+    Outputs     :
+    Return      : 0 for the game thread, 1.. for workers
+----------------------------------------------------------------------------*/
+static sdword jobThreadIndex(void)
+{
+    return (sdword)(memsize)SDL_TLSGet(jobThreadIndexTLS);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobQueuePush
+    Description : Pushes a job onto the bottom of a queue
+    Inputs      : queue, newJob
+    Outputs     :
+    Return      : FALSE if the queue is full
+----------------------------------------------------------------------------*/
+static bool jobQueuePush(jobqueue *queue, job *newJob)
+{
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom - queue->top >= JOB_QueueSize)
+    {
+        SDL_AtomicUnlock(&queue->lock);
+        return FALSE;
+    }
+    queue->jobs[queue->bottom & (JOB_QueueSize - 1)] = *newJob;
+    queue->bottom++;
+    SDL_AtomicUnlock(&queue->lock);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobQueuePop
+    Description : Takes the most recent job off the bottom of a queue
+    Inputs      : queue
+    Outputs     : outJob - job taken
+    Return      : FALSE if the queue is empty
+----------------------------------------------------------------------------*/
+static bool jobQueuePop(jobqueue *queue, job *outJob)
+{
+    if (queue->bottom == queue->top)
+    {                                                       //quick check without the lock
+        return FALSE;
+    }
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom == queue->top)
+    {
+        SDL_AtomicUnlock(&queue->lock);
+        return FALSE;
+    }
+    queue->bottom--;
+    *outJob = queue->jobs[queue->bottom & (JOB_QueueSize - 1)];
+    SDL_AtomicUnlock(&queue->lock);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobQueueSteal
+    Description : Takes the oldest job off the top of a queue
+    Inputs      : queue
+    Outputs     : outJob - job taken
+    Return      : FALSE if the queue is empty
+----------------------------------------------------------------------------*/
+static bool jobQueueSteal(jobqueue *queue, job *outJob)
+{
+    if (queue->bottom == queue->top)
+    {
+        return FALSE;
+    }
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom == queue->top)
+    {
+        SDL_AtomicUnlock(&queue->lock);
+        return FALSE;
+    }
+    *outJob = queue->jobs[queue->top & (JOB_QueueSize - 1)];
+    queue->top++;
+    SDL_AtomicUnlock(&queue->lock);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobExecute
+    Description : Runs a job and counts it off
+    Inputs      : thisJob
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void jobExecute(job *thisJob)
+{
+    thisJob->function(thisJob->data, thisJob->first, thisJob->last);
+    if (thisJob->counter != NULL)
+    {
+        SDL_AtomicAdd(&thisJob->counter->pending, -1);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobRunOne
+    Description : Runs one job from this thread's queue, or failing that one
+                  stolen from another thread's queue.
+    Inputs      : index - this thread's queue index
+    Outputs     :
+    Return      : TRUE if a job was run
+----------------------------------------------------------------------------*/
+static bool jobRunOne(sdword index)
+{
+    job thisJob;
+    sdword victim, count;
+
+    if (jobQueuePop(&jobQueues[index], &thisJob))
+    {
+        jobExecute(&thisJob);
+#if JOB_STATS
+        jobQueues[index].numJobs++;
+#endif
+        return TRUE;
+    }
+
+    //start with the next thread along so thieves spread out
+    for (count = 0, victim = index + 1; count < jobWorkerCount; count++, victim++)
+    {
+        if (victim > jobWorkerCount)
+        {
+            victim = 0;
+        }
+        if (jobQueueSteal(&jobQueues[victim], &thisJob))
+        {
+            jobExecute(&thisJob);
+#if JOB_STATS
+            jobQueues[index].numJobs++;
+            jobQueues[index].numStolen++;
+#endif
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobWorkerThread
+    Description : Worker thread main loop.  Runs jobs until there are none,
+                  then sleeps until more are submitted.
+    Inputs      : data - queue index of this worker
+    Outputs     :
+    Return      : 0
+----------------------------------------------------------------------------*/
+static int jobWorkerThread(void *data)
+{
+    sdword index = (sdword)(memsize)data;
+
+    SDL_TLSSet(jobThreadIndexTLS, data, NULL);
+
+    while (!SDL_AtomicGet(&jobQuit))
+    {
+        if (!jobRunOne(index))
+        {
+            SDL_SemWait(jobWake);
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobWakeWorkers
+    Description : Wakes up to numJobs sleeping workers
+    Inputs      : numJobs - jobs just submitted
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void jobWakeWorkers(sdword numJobs)
+{
+    while (numJobs > 0 && SDL_SemValue(jobWake) < (Uint32)jobWorkerCount)
+    {
+        SDL_SemPost(jobWake);
+        numJobs--;
+    }
+}
+
+#if JOB_TEST
+/*-----------------------------------------------------------------------------
+    Test and benchmark functions
+-----------------------------------------------------------------------------*/
+#define JOB_TestCount           100000
+#define JOB_TestGrain           1000
+#define JOB_TestChunks          (JOB_TestCount / JOB_TestGrain)
+#define JOB_TestFib             20
+#define JOB_TestBenchJobs       100000
+
+typedef struct jobtestsum
+{
+    udword values[JOB_TestCount];
+    udword partial[JOB_TestChunks];
+    udword total;
+    sdword lastMerged;
+}
+jobtestsum;
+
+typedef struct jobtestfib
+{
+    sdword n;
+    sdword result;
+}
+jobtestfib;
+
+static void jobTestSumChunk(void *data, sdword first, sdword last)
+{
+    jobtestsum *sum = (jobtestsum *)data;
+    udword total = 0;
+    sdword index;
+
+    for (index = first; index < last; index++)
+    {
+        total += sum->values[index] * 7 + 3;
+    }
+    sum->partial[first / JOB_TestGrain] = total;
+}
+
+static void jobTestSumMerge(void *data, sdword first, sdword last)
+{
+    jobtestsum *sum = (jobtestsum *)data;
+
+    if (first <= sum->lastMerged)
+    {
+        dbgFatalf(DBG_Loc, "jobTest: chunk %d merged out of order", first);
+    }
+    sum->lastMerged = first;
+    sum->total = sum->total * 31 + sum->partial[first / JOB_TestGrain];
+}
+
+static void jobTestFib(void *data, sdword first, sdword last)
+{
+    jobtestfib *fib = (jobtestfib *)data;
+    jobtestfib a, b;
+    jobcounter counter;
+
+    if (fib->n < 2)
+    {
+        fib->result = fib->n;
+        return;
+    }
+    a.n = fib->n - 1;
+    b.n = fib->n - 2;
+    jobCounterInit(&counter);
+    jobSubmit(jobTestFib, &a, 0, 1, &counter);
+    jobSubmit(jobTestFib, &b, 0, 1, &counter);
+    jobWait(&counter);
+    fib->result = a.result + b.result;
+}
+
+static void jobTestEmpty(void *data, sdword first, sdword last)
+{
+    ;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobTest
+    Description : Checks parallel-for, merge order and nested fork/join give
+                  the same answers as doing the work serially, then measures
+                  the cost of an empty job.
+    Inputs      :
+    Outputs     : results printed with dbgMessagef
+    Return      :
+----------------------------------------------------------------------------*/
+static void jobTest(void)
+{
+    static jobtestsum sum;
+    jobtestfib fib;
+    jobcounter counter;
+    udword expected;
+    sdword index, chunk, fibExpected, fibPrev, fibTemp;
+    Uint64 timeStart, timeStop;
+    real64 frequency = (real64)SDL_GetPerformanceFrequency();
+
+    //parallel-for with an ordered merge
+    for (index = 0; index < JOB_TestCount; index++)
+    {
+        sum.values[index] = (udword)index * 2654435761u;
+    }
+    for (expected = 0, chunk = 0; chunk < JOB_TestChunks; chunk++)
+    {
+        jobTestSumChunk(&sum, chunk * JOB_TestGrain, (chunk + 1) * JOB_TestGrain);
+        expected = expected * 31 + sum.partial[chunk];
+    }
+    sum.total = 0;
+    sum.lastMerged = -1;
+    memset(sum.partial, 0, sizeof(sum.partial));
+    jobParallelFor(JOB_TestCount, JOB_TestGrain, jobTestSumChunk, jobTestSumMerge, &sum);
+    if (sum.total != expected)
+    {
+        dbgFatalf(DBG_Loc, "jobTest: parallel-for total 0x%x, expected 0x%x", sum.total, expected);
+    }
+
+    //nested fork/join
+    for (fibPrev = 0, fibExpected = 1, index = 1; index < JOB_TestFib; index++)
+    {
+        fibTemp = fibExpected;
+        fibExpected += fibPrev;
+        fibPrev = fibTemp;
+    }
+    fib.n = JOB_TestFib;
+    jobTestFib(&fib, 0, 1);
+    if (fib.result != fibExpected)
+    {
+        dbgFatalf(DBG_Loc, "jobTest: fib(%d) = %d, expected %d", JOB_TestFib, fib.result, fibExpected);
+    }
+
+    //overhead of an empty job
+    timeStart = SDL_GetPerformanceCounter();
+    jobCounterInit(&counter);
+    for (index = 0; index < JOB_TestBenchJobs; index++)
+    {
+        jobSubmit(jobTestEmpty, NULL, 0, 1, &counter);
+    }
+    jobWait(&counter);
+    timeStop = SDL_GetPerformanceCounter();
+    dbgMessagef("jobTest: %d threads, %.3f us per submitted job",
+                jobNumThreads(), (real64)(timeStop - timeStart) * 1000000.0 / frequency / JOB_TestBenchJobs);
+
+    timeStart = SDL_GetPerformanceCounter();
+    jobParallelFor(JOB_TestBenchJobs, 1, jobTestEmpty, NULL, NULL);
+    timeStop = SDL_GetPerformanceCounter();
+    dbgMessagef("jobTest: %.3f us per parallel-for chunk",
+                (real64)(timeStop - timeStart) * 1000000.0 / frequency / JOB_TestBenchJobs);
+}
+#endif //JOB_TEST
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : jobStartup
+    Description : Starts the worker threads
+    Inputs      : numWorkers - number of worker threads, JOB_WorkersAuto for
+                    one per CPU core after the first, or 0 to run all jobs on
+                    the submitting thread.
+    Outputs     :
+    Return      : OKAY
+----------------------------------------------------------------------------*/
+sdword jobStartup(sdword numWorkers)
+{
+    sdword index;
+
+    dbgAssertOrIgnore(jobModuleInit == FALSE);
+
+    if (numWorkers == JOB_WorkersAuto)
+    {
+        numWorkers = SDL_GetCPUCount() - 1;
+    }
+    if (numWorkers < 0)
+    {
+        numWorkers = 0;
+    }
+    if (numWorkers > JOB_MaxWorkers)
+    {
+        numWorkers = JOB_MaxWorkers;
+    }
+
+    memset(jobQueues, 0, sizeof(jobQueues));
+    SDL_AtomicSet(&jobQuit, 0);
+    jobThreadIndexTLS = SDL_TLSCreate();
+    jobWake = SDL_CreateSemaphore(0);
+    jobWorkerCount = 0;
+
+    for (index = 1; index <= numWorkers; index++)
+    {
+        jobThreads[jobWorkerCount] = SDL_CreateThread(jobWorkerThread, "hwjob", (void *)(memsize)index);
+        if (jobThreads[jobWorkerCount] == NULL)
+        {
+            dbgMessagef("jobStartup: couldn't start worker thread %d: %s", index, SDL_GetError());
+            break;
+        }
+        jobWorkerCount++;
+    }
+
+    jobModuleInit = TRUE;
+
+    dbgMessagef("jobStartup: %d worker thread%s", jobWorkerCount, jobWorkerCount == 1 ? "" : "s");
+
+#if JOB_TEST
+    jobTest();
+#endif
+
+    return OKAY;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobShutdown
+    Description : Stops the worker threads.  Any jobs must already be finished.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void jobShutdown(void)
+{
+    sdword index;
+
+    if (!jobModuleInit)
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&jobQuit, 1);
+    for (index = 0; index < jobWorkerCount; index++)
+    {
+        SDL_SemPost(jobWake);
+    }
+    for (index = 0; index < jobWorkerCount; index++)
+    {
+        SDL_WaitThread(jobThreads[index], NULL);
+        jobThreads[index] = NULL;
+    }
+    SDL_DestroySemaphore(jobWake);
+    jobWake = NULL;
+    jobWorkerCount = 0;
+    jobModuleInit = FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobNumThreads
+    Description : Returns how many threads can run jobs at once
+    Inputs      :
+    Outputs     :
+    Return      : worker count plus the calling thread
+----------------------------------------------------------------------------*/
+sdword jobNumThreads(void)
+{
+    return jobWorkerCount + 1;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobCounterInit
+    Description : Sets up a counter for a new batch of jobs
+    Inputs      : counter
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void jobCounterInit(jobcounter *counter)
+{
+    SDL_AtomicSet(&counter->pending, 0);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobSubmit
+    Description : Queues function(data, first, last) to be run on any thread
+    Inputs      : function, data, first, last - the job
+                  counter - incremented now, decremented once the job has run
+                    (may be NULL)
+    Outputs     :
+    Return      :
+    Note        : with no workers, or a full queue, the job is run right away
+----------------------------------------------------------------------------*/
+void jobSubmit(jobfunction function, void *data, sdword first, sdword last, jobcounter *counter)
+{
+    job newJob;
+    sdword index;
+
+    newJob.function = function;
+    newJob.data = data;
+    newJob.first = first;
+    newJob.last = last;
+    newJob.counter = counter;
+
+    if (counter != NULL)
+    {
+        SDL_AtomicAdd(&counter->pending, 1);
+    }
+
+    index = jobThreadIndex();
+    if (jobWorkerCount == 0 || !jobQueuePush(&jobQueues[index], &newJob))
+    {
+        jobExecute(&newJob);
+#if JOB_STATS
+        jobQueues[index].numJobs++;
+        jobQueues[index].numInline++;
+#endif
+        return;
+    }
+    jobWakeWorkers(1);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobCounterDone
+    Description : Checks if all the jobs on a counter have run, without
+                  blocking.  Lets a task kick off jobs and taskYield until
+                  they're finished.
+    Inputs      : counter
+    Outputs     :
+    Return      : TRUE if no jobs are outstanding
+----------------------------------------------------------------------------*/
+bool jobCounterDone(jobcounter *counter)
+{
+    return SDL_AtomicGet(&counter->pending) == 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobWait
+    Description : Runs jobs until all the jobs on a counter have run
+    Inputs      : counter
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void jobWait(jobcounter *counter)
+{
+    sdword index = jobThreadIndex();
+
+    while (SDL_AtomicGet(&counter->pending) > 0)
+    {
+        if (!jobRunOne(index))
+        {                                                   //everything left is running on other threads
+            SDL_Delay(0);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : jobParallelFor
+    Description : Calls function(data, first, last) over [0, count) in chunks
+                  of grain, in parallel, and waits for them all to finish.
+                  Then merge (if any) is called on each chunk in order on the
+                  calling thread.
+    Inputs      : count - size of the range
+                  grain - chunk size, or 0 to pick one from the thread count.
+                    Chunks only depend on count and grain, so pass a fixed
+                    grain for results which mustn't depend on the thread count.
+                  function - does the work for one chunk
+                  merge - combines one chunk's results, in order (may be NULL)
+                  data - passed to function and merge
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void jobParallelFor(sdword count, sdword grain, jobfunction function, jobfunction merge, void *data)
+{
+    jobcounter counter;
+    sdword first, last, numChunks;
+
+    if (count <= 0)
+    {
+        return;
+    }
+    if (grain <= 0)
+    {
+        grain = (count + jobNumThreads() * JOB_ChunksPerThread - 1) / (jobNumThreads() * JOB_ChunksPerThread);
+    }
+    numChunks = (count + grain - 1) / grain;
+
+    if (jobWorkerCount == 0 || numChunks == 1)
+    {                                                       //nobody to share with
+        for (first = 0; first < count; first = last)
+        {
+            last = min(first + grain, count);
+            function(data, first, last);
+        }
+    }
+    else
+    {
+        jobCounterInit(&counter);
+        for (first = 0; first < count; first = last)
+        {
+            last = min(first + grain, count);
+            jobSubmit(function, data, first, last, &counter);
+        }
+        jobWait(&counter);
+    }
+
+    if (merge != NULL)
+    {
+        for (first = 0; first < count; first = last)
+        {
+            last = min(first + grain, count);
+            merge(data, first, last);
+        }
+    }
+}
+
+#if JOB_STATS
+/*-----------------------------------------------------------------------------
+    Name        : jobStatsUpdate
+    Description : Totals the per-thread job counts into jobStats and clears
+                    them.  Only call while no jobs are running.
+    Inputs      :
+    Outputs     : jobStats
+    Return      :
+----------------------------------------------------------------------------*/
+void jobStatsUpdate(void)
+{
+    sdword index;
+
+    memset(&jobStats, 0, sizeof(jobStats));
+    for (index = 0; index <= jobWorkerCount; index++)
+    {
+        jobStats.numJobs += jobQueues[index].numJobs;
+        jobStats.numStolen += jobQueues[index].numStolen;
+        jobStats.numInline += jobQueues[index].numInline;
+        jobQueues[index].numJobs = 0;
+        jobQueues[index].numStolen = 0;
+        jobQueues[index].numInline = 0;
+    }
+}
+#endif
@@ -0,0 +1,111 @@
+/*=============================================================================
+    Name    : Job.h
+    Purpose : Work-stealing job system for spreading work over worker threads
+
+    A fixed pool of worker threads, each with its own job queue.  Jobs are
+    pushed onto the submitting thread's queue; idle threads steal from the
+    other end of everybody else's.  Anything waiting on a job counter runs
+    jobs itself while it waits, so jobs may submit and wait on jobs too.
+
+    The game's memory heap, linked lists and most game state are not thread
+    safe.  Jobs should only read shared state and write to memory set aside
+    for them, and should not call memAlloc/memFree.  Anything which feeds the
+    lockstep simulation must give the same answer with any number of workers:
+    use jobParallelFor with a fixed grain and do the order-dependent part in
+    the merge callback, which is called on the submitting thread in order.
+=============================================================================*/
+
+#ifndef ___JOB_H
+#define ___JOB_H
+
+#include "SDL.h"
+
+#include "Types.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+
+#define JOB_ERROR_CHECKING      1               //general error checking
+#define JOB_STATS               1               //count jobs run, stolen etc.
+#define JOB_TEST                0               //test and benchmark the job module at startup
+
+#else
+
+#define JOB_ERROR_CHECKING      0               //general error checking
+#define JOB_STATS               0               //count jobs run, stolen etc.
+#define JOB_TEST                0               //test and benchmark the job module at startup
+
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define JOB_MaxWorkers          16              //maximum number of worker threads
+#define JOB_QueueSize           1024            //jobs per queue, power of 2
+#define JOB_WorkersAuto         -1              //one worker per extra CPU core
+
+#define JOB_ChunksPerThread     4               //automatic parallel-for grain splits this finely
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+//job entry point, called with the range [first, last)
+typedef void (*jobfunction)(void *data, sdword first, sdword last);
+
+//count of jobs outstanding, for fork/join
+typedef struct jobcounter
+{
+    SDL_atomic_t pending;
+}
+jobcounter;
+
+#if JOB_STATS
+typedef struct jobstats
+{
+    sdword numJobs;                             //jobs run
+    sdword numStolen;                           //jobs run by a thread other than the one which submitted them
+    sdword numInline;                           //jobs run immediately because of a full queue or no workers
+}
+jobstats;
+#endif
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+extern sdword jobNumWorkers;                    //worker threads wanted (JOB_WorkersAuto or 0 for none)
+
+#if JOB_STATS
+extern jobstats jobStats;
+#endif
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+//start/close the job system
+sdword jobStartup(sdword numWorkers);
+void jobShutdown(void);
+
+//threads available to run jobs, including the calling thread
+sdword jobNumThreads(void);
+
+//fork/join
+void jobCounterInit(jobcounter *counter);
+void jobSubmit(jobfunction function, void *data, sdword first, sdword last, jobcounter *counter);
+bool jobCounterDone(jobcounter *counter);
+void jobWait(jobcounter *counter);
+
+//split [0, count) into chunks of grain and run them in parallel
+void jobParallelFor(sdword count, sdword grain, jobfunction function, jobfunction merge, void *data);
+
+#if JOB_STATS
+void jobStatsUpdate(void);
+#endif
+
+#endif
@@ -64,6 +64,25 @@ memsmallheapinfo memSmallHeapInfo[] =
 };
 sdword memSmallBlockHeapMaxSize = 0;
 
+#if MEM_SMALL_BLOCK_HEAP
+//typed slab pools, indexed by MSP_*
+memslabinfo memSlabInfo[MSP_NumberSlabs] =
+{
+    {"Bullet",          {0},                        256},
+    {"Missile",         {0},                        64},
+    {"Effect",          {512, 1024, 2048},          128},
+    {"ParticleSystem",  {1024, 2048, 4096, 8192},   32},
+};
+memslab memSlab[MSP_NumberSlabs];
+#endif
+
+//per-frame scratch arena
+ubyte *memFrameArena = NULL;
+ubyte *memFrameArenaEnd = NULL;
+ubyte *memFrameArenaNext = NULL;
+sdword memFrameHighWater = 0;                   //most bytes used in one frame
+sdword memFrameOverflowed = 0;                  //allocations which didn't fit since the last analysis
+
 #if MEM_LOG_MOSTVOLATILE
 volatilestat memVolatileStat[MEM_NumberVolatileStats];
 #endif
@@ -752,6 +771,147 @@ void *memAllocFunctionSBH(sdword length, udword flags)
 #endif
     return(newPointer);                                     //allocation failed.  Too bad
 }
+
+/*-----------------------------------------------------------------------------
+    Name        : memSlabInit
+    Description : Sets up the size classes of a slab pool on first use.
+    Inputs      : slab - index of slab pool to set up
+                  length - length of the first allocation, for fixed size pools
+    Outputs     :
+    Return      : void
+----------------------------------------------------------------------------*/
+void memSlabInit(sdword slab, sdword length)
+{
+    memslabinfo *info = &memSlabInfo[slab];
+    memslab *pool = &memSlab[slab];
+    mbheap *heap;
+    sdword index;
+
+    for (index = 0; index < MSP_NumberSizes; index++)
+    {
+        if (index > 0 && info->blockSize[index] == 0)
+        {
+            break;
+        }
+        heap = &pool->heap[index];
+        memset(heap, 0, sizeof(mbheap));
+        listInit(&heap->allocated);
+        listInit(&heap->free);
+        heap->blockSize = memRoundUp(info->blockSize[index] != 0 ? info->blockSize[index] : length);
+#if MEM_ERROR_CHECKING
+        heap->validation = MEM_HeapValidation;
+#endif
+#if MEM_SMALLBLOCK_STATS
+        heap->firstAllocTime = taskTimeElapsed;
+#endif
+        pool->highWater[index] = 0;
+    }
+    pool->nSizes = index;
+    pool->nAllocs = pool->nOverflowed = 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : memSlabAllocFunction
+    Description : Allocates a block from a typed slab pool.  Blocks are taken
+                    off the free list of the smallest size class they fit in,
+                    and the size class grows by memSlabInfo[].nBlocks when it
+                    runs out.  The block is freed with memFree.
+    Inputs      : slab - MSP_* slab pool to allocate from
+                  length - length of requested block in bytes
+                  name(optional) - name of block
+    Outputs     : Newly allocated block may be cleared.
+    Return      : Pointer to newly allocated block.  Blocks too big for the
+                    pool come from the regular heap.
+----------------------------------------------------------------------------*/
+#if MEM_USE_NAMES
+void *memSlabAllocFunction(sdword slab, sdword length, char *name)
+#else
+void *memSlabAllocFunction(sdword slab, sdword length)
+#endif
+{
+    memslab *pool = &memSlab[slab];
+    mbheap *heap;
+    mbhcookie *cookie;
+    ubyte *newPointer;
+    sdword index;
+
+    memInitCheck();
+    dbgAssertOrIgnore(slab >= 0 && slab < MSP_NumberSlabs);
+    dbgAssertOrIgnore(length > 0);
+
+    if (pool->nSizes == 0)
+    {
+        memSlabInit(slab, length);
+    }
+    pool->nAllocs++;
+
+    for (index = 0, heap = pool->heap; index < pool->nSizes; index++, heap++)
+    {
+        if (heap->blockSize >= length)
+        {
+            break;
+        }
+    }
+    if (index == pool->nSizes)
+    {                                                       //too big for this pool
+        pool->nOverflowed++;
+        newPointer = memAlloc(length, name, Pyrophoric);
+        return(newPointer);
+    }
+#if MEM_ERROR_CHECKING
+    dbgAssertOrIgnore(heap->validation == MEM_HeapValidation);
+    dbgAssertOrIgnore((sdword)(heap->allocated.num + heap->free.num) == heap->nBlocks);
+#endif
+#if MEM_SMALLBLOCK_STATS
+    heap->nAllocationAttempts++;
+    heap->usage += (real32)heap->allocated.num;
+#endif
+    if (heap->free.num == 0)
+    {                                                       //if the size class is all used up
+#if MEM_VERBOSE_LEVEL >= 2
+        dbgMessagef("memSlabAllocFunction: '%s' blocks of size %d all used up.  Allocating another %d", memSlabInfo[slab].name, heap->blockSize, memSlabInfo[slab].nBlocks);
+#endif
+#if MEM_SMALLBLOCK_STATS
+        if (heap->nBlocks > 0)
+        {
+            heap->nOverflowedAllocations++;
+        }
+#endif
+        memSBHGrowBy(heap, memSlabInfo[slab].nBlocks);
+    }
+    cookie = listGetStructOfNode(heap->free.tail);
+    mbhCookieVerify(cookie);
+
+    listRemoveNode(&cookie->link);                          //remove from free list
+    listAddNode(&heap->allocated, &cookie->link, cookie);   //add to allocated list
+    newPointer = (ubyte *)(cookie + 1);
+#if MEM_CLEAR_MEM                                           //clear the new block to allocated pattern
+    memClearDword(newPointer, memClearSetting, heap->blockSize / sizeof(udword));
+#endif
+    bitSet(cookie->flags, MBF_AllocatedNext);               //flag block as allocated
+    cookie->length = length;
+#if MEM_LOG_MOSTVOLATILE
+    cookie->timeAllocated = taskTimeElapsed;
+#endif
+#if MEM_STATISTICS
+    memNumberAllocs++;
+    memCookieNameAdd(name, length);
+#endif
+    mbhNameSet(cookie, name);
+
+    pool->highWater[index] = max(pool->highWater[index], (sdword)heap->allocated.num);
+    return(newPointer);
+}
+#else
+#if MEM_USE_NAMES
+void *memSlabAllocFunction(sdword slab, sdword length, char *name)
+#else
+void *memSlabAllocFunction(sdword slab, sdword length)
+#endif
+{
+    void *newPointer = memAlloc(length, name, Pyrophoric);
+    return(newPointer);
+}
 #endif //MEM_SMALL_BLOCK_HEAP
 
 /*-----------------------------------------------------------------------------
@@ -1411,6 +1571,70 @@ void memFreeSBH(mbhcookie *cookie)
 }
 #endif
 
+/*-----------------------------------------------------------------------------
+    Name        : memFrameAllocFunction
+    Description : Allocates a block of scratch memory which lasts until the
+                    next universe update.  The block may be passed to memFree,
+                    which ignores it, but must not be kept past this frame.
+    Inputs      : length - length of requested block in bytes
+                  name(optional) - name of block, for the overflow case
+    Outputs     :
+    Return      : Pointer to the new block.  If the arena is full the block
+                    comes from the regular heap, and is freed by memFree.
+----------------------------------------------------------------------------*/
+#if MEM_USE_NAMES
+void *memFrameAllocFunction(sdword length, char *name)
+#else
+void *memFrameAllocFunction(sdword length)
+#endif
+{
+    ubyte *newPointer;
+
+    memInitCheck();
+    dbgAssertOrIgnore(length > 0);
+
+    if (memFrameArena == NULL)
+    {
+        memFrameArena = memAlloc(MEM_FrameArenaSize, "FrameArena", NonVolatile);
+        memFrameArenaEnd = memFrameArena + MEM_FrameArenaSize;
+        memFrameArenaNext = memFrameArena;
+    }
+
+    length = (length + MEM_FrameAlignment - 1) & ~(MEM_FrameAlignment - 1);
+    if (memFrameArenaNext + length > memFrameArenaEnd)
+    {                                                       //arena full this frame
+        memFrameOverflowed++;
+        newPointer = memAlloc(length, name, 0);
+        return(newPointer);
+    }
+    newPointer = memFrameArenaNext;
+    memFrameArenaNext += length;
+    return(newPointer);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : memFrameReset
+    Description : Throws away all the scratch memory allocated since the
+                    last reset.  Debug builds fill it with the free pattern so
+                    anything still pointing into it is caught.
+    Inputs      :
+    Outputs     :
+    Return      : void
+----------------------------------------------------------------------------*/
+void memFrameReset(void)
+{
+    sdword used = (sdword)(memFrameArenaNext - memFrameArena);
+
+    memFrameHighWater = max(memFrameHighWater, used);
+#if MEM_CLEAR_MEM_ON_FREE
+    if (used > 0)
+    {
+        memClearDword(memFrameArena, memFreeSetting, used / sizeof(udword));
+    }
+#endif
+    memFrameArenaNext = memFrameArena;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : memFreeNV
     Description : Free a non-volatile memory cookie (only to be called from memFree)
@@ -1533,6 +1757,12 @@ void memFree(void *pointer)
 
     memInitCheck();
     dbgAssertOrIgnore(pointer != NULL);
+
+    if ((ubyte *)pointer >= memFrameArena && (ubyte *)pointer < memFrameArenaEnd)
+    {                                                       //scratch memory goes away by itself
+        return;
+    }
+
     cookie = (memcookie *)pointer;
     cookie--;                                               //get pointer to cookie structure
 
@@ -2132,6 +2362,38 @@ void memAnalysisCreateForPool(mempool *pool, FILE *fpAnalysis, FILE *fpMap)
 #endif //MEM_LOG_MOSTVOLATILE
 }
 
+#if MEM_SMALL_BLOCK_HEAP
+/*-----------------------------------------------------------------------------
+    Name        : memAnalysisCreateForSlabs
+    Description : Prints the occupancy of the typed slab pools and resets
+                    their allocation counts.
+    Inputs      : fpAnalysis - the analysis file pointer (mem.analysis)
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void memAnalysisCreateForSlabs(FILE *fpAnalysis)
+{
+    sdword slab, index;
+    memslab *pool;
+    mbheap *heap;
+
+    fprintf(fpAnalysis, "Slab pool\tBlock size\tAllocated/blocks\tHigh water\n");
+    for (slab = 0, pool = memSlab; slab < MSP_NumberSlabs; slab++, pool++)
+    {
+        dbgMessagef("Slab %-16s: %d allocs, %d too big for the pool", memSlabInfo[slab].name, pool->nAllocs, pool->nOverflowed);
+        fprintf(fpAnalysis, "%s: %d allocs, %d too big for the pool\n", memSlabInfo[slab].name, pool->nAllocs, pool->nOverflowed);
+        for (index = 0, heap = pool->heap; index < pool->nSizes; index++, heap++)
+        {
+            dbgMessagef("    %5d bytes: %5d/%5d allocated (%.2f%%), high water %d", heap->blockSize, heap->allocated.num, heap->nBlocks,
+                        heap->nBlocks ? (real32)heap->allocated.num / (real32)heap->nBlocks * 100.0f : 0.0f, pool->highWater[index]);
+            fprintf(fpAnalysis, "%20s, %10d, %10d/%d, %10d\n", memSlabInfo[slab].name, heap->blockSize, heap->allocated.num, heap->nBlocks, pool->highWater[index]);
+        }
+        pool->nAllocs = 0;
+        pool->nOverflowed = 0;
+    }
+}
+#endif //MEM_SMALL_BLOCK_HEAP
+
 /*-----------------------------------------------------------------------------
     Name        : memAnalysisCreate
     Description : Creates and prints a detailed analysis of the current state
@@ -2185,6 +2447,12 @@ void memAnalysisCreate(void)
     {
         memAnalysisCreateForPool(&memGrowthPool[index], fpAnalysis, fpMap);
     }
+#if MEM_SMALL_BLOCK_HEAP
+    memAnalysisCreateForSlabs(fpAnalysis);
+#endif
+    dbgMessagef("Frame arena: %d/%d bytes high water, %d allocations didn't fit", memFrameHighWater, MEM_FrameArenaSize, memFrameOverflowed);
+    fprintf(fpAnalysis, "Frame arena: %d/%d bytes high water, %d allocations didn't fit\n", memFrameHighWater, MEM_FrameArenaSize, memFrameOverflowed);
+    memFrameOverflowed = 0;
     fclose(fpAnalysis);
     fclose(fpMap);
 }
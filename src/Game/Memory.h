@@ -139,6 +139,18 @@
 #define MEM_OptCounterFreqBig   8192
 #define MEM_GrowFactor          96 / 256        //grow by 37.5% when a SBH pool runs out
 
+//typed slab pools for short-lived game objects
+#define MSP_Bullet              0
+#define MSP_Missile             1
+#define MSP_Effect              2
+#define MSP_ParticleSystem      3
+#define MSP_NumberSlabs         4
+#define MSP_NumberSizes         4               //most size classes in a slab pool
+
+//per-frame scratch arena
+#define MEM_FrameArenaSize      (256 * 1024)    //bytes of scratch memory per universe update
+#define MEM_FrameAlignment      16              //alignment of scratch blocks, power of 2
+
 //for printing memory statistics
 #define MEM_TaskStatsPeriod     1.0             //once per second
 
@@ -224,6 +236,28 @@ typedef struct
 #endif
 }
 mbheap;
+
+//info on a typed slab pool.  A block size of 0 takes the size of the first
+//allocation, for pools of fixed size objects.
+typedef struct
+{
+    char *name;
+    sdword blockSize[MSP_NumberSizes];          //size classes, ascending, 0 terminated after the first
+    sdword nBlocks;                             //blocks to add when a size class runs out
+}
+memslabinfo;
+
+//structure for a typed slab pool.  Each size class is a small block heap which
+//grows as needed, so blocks are freed through memFree like any SBH block.
+typedef struct
+{
+    mbheap heap[MSP_NumberSizes];
+    sdword nSizes;                              //size classes in use
+    sdword highWater[MSP_NumberSizes];          //most blocks allocated at once
+    sdword nAllocs;                             //allocations since the last analysis
+    sdword nOverflowed;                         //allocations too big for any size class
+}
+memslab;
 #endif//MEM_SMALL_BLOCK_HEAP
 
 #if MEM_LOG_MOSTVOLATILE
@@ -305,6 +339,8 @@ extern mempool memMainPool;
 #define mbhNameSet(c, s)    mbhNameSetFunction((c), (s))
 #define memNameSetLong(c, s)    memNameSetFunction((c), (s))
 #define memRealloc(p, l, n, f) memReallocFunction((p), (l), (n), (f));
+#define memSlabAlloc(s, l, n) memSlabAllocFunction((s), (l), (n));
+#define memFrameAlloc(l, n) memFrameAllocFunction((l), (n));
 #else
 #define memAlloc(l, n, f) memAllocFunction((l), (f));
 #define memAllocAttempt(l, n, f) memAllocAttemptFunction((l), (f));
@@ -312,6 +348,8 @@ extern mempool memMainPool;
 #define mbhNameSet(c, s)
 #define memNameSetLong(c, s)
 #define memRealloc(p, l, n, f) memReallocFunction((p), (l), (f));
+#define memSlabAlloc(s, l, n) memSlabAllocFunction((s), (l));
+#define memFrameAlloc(l, n) memFrameAllocFunction((l));
 #endif//MEM_USE_NAMES
 
 //block size macros
@@ -382,6 +420,14 @@ void *memReallocFunction(void *currentPointer, sdword newSize, udword flags);
 void *memAllocAttemptFunction(sdword length, udword flags);
 #endif
 void memFree(void *pointer);
+#if MEM_USE_NAMES
+void *memSlabAllocFunction(sdword slab, sdword length, char *name);
+void *memFrameAllocFunction(sdword length, char *name);
+#else
+void *memSlabAllocFunction(sdword slab, sdword length);
+void *memFrameAllocFunction(sdword length);
+#endif
+void memFrameReset(void);
 char *memStringDupe(char *string);
 char *memStringDupeNV(char *string);
 
@@ -0,0 +1,291 @@
+// =============================================================================
+//  ObjHandle.c
+//  - generational handles for space objects
+//
+//  A handle is a slot in a table plus the generation the slot was at when the
+//  handle was made.  Looking one up is an index and a compare, and a handle to
+//  an object which has since died simply stops matching, so whoever keeps one
+//  doesn't need to be told about the death.  The object keeps its slot index
+//  in handleIndex, which used to be padding, so it can find its handle without
+//  a search.  handleIndex isn't trusted on its own: it comes back from saved
+//  games and isn't set for objects which never got a handle, so it only
+//  counts if the slot points back at the object.
+// =============================================================================
+
+#include "ObjHandle.h"
+
+#include <string.h>
+
+#include "Debug.h"
+#include "Memory.h"
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+#if HND_STATS
+HNDStats hndStats;
+#endif
+
+typedef struct hndslot
+{
+    SpaceObj *obj;                              // NULL if the slot is free
+    uword generation;
+    uword nextFree;                             // next free slot, 0 for none
+} hndslot;
+
+static hndslot *hndSlots = NULL;
+static sdword hndNumSlots = 0;
+static uword hndFirstFree = 0;
+static sdword hndNumLive = 0;                   // objects with a handle
+static bool hndFullReported = FALSE;
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : hndSlotsGrow
+    Description : adds a batch of free slots to the table.  Slot 0 is never
+                  handed out so that HND_None can't match anything.
+    Inputs      :
+    Outputs     :
+    Return      : FALSE if the table is already as big as a handle can address
+----------------------------------------------------------------------------*/
+static bool hndSlotsGrow(void)
+{
+    sdword newNumSlots = min(hndNumSlots + HND_SLOT_BATCH, HND_MaxSlots);
+    sdword index;
+
+    if (newNumSlots == hndNumSlots)
+    {
+        return FALSE;
+    }
+    if (hndSlots == NULL)
+    {
+        hndSlots = memAlloc(sizeof(hndslot) * newNumSlots, "hndSlots", NonVolatile);
+    }
+    else
+    {
+        hndSlots = memRealloc(hndSlots, sizeof(hndslot) * newNumSlots, "hndSlots", NonVolatile);
+    }
+    memset(&hndSlots[hndNumSlots], 0, sizeof(hndslot) * (newNumSlots - hndNumSlots));
+
+    //chain the new slots onto the free list in order, skipping slot 0
+    for (index = newNumSlots - 1; index >= max(hndNumSlots, 1); index--)
+    {
+        hndSlots[index].nextFree = hndFirstFree;
+        hndFirstFree = (uword)index;
+    }
+    hndNumSlots = newNumSlots;
+    return TRUE;
+}
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : hndReset
+    Description : forgets every handle, for a new or loaded game.  Slot
+                  generations start over, which is safe because no handle
+                  from the old game survives the reset.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void hndReset(void)
+{
+    hndShutdown();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndShutdown
+    Description : frees the handle table
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void hndShutdown(void)
+{
+    if (hndSlots != NULL)
+    {
+        memFree(hndSlots);
+        hndSlots = NULL;
+    }
+    hndNumSlots = 0;
+    hndFirstFree = 0;
+    hndNumLive = 0;
+    hndFullReported = FALSE;
+#if HND_STATS
+    memset(&hndStats, 0, sizeof(hndStats));
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndObjBorn
+    Description : gives an object a handle
+    Inputs      : obj - the new object
+    Outputs     : obj->handleIndex is set
+    Return      : the object's handle, the existing one if it already had one,
+                  or HND_None if every slot is taken
+----------------------------------------------------------------------------*/
+objhandle hndObjBorn(SpaceObj *obj)
+{
+    return hndObjBornSpare(obj, 0);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndObjBornSpare
+    Description : gives an object a handle, unless that would leave fewer
+                  than spare slots for other objects.  For users which can
+                  do without a handle, so they don't use up the ones needed
+                  for network ID lookups.
+    Inputs      : obj - the new object
+                  spare - slots which have to remain free afterwards
+    Outputs     : obj->handleIndex is set
+    Return      : the object's handle, the existing one if it already had one,
+                  or HND_None if there aren't enough slots left
+----------------------------------------------------------------------------*/
+objhandle hndObjBornSpare(SpaceObj *obj, sdword spare)
+{
+    objhandle handle = hndOf(obj);
+    hndslot *slot;
+    uword index;
+
+    if (handle != HND_None)
+    {
+        return handle;
+    }
+    if (spare > 0 && hndNumLive + spare >= HND_MaxSlots - 1)
+    {
+        return HND_None;
+    }
+    if (hndFirstFree == 0 && !hndSlotsGrow())
+    {
+        if (!hndFullReported)
+        {
+            dbgMessagef("hndObjBorn: more than %d objects with handles", HND_MaxSlots - 1);
+            hndFullReported = TRUE;
+        }
+        return HND_None;
+    }
+
+    index = hndFirstFree;
+    slot = &hndSlots[index];
+    hndFirstFree = slot->nextFree;
+    slot->obj = obj;
+    slot->nextFree = 0;
+    obj->handleIndex = index;
+    hndNumLive++;
+
+#if HND_STATS
+    hndStats.numLive++;
+    hndStats.highWater = max(hndStats.highWater, hndStats.numLive);
+#endif
+    return ((objhandle)slot->generation << 16) | index;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndObjDied
+    Description : makes every handle to the object stale and frees its slot.
+                  Does nothing if the object has no handle.
+    Inputs      : obj - the dying object
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void hndObjDied(SpaceObj *obj)
+{
+    hndslot *slot;
+    uword index = obj->handleIndex;
+
+    if (index == 0 || index >= hndNumSlots || hndSlots[index].obj != obj)
+    {
+        return;
+    }
+
+    slot = &hndSlots[index];
+    slot->obj = NULL;
+    slot->generation++;
+    slot->nextFree = hndFirstFree;
+    hndFirstFree = index;
+    obj->handleIndex = 0;
+    hndNumLive--;
+
+#if HND_STATS
+    hndStats.numLive--;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndObjRetire
+    Description : makes every handle to the object stale, like hndObjDied,
+                  but lets it keep its slot.  For an object which is dead but
+                  still around for a while, such as an exploding ship, so
+                  whatever is indexed by its slot (RefIndex.h) stays put.
+                  hndOf gives its new handle, and hndObjDied frees the slot
+                  once the object is really deleted.
+    Inputs      : obj - the dead object
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void hndObjRetire(SpaceObj *obj)
+{
+    uword index = obj->handleIndex;
+
+    if (index == 0 || index >= hndNumSlots || hndSlots[index].obj != obj)
+    {
+        return;
+    }
+    hndSlots[index].generation++;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndOf
+    Description : finds the handle of an object
+    Inputs      : obj - the object
+    Outputs     :
+    Return      : its handle, or HND_None if it doesn't have one
+----------------------------------------------------------------------------*/
+objhandle hndOf(SpaceObj *obj)
+{
+    uword index;
+
+    if (obj == NULL)
+    {
+        return HND_None;
+    }
+    index = obj->handleIndex;
+    if (index == 0 || index >= hndNumSlots || hndSlots[index].obj != obj)
+    {
+        return HND_None;
+    }
+    return ((objhandle)hndSlots[index].generation << 16) | index;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : hndObj
+    Description : finds the object a handle refers to
+    Inputs      : handle - the handle
+    Outputs     :
+    Return      : the object, or NULL if it has died or handle is HND_None
+----------------------------------------------------------------------------*/
+SpaceObj *hndObj(objhandle handle)
+{
+    hndslot *slot;
+    udword index = hndIndex(handle);
+
+    if (index == 0 || index >= (udword)hndNumSlots)
+    {
+        return NULL;
+    }
+    slot = &hndSlots[index];
+    if (slot->generation != hndGeneration(handle) || slot->obj == NULL)
+    {
+#if HND_STATS
+        hndStats.numStale++;
+#endif
+        return NULL;
+    }
+    return slot->obj;
+}
@@ -0,0 +1,67 @@
+// =============================================================================
+//  ObjHandle.h
+//  - generational handles for space objects
+// =============================================================================
+
+#ifndef ___OBJHANDLE_H
+#define ___OBJHANDLE_H
+
+#include "SpaceObj.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define HND_STATS                   1
+#else
+#define HND_STATS                   0
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define HND_None                    0           // handle which never refers to anything
+#define HND_MaxSlots                0x10000     // slot index is the low 16 bits of a handle
+#define HND_SLOT_BATCH              256         // slots added at a time
+
+#define hndIndex(h)                 ((h) & 0xffff)
+#define hndGeneration(h)            ((h) >> 16)
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+// slot index in the low 16 bits, generation of the slot in the high 16 bits.
+// The generation moves on when the object dies, so an old handle to a slot
+// which has been reused no longer matches.
+typedef udword objhandle;
+
+#if HND_STATS
+typedef struct HNDStats
+{
+    sdword numLive;                             // objects with a handle
+    sdword highWater;                           // most objects with a handle at once
+    sdword numStale;                            // lookups of handles to dead objects
+} HNDStats;
+
+extern HNDStats hndStats;
+#endif
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void hndReset(void);
+void hndShutdown(void);
+
+objhandle hndObjBorn(SpaceObj *obj);
+objhandle hndObjBornSpare(SpaceObj *obj, sdword spare);
+void hndObjDied(SpaceObj *obj);
+void hndObjRetire(SpaceObj *obj);
+
+objhandle hndOf(SpaceObj *obj);
+SpaceObj *hndObj(objhandle handle);
+
+#endif
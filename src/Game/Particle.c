@@ -22,6 +22,7 @@
 #include "Debug.h"
 #include "Memory.h"
 #include "Particle.h"
+#include "ParticleUpdate.h"
 #include "render.h"
 #include "Mesh.h"
 #include "FastMath.h"
@@ -2165,12 +2166,9 @@ bool8 partUpdateSystem(psysPtr psys, real32 dt, vector* velvec)
 {
     billSystem *pp;
     particle *p = NULL;
-    udword n, i, hits;
-    vector rvec;
-    bool draggin;
+    udword hits;
 
     pp = (billSystem*)psys;      //default assumption
-    n = pp->n;
     if (pp->angDelta != 0.0f)
     {
         pp->ang += dt * pp->angDelta;
@@ -2184,126 +2182,7 @@ bool8 partUpdateSystem(psysPtr psys, real32 dt, vector* velvec)
         return TRUE;
     }
 
-    draggin = (pp->drag != 1.0f);
-
-    for (i = hits = 0; i < n; i++, p++)
-    {
-        //mesh tumble specifics
-        if (pp->t == PART_MESH)
-        {
-            p->tumble[0] += dt * p->deltaTumble[0];
-            p->tumble[1] += dt * p->deltaTumble[1];
-            p->tumble[2] += dt * p->deltaTumble[2];
-        }
-
-        if (p->waitspan > 0.0f)
-        {
-            p->waitspan -= dt;
-            if (p->waitspan < 0.0f)
-            {
-                p->waitspan = 0.0f;
-            }
-            hits++;
-            continue;       //don't dec lifespan if waiting
-        }
-
-        //sprite/mesh system specifics
-        if (p->tstruct != NULL)
-        {
-            partUpdateAnimation(pp, p, dt);
-        }
-        if (p->mstruct != NULL)
-        {
-            partUpdateMeshAnimation((meshSystem*)pp, p, dt);
-        }
-        if (p->deltaRot != 0.0f)
-        {
-            p->rot += dt * p->deltaRot;
-        }
-
-        //lines
-        if (p->deltaLength)
-        {
-            p->length += dt * p->deltaLength;
-            if (isnan((double)p->length))
-            {
-                p->length = 1.0f;
-            }
-        }
-
-        //kinematics
-        if (bitTest(pp->flags, PART_WORLDSPACE))
-        {
-            vector adjWVel, adjWAccel;
-
-            //don't update position if XYZ scaling (hyperspace effect)
-            if (!bitTest(p->flags, PART_XYZSCALE))
-            {
-                //setup
-                adjWVel = p->wVel;
-                adjWAccel = p->wAccel;
-                vecMultiplyByScalar(adjWVel, dt);
-                vecMultiplyByScalar(adjWAccel, dt);
-                //velocity
-                vecAddTo(adjWVel, adjWAccel);
-                //update
-                vecAddTo(p->position, adjWVel);
-                vecAddTo(p->wVel, adjWAccel);
-                //drag
-                vecMultiplyByScalar(p->wVel, pp->drag);
-                vecMultiplyByScalar(p->wAccel, pp->drag);
-            }
-        }
-        else
-        {
-            //position
-            p->position.z += dt * p->velLOF;
-            rvec = p->rvec;
-            vecMultiplyByScalar(rvec, dt * p->velR);
-            vecAddTo(p->position, rvec);
-
-            //velocity
-            p->velLOF += dt * p->deltaVelLOF;
-            p->velR += dt * p->deltaVelR;
-            if (draggin)
-            {
-                p->velLOF *= pp->drag;
-                p->velR *= pp->drag;
-            }
-        }
-
-        //appearance
-        if (p->deltaScale != 0.0f)
-        {                                                   //scale the particle
-            p->scale += dt * p->deltaScale;
-            if (p->scale < 0.0f)
-            {                                               //clamp at zero
-                p->scale = 0.0f;
-            }
-        }
-
-        partColorDelta(p->icolor, p->deltaColor, pp->flags, dt);
-
-        //FIXME: does this make sense?
-        if (p->icolor[3] < 1.0f)
-        {
-            pointSystem* sys = (pointSystem*)psys;
-            bitSet(sys->flags, PART_ALPHA);
-        }
-
-        if (p->lit)
-        {
-            p->illum += dt * p->deltaIllum;
-            RealClamp(p->illum);
-        }
-
-        //lifespan
-        p->lifespan -= dt;
-        if (p->lifespan > 0.0f)
-        {
-            hits++;
-        }
-    }
+    hits = pupUpdateParticles(psys, p, pp->n, dt);
 
     return((bool8)((hits == 0) ? TRUE : FALSE));
 }
@@ -2682,7 +2561,7 @@ psysPtr partCreationHelper(particleType t, udword n, udword dist)
     {
     case PART_BILLBOARD:
         len = sizeof(billSystem) + n*sizeof(particle);
-        p = memAlloc(len, "ps(partsys)", Pyrophoric);
+        p = memSlabAlloc(MSP_ParticleSystem, len, "ps(partsys)");
         bill = (billSystem*)p;
         bill->t = t;
         bill->n = (uword)n;
@@ -2702,7 +2581,7 @@ psysPtr partCreationHelper(particleType t, udword n, udword dist)
         break;
     case PART_MESH:
         len = sizeof(meshSystem) + n*sizeof(particle);
-        p = memAlloc(len, "ps(partsys)", Pyrophoric);
+        p = memSlabAlloc(MSP_ParticleSystem, len, "ps(partsys)");
         mesh = (meshSystem*)p;
         mesh->t = t;
         mesh->n = (uword)n;
@@ -2719,7 +2598,7 @@ psysPtr partCreationHelper(particleType t, udword n, udword dist)
         break;
     case PART_LINES:
         len = sizeof(lineSystem) + n*sizeof(particle);
-        p = memAlloc(len, "ps(partsys)", Pyrophoric);
+        p = memSlabAlloc(MSP_ParticleSystem, len, "ps(partsys)");
         line = (lineSystem*)p;
         line->t = t;
         line->n = (uword)n;
@@ -2733,7 +2612,7 @@ psysPtr partCreationHelper(particleType t, udword n, udword dist)
         break;
     case PART_CUBES:
         len = sizeof(cubeSystem) + n*sizeof(particle);
-        p = memAlloc(len, "ps(partsys)", Pyrophoric);
+        p = memSlabAlloc(MSP_ParticleSystem, len, "ps(partsys)");
         cube = (cubeSystem*)p;
         cube->t = t;
         cube->n = (uword)n;
@@ -2747,7 +2626,7 @@ psysPtr partCreationHelper(particleType t, udword n, udword dist)
         break;
     case PART_POINTS:
         len = sizeof(pointSystem) + n*sizeof(particle);
-        p = memAlloc(len, "ps(partsys)", Pyrophoric);
+        p = memSlabAlloc(MSP_ParticleSystem, len, "ps(partsys)");
         point = (pointSystem*)p;
         point->t = t;
         point->n = (uword)n;
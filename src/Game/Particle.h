@@ -218,6 +218,9 @@ void partShutdown(void);
 void partSetDefaults();
 void partRenderSystem(psysPtr psys);
 bool8 partUpdateSystem(psysPtr psys, real32 dt, vector* velvec);    //TRUE if system died, FALSE otherwise
+void partUpdateAnimation(billSystem* bsys, particle* part, real32 dt);
+void partUpdateMeshAnimation(meshSystem* psys, particle* part, real32 dt);
+void partColorDelta(real32 *c, real32 *d, udword flags, real32 dt);
 psysPtr partCreateSystem(particleType t, udword n);
 psysPtr partCreateSystemWithDelta(particleType t, udword n, udword delta);
 psysPtr partCreateSphericalSystem(particleType t, udword n);
@@ -0,0 +1,666 @@
+// =============================================================================
+//  ParticleUpdate.c
+//  - per-system particle update kernels
+// =============================================================================
+//
+//  partUpdateSystem used to run one loop over every kind of particle system,
+//  testing the system type and motion flags again for every particle.  Here
+//  those tests are made once per system to pick a kernel:
+//
+//  - mesh systems get their tumble pass, waiting particles included.
+//
+//  - local space systems move along the line of fire and the radial vector,
+//    world space systems integrate their world velocity and acceleration.
+//
+//  The particle records stay where they are.  The renderer, ETG and the save
+//  games all walk that layout, and a record is touched once per update, so
+//  copying particles out to arrays and back costs more than it saves.  The
+//  colour fade is the one 4-wide piece of the update, and runs with SSE on
+//  the record's RGBA in place.
+//
+//  The kernels do the same single precision operations in the same order as
+//  the loop they replace, including its clamping of NaNs and the way the first
+//  translucent particle switches on alpha fading for the ones after it, so
+//  results are unchanged.
+// =============================================================================
+
+#include "ParticleUpdate.h"
+
+#include <math.h>
+#include <string.h>
+
+#if PUP_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "Debug.h"
+#include "Memory.h"
+#include "SDL.h"
+
+#if defined _MSC_VER
+	#define isnan(x) _isnan(x)
+#endif
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+#if PUP_STATS
+PUPStats pupStats;
+#define pupStatsAdd(field, n)   SDL_AtomicAdd(&pupStats.field, (n))
+#else
+#define pupStatsAdd(field, n)
+#endif
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : pupMeshTumble
+    Description : Spins the particles of a mesh system, waiting or not.
+    Inputs      : p - first particle, n - number of particles, dt - time step
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void pupMeshTumble(particle *p, udword n, real32 dt)
+{
+    for (; n > 0; n--, p++)
+    {
+        p->tumble[0] += dt * p->deltaTumble[0];
+        p->tumble[1] += dt * p->deltaTumble[1];
+        p->tumble[2] += dt * p->deltaTumble[2];
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupParticleStart
+    Description : Counts down a waiting particle, or updates the animation,
+                  rotation and line length of a running one.
+    Inputs      : pp - system header, p - particle, dt - time step
+    Outputs     :
+    Return      : TRUE if the particle is running and needs the rest of its
+                  update
+----------------------------------------------------------------------------*/
+static inline bool pupParticleStart(billSystem *pp, particle *p, real32 dt)
+{
+    if (p->waitspan > 0.0f)
+    {
+        p->waitspan -= dt;
+        if (p->waitspan < 0.0f)
+        {
+            p->waitspan = 0.0f;
+        }
+        return FALSE;       //don't dec lifespan if waiting
+    }
+
+    //sprite/mesh system specifics
+    if (p->tstruct != NULL)
+    {
+        partUpdateAnimation(pp, p, dt);
+    }
+    if (p->mstruct != NULL)
+    {
+        partUpdateMeshAnimation((meshSystem*)pp, p, dt);
+    }
+    if (p->deltaRot != 0.0f)
+    {
+        p->rot += dt * p->deltaRot;
+    }
+
+    //lines
+    if (p->deltaLength)
+    {
+        p->length += dt * p->deltaLength;
+        if (isnan((double)p->length))
+        {
+            p->length = 1.0f;
+        }
+    }
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupColorDelta
+    Description : partColorDelta on a particle's RGBA at once
+    Inputs      : c - colour, d - colour delta
+                  alpha - TRUE if the alpha fades too
+                  dt - time step
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static inline void pupColorDelta(real32 *c, real32 *d, bool alpha, real32 dt)
+{
+#if PUP_USE_SSE
+    __m128 zero = _mm_setzero_ps();
+    __m128 lanes, before, delta, after, change;
+
+    lanes = alpha ? _mm_cmpeq_ps(zero, zero) : _mm_cmpneq_ps(_mm_set_ps(0.0f, 1.0f, 1.0f, 1.0f), zero);
+    before = _mm_loadu_ps(c);
+    delta = _mm_loadu_ps(d);
+    after = _mm_add_ps(before, _mm_mul_ps(delta, _mm_set1_ps(dt)));
+    //operand order keeps NaNs, like the compares of the scalar clamp
+    after = _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(zero, after));
+    change = _mm_and_ps(_mm_cmpneq_ps(delta, zero), lanes);
+    _mm_storeu_ps(c, _mm_or_ps(_mm_and_ps(change, after), _mm_andnot_ps(change, before)));
+#else
+    partColorDelta(c, d, alpha ? PART_ALPHA : 0, dt);
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupParticleFinish
+    Description : Scales, fades, lights and ages a running particle.
+    Inputs      : pp - system header, p - particle, dt - time step
+                  alpha - TRUE if the system has PART_ALPHA set
+    Outputs     : PART_ALPHA is set on the system, and alpha, once a
+                  particle is translucent
+    Return      : 1 if the particle is still alive, 0 if not
+----------------------------------------------------------------------------*/
+static inline udword pupParticleFinish(billSystem *pp, particle *p, real32 dt, bool *alpha)
+{
+    real32 illum;
+
+    //appearance
+    if (p->deltaScale != 0.0f)
+    {                                                   //scale the particle
+        p->scale += dt * p->deltaScale;
+        if (p->scale < 0.0f)
+        {                                               //clamp at zero
+            p->scale = 0.0f;
+        }
+    }
+
+    pupColorDelta(p->icolor, p->deltaColor, *alpha, dt);
+
+    //FIXME: does this make sense?
+    if (!*alpha && p->icolor[3] < 1.0f)
+    {
+        bitSet(pp->flags, PART_ALPHA);
+        *alpha = TRUE;
+    }
+
+    if (p->lit)
+    {
+        illum = p->illum + dt * p->deltaIllum;
+        if (illum < 0.0f) illum = 0.0f;
+        else if (illum > 1.0f) illum = 1.0f;
+        p->illum = illum;
+    }
+
+    //lifespan
+    p->lifespan -= dt;
+    return (udword)(p->lifespan > 0.0f);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupUpdateLocal
+    Description : Updates the particles of a system which moves in the space
+                  of its effect, along the line of fire and radial vectors.
+    Inputs      : pp - system header
+                  p - first particle, n - number of particles
+                  dt - time step
+    Outputs     :
+    Return      : number of particles which are waiting or still alive
+----------------------------------------------------------------------------*/
+static udword pupUpdateLocal(billSystem *pp, particle *p, udword n, real32 dt)
+{
+    real32 drag = pp->drag;
+    bool draggin = (drag != 1.0f);
+    bool alpha = bitTest(pp->flags, PART_ALPHA) != 0;
+    udword hits = 0, waiting = 0;
+    real32 r;
+
+    for (; n > 0; n--, p++)
+    {
+        if (!pupParticleStart(pp, p, dt))
+        {
+            waiting++;
+            hits++;
+            continue;
+        }
+
+        //position
+        p->position.z += dt * p->velLOF;
+        r = dt * p->velR;
+        p->position.x += p->rvec.x * r;
+        p->position.y += p->rvec.y * r;
+        p->position.z += p->rvec.z * r;
+
+        //velocity
+        p->velLOF += dt * p->deltaVelLOF;
+        p->velR += dt * p->deltaVelR;
+        if (draggin)
+        {
+            p->velLOF *= drag;
+            p->velR *= drag;
+        }
+
+        hits += pupParticleFinish(pp, p, dt, &alpha);
+    }
+
+    pupStatsAdd(numWaiting, waiting);
+    return hits;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupUpdateWorld
+    Description : Updates the particles of a system which moves in world
+                  space with its own velocity and acceleration.
+    Inputs      : pp - system header
+                  p - first particle, n - number of particles
+                  dt - time step
+    Outputs     :
+    Return      : number of particles which are waiting or still alive
+----------------------------------------------------------------------------*/
+static udword pupUpdateWorld(billSystem *pp, particle *p, udword n, real32 dt)
+{
+    real32 drag = pp->drag;
+    bool alpha = bitTest(pp->flags, PART_ALPHA) != 0;
+    udword hits = 0, waiting = 0;
+    vector vel, accel;
+
+    for (; n > 0; n--, p++)
+    {
+        if (!pupParticleStart(pp, p, dt))
+        {
+            waiting++;
+            hits++;
+            continue;
+        }
+
+        //don't update position if XYZ scaling (hyperspace effect)
+        if (!bitTest(p->flags, PART_XYZSCALE))
+        {
+            vel.x = p->wVel.x * dt;
+            vel.y = p->wVel.y * dt;
+            vel.z = p->wVel.z * dt;
+            accel.x = p->wAccel.x * dt;
+            accel.y = p->wAccel.y * dt;
+            accel.z = p->wAccel.z * dt;
+            p->position.x += vel.x + accel.x;
+            p->position.y += vel.y + accel.y;
+            p->position.z += vel.z + accel.z;
+            p->wVel.x = (p->wVel.x + accel.x) * drag;
+            p->wVel.y = (p->wVel.y + accel.y) * drag;
+            p->wVel.z = (p->wVel.z + accel.z) * drag;
+            p->wAccel.x *= drag;
+            p->wAccel.y *= drag;
+            p->wAccel.z *= drag;
+        }
+
+        hits += pupParticleFinish(pp, p, dt, &alpha);
+    }
+
+    pupStatsAdd(numWaiting, waiting);
+    return hits;
+}
+
+/*=============================================================================
+    Public functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : pupBeginUpdate
+    Description : Call once a frame before the particle systems are updated,
+                  to reset the counters.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void pupBeginUpdate(void)
+{
+#if PUP_STATS
+    memset(&pupStats, 0, sizeof(pupStats));
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupUpdateParticles
+    Description : Ticks the particles of a system with the kernel for its
+                  type and motion.
+    Inputs      : psys - system header
+                  p - its first particle, n - number of particles
+                  dt - time step
+    Outputs     :
+    Return      : number of particles which are waiting or still alive
+----------------------------------------------------------------------------*/
+udword pupUpdateParticles(psysPtr psys, particle *p, udword n, real32 dt)
+{
+    billSystem *pp = (billSystem *)psys;
+    udword hits;
+
+    if (pp->t == PART_MESH)
+    {
+        pupMeshTumble(p, n, dt);
+    }
+
+    if (bitTest(pp->flags, PART_WORLDSPACE))
+    {
+        hits = pupUpdateWorld(pp, p, n, dt);
+        pupStatsAdd(numWorldSpace, 1);
+    }
+    else
+    {
+        hits = pupUpdateLocal(pp, p, n, dt);
+    }
+
+    pupStatsAdd(numSystems, 1);
+    pupStatsAdd(numParticles, n);
+
+    return hits;
+}
+
+#if PUP_TEST
+/*-----------------------------------------------------------------------------
+    Test and benchmark functions.  The loop the kernels replaced is kept here
+    to compare against.
+-----------------------------------------------------------------------------*/
+#define PUP_TestRounds          64
+#define PUP_TestFrames          192         // 12 seconds, as long as the longest lived test particles
+#define PUP_TestDt              (1.0f / 16.0f)
+
+#define RealClamp(r) \
+        if ((r) < 0.0f) r = 0.0f; \
+        else if ((r) > 1.0f) r = 1.0f;
+
+typedef struct pupTestSystem
+{
+    char *name;
+    particleType type;
+    udword flags;
+    udword numParticles;
+} pupTestSystem;
+
+//particle counts in the range the stock ETG effects create
+static pupTestSystem pupTestSystems[] =
+{
+    { "sparks",         PART_BILLBOARD, 0,                  12  },
+    { "gun flash",      PART_BILLBOARD, 0,                  48  },
+    { "ion streaks",    PART_LINES,     0,                  96  },
+    { "debris",         PART_MESH,      PART_WORLDSPACE,    24  },
+    { "hull chunks",    PART_CUBES,     PART_WORLDSPACE,    40  },
+    { "big explosion",  PART_BILLBOARD, PART_WORLDSPACE,    300 },
+    { NULL,             0,              0,                  0   }
+};
+
+static udword pupTestSeed;
+
+static real32 pupTestRandom(real32 low, real32 high)
+{
+    pupTestSeed = pupTestSeed * 1664525 + 1013904223;
+    return low + (high - low) * (real32)(pupTestSeed >> 8) / (real32)(1 << 24);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupTestReference
+    Description : the update loop partUpdateSystem used to run
+    Inputs      : pp - system header, p - first particle, n - number of
+                  particles, dt - time step
+    Outputs     :
+    Return      : number of particles which are waiting or still alive
+----------------------------------------------------------------------------*/
+static udword pupTestReference(billSystem *pp, particle *p, udword n, real32 dt)
+{
+    udword i, hits;
+    vector rvec;
+    bool draggin;
+
+    draggin = (pp->drag != 1.0f);
+
+    for (i = hits = 0; i < n; i++, p++)
+    {
+        //mesh tumble specifics
+        if (pp->t == PART_MESH)
+        {
+            p->tumble[0] += dt * p->deltaTumble[0];
+            p->tumble[1] += dt * p->deltaTumble[1];
+            p->tumble[2] += dt * p->deltaTumble[2];
+        }
+
+        if (p->waitspan > 0.0f)
+        {
+            p->waitspan -= dt;
+            if (p->waitspan < 0.0f)
+            {
+                p->waitspan = 0.0f;
+            }
+            hits++;
+            continue;       //don't dec lifespan if waiting
+        }
+
+        //sprite/mesh system specifics
+        if (p->tstruct != NULL)
+        {
+            partUpdateAnimation(pp, p, dt);
+        }
+        if (p->mstruct != NULL)
+        {
+            partUpdateMeshAnimation((meshSystem*)pp, p, dt);
+        }
+        if (p->deltaRot != 0.0f)
+        {
+            p->rot += dt * p->deltaRot;
+        }
+
+        //lines
+        if (p->deltaLength)
+        {
+            p->length += dt * p->deltaLength;
+            if (isnan((double)p->length))
+            {
+                p->length = 1.0f;
+            }
+        }
+
+        //kinematics
+        if (bitTest(pp->flags, PART_WORLDSPACE))
+        {
+            vector adjWVel, adjWAccel;
+
+            //don't update position if XYZ scaling (hyperspace effect)
+            if (!bitTest(p->flags, PART_XYZSCALE))
+            {
+                //setup
+                adjWVel = p->wVel;
+                adjWAccel = p->wAccel;
+                vecMultiplyByScalar(adjWVel, dt);
+                vecMultiplyByScalar(adjWAccel, dt);
+                //velocity
+                vecAddTo(adjWVel, adjWAccel);
+                //update
+                vecAddTo(p->position, adjWVel);
+                vecAddTo(p->wVel, adjWAccel);
+                //drag
+                vecMultiplyByScalar(p->wVel, pp->drag);
+                vecMultiplyByScalar(p->wAccel, pp->drag);
+            }
+        }
+        else
+        {
+            //position
+            p->position.z += dt * p->velLOF;
+            rvec = p->rvec;
+            vecMultiplyByScalar(rvec, dt * p->velR);
+            vecAddTo(p->position, rvec);
+
+            //velocity
+            p->velLOF += dt * p->deltaVelLOF;
+            p->velR += dt * p->deltaVelR;
+            if (draggin)
+            {
+                p->velLOF *= pp->drag;
+                p->velR *= pp->drag;
+            }
+        }
+
+        //appearance
+        if (p->deltaScale != 0.0f)
+        {                                                   //scale the particle
+            p->scale += dt * p->deltaScale;
+            if (p->scale < 0.0f)
+            {                                               //clamp at zero
+                p->scale = 0.0f;
+            }
+        }
+
+        partColorDelta(p->icolor, p->deltaColor, pp->flags, dt);
+
+        //FIXME: does this make sense?
+        if (p->icolor[3] < 1.0f)
+        {
+            bitSet(pp->flags, PART_ALPHA);
+        }
+
+        if (p->lit)
+        {
+            p->illum += dt * p->deltaIllum;
+            RealClamp(p->illum);
+        }
+
+        //lifespan
+        p->lifespan -= dt;
+        if (p->lifespan > 0.0f)
+        {
+            hits++;
+        }
+    }
+
+    return hits;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupTestFill
+    Description : makes up a system's worth of particles with a mix of
+                  waiting, fading, clamped, lit and hyperspace particles
+    Inputs      : test - kind of system, pp - header to fill, p - particles
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void pupTestFill(pupTestSystem *test, billSystem *pp, particle *p)
+{
+    udword i;
+
+    memset(pp, 0, sizeof(billSystem));
+    memset(p, 0, test->numParticles * sizeof(particle));
+    pp->t = test->type;
+    pp->flags = test->flags;
+    pp->n = (uword)test->numParticles;
+    pp->drag = (pupTestSeed & 0x100) ? 1.0f : 0.97f;
+
+    for (i = 0; i < test->numParticles; i++, p++)
+    {
+        p->lifespan = pupTestRandom(0.5f, 12.0f);
+        p->waitspan = (i % 5 == 0) ? pupTestRandom(0.0f, 2.0f) : 0.0f;
+        p->velLOF = pupTestRandom(-200.0f, 200.0f);
+        p->velR = pupTestRandom(0.0f, 150.0f);
+        p->deltaVelLOF = pupTestRandom(-20.0f, 20.0f);
+        p->deltaVelR = (i & 1) ? pupTestRandom(-20.0f, 20.0f) : 0.0f;
+        p->rvec.x = pupTestRandom(-1.0f, 1.0f);
+        p->rvec.y = pupTestRandom(-1.0f, 1.0f);
+        p->rvec.z = pupTestRandom(-1.0f, 1.0f);
+        p->position.x = pupTestRandom(-500.0f, 500.0f);
+        p->position.y = pupTestRandom(-500.0f, 500.0f);
+        p->position.z = pupTestRandom(-500.0f, 500.0f);
+        p->wVel.x = pupTestRandom(-300.0f, 300.0f);
+        p->wVel.y = pupTestRandom(-300.0f, 300.0f);
+        p->wVel.z = pupTestRandom(-300.0f, 300.0f);
+        p->wAccel.x = pupTestRandom(-30.0f, 30.0f);
+        p->wAccel.y = pupTestRandom(-30.0f, 30.0f);
+        p->wAccel.z = pupTestRandom(-30.0f, 30.0f);
+        p->icolor[0] = pupTestRandom(-0.2f, 1.2f);       //some start out of range
+        p->icolor[1] = pupTestRandom(0.0f, 1.0f);
+        p->icolor[2] = pupTestRandom(0.0f, 1.0f);
+        p->icolor[3] = (i < test->numParticles / 3) ? 1.0f : pupTestRandom(0.5f, 1.0f);
+        p->deltaColor[0] = (i % 3) ? pupTestRandom(-0.5f, 0.5f) : 0.0f;
+        p->deltaColor[1] = pupTestRandom(-0.5f, 0.5f);
+        p->deltaColor[2] = (i % 4) ? pupTestRandom(-0.5f, 0.5f) : 0.0f;
+        p->deltaColor[3] = pupTestRandom(-0.3f, 0.0f);
+        p->scale = pupTestRandom(1.0f, 40.0f);
+        p->deltaScale = (i % 3 == 1) ? 0.0f : pupTestRandom(-10.0f, 10.0f);
+        p->lit = (bool8)(i & 1);
+        p->illum = pupTestRandom(0.0f, 1.0f);
+        p->deltaIllum = pupTestRandom(-0.2f, 0.2f);
+        p->length = pupTestRandom(10.0f, 100.0f);
+        p->deltaLength = (test->type == PART_LINES) ? pupTestRandom(-5.0f, 5.0f) : 0.0f;
+        p->deltaRot = (test->type == PART_BILLBOARD) ? pupTestRandom(-3.0f, 3.0f) : 0.0f;
+        p->deltaTumble[0] = pupTestRandom(-2.0f, 2.0f);
+        p->deltaTumble[1] = pupTestRandom(-2.0f, 2.0f);
+        p->deltaTumble[2] = pupTestRandom(-2.0f, 2.0f);
+        p->flags = (i % 7 == 3) ? PART_XYZSCALE : 0;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : pupTest
+    Description : runs the kernels and the old loop on the same made up
+                  systems, fails if they ever disagree and prints how long
+                  each took
+    Inputs      :
+    Outputs     : results printed with dbgMessagef
+    Return      :
+----------------------------------------------------------------------------*/
+void pupTest(void)
+{
+    pupTestSystem *test;
+    billSystem headerRef, headerKernel;
+    particle *partRef, *partKernel;
+    udword round, frame, hitsRef, hitsKernel, size;
+    Uint64 timeStart, timeRef, timeKernel;
+
+    for (test = pupTestSystems; test->name != NULL; test++)
+    {
+        size = test->numParticles * sizeof(particle);
+        partRef = memAlloc(size, "pupTestRef", NonVolatile);
+        partKernel = memAlloc(size, "pupTestKernel", NonVolatile);
+        timeRef = timeKernel = 0;
+
+        //each round is one effect's lifetime, so nothing decays to denormals
+        for (round = 0; round < PUP_TestRounds; round++)
+        {
+            pupTestSeed = round * 977 + (udword)(test - pupTestSystems) + 1;
+            pupTestFill(test, &headerRef, partRef);
+            headerKernel = headerRef;
+            memcpy(partKernel, partRef, size);
+
+            for (frame = 0; frame < PUP_TestFrames; frame++)
+            {
+                hitsRef = pupTestReference(&headerRef, partRef, test->numParticles, PUP_TestDt);
+                hitsKernel = pupUpdateParticles((psysPtr)&headerKernel, partKernel, test->numParticles, PUP_TestDt);
+                if (hitsRef != hitsKernel || headerRef.flags != headerKernel.flags ||
+                    memcmp(partRef, partKernel, size) != 0)
+                {
+                    dbgFatalf(DBG_Loc, "pupTest(%s): kernel differs on round %d frame %d", test->name, round, frame);
+                }
+            }
+
+            pupTestSeed = round * 977 + (udword)(test - pupTestSystems) + 1;
+            pupTestFill(test, &headerRef, partRef);
+            headerKernel = headerRef;
+            memcpy(partKernel, partRef, size);
+
+            timeStart = SDL_GetPerformanceCounter();
+            for (frame = 0; frame < PUP_TestFrames; frame++)
+            {
+                pupTestReference(&headerRef, partRef, test->numParticles, PUP_TestDt);
+            }
+            timeRef += SDL_GetPerformanceCounter() - timeStart;
+
+            timeStart = SDL_GetPerformanceCounter();
+            for (frame = 0; frame < PUP_TestFrames; frame++)
+            {
+                pupUpdateParticles((psysPtr)&headerKernel, partKernel, test->numParticles, PUP_TestDt);
+            }
+            timeKernel += SDL_GetPerformanceCounter() - timeStart;
+        }
+
+        dbgMessagef("pupTest(%s): %d particles, ns per particle per frame %.1f old, %.1f kernel",
+                    test->name, test->numParticles,
+                    (real64)timeRef * 1.0e9 / SDL_GetPerformanceFrequency() / (PUP_TestRounds * PUP_TestFrames) / test->numParticles,
+                    (real64)timeKernel * 1.0e9 / SDL_GetPerformanceFrequency() / (PUP_TestRounds * PUP_TestFrames) / test->numParticles);
+
+        memFree(partRef);
+        memFree(partKernel);
+    }
+}
+#endif //PUP_TEST
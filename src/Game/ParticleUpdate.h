@@ -0,0 +1,59 @@
+// =============================================================================
+//  ParticleUpdate.h
+//  - per-system particle update kernels
+// =============================================================================
+
+#ifndef ___PARTICLEUPDATE_H
+#define ___PARTICLEUPDATE_H
+
+#include "SDL.h"
+
+#include "Particle.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PUP_USE_SSE                 1
+#else
+#define PUP_USE_SSE                 0
+#endif
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define PUP_STATS                   1
+#define PUP_TEST                    0           // test and benchmark against the old update loop at startup
+#else
+#define PUP_STATS                   0
+#define PUP_TEST                    0
+#endif
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+#if PUP_STATS
+// systems may be updated on the job threads, so these are atomic
+typedef struct PUPStats
+{
+    SDL_atomic_t numSystems;                    // systems updated this frame
+    SDL_atomic_t numWorldSpace;                 // of which move in world space
+    SDL_atomic_t numParticles;                  // particles updated
+    SDL_atomic_t numWaiting;                    // particles still waiting to start
+} PUPStats;
+
+extern PUPStats pupStats;
+#endif
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void pupBeginUpdate(void);
+udword pupUpdateParticles(psysPtr psys, particle *p, udword n, real32 dt);
+
+#if PUP_TEST
+void pupTest(void);
+#endif
+
+#endif
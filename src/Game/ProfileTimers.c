@@ -7,6 +7,7 @@
 #include "Memory.h"
 #include "Debug.h"
 #include "File.h"
+#include "SaveGame.h"
 
 #ifdef PROFILE_TIMERS
 
@@ -113,6 +114,13 @@ void profTimerStatsPrintFunc(sdword *y)
                 fontPrintf(0,*y += 15,colWhite, "Timer %d : %d",i,timeDuration);
         }
     }
+
+    if (saveSnapshotStats.numSnapshots)
+    {
+        fontPrintf(0,*y += 15,colWhite, "Autosave capture %.2fms write %.2fms (%dk -> %dk)",
+                   saveSnapshotStats.captureMs, saveSnapshotStats.writeMs,
+                   saveSnapshotStats.length / 1024, saveSnapshotStats.storedLength / 1024);
+    }
 }
 
 void profTimerRecord(sdword timer)
@@ -177,3 +185,43 @@ void profTimerOutputRecordingsFunc()
 
 #endif
 
+
+/*=============================================================================
+    Benchmark timers, always compiled in (see Benchmark.c)
+=============================================================================*/
+
+BenchTimers benchTimers;
+
+void benchTimersReset(void)
+{
+    bool timersOn = benchTimers.timersOn;
+
+    memset(&benchTimers,0,sizeof(benchTimers));
+    benchTimers.timersOn = timersOn;
+}
+
+void benchTimerStartLabelFunc(sdword timer,char *label)
+{
+    if ((timer < 0) || (timer >= NUM_PROFILE_TIMERS)) return;
+    if (benchTimers.timeLabel[timer][0] == 0) memStrncpy(benchTimers.timeLabel[timer],label,PROFILE_TIMER_LABLEN-1);
+    benchTimers.timerRunning[timer] = TRUE;
+    GetRawTimeHiRes(&benchTimers.timeStart[timer]);
+}
+
+void benchTimerStopFunc(sdword timer)
+{
+    uqword timeStop,timeDuration;
+
+    if ((timer < 0) || (timer >= NUM_PROFILE_TIMERS)) return;
+    if (!benchTimers.timerRunning[timer]) return;       // only PTSLAB'd sections are timed
+
+    GetRawTimeHiRes(&timeStop);
+    timeDuration = timeStop - benchTimers.timeStart[timer];
+    benchTimers.timeTotal[timer] += timeDuration;
+    if (timeDuration > benchTimers.timeMax[timer])
+    {
+        benchTimers.timeMax[timer] = timeDuration;
+    }
+    benchTimers.numSamples[timer]++;
+    benchTimers.timerRunning[timer] = FALSE;
+}
@@ -34,6 +34,29 @@ typedef struct ProfileTimers
     bool recordTimersOn;
 } ProfileTimers;
 
+// Benchmark timers share the PTSLAB timer slots but use the high resolution
+// counter and accumulate across frames.  They are compiled into every build
+// and only do work while benchTimers.timersOn is set (see Benchmark.c).
+typedef struct BenchTimers
+{
+    uqword timeStart[NUM_PROFILE_TIMERS];
+    uqword timeTotal[NUM_PROFILE_TIMERS];
+    uqword timeMax[NUM_PROFILE_TIMERS];
+    udword numSamples[NUM_PROFILE_TIMERS];
+    char timeLabel[NUM_PROFILE_TIMERS][PROFILE_TIMER_LABLEN];
+    bool8 timerRunning[NUM_PROFILE_TIMERS];
+    bool timersOn;
+} BenchTimers;
+
+extern BenchTimers benchTimers;
+
+void benchTimersReset(void);
+void benchTimerStartLabelFunc(sdword timer,char *label);
+void benchTimerStopFunc(sdword timer);
+
+#define benchTimerStartLabel(t,lab) if (benchTimers.timersOn) benchTimerStartLabelFunc(t,lab)
+#define benchTimerStop(t)           if (benchTimers.timersOn) benchTimerStopFunc(t)
+
 #ifdef PROFILE_TIMERS
 
 extern ProfileTimers profileTimers;
@@ -63,7 +86,7 @@ void profTimerStopLittleFunc(sdword timer);
 #define PTSTART(t) profTimerStartFunc(t)
 
 #define profTimerStop(t) profTimerStopFunc(t)
-#define PTEND(t) profTimerStopFunc(t)
+#define PTEND(t) { profTimerStopFunc(t); benchTimerStop(t); }
 
 #define PTENDLITTLE(t) profTimerStopLittleFunc(t)
 
@@ -73,7 +96,7 @@ void profTimerStopLittleFunc(sdword timer);
 #define PTLABEL(t,lab) profTimerLabelFunc(t,lab)
 
 #define profTimerStartLabel(t,lab) profTimerStartLabelFunc(t,lab)
-#define PTSLAB(t,lab) profTimerStartLabelFunc(t,lab)
+#define PTSLAB(t,lab) { profTimerStartLabelFunc(t,lab); benchTimerStartLabel(t,lab); }
 
 #define PTSLABLITTLE(t,lab) profTimerStartLittleLabelFunc(t,lab)
 
@@ -92,7 +115,7 @@ void profTimerStopLittleFunc(sdword timer);
 #define PTSTART(t)
 
 #define profTimerStop(t)
-#define PTEND(t)
+#define PTEND(t) { benchTimerStop(t); }
 #define PTENDLITTLE(t)
 
 #define profTimerStatsPrint(y)
@@ -101,7 +124,7 @@ void profTimerStopLittleFunc(sdword timer);
 #define PTLABEL(t,lab)
 
 #define profTimerStartLabel(t,lab)
-#define PTSLAB(t,lab)
+#define PTSLAB(t,lab) { benchTimerStartLabel(t,lab); }
 #define PTSLABLITTLE(t,lab)
 
 #define profTimerRecordOn()
@@ -0,0 +1,624 @@
+// =============================================================================
+//  RefIndex.c
+//  - reverse index of which objects refer to an object
+//
+//  Bullets and missiles point straight at their owner and target, ships at
+//  whoever attacked them or is in their way, and when anything died every
+//  bullet, missile and ship used to be checked for pointers to it.  Instead
+//  each reference is recorded here, in a list hanging off the referred-to
+//  object, so a death only visits the objects which actually refer to it.
+//  Both ends are found through their handle slots (ObjHandle.h), so every
+//  assignment of a tracked pointer to an object has to go through refSet.
+//  Clearing one without refSet only leaves an entry which no longer matches.
+//
+//  Ships which keep references in their own specifics can't be indexed that
+//  way, so they are registered as holders and visited on every death.
+//
+//  If an end can't get a handle slot, the reference isn't recorded and
+//  refIncomplete says so until the next reset; deaths then have to be
+//  cleaned up by sweeping the lists again.
+// =============================================================================
+
+#include "RefIndex.h"
+
+#include <string.h>
+
+#include "Debug.h"
+#include "Memory.h"
+#include "ObjHandle.h"
+
+#if REF_TEST
+#include "SDL.h"
+#endif
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
+#define REF_NumHeld                 (REF_NumKinds + 1)  // held references per slot: one of each kind plus REF_Holder
+
+#if REF_STATS
+REFStats refStats;
+#endif
+
+typedef struct refentry
+{
+    struct refentry *next;                      // next referrer of the same object
+    struct refentry *prev;
+    SpaceObj *referrer;
+    uword refereeSlot;                          // handle slot of the object referred to
+    uword kind;                                 // REF_*
+} refentry;
+
+typedef struct refblock
+{
+    struct refblock *next;
+    refentry entries[REF_ENTRY_BATCH];
+} refblock;
+
+// per handle slot: objects referring to this one, and the references it holds
+static refentry **refReferrers = NULL;
+static refentry **refHeld = NULL;
+static sdword refNumSlots = 0;
+
+static refblock *refBlocks = NULL;
+static refentry *refFreeEntries = NULL;
+
+static bool refMissed = FALSE;                  // a reference couldn't be indexed since the last reset
+
+/*=============================================================================
+    Private functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : refSlotsEnsure
+    Description : makes sure the per-slot arrays cover a handle slot
+    Inputs      : slot - handle slot index
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void refSlotsEnsure(udword slot)
+{
+    sdword newNumSlots;
+
+    if ((sdword)slot < refNumSlots)
+    {
+        return;
+    }
+    newNumSlots = (slot + HND_SLOT_BATCH) & ~(HND_SLOT_BATCH - 1);
+    if (refReferrers == NULL)
+    {
+        refReferrers = memAlloc(sizeof(refentry *) * newNumSlots, "refReferrers", NonVolatile);
+        refHeld = memAlloc(sizeof(refentry *) * newNumSlots * REF_NumHeld, "refHeld", NonVolatile);
+    }
+    else
+    {
+        refReferrers = memRealloc(refReferrers, sizeof(refentry *) * newNumSlots, "refReferrers", NonVolatile);
+        refHeld = memRealloc(refHeld, sizeof(refentry *) * newNumSlots * REF_NumHeld, "refHeld", NonVolatile);
+    }
+    memset(&refReferrers[refNumSlots], 0, sizeof(refentry *) * (newNumSlots - refNumSlots));
+    memset(&refHeld[refNumSlots * REF_NumHeld], 0, sizeof(refentry *) * (newNumSlots - refNumSlots) * REF_NumHeld);
+    refNumSlots = newNumSlots;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refEntryAlloc
+    Description : takes an entry off the free list, adding a block if needed
+    Inputs      :
+    Outputs     :
+    Return      : the entry
+----------------------------------------------------------------------------*/
+static refentry *refEntryAlloc(void)
+{
+    refblock *block;
+    refentry *entry;
+    sdword index;
+
+    if (refFreeEntries == NULL)
+    {
+        block = memAlloc(sizeof(refblock), "refBlock", NonVolatile);
+        block->next = refBlocks;
+        refBlocks = block;
+        for (index = REF_ENTRY_BATCH - 1; index >= 0; index--)
+        {
+            block->entries[index].next = refFreeEntries;
+            refFreeEntries = &block->entries[index];
+        }
+    }
+    entry = refFreeEntries;
+    refFreeEntries = entry->next;
+#if REF_STATS
+    refStats.numEntries++;
+#endif
+    return entry;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refEntryRemove
+    Description : unlinks an entry from both ends and frees it
+    Inputs      : entry - the entry
+                  referrerSlot - handle slot of entry->referrer
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void refEntryRemove(refentry *entry, udword referrerSlot)
+{
+    if (entry->prev != NULL)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        refReferrers[entry->refereeSlot] = entry->next;
+    }
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry->prev;
+    }
+    refHeld[referrerSlot * REF_NumHeld + entry->kind] = NULL;
+
+    entry->next = refFreeEntries;
+    refFreeEntries = entry;
+#if REF_STATS
+    refStats.numEntries--;
+#endif
+}
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    Name        : refReset
+    Description : forgets every reference, for a new or loaded game.  Must go
+                  with a hndReset since entries are indexed by handle slot.
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void refReset(void)
+{
+    refShutdown();
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refShutdown
+    Description : frees the index
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void refShutdown(void)
+{
+    refblock *block, *next;
+
+    for (block = refBlocks; block != NULL; block = next)
+    {
+        next = block->next;
+        memFree(block);
+    }
+    refBlocks = NULL;
+    refFreeEntries = NULL;
+    if (refReferrers != NULL)
+    {
+        memFree(refReferrers);
+        memFree(refHeld);
+        refReferrers = NULL;
+        refHeld = NULL;
+    }
+    refNumSlots = 0;
+    refMissed = FALSE;
+#if REF_STATS
+    memset(&refStats, 0, sizeof(refStats));
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refMiss
+    Description : notes that a reference or holder couldn't be indexed
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void refMiss(void)
+{
+    if (!refMissed)
+    {
+        dbgMessagef("refSet: out of handle slots, deaths will sweep for references until the next game");
+        refMissed = TRUE;
+    }
+#if REF_STATS
+    refStats.numMissed++;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refSet
+    Description : records that referrer now refers to referee, replacing the
+                  reference of that kind it held before.  Call it wherever
+                  the pointer itself is assigned.
+    Inputs      : referrer - the bullet, missile or ship
+                  kind - REF_Owner, REF_Target, REF_RecentAttacker, ...
+                  referee - what it now refers to, or NULL
+    Outputs     : both objects get handles if they didn't have them
+    Return      :
+----------------------------------------------------------------------------*/
+void refSet(SpaceObj *referrer, sdword kind, SpaceObj *referee)
+{
+    udword referrerSlot, refereeSlot;
+    refentry *entry;
+
+    dbgAssertOrIgnore(kind >= 0 && kind < REF_NumKinds);
+
+    referrerSlot = hndIndex(hndObjBornSpare(referrer, REF_HANDLES_SPARE));
+    if (referrerSlot == 0)
+    {
+        if (referee != NULL)
+        {
+            refMiss();
+        }
+        return;
+    }
+    refSlotsEnsure(referrerSlot);
+
+    entry = refHeld[referrerSlot * REF_NumHeld + kind];
+    if (entry != NULL)
+    {
+        refEntryRemove(entry, referrerSlot);
+    }
+    if (referee == NULL)
+    {
+        return;
+    }
+
+    refereeSlot = hndIndex(hndObjBornSpare(referee, REF_HANDLES_SPARE));
+    if (refereeSlot == 0)
+    {
+        refMiss();
+        return;
+    }
+    refSlotsEnsure(refereeSlot);
+
+    entry = refEntryAlloc();
+    entry->referrer = referrer;
+    entry->refereeSlot = (uword)refereeSlot;
+    entry->kind = (uword)kind;
+    entry->prev = NULL;
+    entry->next = refReferrers[refereeSlot];
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry;
+    }
+    refReferrers[refereeSlot] = entry;
+    refHeld[referrerSlot * REF_NumHeld + kind] = entry;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refHolderAdd
+    Description : registers an object which keeps references of its own, so
+                  refVisitHolders calls it back whenever something dies.
+                  The entries live on slot 0, which no object ever gets.
+    Inputs      : holder - the object, usually a ship with
+                  CustShipRemoveShipReferences
+    Outputs     : holder gets a handle if it didn't have one
+    Return      :
+----------------------------------------------------------------------------*/
+void refHolderAdd(SpaceObj *holder)
+{
+    udword holderSlot;
+    refentry *entry;
+
+    holderSlot = hndIndex(hndObjBornSpare(holder, REF_HANDLES_SPARE));
+    if (holderSlot == 0)
+    {
+        refMiss();
+        return;
+    }
+    refSlotsEnsure(holderSlot);
+    if (refHeld[holderSlot * REF_NumHeld + REF_Holder] != NULL)
+    {
+        return;                                 // already registered
+    }
+
+    entry = refEntryAlloc();
+    entry->referrer = holder;
+    entry->refereeSlot = 0;
+    entry->kind = REF_Holder;
+    entry->prev = NULL;
+    entry->next = refReferrers[0];
+    if (entry->next != NULL)
+    {
+        entry->next->prev = entry;
+    }
+    refReferrers[0] = entry;
+    refHeld[holderSlot * REF_NumHeld + REF_Holder] = entry;
+#if REF_STATS
+    refStats.numHolders++;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refReferrerDied
+    Description : drops the references a dying object holds, forgets any
+                  left pointing at it and frees its handle
+    Inputs      : referrer - the dying object
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void refReferrerDied(SpaceObj *referrer)
+{
+    udword slot = hndIndex(hndOf(referrer));
+    sdword kind;
+
+    if (slot != 0 && (sdword)slot < refNumSlots)
+    {
+        for (kind = 0; kind < REF_NumHeld; kind++)
+        {
+            if (refHeld[slot * REF_NumHeld + kind] != NULL)
+            {
+#if REF_STATS
+                if (kind == REF_Holder)
+                {
+                    refStats.numHolders--;
+                }
+#endif
+                refEntryRemove(refHeld[slot * REF_NumHeld + kind], slot);
+            }
+        }
+        //entries refDropReferences left because they no longer matched,
+        //so they don't carry over to whoever gets the slot next
+        while (refReferrers[slot] != NULL)
+        {
+            refEntryRemove(refReferrers[slot], hndIndex(hndOf(refReferrers[slot]->referrer)));
+        }
+    }
+    hndObjDied(referrer);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refDropReferences
+    Description : visits everything which refers to referee, letting the
+                  callback clear the references it wants gone
+    Inputs      : referee - the object going away
+                  callback - clears one reference, returns TRUE if it did
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void refDropReferences(SpaceObj *referee, refdropcallback callback)
+{
+    udword slot = hndIndex(hndOf(referee));
+    refentry *entry, *next;
+
+#if REF_STATS
+    refStats.numSweeps++;
+#endif
+    if (slot == 0 || (sdword)slot >= refNumSlots)
+    {
+        return;
+    }
+
+    for (entry = refReferrers[slot]; entry != NULL; entry = next)
+    {
+        next = entry->next;
+        if (callback(entry->referrer, entry->kind, referee))
+        {
+            refEntryRemove(entry, hndIndex(hndOf(entry->referrer)));
+#if REF_STATS
+            refStats.numDropped++;
+#endif
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refVisitHolders
+    Description : calls every holder registered with refHolderAdd back about
+                  an object which is going away.  The callback's return
+                  value is ignored, holders stay registered until they die.
+    Inputs      : referee - the object going away
+                  callback - clears the holder's references, called with
+                  kind REF_Holder
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void refVisitHolders(SpaceObj *referee, refdropcallback callback)
+{
+    refentry *entry, *next;
+
+    if (refNumSlots == 0)
+    {
+        return;
+    }
+    for (entry = refReferrers[0]; entry != NULL; entry = next)
+    {
+        next = entry->next;
+        callback(entry->referrer, REF_Holder, referee);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refIncomplete
+    Description : tells whether any reference or holder has been left out of
+                  the index since the last reset, in which case deaths have
+                  to sweep for references as well
+    Inputs      :
+    Outputs     :
+    Return      : TRUE if the index can't be relied on
+----------------------------------------------------------------------------*/
+bool refIncomplete(void)
+{
+    return refMissed;
+}
+
+#if REF_TEST
+/*-----------------------------------------------------------------------------
+    Test and benchmark functions.  A battle of REF_TestShips ships and
+    REF_TestBullets bullets is killed off a ship at a time, once sweeping
+    the bullets the way deaths used to and once through the index.
+-----------------------------------------------------------------------------*/
+#define REF_TestShips           200
+#define REF_TestBullets         800
+#define REF_TestRounds          16
+
+static Ship *refTestShips;
+static Bullet *refTestBullets;
+
+/*-----------------------------------------------------------------------------
+    Name        : refTestDrop
+    Description : refDropReferences callback for the test, clears one
+                  bullet's owner or target
+    Inputs      : referrer - the bullet
+                  kind - REF_Owner or REF_Target
+                  referee - the dying ship
+    Outputs     :
+    Return      : TRUE if the reference was cleared
+----------------------------------------------------------------------------*/
+static bool refTestDrop(SpaceObj *referrer, sdword kind, SpaceObj *referee)
+{
+    Bullet *bullet = (Bullet *)referrer;
+
+    if (kind == REF_Owner && bullet->owner == (Ship *)referee)
+    {
+        bullet->owner = NULL;
+        return TRUE;
+    }
+    if (kind == REF_Target && bullet->target == (SpaceObjRotImpTarg *)referee)
+    {
+        bullet->target = NULL;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refTestBattle
+    Description : points every bullet at an owner and a different target
+    Inputs      : round - varies who shoots at whom
+                  indexed - record the references with refSet
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void refTestBattle(udword round, bool indexed)
+{
+    udword index, owner, target;
+
+    for (index = 0; index < REF_TestBullets; index++)
+    {
+        owner = ((index + round) * 2654435761u >> 8) % REF_TestShips;
+        target = (owner + 1 + ((index * 40503u + round) >> 4) % (REF_TestShips - 1)) % REF_TestShips;
+        refTestBullets[index].owner = &refTestShips[owner];
+        refTestBullets[index].target = (SpaceObjRotImpTarg *)&refTestShips[target];
+        if (indexed)
+        {
+            refSet((SpaceObj *)&refTestBullets[index], REF_Owner, (SpaceObj *)refTestBullets[index].owner);
+            refSet((SpaceObj *)&refTestBullets[index], REF_Target, (SpaceObj *)refTestBullets[index].target);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refTestCheckClear
+    Description : makes sure no bullet refers to a ship any more
+    Inputs      : name - which way the ships were killed
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void refTestCheckClear(char *name)
+{
+    udword index;
+
+    for (index = 0; index < REF_TestBullets; index++)
+    {
+        if (refTestBullets[index].owner != NULL || refTestBullets[index].target != NULL)
+        {
+            dbgFatalf(DBG_Loc, "refTest(%s): bullet %u still refers to a dead ship", name, index);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : refTest
+    Description : times killing every ship in a battle, sweeping all the
+                  bullets on each death as before and dropping only the
+                  indexed references, and checks both leave no references
+                  behind.  Uses the handle table, so it must run while no
+                  game is loaded.
+    Inputs      :
+    Outputs     : results printed with dbgMessagef
+    Return      :
+----------------------------------------------------------------------------*/
+void refTest(void)
+{
+    udword round, index, ship;
+    Bullet *bullet;
+    Uint64 timeStart, timeSweep = 0, timeIndex = 0, timeSet = 0;
+
+    refTestShips = memAlloc(sizeof(Ship) * REF_TestShips, "refTestShips", NonVolatile);
+    refTestBullets = memAlloc(sizeof(Bullet) * REF_TestBullets, "refTestBullets", NonVolatile);
+    memset(refTestShips, 0, sizeof(Ship) * REF_TestShips);
+    memset(refTestBullets, 0, sizeof(Bullet) * REF_TestBullets);
+    for (index = 0; index < REF_TestShips; index++)
+    {
+        refTestShips[index].objtype = OBJ_ShipType;
+    }
+    for (index = 0; index < REF_TestBullets; index++)
+    {
+        refTestBullets[index].objtype = OBJ_BulletType;
+    }
+
+    for (round = 0; round < REF_TestRounds; round++)
+    {
+        //the old way: every death looks at every bullet
+        refTestBattle(round, FALSE);
+        timeStart = SDL_GetPerformanceCounter();
+        for (ship = 0; ship < REF_TestShips; ship++)
+        {
+            for (index = 0, bullet = refTestBullets; index < REF_TestBullets; index++, bullet++)
+            {
+                if (bullet->owner == &refTestShips[ship])
+                {
+                    bullet->owner = NULL;
+                }
+                if (bullet->target == (SpaceObjRotImpTarg *)&refTestShips[ship])
+                {
+                    bullet->target = NULL;
+                }
+            }
+        }
+        timeSweep += SDL_GetPerformanceCounter() - timeStart;
+        refTestCheckClear("sweep");
+
+        //through the index: every death looks at the bullets referring to it
+        hndReset();
+        refReset();
+        timeStart = SDL_GetPerformanceCounter();
+        refTestBattle(round, TRUE);
+        timeSet += SDL_GetPerformanceCounter() - timeStart;
+        timeStart = SDL_GetPerformanceCounter();
+        for (ship = 0; ship < REF_TestShips; ship++)
+        {
+            refDropReferences((SpaceObj *)&refTestShips[ship], refTestDrop);
+            refReferrerDied((SpaceObj *)&refTestShips[ship]);
+        }
+        timeIndex += SDL_GetPerformanceCounter() - timeStart;
+        refTestCheckClear("index");
+#if REF_STATS
+        if (refStats.numEntries != 0)
+        {
+            dbgFatalf(DBG_Loc, "refTest: %d entries left after every ship died", refStats.numEntries);
+        }
+#endif
+    }
+
+    dbgMessagef("refTest: %d ships, %d bullets, us per death swept %.2f, indexed %.2f (+%.2f us per bullet to index)",
+                REF_TestShips, REF_TestBullets,
+                (real64)timeSweep * 1.0e6 / SDL_GetPerformanceFrequency() / (REF_TestShips * REF_TestRounds),
+                (real64)timeIndex * 1.0e6 / SDL_GetPerformanceFrequency() / (REF_TestShips * REF_TestRounds),
+                (real64)timeSet * 1.0e6 / SDL_GetPerformanceFrequency() / (REF_TestBullets * REF_TestRounds));
+
+    refShutdown();
+    hndShutdown();
+    memFree(refTestBullets);
+    memFree(refTestShips);
+}
+#endif //REF_TEST
@@ -0,0 +1,83 @@
+// =============================================================================
+//  RefIndex.h
+//  - reverse index of which objects refer to an object
+// =============================================================================
+
+#ifndef ___REFINDEX_H
+#define ___REFINDEX_H
+
+#include "SpaceObj.h"
+
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define REF_STATS                   1
+#define REF_VERIFY                  0           // sweep the old way too, complain about anything missed and time both
+#define REF_TEST                    0           // benchmark ship deaths against sweeping the bullets at startup
+#else
+#define REF_STATS                   0
+#define REF_VERIFY                  0
+#define REF_TEST                    0
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+// kinds of reference an object can hold
+#define REF_Owner                   0           // bullet/missile->owner
+#define REF_Target                  1           // bullet/missile->target
+#define REF_RecentAttacker          2           // ship->recentAttacker
+#define REF_FiringAtUs              3           // ship->firingAtUs
+#define REF_RowGetOutOfWay          4           // ship->rowGetOutOfWay
+#define REF_NumKinds                5
+
+#define REF_Holder                  REF_NumKinds    // kind passed to refVisitHolders callbacks
+
+#define REF_ENTRY_BATCH             512         // entries allocated at a time
+#define REF_HANDLES_SPARE           4096        // handle slots left for network IDs once the index gives up
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+// called for each referrer when the object it refers to goes away.  Return
+// TRUE once the reference has been cleared so the entry is dropped, FALSE to
+// leave this referrer alone.  An entry can be out of date if the pointer was
+// cleared without refSet, so check the pointer still matches first.
+typedef bool (*refdropcallback)(SpaceObj *referrer, sdword kind, SpaceObj *referee);
+
+#if REF_STATS
+typedef struct REFStats
+{
+    sdword numEntries;                          // references being tracked
+    sdword numDropped;                          // references cleared by refDropReferences
+    sdword numSweeps;                           // refDropReferences calls
+    sdword numHolders;                          // objects visited on every death
+    sdword numMissed;                           // references which couldn't be indexed
+} REFStats;
+
+extern REFStats refStats;
+#endif
+
+/*=============================================================================
+    Functions:
+=============================================================================*/
+
+void refReset(void);
+void refShutdown(void);
+
+void refSet(SpaceObj *referrer, sdword kind, SpaceObj *referee);
+void refHolderAdd(SpaceObj *holder);
+void refReferrerDied(SpaceObj *referrer);
+void refDropReferences(SpaceObj *referee, refdropcallback callback);
+void refVisitHolders(SpaceObj *referee, refdropcallback callback);
+bool refIncomplete(void);
+
+#if REF_TEST
+void refTest(void);
+#endif
+
+#endif
@@ -9,7 +9,9 @@
 #include "SaveGame.h"
 
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include "SDL.h"
 
 #include "AIPlayer.h"
 #include "Blobs.h"
@@ -24,11 +26,13 @@
 #include "LevelLoad.h"
 #include "Light.h"
 #include "LinkedList.h"
+#include "LZB.h"
 #include "Memory.h"
 #include "MultiplayerGame.h"
 #include "Objectives.h"
 #include "Ping.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "SalCapCorvette.h"
 #include "Select.h"
 #include "Sensors.h"
@@ -51,14 +55,136 @@ void LoadConsMgr();
  #pragma warning( 4 : 4047)      // turns off "different levels of indirection warning"
 #endif
 
+/*=============================================================================
+    Switches:
+=============================================================================*/
+
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define SAVE_TIMING_STATS       1               //report how long each stage of save and load took
+#else
+#define SAVE_TIMING_STATS       0
+#endif
+
+/*=============================================================================
+    Definitions:
+=============================================================================*/
+
+#define SAVE_CaptureMinSize     (1024*1024)     //first size of the capture buffer
+
+//save container: a header, the save stream compressed in blocks, then the
+//block and section tables.  Files without the magic number are the old
+//uncompressed stream.
+#define SAVE_ContainerMagic     0x43535748      //'HWSC'
+#define SAVE_ContainerVersion   1
+#define SAVE_CodecLZB           1
+#define SAVE_ContainerBlockSize (256*1024)      //save stream bytes per block
+#define SAVE_SectionAbsent      0xffffffff
+
+#define REGINDEX_MinSize        256             //smallest pointer index, power of 2
+#define REGINDEX_MaxLoadNumer   3               //grow when more than 3/4 full
+#define REGINDEX_MaxLoadDenom   4
+
+/*=============================================================================
+    Type definitions:
+=============================================================================*/
+
+//pointer -> registry ID, open addressed with linear probing.  Registries
+//only ever grow between Init and the next Init, so there is no removal.
+typedef struct
+{
+    void  *ptr;                                 //NULL is an empty slot
+    sdword id;
+} RegistrySlot;
+
+typedef struct
+{
+    RegistrySlot *slots;
+    udword size;                                //power of 2
+    udword shift;                               //32 - log2(size)
+    udword count;
+} RegistryIndex;
+
+typedef struct
+{
+    udword magic;                               //SAVE_ContainerMagic
+    udword version;                             //SAVE_ContainerVersion
+    udword codec;                               //SAVE_CodecLZB
+    udword rawLength;                           //length of the save stream
+    udword blockSize;                           //save stream bytes per block, the last may be short
+    udword numBlocks;
+    udword numSections;
+    udword indexOffset;                         //file offset of the block table, then the section table
+} SaveContainerHeader;
+
+typedef struct
+{
+    udword offset;                              //file offset
+    udword storedLength;                        //same as the block's length if stored uncompressed
+} SaveContainerBlock;
+
+//a captured save on its way to disk
+typedef struct
+{
+    SDL_Thread *thread;                         //NULL when nothing is being written
+    filehandle file;
+    char filename[PATH_MAX];
+    ubyte *buffer;                              //malloc'd, the game heap is too small
+    sdword length;
+    udword sections[SAVE_NumSections];          //save stream offset of each section
+    sdword storedLength;                        //set by the writer, length of the file
+    sdword status;                              //set by the writer thread, non-zero on failure
+    Uint64 writeTicks;                          //set by the writer thread
+    SDL_atomic_t done;
+} SaveSnapshotWrite;
+
+//the save being loaded, mapped in whole
+typedef struct
+{
+    filemap map;
+    SaveContainerHeader header;                 //header.magic is 0 for an old uncompressed save
+    SaveContainerBlock *blocks;                 //malloc'd
+    udword sections[SAVE_NumSections];
+    ubyte *block;                               //malloc'd, expanded block
+    sdword blockIndex;                          //block in blockData, -1 for none
+    ubyte *blockData;                           //expanded block, or straight into the map
+    udword blockStart;                          //save stream offset of blockData
+    udword blockLength;
+    udword position;                            //read position in the save stream
+    udword length;                              //length of the save stream
+} SaveReader;
+
+/*=============================================================================
+    Data:
+=============================================================================*/
+
 GrowSelection SpaceObjRegistry;
 GrowSelection BlobRegistry;
 
+static RegistryIndex SpaceObjRegistryIndex;
+static RegistryIndex BlobRegistryIndex;
+
+#if SAVE_TIMING_STATS
+static Uint64 saveTimingStart;
+static Uint64 saveTimingLast;
+#endif
+
 filehandle savefile = 0;
 
 sdword savefilestatus        = 0;
 sdword saveGameVersionNumber = 0;
 
+//saves are captured to this buffer, then compressed and written out
+static ubyte *saveCaptureBuffer = NULL;
+static sdword saveCaptureLength = 0;
+static sdword saveCaptureSize   = 0;
+static udword saveCaptureSections[SAVE_NumSections];
+
+static SaveSnapshotWrite saveSnapshotWrite;
+
+static SaveReader saveReader;
+
+SaveSnapshotStats saveSnapshotStats;
+
 // all the save game format versions this binary supports
 sdword supportedVersionNumbers[] = {
     SAVE_VERSION_NUMBER_HWSDL_1,
@@ -99,6 +225,187 @@ extern sdword actorFlagsEnabled;
     Functions:
 =============================================================================*/
 
+/*-----------------------------------------------------------------------------
+    Name        : RegistryIndexHash
+    Description : Fibonacci hash of a pointer; objects are at least 8 byte
+                  aligned so the low bits are dropped first.
+    Inputs      : index, ptr
+    Outputs     :
+    Return      : home slot of ptr
+----------------------------------------------------------------------------*/
+static udword RegistryIndexHash(RegistryIndex *index, void *ptr)
+{
+    return ((udword)(((memsize)ptr) >> 3) * 2654435769u) >> index->shift;
+}
+
+static void RegistryIndexClose(RegistryIndex *index)
+{
+    if (index->slots != NULL)
+    {
+        memFree(index->slots);
+    }
+    index->slots = NULL;
+    index->size = 0;
+    index->shift = 0;
+    index->count = 0;
+}
+
+static void RegistryIndexAlloc(RegistryIndex *index, udword size)
+{
+    udword bits = 0;
+
+    while ((1u << bits) < size)
+    {
+        bits++;
+    }
+    index->size = 1u << bits;
+    index->shift = 32 - bits;
+    index->count = 0;
+    index->slots = memAlloc(sizeof(RegistrySlot) * index->size, "regindex", 0);
+    memset(index->slots, 0, sizeof(RegistrySlot) * index->size);
+}
+
+static void RegistryIndexInit(RegistryIndex *index)
+{
+    RegistryIndexClose(index);
+    RegistryIndexAlloc(index, REGINDEX_MinSize);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : RegistryIndexFind
+    Description : looks up the registry ID of a pointer
+    Inputs      : index, ptr (not NULL)
+    Outputs     :
+    Return      : ID of ptr, or -1 if it is not registered
+----------------------------------------------------------------------------*/
+static sdword RegistryIndexFind(RegistryIndex *index, void *ptr)
+{
+    udword mask = index->size - 1;
+    udword slot = RegistryIndexHash(index, ptr);
+
+    while (index->slots[slot].ptr != NULL)
+    {
+        if (index->slots[slot].ptr == ptr)
+        {
+            return index->slots[slot].id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+static void RegistryIndexInsert(RegistryIndex *index, void *ptr, sdword id);
+
+static void RegistryIndexGrow(RegistryIndex *index)
+{
+    RegistrySlot *oldSlots = index->slots;
+    udword oldSize = index->size;
+    udword i;
+
+    RegistryIndexAlloc(index, oldSize * 2);
+    for (i = 0; i < oldSize; i++)
+    {
+        if (oldSlots[i].ptr != NULL)
+        {
+            RegistryIndexInsert(index, oldSlots[i].ptr, oldSlots[i].id);
+        }
+    }
+    memFree(oldSlots);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : RegistryIndexInsert
+    Description : records the registry ID of a pointer not already in the index
+    Inputs      : index, ptr (not NULL), id
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void RegistryIndexInsert(RegistryIndex *index, void *ptr, sdword id)
+{
+    udword mask;
+    udword slot;
+
+    if ((index->count + 1) * REGINDEX_MaxLoadDenom > index->size * REGINDEX_MaxLoadNumer)
+    {
+        RegistryIndexGrow(index);
+    }
+
+    mask = index->size - 1;
+    slot = RegistryIndexHash(index, ptr);
+    while (index->slots[slot].ptr != NULL)
+    {
+        dbgAssertOrIgnore(index->slots[slot].ptr != ptr);
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot].ptr = ptr;
+    index->slots[slot].id = id;
+    index->count++;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : RegistryAdd
+    Description : appends a pointer to a registry and indexes it.  The
+                  registry doubles when full; growSelectAddShip only adds
+                  GROWSELECT_ADDBATCH at a time, which is quadratic for the
+                  thousands of objects in a late game.
+    Inputs      : registry, index, ptr
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void RegistryAdd(GrowSelection *registry, RegistryIndex *index, void *ptr)
+{
+    sdword id = registry->selection->numShips;
+
+    if (id >= registry->maxNumShips)
+    {
+        registry->maxNumShips *= 2;
+        registry->selection = memRealloc(registry->selection, sizeofSelectCommand(registry->maxNumShips), "regrowships", 0);
+    }
+    registry->selection->ShipPtr[id] = (Ship *)ptr;
+    registry->selection->numShips = id + 1;
+
+    RegistryIndexInsert(index, ptr, id);
+}
+
+#if SAVE_TIMING_STATS
+/*-----------------------------------------------------------------------------
+    Name        : SaveTimingStart/SaveTimingStage/SaveTimingEnd
+    Description : reports how long each stage of a save or load took
+    Inputs      : stage - name of the stage just finished
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void SaveTimingStart(void)
+{
+    saveTimingStart = saveTimingLast = SDL_GetPerformanceCounter();
+}
+
+static real64 SaveTimingMs(Uint64 ticks)
+{
+    return (real64)ticks * 1000.0 / (real64)SDL_GetPerformanceFrequency();
+}
+
+static void SaveTimingStage(char *stage)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    dbgMessagef("  %-16s %8.2fms", stage, SaveTimingMs(now - saveTimingLast));
+    saveTimingLast = now;
+}
+
+static void SaveTimingEnd(char *what, char *filename)
+{
+    dbgMessagef("%s %s: %.2fms total, %d objects, %d blobs",
+                what, filename, SaveTimingMs(SDL_GetPerformanceCounter() - saveTimingStart),
+                SpaceObjRegistry.selection->numShips, BlobRegistry.selection->numShips);
+}
+#else
+#define SaveTimingStart()
+#define SaveTimingStage(stage)
+#define SaveTimingEnd(what, filename)
+#endif
+
 void SpaceObjRegistryInit()
 {
     Node* objnode = universe.ShipList.head;
@@ -108,28 +415,20 @@ void SpaceObjRegistryInit()
         dmgStopEffect((Ship*)spaceobj, DMG_All);
         objnode = objnode->next;
     }
+    growSelectClose(&SpaceObjRegistry);        // left over from the last save or load
     growSelectInit(&SpaceObjRegistry);
+    RegistryIndexInit(&SpaceObjRegistryIndex);
 }
 
 void SpaceObjRegistryClose()
 {
     growSelectClose(&SpaceObjRegistry);
+    RegistryIndexClose(&SpaceObjRegistryIndex);
 }
 
 sdword SpaceObjRegistryObjPresent(SpaceObj *obj)
 {
-    sdword i;
-    sdword numObjs = SpaceObjRegistry.selection->numShips;
-
-    for (i=0;i<numObjs;i++)
-    {
-        if (obj == (SpaceObj *)SpaceObjRegistry.selection->ShipPtr[i])
-        {
-            return i;
-        }
-    }
-
-    return -1;
+    return RegistryIndexFind(&SpaceObjRegistryIndex, obj);
 }
 
 void SpaceObjRegistryRegister(SpaceObj *obj)
@@ -137,13 +436,13 @@ void SpaceObjRegistryRegister(SpaceObj *obj)
     sdword index = SpaceObjRegistryObjPresent(obj);
     if (index == -1)        // object not present, so add
     {
-        growSelectAddShip(&SpaceObjRegistry,(Ship *)obj);
+        RegistryAdd(&SpaceObjRegistry, &SpaceObjRegistryIndex, obj);
     }
 }
 
 void SpaceObjRegistryRegisterNoCheck(SpaceObj *obj)
 {
-    growSelectAddShip(&SpaceObjRegistry,(Ship *)obj);
+    RegistryAdd(&SpaceObjRegistry, &SpaceObjRegistryIndex, obj);
 }
 
 sdword SpaceObjRegistryGetID(SpaceObj *obj)
@@ -230,34 +529,26 @@ TargetPtr SpaceObjRegistryGetTarget(sdword id)
 
 void BlobRegistryInit()
 {
+    growSelectClose(&BlobRegistry);            // left over from the last save or load
     growSelectInit(&BlobRegistry);
+    RegistryIndexInit(&BlobRegistryIndex);
 }
 
 void BlobRegistryClose()
 {
     growSelectClose(&BlobRegistry);
+    RegistryIndexClose(&BlobRegistryIndex);
 }
 
 sdword BlobRegistryBlobPresent(blob *tblob)
 {
-    sdword i;
-    sdword numObjs = BlobRegistry.selection->numShips;
-
-    for (i=0;i<numObjs;i++)
-    {
-        if (tblob == (blob *)BlobRegistry.selection->ShipPtr[i])
-        {
-            return i;
-        }
-    }
-
-    return -1;
+    return RegistryIndexFind(&BlobRegistryIndex, tblob);
 }
 
 void BlobRegistryRegister(blob *tblob)
 {
     dbgAssertOrIgnore(BlobRegistryBlobPresent(tblob) == -1);
-    growSelectAddShip(&BlobRegistry,(Ship *)tblob);
+    RegistryAdd(&BlobRegistry, &BlobRegistryIndex, tblob);
 }
 
 sdword BlobRegistryGetIDWrapper(blob *tblob, bool check_valid_id)
@@ -299,6 +590,309 @@ blob *BlobRegistryGetBlob(sdword id)
     return NULL;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : SaveWriteBytes
+    Description : appends to the save being captured
+    Inputs      : data, length
+    Outputs     : sets savefilestatus on failure
+    Return      :
+----------------------------------------------------------------------------*/
+static void SaveWriteBytes(void *data, sdword length)
+{
+    dbgAssertOrIgnore(saveCaptureBuffer != NULL);
+
+    if (saveCaptureLength + length > saveCaptureSize)
+    {
+        ubyte *newBuffer;
+        sdword newSize = saveCaptureSize;
+
+        while (saveCaptureLength + length > newSize)
+        {
+            newSize *= 2;
+        }
+        newBuffer = realloc(saveCaptureBuffer, newSize);
+        if (newBuffer == NULL)
+        {
+            savefilestatus = 1;
+            return;
+        }
+        saveCaptureBuffer = newBuffer;
+        saveCaptureSize = newSize;
+    }
+    memcpy(saveCaptureBuffer + saveCaptureLength, data, length);
+    saveCaptureLength += length;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveSection
+    Description : marks the start of a section of the save, so loaders can
+                  seek to it with SaveSeekSection
+    Inputs      : section - SAVE_SECTION_xxx
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void SaveSection(sdword section)
+{
+    dbgAssertOrIgnore(section >= 0 && section < SAVE_NumSections);
+    saveCaptureSections[section] = (udword)saveCaptureLength;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveContainerWrite
+    Description : compresses a captured save in blocks and writes it out as
+                  a save container.  Only uses stdio and malloc, so it can
+                  run on the snapshot writer thread.
+    Inputs      : fp - file to write to, at its start
+                  raw, rawLength - the captured save stream
+                  sections - save stream offset of each section
+    Outputs     :
+    Return      : length of the file written, or 0 on failure
+----------------------------------------------------------------------------*/
+static sdword SaveContainerWrite(FILE *fp, ubyte *raw, sdword rawLength, udword *sections)
+{
+    SaveContainerHeader header;
+    SaveContainerBlock *blocks;
+    ubyte *packed;
+    sdword packedSize = lzbCompressBound(SAVE_ContainerBlockSize);
+    udword offset = sizeof(SaveContainerHeader);
+    udword i;
+    bool ok;
+
+    header.magic = SAVE_ContainerMagic;
+    header.version = SAVE_ContainerVersion;
+    header.codec = SAVE_CodecLZB;
+    header.rawLength = rawLength;
+    header.blockSize = SAVE_ContainerBlockSize;
+    header.numBlocks = (rawLength + SAVE_ContainerBlockSize - 1) / SAVE_ContainerBlockSize;
+    header.numSections = SAVE_NumSections;
+    header.indexOffset = 0;
+
+    blocks = malloc(sizeof(SaveContainerBlock) * max(header.numBlocks, 1));
+    packed = malloc(packedSize);
+    ok = (blocks != NULL && packed != NULL);
+
+    //header goes in again at the end once the index offset is known
+    ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    for (i = 0; ok && i < header.numBlocks; i++)
+    {
+        ubyte *block = raw + i * SAVE_ContainerBlockSize;
+        sdword length = min(rawLength - (sdword)(i * SAVE_ContainerBlockSize), SAVE_ContainerBlockSize);
+        sdword stored = lzbCompressBuffer((char *)block, length, (char *)packed, packedSize);
+
+        if (stored <= 0 || stored >= length)
+        {                                                   //doesn't compress, store it
+            stored = length;
+            ok = fwrite(block, length, 1, fp) == 1;
+        }
+        else
+        {
+            ok = fwrite(packed, stored, 1, fp) == 1;
+        }
+        blocks[i].offset = offset;
+        blocks[i].storedLength = stored;
+        offset += stored;
+    }
+
+    header.indexOffset = offset;
+    ok = ok && (header.numBlocks == 0 || fwrite(blocks, sizeof(SaveContainerBlock) * header.numBlocks, 1, fp) == 1);
+    ok = ok && fwrite(sections, sizeof(udword) * SAVE_NumSections, 1, fp) == 1;
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && fflush(fp) == 0;
+
+    free(packed);
+    free(blocks);
+
+    return ok ? (sdword)(offset + sizeof(SaveContainerBlock) * header.numBlocks + sizeof(udword) * SAVE_NumSections) : 0;
+}
+
+static void SaveReadClose(void)
+{
+    SaveReader *reader = &saveReader;
+
+    free(reader->blocks);
+    free(reader->block);
+    fileUnmap(&reader->map);
+    memset(reader, 0, sizeof(SaveReader));
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveReadOpen
+    Description : maps a save game for loading.  Takes both save containers
+                  and the old uncompressed saves.
+    Inputs      : filename
+    Outputs     : sets up saveReader
+    Return      : TRUE on success
+----------------------------------------------------------------------------*/
+static bool SaveReadOpen(char *filename)
+{
+    SaveReader *reader = &saveReader;
+    SaveContainerHeader *header = &reader->header;
+    udword i, tableEnd;
+
+    if (reader->map.data != NULL)
+    {                                                       //PreLoadGame without a LoadGame
+        SaveReadClose();
+    }
+    memset(reader, 0, sizeof(SaveReader));
+    reader->blockIndex = -1;
+
+    if (!fileMapReadOnly(filename, FF_UserSettingsPath, &reader->map))
+    {
+        return FALSE;
+    }
+
+    if (reader->map.length >= (sdword)sizeof(SaveContainerHeader))
+    {
+        memcpy(header, reader->map.data, sizeof(SaveContainerHeader));
+    }
+    if (header->magic != SAVE_ContainerMagic)
+    {                                                       //old save, the file is the stream
+        memset(header, 0, sizeof(SaveContainerHeader));
+        reader->blockData = reader->map.data;
+        reader->blockLength = reader->length = reader->map.length;
+        for (i = 0; i < SAVE_NumSections; i++)
+        {
+            reader->sections[i] = SAVE_SectionAbsent;
+        }
+        return TRUE;
+    }
+
+    tableEnd = header->indexOffset + sizeof(SaveContainerBlock) * header->numBlocks + sizeof(udword) * min(header->numSections, SAVE_NumSections);
+    if (header->version != SAVE_ContainerVersion || header->codec != SAVE_CodecLZB ||
+        header->blockSize == 0 || header->blockSize > SAVE_ContainerBlockSize ||
+        header->numBlocks != (header->rawLength + header->blockSize - 1) / header->blockSize ||
+        header->indexOffset < sizeof(SaveContainerHeader) || tableEnd < header->indexOffset ||
+        tableEnd > (udword)reader->map.length)
+    {
+        dbgMessagef("SaveReadOpen: %s is a damaged or newer save container", filename);
+        fileUnmap(&reader->map);
+        return FALSE;
+    }
+
+    reader->blocks = malloc(sizeof(SaveContainerBlock) * max(header->numBlocks, 1));
+    reader->block = malloc(header->blockSize);
+    if (reader->blocks == NULL || reader->block == NULL)
+    {
+        free(reader->blocks);
+        free(reader->block);
+        fileUnmap(&reader->map);
+        return FALSE;
+    }
+    memcpy(reader->blocks, reader->map.data + header->indexOffset, sizeof(SaveContainerBlock) * header->numBlocks);
+    for (i = 0; i < SAVE_NumSections; i++)
+    {
+        reader->sections[i] = SAVE_SectionAbsent;
+        if (i < header->numSections)
+        {
+            memcpy(&reader->sections[i], reader->map.data + header->indexOffset + sizeof(SaveContainerBlock) * header->numBlocks + sizeof(udword) * i, sizeof(udword));
+        }
+    }
+    reader->length = header->rawLength;
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveReadBlock
+    Description : makes block index of a save container the current block,
+                  expanding it unless it was stored uncompressed
+    Inputs      : index
+    Outputs     :
+    Return      : TRUE on success, FALSE if the block is damaged
+----------------------------------------------------------------------------*/
+static bool SaveReadBlock(udword index)
+{
+    SaveReader *reader = &saveReader;
+    SaveContainerBlock *block = &reader->blocks[index];
+    udword length = min(reader->length - index * reader->header.blockSize, reader->header.blockSize);
+
+    if (block->offset < sizeof(SaveContainerHeader) || block->storedLength > length ||
+        block->offset + block->storedLength > reader->header.indexOffset ||
+        block->offset + block->storedLength < block->offset)
+    {
+        return FALSE;
+    }
+
+    if (block->storedLength == length)
+    {                                                       //stored, read it straight from the map
+        reader->blockData = reader->map.data + block->offset;
+    }
+    else
+    {
+        if (lzbExpandBuffer((char *)reader->map.data + block->offset, block->storedLength,
+                            (char *)reader->block, length) != (sdword)length)
+        {
+            return FALSE;
+        }
+        reader->blockData = reader->block;
+    }
+    reader->blockIndex = index;
+    reader->blockStart = index * reader->header.blockSize;
+    reader->blockLength = length;
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveReadBytes
+    Description : reads from the save being loaded
+    Inputs      : dest, length
+    Outputs     :
+    Return      : bytes read, less than length at the end of the save or if
+                  it is damaged
+----------------------------------------------------------------------------*/
+static sdword SaveReadBytes(void *dest, sdword length)
+{
+    SaveReader *reader = &saveReader;
+    ubyte *out = (ubyte *)dest;
+    sdword done = 0;
+
+    while (done < length && reader->position < reader->length)
+    {
+        udword inBlock, count;
+
+        if (reader->header.magic != 0 &&
+            (reader->blockIndex < 0 || reader->position < reader->blockStart ||
+             reader->position >= reader->blockStart + reader->blockLength))
+        {
+            if (!SaveReadBlock(reader->position / reader->header.blockSize))
+            {
+                break;
+            }
+        }
+        inBlock = reader->position - reader->blockStart;
+        count = min((udword)(length - done), reader->blockLength - inBlock);
+        memcpy(out + done, reader->blockData + inBlock, count);
+        done += count;
+        reader->position += count;
+    }
+
+    return done;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveSeekSection
+    Description : moves the read position of the save being loaded to the
+                  start of one of its sections, expanding only the blocks
+                  read from there
+    Inputs      : section - SAVE_SECTION_xxx
+    Outputs     :
+    Return      : TRUE if the save has a section index and the section
+----------------------------------------------------------------------------*/
+bool SaveSeekSection(sdword section)
+{
+    SaveReader *reader = &saveReader;
+
+    if (section < 0 || section >= SAVE_NumSections ||
+        reader->sections[section] == SAVE_SectionAbsent ||
+        reader->sections[section] > reader->length)
+    {
+        return FALSE;
+    }
+    reader->position = reader->sections[section];
+    return TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : SaveThisChunk
     Description : saves thischunk
@@ -308,14 +902,7 @@ blob *BlobRegistryGetBlob(sdword id)
 ----------------------------------------------------------------------------*/
 void SaveThisChunk(SaveChunk *thischunk)
 {
-    FILE *fp;
-    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
-    fp = fileStream(savefile);
-
-    if (fwrite(thischunk, sizeofSaveChunk(thischunk->contentsSize), 1, fp) != 1)
-    {
-        savefilestatus = 1;
-    }
+    SaveWriteBytes(thischunk, sizeofSaveChunk(thischunk->contentsSize));
 }
 
 SaveChunk *CreateChunk(TypeOfSaveChunk type,sdword contentsSize,void *contents)
@@ -339,13 +926,9 @@ SaveChunk *LoadNextChunk()
     SaveChunk readchunk;
     sdword num;
     SaveChunk *returnchunk;
-    FILE *fp;
 
-    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
-    fp = fileStream(savefile);
-
-    num = fread(&readchunk,sizeof(SaveChunk),1,fp);
-    dbgAssertOrIgnore(num != 0);
+    num = SaveReadBytes(&readchunk,sizeof(SaveChunk));
+    dbgAssertOrIgnore(num == sizeof(SaveChunk));
 
     dbgAssertOrIgnore(readchunk.contentsSize >= 0);
 
@@ -355,8 +938,8 @@ SaveChunk *LoadNextChunk()
 
     if (readchunk.contentsSize > 0)
     {
-        num = fread(((ubyte *)returnchunk) + sizeof(SaveChunk),readchunk.contentsSize,1,fp);
-        dbgAssertOrIgnore(num != 0);
+        num = SaveReadBytes(((ubyte *)returnchunk) + sizeof(SaveChunk),readchunk.contentsSize);
+        dbgAssertOrIgnore(num == readchunk.contentsSize);
     }
 
     return returnchunk;
@@ -367,13 +950,9 @@ SaveChunk *LoadNextChunkSafe()
     SaveChunk readchunk;
     sdword num;
     SaveChunk *returnchunk;
-    FILE *fp;
-
-    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
-    fp = fileStream(savefile);
 
-    num = fread(&readchunk,sizeof(SaveChunk),1,fp);
-    if (num == 0)
+    num = SaveReadBytes(&readchunk,sizeof(SaveChunk));
+    if (num != sizeof(SaveChunk))
     {
         return NULL;
     }
@@ -389,8 +968,8 @@ SaveChunk *LoadNextChunkSafe()
 
     if (readchunk.contentsSize > 0)
     {
-        num = fread(((ubyte *)returnchunk) + sizeof(SaveChunk),readchunk.contentsSize,1,fp);
-        if (num == 0)
+        num = SaveReadBytes(((ubyte *)returnchunk) + sizeof(SaveChunk),readchunk.contentsSize);
+        if (num != readchunk.contentsSize)
         {
             memFree(returnchunk);
             return NULL;
@@ -554,26 +1133,15 @@ void LoadLighting(void)
 void SaveVersionInfo(void)
 {
     sdword version = SAVE_VERSION_NUMBER;
-    FILE *fp;
 
-    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
-    fp = fileStream(savefile);
-
-    if (fwrite(&version, sizeof(sdword), 1, fp) != 1)
-    {
-        savefilestatus = 1;
-    }
+    SaveWriteBytes(&version, sizeof(sdword));
 }
 
 sdword LoadVersionInfo(void)
 {
-    FILE *fp;
     udword i;
 
-    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
-    fp = fileStream(savefile);
-
-    if (fread(&saveGameVersionNumber, sizeof(sdword), 1, fp) == 0)
+    if (SaveReadBytes(&saveGameVersionNumber, sizeof(sdword)) != sizeof(sdword))
     {
         return VERIFYSAVEFILE_ERROROPENING;
     }
@@ -667,42 +1235,51 @@ void LoadPreGameInfo(void)
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : SaveGame
-    Description :
+    Name        : SaveGameContents
+    Description : writes everything in a save game through SaveWriteBytes
     Inputs      :
-    Outputs     :
-    Return      : TRUE on success
+    Outputs     : sets savefilestatus on failure
+    Return      :
 ----------------------------------------------------------------------------*/
-bool SaveGame(char *filename)
+static void SaveGameContents(void)
 {
     sdword i;
 
-    savefile = fileOpen(filename, FF_WriteMode | FF_ReturnNULLOnFail | FF_UserSettingsPath);
-    if (savefile == (filehandle)NULL)
-    {
-        return FALSE;
-    }
-    savefilestatus = 0;
+    SaveTimingStart();
 
     SaveVersionInfo();
+    SaveSection(SAVE_SECTION_PreGame);
     SavePreGameInfo();
+    SaveTimingStage("pregame");
 
     SpaceObjRegistryInit();
     BlobRegistryInit();
 
     RegisterAllSpaceObjs();
     RegisterAllBlobs();
+    SaveTimingStage("register");
+    SaveSection(SAVE_SECTION_SpaceObjs);
     SaveAllSpaceObjs();
+    SaveTimingStage("spaceobjs");
+    SaveSection(SAVE_SECTION_Blobs);
     SaveAllBlobs();
+    SaveSection(SAVE_SECTION_Universe);
     SaveUniverse();
+    SaveTimingStage("blobs+universe");
+    SaveSection(SAVE_SECTION_IDTables);
     SaveIDToPtrTable(&ShipIDToPtr);
     SaveIDToPtrTable(&ResourceIDToPtr);
     SaveIDToPtrTable(&DerelictIDToPtr);
     SaveIDToPtrTable(&MissileIDToPtr);
+    SaveSection(SAVE_SECTION_Nebulae);
     nebSave_Nebula();
+    SaveSection(SAVE_SECTION_ConsMgr);
     SaveConsMgr();
+    SaveSection(SAVE_SECTION_AIPlayers);
     aiplayerSave();
+    SaveTimingStage("consmgr+ai");
 
+    SaveSection(SAVE_SECTION_SinglePlayer);
     SaveSinglePlayerGame();
 
     if (singlePlayerGame)
@@ -719,15 +1296,18 @@ bool SaveGame(char *filename)
         tutSaveTutorialGame();
     }
 
+    SaveSection(SAVE_SECTION_Selections);
     SaveMaxSelection(&selSelected);
     for (i=0;i<SEL_NumberHotKeyGroups;i++)
     {
         SaveMaxSelection(&selHotKeyGroup[i]);
     }
 
+    SaveSection(SAVE_SECTION_Background);
     SaveBackground();
     SaveLighting();
 
+    SaveSection(SAVE_SECTION_Misc);
     smSave();
     ranSave();
 
@@ -735,9 +1315,85 @@ bool SaveGame(char *filename)
     SaveInfoNumber(smGhostMode);
 
     SaveConsMgrDetermOptional();                // added for V1.04 patch
+    SaveTimingStage("rest");
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveGameCapture
+    Description : captures a save game into malloc'd memory
+    Inputs      :
+    Outputs     : write - buffer, length and sections filled in
+    Return      : TRUE on success
+----------------------------------------------------------------------------*/
+static bool SaveGameCapture(SaveSnapshotWrite *write)
+{
+    sdword i;
+
+    saveCaptureSize = max(saveSnapshotStats.length, SAVE_CaptureMinSize);
+    saveCaptureBuffer = malloc(saveCaptureSize);
+    saveCaptureLength = 0;
+    if (saveCaptureBuffer == NULL)
+    {
+        return FALSE;
+    }
+    for (i = 0; i < SAVE_NumSections; i++)
+    {
+        saveCaptureSections[i] = SAVE_SectionAbsent;
+    }
+    savefilestatus = 0;
+
+    SaveGameContents();
+
+    write->buffer = saveCaptureBuffer;
+    write->length = saveCaptureLength;
+    memcpy(write->sections, saveCaptureSections, sizeof(saveCaptureSections));
+    saveCaptureBuffer = NULL;
+    saveCaptureSize = saveCaptureLength = 0;
+
+    if (savefilestatus)
+    {
+        savefilestatus = 0;
+        free(write->buffer);
+        write->buffer = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveGame
+    Description :
+    Inputs      :
+    Outputs     :
+    Return      : TRUE on success
+----------------------------------------------------------------------------*/
+bool SaveGame(char *filename)
+{
+    SaveSnapshotWrite write;
+
+    SaveGameSnapshotPoll(TRUE);
+
+    if (!SaveGameCapture(&write))
+    {
+        return FALSE;
+    }
+
+    savefile = fileOpen(filename, FF_WriteMode | FF_ReturnNULLOnFail | FF_UserSettingsPath);
+    if (savefile == (filehandle)NULL)
+    {
+        free(write.buffer);
+        return FALSE;
+    }
+    dbgAssertOrIgnore(!fileUsingBigfile(savefile));
+
+    write.storedLength = SaveContainerWrite(fileStream(savefile), write.buffer, write.length, write.sections);
+    savefilestatus = (write.storedLength == 0);
+    free(write.buffer);
 
     fileClose(savefile);
     savefile = 0;
+    SaveTimingStage("compress+write");
+    SaveTimingEnd("SaveGame", filename);
 
     if (savefilestatus)
     {
@@ -749,6 +1405,132 @@ bool SaveGame(char *filename)
     return TRUE;        // save successful
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : SaveSnapshotWriter
+    Description : writer thread for SaveGameSnapshot.  Only touches the
+                  snapshot and its FILE, never the game heap or file table.
+    Inputs      : data - the SaveSnapshotWrite
+    Outputs     :
+    Return      : 0
+----------------------------------------------------------------------------*/
+static int SaveSnapshotWriter(void *data)
+{
+    SaveSnapshotWrite *write = (SaveSnapshotWrite *)data;
+    FILE *fp = fileStream(write->file);
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    write->storedLength = SaveContainerWrite(fp, write->buffer, write->length, write->sections);
+    write->status = (write->storedLength == 0);
+    write->writeTicks = SDL_GetPerformanceCounter() - start;
+    SDL_AtomicSet(&write->done, 1);
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveSnapshotFinish
+    Description : closes a written snapshot's file, deleting it if the write
+                  failed, frees the snapshot and updates saveSnapshotStats
+    Inputs      : write
+    Outputs     :
+    Return      : TRUE if the snapshot was written
+----------------------------------------------------------------------------*/
+static bool SaveSnapshotFinish(SaveSnapshotWrite *write)
+{
+    fileClose(write->file);
+    if (write->status)
+    {
+        fileDelete(write->filename);
+        saveSnapshotStats.numFailed++;
+    }
+    free(write->buffer);
+    write->buffer = NULL;
+
+    saveSnapshotStats.writeMs = (real32)((real64)write->writeTicks * 1000.0 / (real64)SDL_GetPerformanceFrequency());
+    saveSnapshotStats.storedLength = write->storedLength;
+    return write->status == 0;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveGameSnapshotPoll
+    Description : finishes off the last SaveGameSnapshot if its writer thread
+                  is done
+    Inputs      : wait - wait for the writer instead of returning if it is busy
+    Outputs     :
+    Return      : TRUE if no snapshot is being written any more
+----------------------------------------------------------------------------*/
+bool SaveGameSnapshotPoll(bool wait)
+{
+    SaveSnapshotWrite *write = &saveSnapshotWrite;
+
+    if (write->thread == NULL)
+    {
+        return TRUE;
+    }
+    if (!wait && !SDL_AtomicGet(&write->done))
+    {
+        return FALSE;
+    }
+
+    SDL_WaitThread(write->thread, NULL);
+    write->thread = NULL;
+    SaveSnapshotFinish(write);
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : SaveGameSnapshot
+    Description : saves the game the way SaveGame does, but compresses and
+                  writes it on a background thread, so the caller only waits
+                  for the capture.  Any earlier snapshot still being written
+                  is waited for first.
+    Inputs      : filename
+    Outputs     :
+    Return      : TRUE if the snapshot was captured and its write started
+----------------------------------------------------------------------------*/
+bool SaveGameSnapshot(char *filename)
+{
+    SaveSnapshotWrite *write = &saveSnapshotWrite;
+    Uint64 start;
+    bool captured;
+
+    SaveGameSnapshotPoll(TRUE);
+
+    start = SDL_GetPerformanceCounter();
+    captured = SaveGameCapture(write);
+    saveSnapshotStats.captureMs = (real32)((real64)(SDL_GetPerformanceCounter() - start) * 1000.0 / (real64)SDL_GetPerformanceFrequency());
+    if (!captured)
+    {
+        return FALSE;
+    }
+    saveSnapshotStats.length = write->length;
+    saveSnapshotStats.numSnapshots++;
+    SaveTimingEnd("SaveGameSnapshot", filename);
+
+    write->file = fileOpen(filename, FF_WriteMode | FF_ReturnNULLOnFail | FF_UserSettingsPath);
+    if (write->file == (filehandle)NULL)
+    {
+        free(write->buffer);
+        write->buffer = NULL;
+        return FALSE;
+    }
+    dbgAssertOrIgnore(!fileUsingBigfile(write->file));
+    dbgAssertOrIgnore(strlen(filename) < PATH_MAX);
+    strcpy(write->filename, filename);
+    write->storedLength = 0;
+    write->status = 0;
+    write->writeTicks = 0;
+    SDL_AtomicSet(&write->done, 0);
+
+    write->thread = SDL_CreateThread(SaveSnapshotWriter, "savesnapshot", write);
+    if (write->thread == NULL)
+    {                                                       //no thread, write it here
+        SaveSnapshotWriter(write);
+        return SaveSnapshotFinish(write);
+    }
+
+    return TRUE;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : VerifySaveFile
     Description : verifies filename is valid save game file
@@ -760,20 +1542,47 @@ sdword VerifySaveFile(char *filename)
 {
     sdword verify;
 
-    savefile = fileOpen(filename, FF_ReturnNULLOnFail | FF_UserSettingsPath);
+    SaveGameSnapshotPoll(TRUE);
 
-    if (savefile == 0)
+    if (!SaveReadOpen(filename))
     {
         return VERIFYSAVEFILE_ERROROPENING;
     }
 
     verify = LoadVersionInfo();
-    fileClose(savefile);
-    savefile = 0;
+    SaveReadClose();
 
     return verify;
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : SaveFileIsSinglePlayer
+    Description : peeks at the pre-game info of a save game file
+    Inputs      : filename
+    Outputs     :
+    Return      : TRUE if filename holds a single player game
+----------------------------------------------------------------------------*/
+bool SaveFileIsSinglePlayer(char *filename)
+{
+    bool singlePlayer = FALSE;
+
+    SaveGameSnapshotPoll(TRUE);
+
+    if (!SaveReadOpen(filename))
+    {
+        return FALSE;
+    }
+
+    if (LoadVersionInfo() == VERIFYSAVEFILE_OK)
+    {
+        SaveSeekSection(SAVE_SECTION_PreGame);      // old saves have no index, but it follows the version anyway
+        singlePlayer = (LoadInfoNumber() != 0);     // first thing SavePreGameInfo writes
+    }
+    SaveReadClose();
+
+    return singlePlayer;
+}
+
 /*-----------------------------------------------------------------------------
     Name        : PreLoadGame
     Description :
@@ -785,7 +1594,13 @@ void PreLoadGame(char *filename)
 {
     sdword verify;
 
-    savefile = fileOpen(filename, FF_UserSettingsPath);
+    SaveGameSnapshotPoll(TRUE);
+
+    if (!SaveReadOpen(filename))
+    {
+        dbgFatalf(DBG_Loc,"Couldn't open saved game %s",filename);
+        return;
+    }
     verify = LoadVersionInfo();
     if (verify != VERIFYSAVEFILE_OK)
     {
@@ -806,14 +1621,18 @@ void LoadGame(char *filename)
 {
     sdword i;
 
-    dbgAssertOrIgnore(savefile);
+    dbgAssertOrIgnore(saveReader.map.data != NULL);
+
+    SaveTimingStart();
 
     SpaceObjRegistryInit();
     BlobRegistryInit();
 
     LoadAllSpaceObjs();
+    SaveTimingStage("spaceobjs");
     LoadAllBlobs();
     LoadUniverse();
+    SaveTimingStage("blobs+universe");
     LoadIDToPtrTable(&ShipIDToPtr);
     LoadIDToPtrTable(&ResourceIDToPtr);
     LoadIDToPtrTable(&DerelictIDToPtr);
@@ -821,6 +1640,7 @@ void LoadGame(char *filename)
     nebLoad_Nebula();
     LoadConsMgr();
     aiplayerLoad();
+    SaveTimingStage("consmgr+ai");
 
     LoadSinglePlayerGame();
 
@@ -854,14 +1674,16 @@ void LoadGame(char *filename)
     smGhostMode = LoadInfoNumber();
 
     LoadConsMgrDetermOptional();            // optional, won't crash if not there, added for V1.04 patch
+    SaveTimingStage("rest");
 
     FixAllSpaceObjs();
     FixAllBlobs();
+    SaveTimingStage("fixup");
 
     listInit(&universe.effectList);
 
-    fileClose(savefile);
-    savefile = 0;
+    SaveReadClose();
+    SaveTimingEnd("LoadGame", filename);
 }
 
 /*=============================================================================
@@ -2105,6 +2927,8 @@ void FixShip(Ship *ship)
     {
         shipstaticinfo->custshipheader.CustShip_Fix(ship);
     }
+
+    univRecordShipReferences(ship);
 }
 
 void SaveAsteroid(Asteroid *asteroid)
@@ -2377,7 +3201,7 @@ Bullet *LoadBullet(SaveChunk *chunk)
 
     VerifyChunk(chunk,BASIC_STRUCTURE|SAVE_SPACEOBJ|OBJ_BulletType,sizeof(Bullet));
 
-    bullet = memAlloc(sizeof(Bullet),"Bullet",0);
+    bullet = memSlabAlloc(MSP_Bullet, sizeof(Bullet), "Bullet");
 
     memcpy(bullet,chunkContents(chunk),chunk->contentsSize);
 
@@ -2402,6 +3226,8 @@ void FixBullet(Bullet *bullet)
         bullet->gunowner = NULL;
     }
     bullet->target = SpaceObjRegistryGetTarget((sdword)bullet->target);
+    refSet((SpaceObj *)bullet, REF_Owner, (SpaceObj *)bullet->owner);
+    refSet((SpaceObj *)bullet, REF_Target, (SpaceObj *)bullet->target);
 
     bullet->playerowner = SavePlayerIndexToPlayer(bullet->playerowner);
 }
@@ -2525,7 +3351,7 @@ Missile *LoadMissile(SaveChunk *chunk)
 
     VerifyChunk(chunk,BASIC_STRUCTURE|SAVE_SPACEOBJ|OBJ_MissileType,sizeof(Missile));
 
-    missile = memAlloc(sizeof(Missile),"Missile",0);
+    missile = memSlabAlloc(MSP_Missile, sizeof(Missile), "Missile");
 
     memcpy(missile,chunkContents(chunk),chunk->contentsSize);
 
@@ -2557,6 +3383,8 @@ void FixMissile(Missile *missile)
 
     missile->owner = SpaceObjRegistryGetShip((sdword)missile->owner);
     missile->target = SpaceObjRegistryGetTarget((sdword)missile->target);
+    refSet((SpaceObj *)missile, REF_Owner, (SpaceObj *)missile->owner);
+    refSet((SpaceObj *)missile, REF_Target, (SpaceObj *)missile->target);
 
     missile->hitEffect = saveIndexToEtglodGunEvent((sdword)missile->hitEffect);
 
@@ -89,7 +89,39 @@ typedef struct
     dbgAssertOrIgnore(c);                       \
     dbgAssertOrIgnore((c)->type == (t));
 
+// sections of a save game.  The save container indexes where each starts,
+// so a loader can go straight to one with SaveSeekSection.
+#define SAVE_SECTION_PreGame            0
+#define SAVE_SECTION_SpaceObjs          1
+#define SAVE_SECTION_Blobs              2
+#define SAVE_SECTION_Universe           3
+#define SAVE_SECTION_IDTables           4
+#define SAVE_SECTION_Nebulae            5
+#define SAVE_SECTION_ConsMgr            6
+#define SAVE_SECTION_AIPlayers          7
+#define SAVE_SECTION_SinglePlayer       8
+#define SAVE_SECTION_Selections         9
+#define SAVE_SECTION_Background         10
+#define SAVE_SECTION_Misc               11
+#define SAVE_NumSections                12
+
+// timings of the background autosaves made by SaveGameSnapshot
+typedef struct
+{
+    real32 captureMs;                   // last capture, on the simulation thread
+    real32 writeMs;                     // last compress and write, on the writer thread
+    sdword length;                      // bytes in the last snapshot
+    sdword storedLength;                // bytes written for it
+    sdword numSnapshots;
+    sdword numFailed;                   // writes that failed
+} SaveSnapshotStats;
+
+extern SaveSnapshotStats saveSnapshotStats;
+
 bool SaveGame(char *filename);
+bool SaveGameSnapshot(char *filename);
+bool SaveGameSnapshotPoll(bool wait);
+bool SaveSeekSection(sdword section);
 void LoadGame(char *filename);
 void PreLoadGame(char *filename);
 
@@ -150,6 +182,7 @@ void Load_StringToAddress(char *addr);
 #define VERIFYSAVEFILE_BADVERSION       -2
 
 sdword VerifySaveFile(char *filename);
+bool SaveFileIsSinglePlayer(char *filename);
 
 bool LoadInfoNumberOptional(sdword *info);
 SaveChunk *LoadNextChunkSafe();
@@ -748,7 +748,7 @@ void soundEventInit(void)
     /* LOAD volume curves */
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Volume.lut");
-    size = fileLoadAlloc(loadfile, (void**)&VolumeLUT, NonVolatile);
+    size = fileLoadAlloc(loadfile, (void**)&VolumeLUT, NonVolatile | FF_ZeroCopy);
     VolumeFloatLUT = memAlloc(size, "Volume Table", NonVolatile);
 
 #if FIX_ENDIAN
@@ -759,7 +759,7 @@ void soundEventInit(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Range.lut");
-    size = fileLoadAlloc(loadfile, (void**)&RangeLUT, NonVolatile);
+    size = fileLoadAlloc(loadfile, (void**)&RangeLUT, NonVolatile | FF_ZeroCopy);
 	RangeFloatLUT = memAlloc(size, "Range Table", NonVolatile);
 
 #if FIX_ENDIAN
@@ -770,7 +770,7 @@ void soundEventInit(void)
     
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Frequency.lut");
-    size = fileLoadAlloc(loadfile, (void**)&FrequencyLUT, NonVolatile);
+    size = fileLoadAlloc(loadfile, (void**)&FrequencyLUT, NonVolatile | FF_ZeroCopy);
 	FreqLUT = memAlloc(size, "Frequency Table", NonVolatile);
 
 #if FIX_ENDIAN
@@ -830,9 +830,9 @@ void soundEventClose(void)
 
     if (enableSFX || enableSpeech)
     {
-        memFree(VolumeLUT);
-        memFree(RangeLUT);
-        memFree(FrequencyLUT);
+        fileLoadFree(VolumeLUT);
+        fileLoadFree(RangeLUT);
+        fileLoadFree(FrequencyLUT);
 		memFree(VolumeFloatLUT);
 		memFree(RangeFloatLUT);
 		memFree(FreqLUT);
@@ -840,14 +840,14 @@ void soundEventClose(void)
 
     if (enableSFX)
     {
-        memFree(GunEventsLUT);
-        memFree(ShipCmnEventsLUT);
-        memFree(ShipEventsLUT);
-        memFree(DerelictEventsLUT);
+        fileLoadFree(GunEventsLUT);
+        fileLoadFree(ShipCmnEventsLUT);
+        fileLoadFree(ShipEventsLUT);
+        fileLoadFree(DerelictEventsLUT);
 //        memFree(SpecEffectEventsLUT);
-        memFree(SpecExpEventsLUT);
-        memFree(SpecHitEventsLUT);
-        memFree(UIEventsLUT);
+        fileLoadFree(SpecExpEventsLUT);
+        fileLoadFree(SpecHitEventsLUT);
+        fileLoadFree(UIEventsLUT);
         memFree(GunBank);
         memFree(ShipBank);
         memFree(SpecialEffectBank);
@@ -965,20 +965,20 @@ void soundEventReloadVolumes(void)
 	/* LOAD volume curves */
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Volume.lut");
-    fileLoadAlloc(loadfile, &tempLUT, NonVolatile);
-    memFree(VolumeLUT);
+    fileLoadAlloc(loadfile, &tempLUT, NonVolatile | FF_ZeroCopy);
+    fileLoadFree(VolumeLUT);
     VolumeLUT = (TABLELUT *)tempLUT;
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Range.lut");
-    fileLoadAlloc(loadfile, &tempLUT, NonVolatile);
-    memFree(RangeLUT);
+    fileLoadAlloc(loadfile, &tempLUT, NonVolatile | FF_ZeroCopy);
+    fileLoadFree(RangeLUT);
     RangeLUT = (TABLELUT *)tempLUT;
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "Frequency.lut");
-    fileLoadAlloc(loadfile, &tempLUT, NonVolatile);
-    memFree(FrequencyLUT);
+    fileLoadAlloc(loadfile, &tempLUT, NonVolatile | FF_ZeroCopy);
+    fileLoadFree(FrequencyLUT);
     FrequencyLUT = (FREQUENCYLUT *)tempLUT;
 
     /* do some pre-calculations on the volume, range and frequency tables */
@@ -2595,7 +2595,7 @@ void SEloadbank(void)
     /* new stuff */
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "GunEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&GunEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&GunEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN	
 	GunEventsLUT->ID            = FIX_ENDIAN_INT_32( GunEventsLUT->ID );
@@ -2610,7 +2610,7 @@ void SEloadbank(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "ShipCmnEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&ShipCmnEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&ShipCmnEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	ShipCmnEventsLUT->ID            = FIX_ENDIAN_INT_32( ShipCmnEventsLUT->ID );
@@ -2625,7 +2625,7 @@ void SEloadbank(void)
 		
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "ShipEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&ShipEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&ShipEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	ShipEventsLUT->ID            = FIX_ENDIAN_INT_32( ShipEventsLUT->ID );
@@ -2646,7 +2646,7 @@ void SEloadbank(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "DerelictEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&DerelictEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&DerelictEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	DerelictEventsLUT->ID            = FIX_ENDIAN_INT_32( DerelictEventsLUT->ID );
@@ -2671,7 +2671,7 @@ void SEloadbank(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "SpecExpEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&SpecExpEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&SpecExpEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	SpecExpEventsLUT->ID            = FIX_ENDIAN_INT_32( SpecExpEventsLUT->ID );
@@ -2692,7 +2692,7 @@ void SEloadbank(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "SpecHitEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&SpecHitEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&SpecHitEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	SpecHitEventsLUT->ID            = FIX_ENDIAN_INT_32( SpecHitEventsLUT->ID );
@@ -2714,7 +2714,7 @@ void SEloadbank(void)
 
     strcpy(loadfile, SOUNDFXDIR);
     strcat(loadfile, "UIEvents.lut");
-    fileLoadAlloc(loadfile, (void**)&UIEventsLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&UIEventsLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	UIEventsLUT->ID = FIX_ENDIAN_INT_32( UIEventsLUT->ID );
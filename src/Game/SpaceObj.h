@@ -986,7 +986,7 @@ typedef struct
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;           // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1011,7 +1011,7 @@ typedef struct
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;           // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1035,7 +1035,7 @@ typedef struct
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1061,7 +1061,7 @@ typedef struct SpaceObjRotImpTarg
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1093,7 +1093,7 @@ typedef struct SpaceObjRotImpTargGuidance
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1121,7 +1121,7 @@ typedef struct SpaceObjRotImpTargGuidanceShipDerelict
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1303,7 +1303,7 @@ typedef struct Ship         // Ship object
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1478,7 +1478,7 @@ typedef struct
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;               // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;                // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;                    // distance used for optimizing collision checking
@@ -1540,7 +1540,7 @@ typedef struct Effect
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;               // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;                    // distance used for optimizing collision checking
@@ -1587,7 +1587,7 @@ typedef struct                                  // Bullet object
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;               // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;                // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;                    // distance used for optimizing collision checking
@@ -1642,7 +1642,7 @@ typedef struct
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1718,7 +1718,7 @@ typedef struct Resource
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1755,7 +1755,7 @@ typedef struct Asteroid
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1793,7 +1793,7 @@ typedef struct Nebula
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1834,7 +1834,7 @@ typedef struct GasCloud
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
@@ -1873,7 +1873,7 @@ typedef struct DustCloud
     ubyte renderedLODs;     //what LODs have been rendered already
     uword attributes;               // settable attributes from mission editor
     sword attributesParam;          // parameter for attributes, set from mission editor
-    ubyte attributesPad[2];          // leftover, free space
+    uword handleIndex;               // slot in the handle table, see ObjHandle.h
     real32 cameraDistanceSquared;    // distance to camera (for sound, level of detail)
     vector cameraDistanceVector;     // vector to camera (camera eyeposition - obj->posinfo.position)
     real32 collOptimizeDist;         // distance used for optimizing collision checking
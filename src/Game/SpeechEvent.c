@@ -447,7 +447,7 @@ sdword speechEventInit(void)
 #else
     strcat(loadfile, "speechsentence_comp.lut");
 #endif
-    fileLoadAlloc(loadfile, (void**)&SentenceLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&SentenceLUT, NonVolatile | FF_ZeroCopy);
 
 #if FIX_ENDIAN
 	SentenceLUT->ID         = FIX_ENDIAN_INT_32( SentenceLUT->ID );
@@ -474,7 +474,7 @@ sdword speechEventInit(void)
 #else
     strcat(loadfile, "speechphrase_comp.lut");
 #endif
-    fileLoadAlloc(loadfile, (void**)&PhraseLUT, NonVolatile);
+    fileLoadAlloc(loadfile, (void**)&PhraseLUT, NonVolatile);   //not FF_ZeroCopy: SENextVariationInSeries keeps its sequences in here
 
 #if FIX_ENDIAN
 	PhraseLUT->ID = FIX_ENDIAN_INT_32( PhraseLUT->ID );
@@ -523,8 +523,8 @@ sdword speechEventInit(void)
 
     if (buffersize == 0)
     {
-        memFree(SentenceLUT);
-        memFree(PhraseLUT);
+        fileLoadFree(SentenceLUT);
+        fileLoadFree(PhraseLUT);
         /* soundstreamquery failed */
         return (SOUND_ERR);
     }
@@ -632,8 +632,8 @@ void speechEventClose(void)
     memFree(pspeechbuffer3);
     memFree(pspeechbuffer4);
 #endif
-    memFree(SentenceLUT);
-    memFree(PhraseLUT);
+    fileLoadFree(SentenceLUT);
+    fileLoadFree(PhraseLUT);
 }
 
 
@@ -13,6 +13,7 @@
 
 #include "LinkedList.h"
 #include "Debug.h"
+#include "Job.h"
 
 /*=============================================================================
     Switches:
@@ -176,6 +177,13 @@ extern real32 taskFrequency;
         ((struct taskContextClass *)*taskContextPtr)->taskLine = __LINE__; \
         return;                                                  \
     case __LINE__:
+// Yield until all the jobs on a job counter (see Job.h) have run.  The
+// counter has to be a task-specific variable so it survives the yields.
+#define taskWaitJobs(counter)                   \
+        while (!jobCounterDone(counter))        \
+        {                                       \
+            taskYield(0);                       \
+        }
 // An exited task gets removed from the task list.
 #define taskExit()                              \
         free(*taskContextPtr);                  \
@@ -47,6 +47,9 @@
 
 #define TRAIL_LINE_CUTOFF_LOD 2
 
+#define TRAIL_DRAWN_TICKS     3     //universe updates a trail counts as on screen after being drawn
+#define TRAIL_BATCH_GROW      64
+
 extern udword gDevcaps2;
 
 sdword bTrailRender = 1;
@@ -96,6 +99,8 @@ static sdword TRAIL_GLOW_2_BLUE = 255;
 
 static sdword TRAIL_EXPANSION_TICKS = 16;
 
+static sdword TRAIL_OFFSCREEN_RATE = 4;     //trails not drawn recently take a segment this many times less often
+
 scriptEntry TrailTweaks[] =
 {
     makeEntry(RANDOM_MAX, scriptSetReal32CB),
@@ -130,6 +135,7 @@ scriptEntry TrailTweaks[] =
     makeEntry(TRAIL_GLOW_2_GREEN, scriptSetSdwordCB),
     makeEntry(TRAIL_GLOW_2_BLUE, scriptSetSdwordCB),
     makeEntry(TRAIL_EXPANSION_TICKS, scriptSetSdwordCB),
+    makeEntry(TRAIL_OFFSCREEN_RATE, scriptSetSdwordCB),
     
     END_SCRIPT_ENTRY
 };
@@ -145,6 +151,19 @@ static real32 origin[] = {0.0f, 0.0f, 0.0f};
 
 static real32 NLipsScaleFactor = 1.0f;
 
+//ship trails due for a new segment this update, gathered by trailsUpdate
+typedef struct
+{
+    shiptrail *trail;
+    real32 *coordsys;                   //ship's rotation matrix
+    real32 *translation;                //ship's position
+    real32 *nozzle;                     //engine nozzle offset in ship space
+}
+trailbatch;
+
+static trailbatch *trailBatch = NULL;
+static sdword trailBatchMax = 0;
+
 #define trailCopySegment(D,S) memcpy(D, S, sizeof(trailsegment))
 
 trhandle  g_glowHandle = 0;
@@ -206,6 +225,7 @@ bool8 _afterburning;
 static void trailSegmentsRead(char *directory,char *field,void *dataToFillIn);
 static void trailGranularityRead(char *directory,char *field,void *dataToFillIn);
 static void trailColorRead(char *directory,char *field,void *dataToFillIn);
+void trailInplacePossibleRotate(vector* vec, real32 degrees);
 scriptEntry trailStaticScriptTable[] =
 {
     { "trailSegments",                  trailSegmentsRead,  NULL },
@@ -269,6 +289,13 @@ void trailShutdown(void)
             trailMeshes[i] = NULL;
         }
     }
+
+    if (trailBatch != NULL)
+    {
+        memFree(trailBatch);
+        trailBatch = NULL;
+        trailBatchMax = 0;
+    }
 }
 
 /*-----------------------------------------------------------------------------
@@ -328,6 +355,7 @@ shiptrail *trailNew(trailstatic *staticInfo, void* vship, bool8 second, ubyte tr
     shiptrail *trail;
     Ship* ship;
     ShipStaticInfo* shipstaticinfo;
+    sdword nCapacity;
 
 #if TRAIL_VERBOSE_LEVEL >= 2
     if (staticInfo != NULL)
@@ -337,12 +365,21 @@ shiptrail *trailNew(trailstatic *staticInfo, void* vship, bool8 second, ubyte tr
 #endif
     if (staticInfo != NULL)
     {
-        trail = memAlloc(trailSize(staticInfo->nSegments), "Ship Engine Trail", NonVolatile);
+        nCapacity = staticInfo->nSegments;
+        trail = memAlloc(trailSize(nCapacity), "Ship Engine Trail", NonVolatile);
     }
     else
     {
-        trail = memAlloc(trailSize(1), "Ship Capital Trail", NonVolatile);
+        nCapacity = 1;
+        trail = memAlloc(trailSize(nCapacity), "Ship Capital Trail", NonVolatile);
     }
+    //segment arrays follow the structure
+    trail->nCapacity = nCapacity;
+    trail->positions = (vector *)(trail + 1);
+    trail->horizontals = trail->positions + nCapacity;
+    trail->verticals = trail->horizontals + nCapacity;
+    trail->wides = (bool8 *)(trail->verticals + nCapacity);
+    trail->drawCounter = 0;
     trail->ran = 0.0f;
     trail->ranCounter = 0;
     trail->lastvelsquared = trail->prevvelsquared = 0.0f;
@@ -410,6 +447,13 @@ shiptrail *trailNew(trailstatic *staticInfo, void* vship, bool8 second, ubyte tr
     trail->ribbonadjust = shipstaticinfo->trailRibbonAdjust[trailNum];
     trail->style = (bool8)shipstaticinfo->trailStyle[trailNum];
 
+    //the trail angle never changes, so rotate the ribbon axes once here
+    //rather than on every update
+    VECCOPY(&trail->horizontal, yaxis);
+    trailInplacePossibleRotate(&trail->horizontal, trail->angle);
+    VECCOPY(&trail->vertical, xaxis);
+    trailInplacePossibleRotate(&trail->vertical, trail->angle);
+
     return(trail);
 }
 
@@ -591,106 +635,185 @@ void mistrailUpdate(missiletrail* trail, vector* position)
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : trailUpdate
-    Description : Update a trail
-    Inputs      : position - 3d location to put at head of trail
-    Outputs     : Updates trail's circular queue
-    Return      : void
+    Name        : trailStateUpdate
+    Description : Update the expansion state of a capital ship glow
+    Inputs      : trail - the trail (style > 2)
+    Outputs     :
+    Return      :
 ----------------------------------------------------------------------------*/
-void trailUpdate(shiptrail *trail, vector *position)
+static void trailStateUpdate(shiptrail *trail)
 {
-    trailstatic *trailStatic = trail->staticInfo;
-    trailsegment* seg;
-    trailsegment* seg2;
-
-    if (!enableTrails)
+    trail->exponent = trailRealRand(TRAIL_EXPONENT_RANGE) + TRAIL_EXPONENT_BASE;
+    if (trail->counter > 0)
     {
-        return;
+        trail->counter--;
     }
-
-    if (trail->style > 2)
+    switch (trail->state)
     {
-        trail->exponent = trailRealRand(TRAIL_EXPONENT_RANGE) + TRAIL_EXPONENT_BASE;
-        if (trail->counter > 0)
+    case TRAIL_CONTRACTING:
+        if (trail->counter == 0)
         {
-            trail->counter--;
+            trail->state = TRAIL_CONTRACTED;
         }
-        switch (trail->state)
-        {
-        case TRAIL_CONTRACTING:
-            if (trail->counter == 0)
-            {
-                trail->state = TRAIL_CONTRACTED;
-            }
-            break;
-
-        case TRAIL_CONTRACTED:
-            break;
+        break;
 
-        case TRAIL_EXPANDING:
-            if (trail->counter == 0)
-            {
-                trail->state = TRAIL_EXPANDED;
-            }
-            break;
+    case TRAIL_CONTRACTED:
+        break;
 
-        case TRAIL_EXPANDED:
-            break;
+    case TRAIL_EXPANDING:
+        if (trail->counter == 0)
+        {
+            trail->state = TRAIL_EXPANDED;
         }
-        return;
+        break;
+
+    case TRAIL_EXPANDED:
+        break;
     }
+}
 
-    trail->grainCounter--;
-    if (trail->grainCounter < 0)
+/*-----------------------------------------------------------------------------
+    Name        : trailTransformBatch
+    Description : Transform the nozzle position and ribbon axes of a batch of
+                    trails into world space and push them onto the head of each
+                    trail's segment queue.
+    Inputs      : batch - trails gathered by trailsUpdate
+                  count - number of trails in the batch
+    Outputs     : Updates each trail's circular queue
+    Return      :
+----------------------------------------------------------------------------*/
+static void trailTransformBatch(trailbatch *batch, sdword count)
+{
+    shiptrail *trail;
+    real32 *m, *t, *n, *h, *v;
+    real32 *position, *horizontal, *vertical;
+    sdword i, r;
+
+    for (i = 0; i < count; i++, batch++)
     {
-        trail->grainCounter = trailStatic->granularity;
+        trail = batch->trail;
+        dbgAssertOrIgnore(trail->iHead < trail->nCapacity);
+
+        m = batch->coordsys;
+        t = batch->translation;
+        n = batch->nozzle;
+        h = (real32 *)&trail->horizontal;
+        v = (real32 *)&trail->vertical;
+
+        position = (real32 *)&trail->positions[trail->iHead];
+        horizontal = (real32 *)&trail->horizontals[trail->iHead];
+        vertical = (real32 *)&trail->verticals[trail->iHead];
+
+        //one pass over the (column major) coordsys for all three vectors
+        for (r = 0; r < 3; r++)
+        {
+            position[r]   = t[r] + m[r] * n[0] + m[r + 3] * n[1] + m[r + 6] * n[2];
+            horizontal[r] =        m[r] * h[0] + m[r + 3] * h[1] + m[r + 6] * h[2];
+            vertical[r]   =        m[r] * v[0] + m[r + 3] * v[1] + m[r + 6] * v[2];
+        }
+        trail->wides[trail->iHead] = FALSE;
+
+        if (trail->nLength < trail->nCapacity)
+        {
+            //if still building ship trail, insert new point
+            trail->nLength++;
+        }
+        //wrap around once the list is full size
+        trail->iHead = (trail->iHead + 1) < trail->nCapacity ? trail->iHead + 1 : 0;
     }
-    else
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : trailsUpdate
+    Description : Update the trails of all ships.  Trails due for a new segment
+                    are gathered into a batch and transformed together.  Trails
+                    that haven't been drawn recently take segments at a reduced
+                    rate (TRAIL_OFFSCREEN_RATE).
+    Inputs      : nisShips - also update the trails of NIS ships that are
+                    otherwise moved by the NIS (as when the universe is paused)
+    Outputs     : Updates each trail's circular queue
+    Return      : void
+----------------------------------------------------------------------------*/
+void trailsUpdate(bool nisShips)
+{
+    Node *objnode;
+    Ship *ship;
+    shiptrail *trail;
+    trailbatch *entry;
+    sdword i, nBatch = 0, rate;
+
+    if (!enableTrails)
     {
         return;
     }
 
-    dbgAssertOrIgnore(trail->iHead < trailStatic->nSegments);
-
-#if TRAIL_GATHER_STATS
-    trailsUpdated++;
-#endif
-
-    seg = &trail->segments[trail->iHead];
+    rate = MAX2(TRAIL_OFFSCREEN_RATE, 1);
 
-    trailGetNozzleOffset(seg->position, trail);
-    trailGetCoordsys(seg->rotation, trail);
-    trailGetTranslation(seg->translation, trail);
+    for (objnode = universe.ShipList.head; objnode != NULL; objnode = objnode->next)
+    {
+        ship = (Ship *)listGetStructOfNode(objnode);
 
-    trailInplaceShipToWorld(seg->position, seg->rotation, seg->translation);
+        if (!nisShips && (ship->flags & (SOF_NISShip|SOF_DontApplyPhysics)) == SOF_NISShip)
+        {
+            continue;
+        }
 
-    VECCOPY(seg->horizontal, yaxis);
-    trailInplacePossibleRotate((vector*)seg->horizontal, trail->angle);
-    trailInplaceShipToWorld(seg->horizontal, seg->rotation, origin);
+        for (i = 0; i < MAX_NUM_TRAILS; i++)
+        {
+            trail = ship->trail[i];
+            if (trail == NULL)
+            {
+                continue;
+            }
 
-    VECCOPY(seg->vertical, xaxis);
-    trailInplacePossibleRotate((vector*)seg->vertical, trail->angle);
-    trailInplaceShipToWorld(seg->vertical, seg->rotation, origin);
+            if (trail->style > 2)
+            {
+                trailStateUpdate(trail);
+                continue;
+            }
 
-    trail->segments[trail->iHead].wide = FALSE;
+            if (trail->drawCounter > 0)
+            {
+                trail->drawCounter--;
+                //back on screen, so don't wait out an off screen interval
+                trail->grainCounter = MIN2(trail->grainCounter, trail->staticInfo->granularity);
+            }
 
-    seg2 = &trail->segments[(trail->iHead - 1) <= 1 ? trailStatic->nSegments - 1 : trail->iHead - 1];
+            trail->grainCounter--;
+            if (trail->grainCounter >= 0)
+            {
+#if TRAIL_GATHER_STATS
+                trailsNotUpdated++;
+#endif
+                continue;
+            }
+            if (trail->drawCounter > 0)
+            {
+                trail->grainCounter = trail->staticInfo->granularity;
+            }
+            else
+            {
+                trail->grainCounter = (trail->staticInfo->granularity + 1) * rate - 1;
+            }
 
-    if (trail->nLength < trailStatic->nSegments)
-    {
-        //if still building ship trail, insert new point
-        trail->nLength++;                                     //update head and length
-        trail->iHead++;
-        if ((trail->iHead) >= trailStatic->nSegments)
-        {
-            trail->iHead = 0;
+            if (nBatch >= trailBatchMax)
+            {
+                trailBatchMax += TRAIL_BATCH_GROW;
+                trailBatch = memRealloc(trailBatch, trailBatchMax * sizeof(trailbatch), "trailBatch", NonVolatile);
+            }
+            entry = &trailBatch[nBatch++];
+            entry->trail = trail;
+            entry->coordsys = (real32 *)&ship->rotinfo.coordsys;
+            entry->translation = (real32 *)&ship->posinfo.position;
+            entry->nozzle = (real32 *)&ship->staticinfo->engineNozzleOffset[trail->trailNum];
         }
     }
-    else
-    {
-        //else the list is full size, wrap around
-        trail->iHead = (trail->iHead + 1) < trailStatic->nSegments ? trail->iHead + 1 : 0;
-    }
+
+#if TRAIL_GATHER_STATS
+    trailsUpdated += nBatch;
+#endif
+
+    trailTransformBatch(trailBatch, nBatch);
 }
 
 /*-----------------------------------------------------------------------------
@@ -1222,33 +1345,28 @@ void trailStraighten(vector positions[], real32* coordsys)
 void trailPositions(sdword n, vector positions[], vector horizontals[], vector verticals[], shiptrail* trail)
 {
     sdword i, index;
-    trailsegment* segment;
 
-    index = trail->iHead <= 0 ? trail->staticInfo->nSegments - 1 : trail->iHead - 1;
+    index = trail->iHead <= 0 ? trail->nCapacity - 1 : trail->iHead - 1;
 
     if (horizontals == NULL)
     {
         for (i = 0; i < n; i++)
         {
-            segment = &trail->segments[index];
+            positions[i+1] = trail->positions[index];
 
-            VECCOPY(&positions[i+1], segment->position);
-
-            index = index <= 1 ? trail->staticInfo->nSegments - 1 : index - 1;
+            index = index <= 1 ? trail->nCapacity - 1 : index - 1;
         }
     }
     else
     {
         for (i = 0; i < n; i++)
         {
-            segment = &trail->segments[index];
-
-            VECCOPY(&horizontals[i+1], segment->horizontal);
-            VECCOPY(&verticals[i+1], segment->vertical);
+            horizontals[i+1] = trail->horizontals[index];
+            verticals[i+1] = trail->verticals[index];
 
-            VECCOPY(&positions[i+1], segment->position);
+            positions[i+1] = trail->positions[index];
 
-            index = index <= 1 ? trail->staticInfo->nSegments - 1 : index - 1;
+            index = index <= 1 ? trail->nCapacity - 1 : index - 1;
         }
     }
 }
@@ -1848,6 +1966,8 @@ void trailDraw(vector *current, shiptrail *trail, sdword LOD, sdword teamIndex)
         return;
     }
 
+    trail->drawCounter = TRAIL_DRAWN_TICKS;
+
     if (!IS_MOVING_LINEARLY(ship->posinfo.isMoving) || (ship->flags & (SOF_DontDrawTrails|SOF_Clamped|SOF_Disabled)))  // clamped objs dont draw trails either
     {
         dontdrawtrail = TRUE;
@@ -1929,7 +2049,7 @@ void trailDraw(vector *current, shiptrail *trail, sdword LOD, sdword teamIndex)
     trailGetCoordsys(lastSegment.rotation, trail);
     trailGetTranslation(lastSegment.translation, trail);
 
-    trail->segments[trail->iHead].wide = FALSE;
+    trail->wides[trail->iHead] = FALSE;
     if (LOD < 3)
     {
         real32 rad = ship->staticinfo->staticheader.staticCollInfo.collspheresize;
@@ -1939,7 +2059,7 @@ void trailDraw(vector *current, shiptrail *trail, sdword LOD, sdword teamIndex)
 
         if (lastSegment.wide)
         {
-            trail->segments[trail->iHead].wide = TRUE;
+            trail->wides[trail->iHead] = TRUE;
         }
     }
 
@@ -2007,7 +2127,7 @@ void trailDraw(vector *current, shiptrail *trail, sdword LOD, sdword teamIndex)
 
         for (i = 0; i < n; i++)
         {
-            wides[i] = trail->segments[i].wide;
+            wides[i] = trail->wides[i];
         }
         wides[n] = FALSE;
         VECCOPY(&segments[n], &segments[n-1]);
@@ -2348,15 +2468,13 @@ void trailZeroLength(shiptrail* trail)
 void trailMove(shiptrail* trail, vector *delta)
 {
     sdword index;
-    trailsegment *segment;
+    vector *position;
 
     dbgAssertOrIgnore(trail != NULL);
-    segment = trail->segments;
-    for (index = trail->staticInfo->nSegments; index >= 0; index--, segment++)
+    position = trail->positions;
+    for (index = trail->nCapacity; index > 0; index--, position++)
     {
-        segment->position[0] += delta->x;
-        segment->position[1] += delta->y;
-        segment->position[2] += delta->z;
+        vecAddTo(*position, *delta);
     }
 }
 
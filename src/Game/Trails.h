@@ -76,7 +76,8 @@ missiletrailsegment;
 #define TRAIL_CONTRACTED  4
 #define TRAIL_EXPANDED    8
 
-//dynamic trail structure
+//dynamic trail structure.  The segment history is a fixed-capacity ring
+//buffer stored as parallel arrays directly after the structure.
 typedef struct
 {
     trailstatic *staticInfo;            //non-dynamic trail info reference
@@ -99,8 +100,14 @@ typedef struct
     real32 exponent;
     real32 scalecap;
     sdword grainCounter;                //counter to reflect if the trail should be updated this time around
+    ubyte  drawCounter;                 //non-zero if the trail has been drawn recently
     sdword iHead, iTail, nLength;       //circular queue members
-    trailsegment segments[1];           //trail segments
+    sdword nCapacity;                   //size of the segment arrays
+    vector horizontal, vertical;        //ribbon axes in ship space
+    vector *positions;                  //world space segment positions
+    vector *horizontals;                //world space ribbon axes of each segment
+    vector *verticals;
+    bool8  *wides;                      //afterburner state of each segment
 }
 shiptrail;
 
@@ -125,7 +132,7 @@ extern sdword trailInsertCount;
     Macros:
 =============================================================================*/
 #define mistrailSize(n)     (sizeof(missiletrail) + (n)*sizeof(missiletrailsegment))
-#define trailSize(n)        (sizeof(shiptrail) + (n)*sizeof(trailsegment))
+#define trailSize(n)        (sizeof(shiptrail) + (n)*(3*sizeof(vector) + sizeof(bool8)))
 #define trailStaticSize(n)  (sizeof(trailstatic) + (n) * sizeof(color) * MAX_MULTIPLAYER_PLAYERS)
 #define trailInsertTrail()  ((trailInsertCount ^= TRUE) != 0)
 
@@ -147,8 +154,8 @@ void mistrailDraw(vector* current, missiletrail* trail, sdword LOD, sdword teamI
 shiptrail *trailNew(trailstatic *staticInfo, void* vship, bool8 second, ubyte trailNum);
 void trailDelete(shiptrail *trail);
 
-//update a trail by adding in a new position into its queue
-void trailUpdate(shiptrail *trail, vector *position);
+//update all ship trails by adding the current nozzle positions into their queues
+void trailsUpdate(bool nisShips);
 
 //draw a ship trail
 void trailDraw(vector *current, shiptrail *trail, sdword LOD, sdword teamIndex);
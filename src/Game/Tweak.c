@@ -401,6 +401,12 @@ sdword REFRESH_COLLBLOB_FRAME        =  6;
 
 sdword REFRESH_COLLBLOB_BATTLEPING_FRAME =  4;
 
+bool   COLLGRID_ENABLED              =  FALSE;
+real32 COLLGRID_CELL_SIZE            =  3000.0f;
+
+bool   ETG_PARTICLES_PARALLEL        =  TRUE;
+bool   ETG_UPDATE_BATCHED            =  TRUE;
+
 sdword REFRESH_RESEARCH_RATE         =  15;
 sdword REFRESH_RESEARCH_FRAME        =  13;
 
@@ -606,6 +612,8 @@ scriptEntry Tweaks[] =
     { "univBobOverlapFactor",  scriptSetBlobPropertyOverlap, &collBlobProperties },
     { "univBobSmallestRadius", scriptSetReal32CB, &collBlobProperties.bobSmallestRadius },
     { "univBobBiggestRadius", scriptSetBlobBiggestRadius, &collBlobProperties },
+    { "univBobIncremental", scriptSetBool, &collBlobProperties.bobIncremental },
+    { "univBobIncrementalHysteresis", scriptSetReal32CB, &collBlobProperties.bobIncrementalHysteresis },
 //    { "univBobDoingCollisionBobs", scriptSetBool, &collBlobProperties.bobDoingCollisionBobs },
 
     //stats gathering tweaks
@@ -984,6 +992,11 @@ scriptEntry Tweaks[] =
 
     makeEntry(REFRESH_COLLBLOB_BATTLEPING_FRAME, scriptSetSdwordCB),
 
+    makeEntry(COLLGRID_ENABLED, scriptSetBool),
+    makeEntry(COLLGRID_CELL_SIZE, scriptSetReal32CB),
+    makeEntry(ETG_PARTICLES_PARALLEL, scriptSetBool),
+    makeEntry(ETG_UPDATE_BATCHED, scriptSetBool),
+
     makeEntry(REFRESH_RESEARCH_RATE, scriptSetSdwordCB),
     makeEntry(REFRESH_RESEARCH_FRAME, scriptSetSdwordCB),
 
@@ -497,6 +497,12 @@ extern sdword REFRESH_COLLBLOB_FRAME;
 
 extern sdword REFRESH_COLLBLOB_BATTLEPING_FRAME;
 
+extern bool   COLLGRID_ENABLED;
+extern real32 COLLGRID_CELL_SIZE;
+
+extern bool   ETG_PARTICLES_PARALLEL;
+extern bool   ETG_UPDATE_BATCHED;
+
 extern sdword REFRESH_RESEARCH_RATE;
 extern sdword REFRESH_RESEARCH_FRAME;
 
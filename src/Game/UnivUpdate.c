@@ -9,6 +9,7 @@
 #include "UnivUpdate.h"
 
 #include <math.h>
+#include "SDL.h"
 
 #include "AIPlayer.h"
 #include "AIShip.h"
@@ -16,7 +17,9 @@
 #include "Alliance.h"
 #include "Battle.h"
 #include "Bounties.h"
+#include "BulletStore.h"
 #include "Clamp.h"
+#include "CollGrid.h"
 #include "Collision.h"
 #include "CommandDefs.h"
 #include "CommandWrap.h"
@@ -39,10 +42,12 @@
 #include "MultiplayerGame.h"
 #include "NetCheck.h"
 #include "NIS.h"
+#include "ObjHandle.h"
 #include "Physics.h"
 #include "PiePlate.h"
 #include "Ping.h"
 #include "ProfileTimers.h"
+#include "RefIndex.h"
 #include "Randy.h"
 #include "SaveGame.h"
 #include "Select.h"
@@ -63,6 +68,14 @@
 
 #define DEBUG_COLLISIONS 0
 
+#ifdef HW_BUILD_FOR_DEBUGGING
+#define UNIV_DEATH_STATS        1               //report frames where cleaning up after dead ships took long
+#else
+#define UNIV_DEATH_STATS        0
+#endif
+
+#define UNIV_DeathReportMs      1.0             //report death cleanup longer than this
+
 vector defaultshipupvector = { 0.0f, 0.0f, 1.0f };
 vector defaultshiprightvector = { 0.0f, -1.0f, 0.0f };
 vector defaultshipheadingvector = { 1.0f, 0.0f, 0.0f };
@@ -93,6 +106,14 @@ Private data
 
 bool gameIsEnding=FALSE;
 
+#if UNIV_DEATH_STATS
+static Uint64 univDeathTicks = 0;               //time spent in univRemoveShipReferences this frame
+static sdword univDeathCount = 0;               //ships it was called for
+#if REF_VERIFY
+static Uint64 univDeathSweepTicks = 0;          //time the same deaths took the old way, by sweeping the lists
+#endif
+#endif
+
 /*=============================================================================
     Tweakables
 =============================================================================*/
@@ -258,15 +279,15 @@ void univInitSpaceObjPosRot(SpaceObj *obj,vector *position,bool randomOrientatio
 void IDToPtrTableInit(IDToPtrTable *table)
 {
     table->numEntries = 0;
-    table->objptrs = NULL;
+    table->handles = NULL;
 }
 
 void IDToPtrTableClose(IDToPtrTable *table)
 {
-    if (table->objptrs)
+    if (table->handles)
     {
-        memFree(table->objptrs);
-        table->objptrs = NULL;
+        memFree(table->handles);
+        table->handles = NULL;
     }
     table->numEntries = 0;
 }
@@ -277,16 +298,7 @@ void IDToPtrTableReset(IDToPtrTable *table)
     IDToPtrTableInit(table);
 }
 
-void IDToPtrTableObjDied(IDToPtrTable *table,uword ID)
-{
-    if (ID >= table->numEntries)
-    {
-        return;
-    }
-
-    table->objptrs[ID] = NULL;      // remove reference
-}
-
+// entries are handles, so they go stale by themselves when the object dies
 SpaceObjPtr IDToPtrTableIDToObj(IDToPtrTable *table,uword ID)
 {
     if (ID >= table->numEntries)
@@ -294,7 +306,7 @@ SpaceObjPtr IDToPtrTableIDToObj(IDToPtrTable *table,uword ID)
         return NULL;
     }
 
-    return table->objptrs[ID];
+    return hndObj(table->handles[ID]);
 }
 
 void IDToPtrTableAdd(IDToPtrTable *table,uword ID,SpaceObj *obj)
@@ -305,27 +317,27 @@ void IDToPtrTableAdd(IDToPtrTable *table,uword ID,SpaceObj *obj)
     {
         sdword newnumber = table->numEntries+IDTOPTR_GROWBATCH;
 
-        if (table->objptrs)
+        if (table->handles)
         {
-            table->objptrs = memRealloc(table->objptrs,sizeof(SpaceObjPtr) * newnumber,"idtoptrs",0);
+            table->handles = memRealloc(table->handles,sizeof(objhandle) * newnumber,"idtoptrs",0);
         }
         else
         {
-            table->objptrs = memAlloc(sizeof(SpaceObjPtr) * newnumber,"idtoptrs",0);
+            table->handles = memAlloc(sizeof(objhandle) * newnumber,"idtoptrs",0);
         }
-        memset(&table->objptrs[table->numEntries],0,sizeof(SpaceObjPtr)*IDTOPTR_GROWBATCH);
+        memset(&table->handles[table->numEntries],0,sizeof(objhandle)*IDTOPTR_GROWBATCH);
         table->numEntries += IDTOPTR_GROWBATCH;
     }
 
     dbgAssertOrIgnore(ID < table->numEntries);
 
-    if (table->objptrs[ID])
+    if (hndObj(table->handles[ID]))
     {
         dbgFatalf(DBG_Loc,"Obj with this ID %d already exists",ID);
     }
     else
     {
-        table->objptrs[ID] = obj;
+        table->handles[ID] = hndObjBorn(obj);
     }
     return;
 }
@@ -358,7 +370,7 @@ void SaveIDToPtrTable(IDToPtrTable *table)
 
     for (i=0;i<num;i++)
     {
-        savecontents->ID[i] = SpaceObjRegistryGetID(table->objptrs[i]);
+        savecontents->ID[i] = SpaceObjRegistryGetID(hndObj(table->handles[i]));
     }
 
     SaveThisChunk(chunk);
@@ -369,6 +381,7 @@ void LoadIDToPtrTable(IDToPtrTable *table)
 {
     SaveChunk *chunk;
     SaveIDToPtrTableStruct *loadcontents;
+    SpaceObj *obj;
     sdword num;
     sdword i;
 
@@ -383,17 +396,18 @@ void LoadIDToPtrTable(IDToPtrTable *table)
     table->numEntries = num;
     if (num == 0)
     {
-        table->objptrs = NULL;
+        table->handles = NULL;
     }
     else
     {
-        table->objptrs = memAlloc(sizeof(SpaceObjPtr) * num,"idtoptrs",0);
+        table->handles = memAlloc(sizeof(objhandle) * num,"idtoptrs",0);
     }
 
     for (i=0;i<num;i++)
     {
-        table->objptrs[i] = SpaceObjRegistryGetObj(loadcontents->ID[i]);
-}
+        obj = SpaceObjRegistryGetObj(loadcontents->ID[i]);
+        table->handles[i] = (obj != NULL) ? hndObjBorn(obj) : HND_None;
+    }
 
     memFree(chunk);
 }
@@ -407,6 +421,8 @@ void LoadIDToPtrTable(IDToPtrTable *table)
 
 void univInitFastNetworkIDLookups(void)
 {
+    hndReset();
+    refReset();
     IDToPtrTableInit(&ShipIDToPtr);
     IDToPtrTableInit(&ResourceIDToPtr);
     IDToPtrTableInit(&DerelictIDToPtr);
@@ -419,10 +435,14 @@ void univCloseFastNetworkIDLookups(void)
     IDToPtrTableClose(&ResourceIDToPtr);
     IDToPtrTableClose(&DerelictIDToPtr);
     IDToPtrTableClose(&MissileIDToPtr);
+    refShutdown();
+    hndShutdown();
 }
 
 void univResetFastNetworkIDLookups(void)
 {
+    hndReset();
+    refReset();
     IDToPtrTableReset(&ShipIDToPtr);
     IDToPtrTableReset(&ResourceIDToPtr);
     IDToPtrTableReset(&DerelictIDToPtr);
@@ -666,7 +686,7 @@ Missile *univAddMissile(ShipRace race)
     Missile *missile;
     sdword i;
 
-    missile = memAlloc(sizeof(Missile),"Missile",0);
+    missile = memSlabAlloc(MSP_Missile, sizeof(Missile), "Missile");
     memset(missile,0,sizeof(Missile));
 
     missile->objtype = OBJ_MissileType;
@@ -1568,6 +1588,7 @@ Ship *univCreateShip(ShipType shiptype,ShipRace shiprace,vector *shippos,struct
     {
         ((ShipStaticInfo *)newship->staticinfo)->custshipheader.CustShipInit(newship);
     }
+    univRecordShipReferences(newship);
 
     //lightning effect stuff
     newship->lightning[0] = NULL;
@@ -1704,13 +1725,15 @@ void univUpdateAllPosVelBullets()
     etgeffectstatic *stat;
     Effect *effect;
 
+    bstBeginUpdate();
+
     while (bulletnode != NULL)
     {
         bullet = (Bullet *)listGetStructOfNode(bulletnode);
 
         if ((bullet->flags & SOF_DontApplyPhysics) == 0)
         {
-            if (physUpdateBulletPosVel(bullet,universe.phystimeelapsed))
+            if (bstUpdateBulletPosVel(bullet,bulletnode,universe.phystimeelapsed))
             {
                 //bullet has died so clean it up
 
@@ -1801,6 +1824,7 @@ void univUpdateAllPosVelBullets()
                 }
 
                 bobObjectDied(((SpaceObj *)bullet),&universe.collBlobList);
+                refReferrerDied((SpaceObj *)bullet);
                 listRemoveNode(&bullet->bulletlink);
                 univRemoveObjFromRenderList(((SpaceObj *)bullet));
                 listDeleteNode(&bullet->objlink);
@@ -1848,6 +1872,10 @@ void univUpdateAllPosVelMissiles()
             {
                 AddMissileToDeleteMissileList(missile, -1);
             }
+            else if (missile->missileType == MISSILE_Mine)
+            {
+                cgridObjectMoved((SpaceObj *)missile);
+            }
         }
         misnode = misnode->next;
     }
@@ -1875,6 +1903,7 @@ void univUpdateAllPosVelDerelicts()
                 physUpdateObjPosVelDerelicts(derelict,universe.phystimeelapsed);
             }
         }
+        cgridObjectMoved((SpaceObj *)derelict);
         objnode = objnode->next;
     }
 }
@@ -1904,6 +1933,7 @@ void univUpdateAllPosVelResources()
             resource->resourceNotAccessible--;
         }
 
+        cgridObjectMoved((SpaceObj *)resource);
         objnode = objnode->next;
     }
 }
@@ -1982,6 +2012,7 @@ nowdosetupforshipsShipCustomFunc:
             }
         }
 
+        cgridObjectMoved((SpaceObj *)ship);
 
         objnode = objnode->next;
     }
@@ -2070,6 +2101,16 @@ void univUpdateAllPosVelEffects()
     Node *deletenode;
     Effect *effect;
 
+#if ETG_EXEC_STATS
+    etgExecStatsReset();
+#endif
+
+    if (ETG_UPDATE_BATCHED)
+    {
+        etgEffectsUpdate(universe.phystimeelapsed);
+        return;
+    }
+
     while (objnode != NULL)
     {
         effect = (Effect *)listGetStructOfNode(objnode);
@@ -2695,6 +2736,7 @@ void AddDerelictToDeleteDerelictList(Derelict *derelict,GunSoundType damageType)
     DeleteDerelict *deleteDerelict = memAlloc(sizeof(DeleteDerelict),"DeleteDerelict",Pyrophoric);
 
     bobObjectDied((SpaceObj *)derelict,&universe.collBlobList);//can't have dead derelicts in the blobs
+    cgridObjectDied((SpaceObj *)derelict);
     derelict->flags |= SOF_Dead;
 
     deleteDerelict->derelict = derelict;
@@ -3177,6 +3219,7 @@ nobulletmasstransfer:
             ((Ship *)target)->gettingrocked = bulletowner;
 
             ((Ship *)target)->recentAttacker = bulletowner;
+            refSet((SpaceObj *)target, REF_RecentAttacker, (SpaceObj *)bulletowner);
             ((Ship *)target)->recentlyAttacked = RECENT_ATTACK_DURATION;  // start counting down
         }
         else
@@ -3362,6 +3405,7 @@ void univMissileCollidedWithTarget(SpaceObjRotImpTarg *target,StaticHeader *targ
             ((Ship *)target)->gettingrocked = missileowner;
 
             ((Ship *)target)->recentAttacker = missileowner;
+            refSet((SpaceObj *)target, REF_RecentAttacker, (SpaceObj *)missileowner);
             ((Ship *)target)->recentlyAttacked = RECENT_ATTACK_DURATION;  // start counting down
         }
         else
@@ -3432,180 +3476,354 @@ void univMissileCollidedWithTarget(SpaceObjRotImpTarg *target,StaticHeader *targ
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : univRemoveAllTargetReferencesFromBullets
-    Description : removes all ship references from any bullets
-    Inputs      : ship
+    Name        : univDropShipReference
+    Description : clears one of a ship's references to a ship which is going
+                  away
+    Inputs      : ship - the ship holding the reference
+                  kind - REF_RecentAttacker, REF_FiringAtUs or REF_RowGetOutOfWay
+                  shiptoremove - the ship going away
     Outputs     :
-    Return      :
+    Return      : TRUE if the reference was cleared
 ----------------------------------------------------------------------------*/
-void univRemoveAllTargetReferencesFromBullets(SpaceObjRotImpTarg *target)
+static bool univDropShipReference(Ship *ship, sdword kind, Ship *shiptoremove)
 {
-    Node *objnodebullet = universe.BulletList.head;
-    Bullet *bullet;
-
-    // Update bullet->owner for all bullets whose owner is now dead
-    while (objnodebullet != NULL)
+    switch (kind)
     {
-        bullet = (Bullet *)listGetStructOfNode(objnodebullet);
-        dbgAssertOrIgnore(bullet->objtype == OBJ_BulletType);
+        case REF_RecentAttacker:
+            if (ship->recentlyAttacked && ship->recentAttacker == shiptoremove)
+            {
+                // forget that this ship had recently attacked anyone
+                ship->recentlyAttacked = 0;
+                ship->recentAttacker = NULL;
+                return TRUE;
+            }
+            break;
 
-        if (bullet->owner == (Ship *)target)
-        {
-            bullet->owner = NULL;       // bullet has no owner now that parent ship died
-            bullet->gunowner = NULL;
-            if (bullet->bulletType == BULLET_Beam)
+        case REF_FiringAtUs:
+            if (ship->recentlyFiredUpon && ship->firingAtUs == shiptoremove)
             {
-                bullet->timelived += 10000.0f;  // delete bullet if it is a beam weapon and target wielding it died
+                ship->recentlyFiredUpon = 0;
+                ship->firingAtUs = NULL;
+                return TRUE;
             }
-        }
+            break;
 
-        if (bullet->target == target)
-        {
-            bullet->target = NULL;
-        }
+        case REF_RowGetOutOfWay:
+            if (ship->rowGetOutOfWay == shiptoremove)
+            {
+                rowGetOutOfWayShipDiedCB(ship);
+                ship->rowGetOutOfWay = NULL;
+                return TRUE;
+            }
+            break;
 
-        objnodebullet = objnodebullet->next;
+        default:
+            break;
     }
+    return FALSE;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : univRemoveAllTargetReferencesFromMissiles
-    Description : removes all target references from any missiles
-    Inputs      : ship
+    Name        : univDropTargetReference
+    Description : refDropReferences callback, clears one bullet, missile or
+                  ship's reference to an object which is going away
+    Inputs      : referrer - the bullet, missile or ship
+                  kind - REF_Owner, REF_Target, REF_RecentAttacker, ...
+                  referee - the object going away
     Outputs     :
-    Return      :
+    Return      : TRUE if the reference was cleared
 ----------------------------------------------------------------------------*/
-void univRemoveAllTargetReferencesFromMissiles(SpaceObjRotImpTarg *target)
+static bool univDropTargetReference(SpaceObj *referrer, sdword kind, SpaceObj *referee)
 {
-    Node *objnodemissile = universe.MissileList.head;
+    Bullet *bullet;
     Missile *missile;
 
-    // Update missile->owner for all missiles whose owner is now dead
-    while (objnodemissile != NULL)
+    switch (referrer->objtype)
     {
-        missile = (Missile *)listGetStructOfNode(objnodemissile);
-        dbgAssertOrIgnore(missile->objtype == OBJ_MissileType);
+        case OBJ_BulletType:
+            bullet = (Bullet *)referrer;
+            if (kind == REF_Owner && bullet->owner == (Ship *)referee)
+            {
+                bullet->owner = NULL;       // bullet has no owner now that parent ship died
+                bullet->gunowner = NULL;
+                if (bullet->bulletType == BULLET_Beam)
+                {
+                    bullet->timelived += 10000.0f;  // delete bullet if it is a beam weapon and target wielding it died
+                }
+                return TRUE;
+            }
+            if (kind == REF_Target && bullet->target == (SpaceObjRotImpTarg *)referee)
+            {
+                bullet->target = NULL;
+                return TRUE;
+            }
+            break;
 
-        if (missile->owner == (Ship *)target)
-        {
-            missile->owner = NULL;       // missile has no owner now that parent ship died
-        }
+        case OBJ_MissileType:
+            missile = (Missile *)referrer;
+            if (kind == REF_Owner && missile->owner == (Ship *)referee)
+            {
+                missile->owner = NULL;      // missile has no owner now that parent ship died
+                return TRUE;
+            }
+            if (kind == REF_Target && missile->target == (SpaceObjRotImpTarg *)referee)
+            {
+                missile->target = NULL;
+                return TRUE;
+            }
+            break;
 
-        if (missile->target == target)
-        {
-            missile->target = NULL;
-        }
+        case OBJ_ShipType:
+            return univDropShipReference((Ship *)referrer, kind, (Ship *)referee);
 
-        objnodemissile = objnodemissile->next;
+        default:
+            dbgAssertOrIgnore(FALSE);
+            break;
     }
+    return FALSE;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : univRemoveAllDerelictReferencesFromSpecialShips
-    Description : removes all derelict references from special ships
-    Inputs      : d - derelictto remove
+    Name        : univDropMissileTargetReference
+    Description : refDropReferences callback, like univDropTargetReference
+                  but leaves everything except missiles alone
+    Inputs      : referrer - the bullet, missile or ship
+                  kind - REF_Owner, REF_Target, REF_RecentAttacker, ...
+                  referee - the object going away
     Outputs     :
-    Return      :
+    Return      : TRUE if the reference was cleared
 ----------------------------------------------------------------------------*/
-void univRemoveAllDerelictReferencesFromSpecialShips(Derelict *d)
+static bool univDropMissileTargetReference(SpaceObj *referrer, sdword kind, SpaceObj *referee)
 {
-    Node *node = universe.ShipList.head;
-    Ship *ship;
-    InsideShip *insideShip;
-
-    while (node != NULL)
+    if (referrer->objtype != OBJ_MissileType)
     {
-        ship = (Ship *)listGetStructOfNode(node);
-        dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
-
-        if(ship->specialFlags & SPECIAL_IsASalvager)
-            salCapRemoveDerelictReferences(ship,d);
-
-        node = node->next;
+        return FALSE;
     }
+    return univDropTargetReference(referrer, kind, referee);
+}
 
-    // walk through ships in hyperspace too!
+/*-----------------------------------------------------------------------------
+    Name        : univHolderShipDied
+    Description : refVisitHolders callback, lets a special ship forget a ship
+                  which is going away
+    Inputs      : holder - the special ship
+                  kind - REF_Holder
+                  referee - the ship going away
+    Outputs     :
+    Return      : FALSE
+----------------------------------------------------------------------------*/
+static bool univHolderShipDied(SpaceObj *holder, sdword kind, SpaceObj *referee)
+{
+    Ship *ship = (Ship *)holder;
 
-    node = singlePlayerGameInfo.ShipsInHyperspace.head;
+    (void)kind;
+    dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
 
-    while (node != NULL)
+    if(!(gameIsEnding && ship->shiptype == ResearchShip))
     {
-        insideShip = (InsideShip *)listGetStructOfNode(node);
-        ship = insideShip->ship;
-        dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
+        if(((ShipStaticInfo *)ship->staticinfo)->custshipheader.CustShipRemoveShipReferences != NULL)
+        {
+            ((ShipStaticInfo *)ship->staticinfo)->custshipheader.CustShipRemoveShipReferences(ship, (Ship *)referee);
+        }
+    }
+    return FALSE;
+}
 
-        if(ship->specialFlags & SPECIAL_IsASalvager)
-            salCapRemoveDerelictReferences(ship,d);
+/*-----------------------------------------------------------------------------
+    Name        : univHolderDerelictDied
+    Description : refVisitHolders callback, lets a salvager forget a derelict
+                  which is going away
+    Inputs      : holder - the special ship
+                  kind - REF_Holder
+                  referee - the derelict going away
+    Outputs     :
+    Return      : FALSE
+----------------------------------------------------------------------------*/
+static bool univHolderDerelictDied(SpaceObj *holder, sdword kind, SpaceObj *referee)
+{
+    Ship *ship = (Ship *)holder;
 
-        node = node->next;
-    }
+    (void)kind;
+    dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
+
+    if(ship->specialFlags & SPECIAL_IsASalvager)
+        salCapRemoveDerelictReferences(ship,(Derelict *)referee);
+    return FALSE;
 }
 
-void univRemoveAllShipReferencesFromSpecialShip(Ship *shiptoremove,Ship *ship)
+/*-----------------------------------------------------------------------------
+    Name        : univSweepReferences
+    Description : offers a reference to referee from every bullet, missile
+                  and ship to the callbacks, the way deaths were cleaned up
+                  before the reverse index (RefIndex.h).  Only needed when
+                  the index is incomplete, or to check it under REF_VERIFY.
+    Inputs      : referee - the object going away
+                  callback - clears one reference, NULL to skip
+                  holdercallback - called once per ship with kind
+                    REF_Holder, NULL to skip
+    Outputs     :
+    Return      : number of references callback cleared
+----------------------------------------------------------------------------*/
+static sdword univSweepReferences(SpaceObj *referee, refdropcallback callback, refdropcallback holdercallback)
 {
-    if (ship->recentlyAttacked && ship->recentAttacker == shiptoremove)
+    Node *node;
+    InsideShip *insideShip;
+    SpaceObj *obj;
+    sdword kind, numCleared = 0;
+
+    for (node = universe.BulletList.head; callback != NULL && node != NULL; node = node->next)
     {
-        // forget that this ship had recently attacked anyone
-        ship->recentlyAttacked = 0;
-        ship->recentAttacker = NULL;
+        obj = (SpaceObj *)listGetStructOfNode(node);
+        for (kind = REF_Owner; kind <= REF_Target; kind++)
+        {
+            numCleared += callback(obj, kind, referee);
+        }
     }
-    if (ship->recentlyFiredUpon && ship->firingAtUs == shiptoremove)
+    for (node = universe.MissileList.head; callback != NULL && node != NULL; node = node->next)
     {
-        ship->recentlyFiredUpon = 0;
-        ship->firingAtUs = NULL;
+        obj = (SpaceObj *)listGetStructOfNode(node);
+        for (kind = REF_Owner; kind <= REF_Target; kind++)
+        {
+            numCleared += callback(obj, kind, referee);
+        }
     }
 
-    if (ship->rowGetOutOfWay == shiptoremove)
+    for (node = universe.ShipList.head; node != NULL; node = node->next)
     {
-        rowGetOutOfWayShipDiedCB(ship);
-        ship->rowGetOutOfWay = NULL;
+        obj = (SpaceObj *)listGetStructOfNode(node);
+        for (kind = REF_RecentAttacker; callback != NULL && kind <= REF_RowGetOutOfWay; kind++)
+        {
+            numCleared += callback(obj, kind, referee);
+        }
+        if (holdercallback != NULL)
+        {
+            holdercallback(obj, REF_Holder, referee);
+        }
     }
 
-    if(!(gameIsEnding && ship->shiptype == ResearchShip))
+    // walk through ships in hyperspace too!
+    for (node = singlePlayerGameInfo.ShipsInHyperspace.head; node != NULL; node = node->next)
     {
-        if(((ShipStaticInfo *)ship->staticinfo)->custshipheader.CustShipRemoveShipReferences != NULL)
+        insideShip = (InsideShip *)listGetStructOfNode(node);
+        obj = (SpaceObj *)insideShip->ship;
+        for (kind = REF_RecentAttacker; callback != NULL && kind <= REF_RowGetOutOfWay; kind++)
+        {
+            numCleared += callback(obj, kind, referee);
+        }
+        if (holdercallback != NULL)
         {
-            ((ShipStaticInfo *)ship->staticinfo)->custshipheader.CustShipRemoveShipReferences(ship, shiptoremove);
+            holdercallback(obj, REF_Holder, referee);
         }
     }
+    return numCleared;
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : univRemoveAllShipReferencesFromSpecialShips
-    Description : removes all ship references from special ships
-    Inputs      : shiptoremove
+    Name        : univSweepAfterIndex
+    Description : backs up the reverse index once it has cleared the
+                  references to an object.  The lists only need sweeping if
+                  the index is incomplete; under REF_VERIFY they are swept
+                  anyway, timed, and anything found is a reference the index
+                  missed.
+    Inputs      : referee - the object going away
+                  callback - the refDropReferences callback just used
     Outputs     :
     Return      :
 ----------------------------------------------------------------------------*/
-void univRemoveAllShipReferencesFromSpecialShips(Ship *shiptoremove)
+static void univSweepAfterIndex(SpaceObj *referee, refdropcallback callback)
 {
-    Node *node = universe.ShipList.head;
-    Ship *ship;
-    InsideShip *insideShip;
+#if REF_VERIFY
+    sdword numCleared;
+#if UNIV_DEATH_STATS
+    Uint64 sweepStart = SDL_GetPerformanceCounter();
+#endif
 
-    while (node != NULL)
+    numCleared = univSweepReferences(referee, callback, NULL);
+#if UNIV_DEATH_STATS
+    univDeathSweepTicks += SDL_GetPerformanceCounter() - sweepStart;
+#endif
+    if (numCleared != 0 && !refIncomplete())
     {
-        ship = (Ship *)listGetStructOfNode(node);
-        dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
-
-        univRemoveAllShipReferencesFromSpecialShip(shiptoremove,ship);
-
-        node = node->next;
+        dbgFatalf(DBG_Loc, "univSweepAfterIndex: %d references to %p weren't indexed", numCleared, referee);
     }
+#else
+    if (refIncomplete())
+    {
+        univSweepReferences(referee, callback, NULL);
+    }
+#endif
+}
 
-    // walk through ships in hyperspace too!
+/*-----------------------------------------------------------------------------
+    Name        : univRemoveAllTargetReferences
+    Description : removes all references to target from bullets, missiles
+                  and ships' recentAttacker, firingAtUs and rowGetOutOfWay
+    Inputs      : target
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void univRemoveAllTargetReferences(SpaceObjRotImpTarg *target)
+{
+    refDropReferences((SpaceObj *)target, univDropTargetReference);
+    univSweepAfterIndex((SpaceObj *)target, univDropTargetReference);
+}
 
-    node = singlePlayerGameInfo.ShipsInHyperspace.head;
+/*-----------------------------------------------------------------------------
+    Name        : univRemoveAllTargetReferencesFromMissiles
+    Description : removes all target references from any missiles
+    Inputs      : ship
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void univRemoveAllTargetReferencesFromMissiles(SpaceObjRotImpTarg *target)
+{
+    refDropReferences((SpaceObj *)target, univDropMissileTargetReference);
+    univSweepAfterIndex((SpaceObj *)target, univDropMissileTargetReference);
+}
 
-    while (node != NULL)
+/*-----------------------------------------------------------------------------
+    Name        : univRemoveAllHolderReferences
+    Description : lets the special ships registered with refHolderAdd forget
+                  an object which is going away, or every ship if the index
+                  is incomplete
+    Inputs      : obj - the ship or derelict going away
+                  holdercallback - univHolderShipDied or univHolderDerelictDied
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void univRemoveAllHolderReferences(SpaceObj *obj, refdropcallback holdercallback)
+{
+    if (refIncomplete())
     {
-        insideShip = (InsideShip *)listGetStructOfNode(node);
-        ship = insideShip->ship;
-        dbgAssertOrIgnore(ship->objtype == OBJ_ShipType);
+        univSweepReferences(obj, NULL, holdercallback);
+    }
+    else
+    {
+        refVisitHolders(obj, holdercallback);
+    }
+}
 
-        univRemoveAllShipReferencesFromSpecialShip(shiptoremove,ship);
+/*-----------------------------------------------------------------------------
+    Name        : univRecordShipReferences
+    Description : enters a ship's references into the reverse index, and
+                  registers it as a holder if it keeps references of its own
+                  (a CustShipRemoveShipReferences, or a salvager's
+                  derelicts).  Called for new ships and for loaded ones once
+                  their pointers are fixed up.
+    Inputs      : ship
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+void univRecordShipReferences(Ship *ship)
+{
+    refSet((SpaceObj *)ship, REF_RecentAttacker, (SpaceObj *)ship->recentAttacker);
+    refSet((SpaceObj *)ship, REF_FiringAtUs, (SpaceObj *)ship->firingAtUs);
+    refSet((SpaceObj *)ship, REF_RowGetOutOfWay, (SpaceObj *)ship->rowGetOutOfWay);
 
-        node = node->next;
+    if (((ShipStaticInfo *)ship->staticinfo)->custshipheader.CustShipRemoveShipReferences != NULL ||
+        (ship->specialFlags & SPECIAL_IsASalvager))
+    {
+        refHolderAdd((SpaceObj *)ship);
     }
 }
 
@@ -3691,6 +3909,7 @@ void univWipeShipOutOfExistence(Ship *ship)
     etgShipDied(ship);
     univRemoveObjFromRenderList((SpaceObj *)ship);
     univFreeShipContents(ship);
+    cgridObjectDied((SpaceObj *)ship);
     listDeleteNode(&ship->objlink);
 }
 
@@ -3744,6 +3963,7 @@ void univRemoveShipFromOutside(Ship *ship)
     }
 
     bobObjectDied((SpaceObj *)ship,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)ship);
     pingObjectDied((SpaceObj *)ship);
     ship->collMyBlob = NULL;
 
@@ -4028,10 +4248,9 @@ void univDeleteDeadShip(Ship *ship, sdword deathBy)
         }
     }
 
-    univRemoveAllTargetReferencesFromBullets((SpaceObjRotImpTarg *)ship);
-    univRemoveAllTargetReferencesFromMissiles((SpaceObjRotImpTarg *)ship);
+    univRemoveAllTargetReferences((SpaceObjRotImpTarg *)ship);
 
-    univRemoveAllShipReferencesFromSpecialShips(ship);
+    univRemoveAllHolderReferences((SpaceObj *)ship, univHolderShipDied);
 
     //if sensors manager is running, delete it from any sm spheres
     if (smSensorsActive)
@@ -4040,6 +4259,7 @@ void univDeleteDeadShip(Ship *ship, sdword deathBy)
     }
 
     bobObjectDied((SpaceObj *)ship,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)ship);
     pingObjectDied((SpaceObj *)ship);
     ship->collMyBlob = NULL;
 
@@ -4064,7 +4284,7 @@ void univDeleteDeadShip(Ship *ship, sdword deathBy)
     // Tell the sound layer that the ship died
     soundEventShipDied(ship);
 
-    IDToPtrTableObjDied(&ShipIDToPtr,ship->shipID.shipNumber);
+    hndObjRetire((SpaceObj *)ship);                         //ID lookups stop finding it, references go when it's wiped
 
     growSelectRemoveShip(&universe.HousekeepShipList,ship);
 
@@ -4480,15 +4700,15 @@ void DeleteDeadResource(Resource *resource)
     ccRemoveShip(&universe.mainCameraCommand,(Ship *)resource);
 
     bobObjectDied((SpaceObj *)resource,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)resource);
     pingObjectDied((SpaceObj *)resource);
 
     // Update Command Layer to reflect resource death
-    univRemoveAllTargetReferencesFromBullets((SpaceObjRotImpTarg *)resource);
-    univRemoveAllTargetReferencesFromMissiles((SpaceObjRotImpTarg *)resource);
+    univRemoveAllTargetReferences((SpaceObjRotImpTarg *)resource);
     clResourceDied(&universe.mainCommandLayer,resource);
     aiplayerResourceDied(resource);
 
-    IDToPtrTableObjDied(&ResourceIDToPtr,resource->resourceID.resourceNumber);
+    refReferrerDied((SpaceObj *)resource);
 
     univFreeResourceContents(resource);
 }
@@ -4597,6 +4817,7 @@ bool DeleteDeadDerelict(Derelict *derelict, sdword deathBy)
     }
 
     bobObjectDied((SpaceObj *)derelict,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)derelict);
     //if sensors manager is running, delete it from any sm spheres
     if (smSensorsActive)
     {
@@ -4606,15 +4827,14 @@ bool DeleteDeadDerelict(Derelict *derelict, sdword deathBy)
     /* shut off the derelicts sounds */
     soundEventDerelictRemove(derelict);
 
-    univRemoveAllDerelictReferencesFromSpecialShips(derelict);
+    univRemoveAllHolderReferences((SpaceObj *)derelict, univHolderDerelictDied);
     pingObjectDied((SpaceObj *)derelict);
     ccRemoveShip(&universe.mainCameraCommand,(Ship *)derelict);
     // Update Command Layer to reflect derelict death
-    univRemoveAllTargetReferencesFromBullets((SpaceObjRotImpTarg *)derelict);
-    univRemoveAllTargetReferencesFromMissiles((SpaceObjRotImpTarg *)derelict);
+    univRemoveAllTargetReferences((SpaceObjRotImpTarg *)derelict);
     clDerelictDied(&universe.mainCommandLayer,derelict);
 
-    IDToPtrTableObjDied(&DerelictIDToPtr,derelict->derelictID.derelictNumber);
+    refReferrerDied((SpaceObj *)derelict);
 
 #if ETG_DISABLEABLE
     if (deathBy >= 0 && etgEffectsEnabled)
@@ -4685,6 +4905,7 @@ void univReallyDeleteThisDerelictRightNow(Derelict *derelict)
 void univWipeDerelictOutOfExistance(Derelict *derelict)
 {
     bobObjectDied((SpaceObj *)derelict,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)derelict);
     nisObjectDied((SpaceObj *)derelict);
     if (derelict->derelictlink.belongto != NULL)
     {
@@ -4800,14 +5021,14 @@ void DeleteDeadMissile(Missile *missile, sdword deathBy)
         }
     }
     bobObjectDied((SpaceObj *)missile,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)missile);
     pingObjectDied((SpaceObj *)missile);
 
-    univRemoveAllTargetReferencesFromBullets((SpaceObjRotImpTarg *)missile);
-    univRemoveAllTargetReferencesFromMissiles((SpaceObjRotImpTarg *)missile);
+    univRemoveAllTargetReferences((SpaceObjRotImpTarg *)missile);
     nisRemoveMissileReference(missile);
     clMissileDied(&universe.mainCommandLayer,missile);
 
-    IDToPtrTableObjDied(&MissileIDToPtr,missile->missileID.missileNumber);
+    refReferrerDied((SpaceObj *)missile);
 
     univFreeMissileContents(missile);
 }
@@ -5540,27 +5761,15 @@ udword univCalcShipChecksum(void)
 ----------------------------------------------------------------------------*/
 void univMinorSetupShipForControl(Ship *ship)
 {
-    sdword i;
-
     ship->gettingrocked = NULL;     // always make sure this gets set to NULL - don't want any bad references
 
     dmgShipThink(ship);
-
-    //update engine trails
-    for (i = 0; i < MAX_NUM_TRAILS; i++)
-    {
-        if (ship->trail[i] != NULL)
-        {
-            trailUpdate(ship->trail[i], &ship->enginePosition);
-        }
-    }
-
 }
 
 void univSetupShipForControl(Ship *ship)
 {
     ShipStaticInfo *shipstatic;
-    sdword i,t;
+    sdword t;
 
     ship->gettingrocked = NULL;     // always make sure this gets set to NULL - don't want any bad references
 
@@ -5644,15 +5853,6 @@ void univSetupShipForControl(Ship *ship)
 
     dmgShipThink(ship);
 
-    //update engine trails
-    for (i = 0; i < MAX_NUM_TRAILS; i++)
-    {
-        if (ship->trail[i] != NULL)
-        {
-            trailUpdate(ship->trail[i], &ship->enginePosition);
-        }
-    }
-
     if ((ship->flags & SOF_Disabled) == 0)
     {
         if (shipstatic->repairDamage != 0)
@@ -6239,6 +6439,7 @@ void univupdateReset()
     listInit(&universe.DeleteShipList);
 
     listInit(&universe.collBlobList);
+    cgridReset();
 
     // tactics stuff
     listInit(&universe.RetreatList);
@@ -6435,6 +6636,13 @@ void univFreeMissileContents(Missile *missile)
 ----------------------------------------------------------------------------*/
 void univRemoveShipReferences(Ship *ship)
 {
+#if UNIV_DEATH_STATS
+    Uint64 deathStart = SDL_GetPerformanceCounter();
+#if REF_VERIFY
+    Uint64 sweepStart = univDeathSweepTicks;
+#endif
+#endif
+
     ship->flags |= SOF_Dead;
     bitClear(ship->flags,SOF_Selectable);
 
@@ -6471,10 +6679,9 @@ void univRemoveShipReferences(Ship *ship)
         dockDealWithDeadSlaveable(ship);        //this probably won't be called ever
     }
 
-    univRemoveAllTargetReferencesFromBullets((SpaceObjRotImpTarg *)ship);
-    univRemoveAllTargetReferencesFromMissiles((SpaceObjRotImpTarg *)ship);
+    univRemoveAllTargetReferences((SpaceObjRotImpTarg *)ship);
 
-    univRemoveAllShipReferencesFromSpecialShips(ship);
+    univRemoveAllHolderReferences((SpaceObj *)ship, univHolderShipDied);
 
     //if sensors manager is running, delete it from any sm spheres
     if (smSensorsActive)
@@ -6483,6 +6690,7 @@ void univRemoveShipReferences(Ship *ship)
     }
 
     bobObjectDied((SpaceObj *)ship,&universe.collBlobList);
+    cgridObjectDied((SpaceObj *)ship);
     pingObjectDied((SpaceObj *)ship);
 
     // Update Ship Command Layer to reflect ship death
@@ -6504,7 +6712,7 @@ void univRemoveShipReferences(Ship *ship)
 //  the soundEventShipRemove() doesn't say the ship died speech event
     soundEventShipRemove(ship);
 
-    IDToPtrTableObjDied(&ShipIDToPtr,ship->shipID.shipNumber);
+    refReferrerDied((SpaceObj *)ship);
 
     growSelectRemoveShip(&universe.HousekeepShipList,ship);
 
@@ -6512,7 +6720,56 @@ void univRemoveShipReferences(Ship *ship)
     univRemoveShipFromHotkeyGroup(ship,FALSE);
 
     mrShipDied(ship);
+
+#if UNIV_DEATH_STATS
+    univDeathTicks += SDL_GetPerformanceCounter() - deathStart;
+#if REF_VERIFY
+    univDeathTicks -= univDeathSweepTicks - sweepStart;     //don't count the check
+#endif
+    univDeathCount++;
+#endif
+}
+
+#if UNIV_DEATH_STATS
+/*-----------------------------------------------------------------------------
+    Name        : univDeathStatsReport
+    Description : reports the last frame's ship death cleanup if it took
+                  long enough to hitch
+    Inputs      :
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void univDeathStatsReport(void)
+{
+    real64 ms;
+#if REF_VERIFY
+    real64 sweepMs;
+#endif
+
+    if (univDeathCount == 0)
+    {
+        return;
+    }
+    ms = (real64)univDeathTicks * 1000.0 / (real64)SDL_GetPerformanceFrequency();
+#if REF_VERIFY
+    sweepMs = (real64)univDeathSweepTicks * 1000.0 / (real64)SDL_GetPerformanceFrequency();
+    if (ms > UNIV_DeathReportMs || sweepMs > UNIV_DeathReportMs)
+    {
+        dbgMessagef("univUpdate: %d ship deaths took %.2fms, %.2fms sweeping the lists (%d bullets, %d missiles, %d ships)",
+                    univDeathCount, ms, sweepMs, universe.BulletList.num, universe.MissileList.num, universe.ShipList.num);
+    }
+    univDeathSweepTicks = 0;
+#else
+    if (ms > UNIV_DeathReportMs)
+    {
+        dbgMessagef("univUpdate: %d ship deaths took %.2fms (%d bullets, %d missiles, %d ships)",
+                    univDeathCount, ms, universe.BulletList.num, universe.MissileList.num, universe.ShipList.num);
+    }
+#endif
+    univDeathTicks = 0;
+    univDeathCount = 0;
 }
+#endif
 
 /*-----------------------------------------------------------------------------
     Name        : univFreeShipContents
@@ -6727,6 +6984,7 @@ void univupdateCloseAllObjectsAndMissionSpheres()
     listInit(&universe.MissileList);
 
     bobListDelete(&universe.collBlobList);
+    cgridReset();
 
     listDeleteAll(&universe.MineFormationList);
     listDeleteAll(&universe.ResourceVolumeList);
@@ -6757,6 +7015,8 @@ void univupdateCloseAllObjectsAndMissionSpheres()
 void univupdateClose()
 {
     univupdateCloseAllObjectsAndMissionSpheres();
+    cgridShutdown();
+    bstShutdown();
 
     star3dClose(universe.star3dinfo);
     universe.star3dinfo = NULL;
@@ -7269,6 +7529,13 @@ bool univUpdate(real32 phystimeelapsed)
 #define TMP_SAVEDGAMES_PATH "SavedGames/"
 #endif
 
+    memFrameReset();                                        //last frame's scratch selections are dead
+#if UNIV_DEATH_STATS
+    univDeathStatsReport();
+#endif
+
+    SaveGameSnapshotPoll(FALSE);                            //collect a finished background autosave
+
     if ((autoSaveDebug) && ((universe.univUpdateCounter & 31) == 0))    // every 2s
     {
         char savegamename[200];
@@ -7277,7 +7544,7 @@ bool univUpdate(real32 phystimeelapsed)
         if (multiPlayerGame)
         {
             sprintf(savegamename,TMP_SAVEDGAMES_PATH "AutoSave%f",universe.totaltimeelapsed);
-            SaveGame(savegamename);
+            SaveGameSnapshot(savegamename);
             clCommandMessage(strGetString(strSavedGame));
         }
         else
@@ -7293,7 +7560,7 @@ bool univUpdate(real32 phystimeelapsed)
                 {
                     sprintf(savegamename,TMP_SAVEDGAMES_PATH "AutoSaveDebug%d",savenumber);
                     savenumber = (savenumber+1) & 7;
-                    SaveGame(savegamename);
+                    SaveGameSnapshot(savegamename);
                     clCommandMessage(strGetString(strSavedGame));
                 }
             }
@@ -7541,6 +7808,7 @@ bool univUpdate(real32 phystimeelapsed)
     {
         univPausedUpdateAllPosVelShips();   //certain operations only for when universe is paused
     }
+    trailsUpdate(nisUniversePause);     // engine trails of all ships in one pass, once they've all moved
     univUpdateAllPosVelEffects();   // MUST do effects sometime after ships+bullets and possibly other things that they may be attached to
 
     PTEND(6);
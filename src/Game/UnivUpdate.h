@@ -45,11 +45,11 @@ typedef struct DeleteDerelict
     sdword deathBy;
 } DeleteDerelict;
 
-// For Ship ID Decoding:
+// For Ship ID Decoding, network ID -> handle of the object
 typedef struct IDToPtrTable
 {
     sdword numEntries;
-    SpaceObjPtr *objptrs;
+    udword *handles;                // objhandle, see ObjHandle.h
 } IDToPtrTable;
 
 /*=============================================================================
@@ -96,6 +96,7 @@ void MakeNewDustCloudStaticInfo(DustCloud *dustcloud);
 
 void univDeleteEffect(Effect *effect);
 void univRemoveShipFromOutside(Ship *ship);
+void univRecordShipReferences(Ship *ship);          // enters a new or loaded ship in the reverse reference index
 void univDeleteWipeInsideShipOutOfExistence(Ship *ship);
 void univDeleteDeadShip(Ship *ship, sdword deathBy);// deletes ship, but lets part of it hang around for explosion
 void univWipeShipOutOfExistence(Ship *ship);                // totally deletes ship, frees memory
@@ -3011,6 +3011,97 @@ void universeLoadEverythingNeeded(void)
     dbgAssertOrIgnore(data == INFO_NEEDED_FLAGS_DELIMITER);
 }
 
+//what universeStaticInit is going to load
+static bool universeStaticToLoad(StaticInfo *staticinfo)
+{
+    return bitTest(staticinfo->staticheader.infoFlags, IF_InfoNeeded) &&
+          !bitTest(staticinfo->staticheader.infoFlags, IF_InfoLoaded);
+}
+
+/*-----------------------------------------------------------------------------
+    Name        : universePrefetchNeededStatics
+    Description : Start expanding the files of every static universeStaticInit
+                    is about to load (needed and not yet loaded) on a
+                    background thread, in the order it will load them.  The
+                    prefetch runs until the horse race finishes, so it also
+                    covers the textures registered along the way.
+    Inputs      : none
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+static void universePrefetchNeededStatics(void)
+{
+    ShipRace shiprace;
+    ShipType shiptype;
+    AsteroidType asteroidtype;
+    DustCloudType dustcloudtype;
+    NebulaType nebulatype;
+    DerelictType derelicttype;
+    char prefix[80];
+
+    for (shiprace=0;shiprace<NUM_RACES;shiprace++)
+    {
+        for (shiptype=FirstShipTypeOfRace[shiprace];shiptype<=LastShipTypeOfRace[shiprace];shiptype++)
+        {
+            if (universeStaticToLoad((StaticInfo *)GetShipStaticInfo(shiptype,shiprace)))
+            {
+                sprintf(prefix, "%s/%s", ShipRaceToStr(shiprace), ShipTypeToStr(shiptype));
+                bigPrefetchAdd(prefix);
+            }
+        }
+    }
+    for (asteroidtype=0;asteroidtype<NUM_ASTEROIDTYPES;asteroidtype++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&asteroidStaticInfos[asteroidtype]))
+        {
+            sprintf(prefix, "Resources/Asteroids/%s", AsteroidTypeToStr(asteroidtype));
+            bigPrefetchAdd(prefix);
+        }
+    }
+    for (dustcloudtype=0;dustcloudtype<NUM_DUSTCLOUDTYPES;dustcloudtype++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&dustcloudStaticInfos[dustcloudtype]))
+        {
+            sprintf(prefix, "Resources/DustClouds/%s", DustCloudTypeToStr(dustcloudtype));
+            bigPrefetchAdd(prefix);
+        }
+    }
+    for (nebulatype=0;nebulatype<NUM_NEBULATYPES;nebulatype++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&nebulaStaticInfos[nebulatype]))
+        {
+            sprintf(prefix, "Resources/Nebulae/%s", NebulaTypeToStr(nebulatype));
+            bigPrefetchAdd(prefix);
+        }
+    }
+    for (derelicttype=0;derelicttype<NUM_DERELICTTYPES;derelicttype++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&derelictStaticInfos[derelicttype]))
+        {
+            sprintf(prefix, "Derelicts/%s", DerelictTypeToStr(derelicttype));
+            bigPrefetchAdd(prefix);
+        }
+    }
+    for (shiprace=0;shiprace<NUM_RACES;shiprace++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&missileStaticInfos[shiprace]))
+        {
+            sprintf(prefix, "%s/Missile", ShipRaceToStr(shiprace));
+            bigPrefetchAdd(prefix);
+        }
+    }
+    for (shiprace=0;shiprace<2;shiprace++)
+    {
+        if (universeStaticToLoad((StaticInfo *)&mineStaticInfos[shiprace]))
+        {
+            sprintf(prefix, "%s/Mine", ShipRaceToStr(shiprace));
+            bigPrefetchAdd(prefix);
+        }
+    }
+
+    bigPrefetchStart();
+}
+
 /*-----------------------------------------------------------------------------
     Name        : universeStaticInit
     Description : Initializes static data for the Universe.  Only the ships,
@@ -3083,6 +3174,8 @@ void universeStaticInit(void)
 
 #undef TMP_DEFSHIP_PATH
 
+    universePrefetchNeededStatics();
+
     max = 0;
     for (shiprace=0;shiprace<NUM_RACES;shiprace++)
     {
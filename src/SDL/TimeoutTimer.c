@@ -100,3 +100,12 @@ void GetRawTime(sqword *time)
     *time = SDL_GetTicks();
 }
 
+void GetRawTimeHiRes(uqword *time)
+{
+    *time = SDL_GetPerformanceCounter();
+}
+
+uqword GetRawTimeHiResFrequency(void)
+{
+    return SDL_GetPerformanceFrequency();
+}
@@ -28,6 +28,8 @@ void TTimerStart(TTimer *timer,real32 timeout);
 bool TTimerIsTimedOut(TTimer *timer);
 
 void GetRawTime(sqword *time);
+void GetRawTimeHiRes(uqword *time);
+uqword GetRawTimeHiResFrequency(void);
 
 #endif
 
@@ -15,6 +15,7 @@
 #include "AIPlayer.h"
 #include "AutoLOD.h"
 #include "avi.h"
+#include "Benchmark.h"
 // #include "bink.h"
 #include "BTG.h"
 #include "Camera.h"
@@ -31,6 +32,7 @@
 #include "glinc.h"
 #include "Globals.h"
 #include "HorseRace.h"
+#include "Job.h"
 #include "Key.h"
 #include "LaunchMgr.h"
 #include "main.h"
@@ -124,6 +126,7 @@ void *ghInstance = NULL;
 extern bool CompareBigfiles;
 extern bool IgnoreBigfiles;
 extern bool LogFileLoads;
+extern bool PrefetchBigfiles;
 
 //command-line switches and parameters
 bool mainNoDrawPixels = FALSE;
@@ -411,6 +414,29 @@ bool EnableShowStatsFight(char *string)
     return TRUE;
 }
 
+bool EnableBenchmark(char *string)
+{
+    memStrncpy(benchLoadFile, string, BENCH_LOADFILE_LENGTH - 1);
+    benchEnabled = TRUE;
+    return TRUE;
+}
+
+bool BenchmarkFramesSet(char *string)
+{
+    sscanf(string, "%u", &benchFrames);
+    if (benchFrames == 0)
+    {
+        benchFrames = BENCH_DEFAULT_FRAMES;
+    }
+    return TRUE;
+}
+
+bool JobWorkersSet(char *string)
+{
+    sscanf(string, "%d", &jobNumWorkers);
+    return TRUE;
+}
+
 bool SpecifyLogFilePath(char *string)
 {
     strcpy(logFilePath,string);
@@ -654,6 +680,7 @@ commandoption commandOptions[] =
 #endif
 #endif
     entryVr("/ignoreBigfiles",      IgnoreBigfiles, TRUE,               " - don't use anything from bigfile(s)"),
+    entryVr("/noPrefetch",          PrefetchBigfiles, FALSE,            " - load level data only as it's asked for"),
 #ifdef HW_BUILD_FOR_DEBUGGING
     entryFV("/logFileLoads",        EnableFileLoadLog,LogFileLoads,TRUE," - create log of data files loaded"),
 #endif
@@ -780,6 +807,14 @@ commandoption commandOptions[] =
     entryFnParam("/showStatsFancyFight", EnableShowStatsFancyFight,     "=filename.script"),
 #endif
 
+    entryComment("BENCHMARKING"),   //-----------------------------------------------------
+    entryFnParam("/hwbench",        EnableBenchmark,                    " <savegame> - headless simulation benchmark of [savegame] (relative to the settings path), results in " BENCH_LOGFILE "."),
+    entryFnParam("/hwbenchFrames",  BenchmarkFramesSet,                 " <n> - number of universe updates to benchmark (default 4800)."),
+    entryVr("/hwbenchCheck",        benchCheckThreads, TRUE,            " - run the benchmark again with no job workers and check the universe checksums match after every update."),
+
+    entryComment("THREADING"),      //-----------------------------------------------------
+    entryFnParam("/jobWorkers",     JobWorkersSet,                      " <n> - number of job worker threads, 0 to do all work on the main thread (default one per extra CPU core)."),
+
 #ifdef HW_BUILD_FOR_DEBUGGING
     entryComment("NETWORK PLAY"),   //-----------------------------------------------------
     //entryVr("/captaincyLogOff",     captaincyLogEnable, FALSE,          " - turns off captaincy log file" ),
@@ -2167,6 +2202,11 @@ int main (int argc, char* argv[])
         MAIN_WindowDepth  = mainWindowDepth;
     }
 
+    if (benchEnabled)
+    {
+        benchPrepareHeadless();
+    }
+
     //initial game systems startup
     preInit = FALSE;
     if (errorString == NULL)
@@ -2234,7 +2274,15 @@ int main (int argc, char* argv[])
         }
     }
 
-    if (errorString == NULL)
+    if (errorString == NULL && benchEnabled)
+    {
+        preInit = FALSE;
+
+        //no event loop or task dispatch, just the simulation
+        event_res = (benchRun() == OKAY) ? 0 : ERR_ErrorStart;
+        WindowsCleanup();
+    }
+    else if (errorString == NULL)
     {
         preInit = FALSE;
 
@@ -18,9 +18,11 @@
 #include "AutoLOD.h"
 //#include "bink.h"
 #include "BTG.h"
+#include "BulletStore.h"
 #include "CameraCommand.h"
 #include "Clipper.h"
 #include "Clouds.h"
+#include "CollGrid.h"
 #include "Collision.h"
 #include "CommandNetwork.h"
 #include "Debug.h"
@@ -49,6 +51,7 @@
 #include "NetCheck.h"
 #include "NIS.h"
 #include "Objectives.h"
+#include "ParticleUpdate.h"
 #include "PiePlate.h"
 #include "prim2d.h"
 #include "prim3d.h"
@@ -238,6 +241,7 @@ extern regionhandle ghMainRegion;
 #if defined(COLLISION_CHECK_STATS) || defined(PROFILE_TIMERS)
 sdword rndDisplayCollStats = 0;
 #define RND_CollStatsKey            NUMPADSLASH
+extern BlobProperties collBlobProperties;
 #endif
 
 //polygon statistics measurements
@@ -2517,6 +2521,9 @@ void rndMainViewRenderFunction(Camera *camera)
     trailsRendered = shipTrails = 0;
     alodSetPolys(0);
 
+    //update the particles of the effects about to be drawn on the job threads
+    etgEffectsUpdateParticles(universe.RenderList.head);
+
     objnode = universe.RenderList.head;
 
     while (objnode != NULL)
@@ -3653,6 +3660,16 @@ void rndDrawOnScreenDebugInfo(void)
         y += 10;
 
         fontPrintf(0,y += 20,colRGB(255,255,0),"Channels in use:%d Guns:%d Ships:%d SFX:%d UI:%d",channelsinuse,numchans[0],numchans[1],numchans[2],numchans[3]);
+#if PUP_STATS
+        fontPrintf(0,y += 20,colRGB(255,255,0),"Particle systems:%d worldSpace:%d particles:%d waiting:%d",
+                   SDL_AtomicGet(&pupStats.numSystems), SDL_AtomicGet(&pupStats.numWorldSpace),
+                   SDL_AtomicGet(&pupStats.numParticles), SDL_AtomicGet(&pupStats.numWaiting));
+#endif
+#if ETG_EXEC_STATS
+        fontPrintf(0,y += 20,colRGB(255,255,0),"Effects:%d types:%d opcodes:%d busiest:%s (%d effects, %d opcodes)",
+                   etgExecStats.nEffects, etgExecTypes, etgExecStats.nOpcodes,
+                   etgExecBusiestName, etgExecBusiestStats.nEffects, etgExecBusiestStats.nOpcodes);
+#endif
 
     }
 #endif//RND_FRAME_RATE
@@ -3680,6 +3697,24 @@ void rndDrawOnScreenDebugInfo(void)
                        bobStats.numChecks, bobStats.trivialRejects, bobStats.initialBlobs, bobStats.finalBlobs);
         }
 #endif
+#if CGRID_STATS
+        if (COLLGRID_ENABLED)
+        {
+            fontPrintf(0,y += 20,colWhite, "CollGrid objects:%d cells:%d clusters:%d joins:%d moved:%d unchanged:%d",
+                       cgridStats.numEntries, cgridStats.numCells, cgridStats.numClusters, cgridStats.numJoins,
+                       cgridStats.numMoved, cgridStats.numUnchanged);
+        }
+#endif
+#if BST_STATS
+        fontPrintf(0,y += 20,colWhite, "BulletStore batches:%d integrated:%d sphereTests:%d sphereHits:%d",
+                   bstStats.numBatches, bstStats.numIntegrated, bstStats.numSphereTests, bstStats.numSphereHits);
+#endif
+        if (collBlobProperties.bobIncremental)
+        {
+            fontPrintf(0,y += 20,colWhite, "Blobs kept:%d split:%d dissolved:%d objectsSplit:%d pairsSkipped:%d combines:%d",
+                       bobUpdateStats.blobsKept, bobUpdateStats.blobsSplit, bobUpdateStats.blobsDissolved,
+                       bobUpdateStats.objectsSplit, bobUpdateStats.pairsSkipped, bobUpdateStats.combines);
+        }
 #if AISHIP_STATS
         aishipStatsPrint(&y);
 #endif
@@ -15,6 +15,7 @@
 #include "Twiddle.h"
 #include "prim2d.h"
 #include "File.h"
+#include "Hash.h"
 #include "Key.h"
 #include "texreg.h"
 #include "StatScript.h"
@@ -44,6 +45,8 @@ sdword trAvoidedChanges = 0;
 //actual registry:
 texreg *trTextureRegistry = NULL;
 crc32 *trNameCRCs = NULL;                              //separate list to reduce cache misses during searches.
+static hashtable *trNameTable = NULL;                  //name CRC -> registry index + 1
+static sdword trNameCollisions = 0;                    //names not in trNameTable because their CRC was taken (or 0)
 sdword trLowestFree = 0;                        //indices of extremes free texture indices
 sdword trHighestAllocated = -1;
 
@@ -202,6 +205,12 @@ void trReset(void)
     bNewList = FALSE;
     trCurrentHandle = TR_Invalid;
     memClearDword(trNameCRCs, 0, TR_RegistrySize);           //clear all CRC's to 0
+    if (trNameTable != NULL)
+    {
+        hashDeleteTable(trNameTable);
+    }
+    trNameTable = hashNewTable(TR_RegistrySize / 4);
+    trNameCollisions = 0;
 }
 
 /*-----------------------------------------------------------------------------
@@ -221,6 +230,8 @@ void trShutdown(void)
     trTextureRegistry = NULL;
     memFree(trNameCRCs);
     trNameCRCs = NULL;
+    hashDeleteTable(trNameTable);
+    trNameTable = NULL;
 
     bNewList = TRUE;
 
@@ -397,6 +408,10 @@ sdword trTextureDelete(trhandle handle)
     }
 
     //delete the name string
+    if (hashLookup(trNameTable, trNameCRCs[trIndex(handle)]) == (void *)(memsize)(trIndex(handle) + 1))
+    {                                                       //if it's this texture that's indexed by the name CRC
+        hashRemove(trNameTable, trNameCRCs[trIndex(handle)]);
+    }
     memFree(reg->fileName);                                 //free the name of the texture
     trNameCRCs[trIndex(handle)] = 0;                        //clear this CRC to blank
     reg->flags = 0;
@@ -572,25 +587,35 @@ sdword trColorsIndexAlloc(trcolorinfo *info, sdword textureIndex)
 }
 
 /*-----------------------------------------------------------------------------
-    Name        : trFindTextureIndexByName
-    Description : Find the handle for a given texture name, if it has been registered.
+    Name        : trNameIndexFind
+    Description : Find the registry index of a texture name.  Names are looked
+                    up by CRC in trNameTable; the registry is only searched
+                    if a name has ever been left out of the table because
+                    another texture had its CRC.
     Inputs      : fileName - name of texture to find.
+                  nameCRC - CRC of fileName
     Outputs     :
-    Return      :
+    Return      : index of texture or TR_NotShared if not registered
 ----------------------------------------------------------------------------*/
-sdword trFindTextureIndexByName(char *fileName)
+static sdword trNameIndexFind(char *fileName, crc32 nameCRC)
 {
     sdword index;
-    sdword length;
-    crc32 nameCRC, *regCRC;
+    crc32 *regCRC;
     texreg *reg;
 
-    //strupr(fileName);                                       //!!! is this going to screw anything up?
-    /* Yes, yes it is... */
-    length = strlen(fileName);
-    dbgAssertOrIgnore(length > 0);
-
-    nameCRC = crc32Compute((ubyte*)fileName, length);               //compute a name for the CRC
+    if (nameCRC != 0)
+    {
+        index = (sdword)(memsize)hashLookup(trNameTable, nameCRC) - 1;
+        if (index >= 0 && !strcmp(trTextureRegistry[index].fileName, fileName))
+        {
+            dbgAssertOrIgnore(trAllocated(index));
+            return(index);
+        }
+    }
+    if (trNameCollisions == 0)
+    {
+        return(TR_NotShared);
+    }
 
     reg = &trTextureRegistry[trHighestAllocated];
     regCRC = &trNameCRCs[trHighestAllocated];
@@ -611,6 +636,25 @@ sdword trFindTextureIndexByName(char *fileName)
     return(TR_NotShared);                                   //no index found; error
 }
 
+/*-----------------------------------------------------------------------------
+    Name        : trFindTextureIndexByName
+    Description : Find the handle for a given texture name, if it has been registered.
+    Inputs      : fileName - name of texture to find.
+    Outputs     :
+    Return      :
+----------------------------------------------------------------------------*/
+sdword trFindTextureIndexByName(char *fileName)
+{
+    sdword length;
+
+    //strupr(fileName);                                       //!!! is this going to screw anything up?
+    /* Yes, yes it is... */
+    length = strlen(fileName);
+    dbgAssertOrIgnore(length > 0);
+
+    return(trNameIndexFind(fileName, crc32Compute((ubyte*)fileName, length)));
+}
+
 /*-----------------------------------------------------------------------------
     Name        : trTextureRegister
     Description : Register a texture for later loading
@@ -625,7 +669,7 @@ sdword trFindTextureIndexByName(char *fileName)
 trhandle trTextureRegister(char *fileName, trcolorinfo *info, void *meshReference)
 {
     sdword index, paletteIndex, length;
-    crc32 nameCRC, *regCRC;
+    crc32 nameCRC;
     texreg *reg;
 
     //strupr(fileName);                                       //!!! is this going to screw anything up?
@@ -648,48 +692,38 @@ trhandle trTextureRegister(char *fileName, trcolorinfo *info, void *meshReferenc
     }
 
     nameCRC = crc32Compute((ubyte*)fileName, length);               //compute a name for the CRC
-    reg = &trTextureRegistry[trHighestAllocated];
-    regCRC = &trNameCRCs[trHighestAllocated];
 
-    for (index = trHighestAllocated; index >= 0 ; index--, reg--, regCRC--)
-    {                                                       //for all registry entries
-        if (*regCRC == nameCRC)
-        {                                                   //if names have matching CRC's
-            if (!trAllocated(index))
-            {                                               //if not allocated
-                continue;                                   //skip it
-            }
-            if (!strcmp(reg->fileName, fileName))
-            {                                               //and they match names
-                if ((paletteIndex = trColorsEqual(info, index)) >= 0)
-                {                                           //and they're the same color
-                    //... use this texture
-                    dbgAssertOrIgnore(reg->nUsageCount < SDWORD_Max);
-                    reg->nUsageCount++; //update usage count
+    index = trNameIndexFind(fileName, nameCRC);
+    if (index != (sdword)TR_NotShared)
+    {                                                       //if this name is already registered
+        reg = &trTextureRegistry[index];
+        if ((paletteIndex = trColorsEqual(info, index)) >= 0)
+        {                                                   //and they're the same color
+            //... use this texture
+            dbgAssertOrIgnore(reg->nUsageCount < SDWORD_Max);
+            reg->nUsageCount++; //update usage count
 #if TR_VERBOSE_LEVEL >= 2
-                    dbgMessagef("trTextureRegister: texture handle 0x%x nUsageCount incremented to %d", index, reg->nUsageCount);
+            dbgMessagef("trTextureRegister: texture handle 0x%x nUsageCount incremented to %d", index, reg->nUsageCount);
 #endif  //TR_VERBOSE_LEVEL
-                    return(trHandleMake(index, paletteIndex));//and use this texture
-                }
-                else
-                {                                           //colors do not match
-                    //!!! create a new paletted copy
-                    //... if it is a pending texture
-                    dbgAssertOrIgnore(reg->nUsageCount < SDWORD_Max);
-                    reg->nUsageCount++; //update usage count
+            return(trHandleMake(index, paletteIndex));//and use this texture
+        }
+        else
+        {                                                   //colors do not match
+            //!!! create a new paletted copy
+            //... if it is a pending texture
+            dbgAssertOrIgnore(reg->nUsageCount < SDWORD_Max);
+            reg->nUsageCount++; //update usage count
 #if TR_VERBOSE_LEVEL >= 2
-                    dbgMessagef("trTextureRegister: texture handle 0x%x nUsageCount incremented to %d", index, reg->nUsageCount);
+            dbgMessagef("trTextureRegister: texture handle 0x%x nUsageCount incremented to %d", index, reg->nUsageCount);
 #endif  //TR_VERBOSE_LEVEL
-                    /*
-                    ((trcolorinfo *)reg->palettes)
-                        [reg->nPalettes] = *info;//retain reference to the color info
-                    reg->nPalettes++;//update palette index
-                    dbgAssertOrIgnore(reg->nPalettes <= TR_NumPalettesPerTexture);
-                    */
-                    paletteIndex = trColorsIndexAlloc(info, index);
-                    return(trHandleMake(index, paletteIndex));
-                }
-            }
+            /*
+            ((trcolorinfo *)reg->palettes)
+                [reg->nPalettes] = *info;//retain reference to the color info
+            reg->nPalettes++;//update palette index
+            dbgAssertOrIgnore(reg->nPalettes <= TR_NumPalettesPerTexture);
+            */
+            paletteIndex = trColorsIndexAlloc(info, index);
+            return(trHandleMake(index, paletteIndex));
         }
     }
 
@@ -720,6 +754,14 @@ trhandle trTextureRegister(char *fileName, trcolorinfo *info, void *meshReferenc
             trTextureRegistry[index].meshReference = meshReference;//texture's parent mesh
 			trTextureRegistry[index].nUsageCount = 1;       //one usage of this texture
             trNameCRCs[index] = nameCRC;                    //save the name CRC
+            if (nameCRC == 0 || hashLookup(trNameTable, nameCRC) != NULL)
+            {                                               //CRC can't be indexed, fall back to searching
+                trNameCollisions++;
+            }
+            else
+            {
+                hashInsert(trNameTable, nameCRC, (void *)(memsize)(index + 1));
+            }
 			trTextureRegistry[index].fileName = memAlloc(length + 1, "NameTex", NonVolatile);
             strcpy(trTextureRegistry[index].fileName, fileName);
             trTextureRegistry[index].nPalettes = 1;         //one palette to start
@@ -45,8 +45,10 @@
 #include "Globals.h"
 #include "Gun.h"
 #include "HorseRace.h"
+#include "Hash.h"
 #include "HS.h"
 #include "InfoOverlay.h"
+#include "Job.h"
 #include "Key.h"
 #include "KeyBindings.h"
 #include "LaunchMgr.h"
@@ -62,11 +64,13 @@
 #include "NIS.h"
 #include "Options.h"
 #include "Particle.h"
+#include "ParticleUpdate.h"
 #include "PiePlate.h"
 #include "Ping.h"
 #include "PlugScreen.h"
 #include "prim3d.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "regkey.h"
 #include "render.h"
 #include "ResearchAPI.h"
@@ -3961,6 +3965,18 @@ char *utyGameSystemsInit(void)
                                                             //start the task manager
     taskStartup((udword)(1000 / utyTimerDivisor));
     utySet(SSA_Task);
+                                                            //start the job worker threads
+    jobStartup(jobNumWorkers);
+    utySet(SS2_Jobs);
+#if HASH_TEST
+    hashTest();
+#endif
+#if REF_TEST
+    refTest();
+#endif
+#if PUP_TEST
+    pupTest();
+#endif
 
 #if MEM_STATISTICS
     if (memStatsTaskHandle == 0xffffffff)
@@ -4354,6 +4370,9 @@ char* utyGameSystemsPreShutdown(void)
 ----------------------------------------------------------------------------*/
 char *utyGameSystemsShutdown(void)
 {
+    // finish writing any background autosave
+    SaveGameSnapshotPoll(TRUE);
+
     // close the autorun lock file
     if(utyLockFilehandle != 0) fileClose(utyLockFilehandle);
 
@@ -4647,6 +4666,11 @@ char *utyGameSystemsShutdown(void)
         ferShutdown();
 #endif
     }
+    if (utyTest(SS2_Jobs))
+    {
+        jobShutdown();
+        utyClear(SS2_Jobs);
+    }
     if (utyTest(SSA_Task))
     {
         taskShutdown();
@@ -93,6 +93,7 @@ typedef enum
     SS2_Tutorial,
     SS2_ToggleKeys,
     SS2_SoundEngine,
+    SS2_Jobs,
 
     SS2_SystemStarted,
 
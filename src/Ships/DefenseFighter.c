@@ -14,6 +14,7 @@
 #include "glinc.h"
 #include "Memory.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "SaveGame.h"
 #include "SoundEvent.h"
 #include "StatScript.h"
@@ -133,7 +134,7 @@ void defensefightertargetbullet(Ship *ship, Bullet *bullettotarget)
 
     bitSet(bullettotarget->SpecialEffectFlag, 0x0002);   //set the flag
 
-    laser = memAlloc(sizeof(Bullet),"Bullet",0);
+    laser = memSlabAlloc(MSP_Bullet, sizeof(Bullet), "Bullet");
     memset(laser,0,sizeof(Bullet));      // for safety
 
     laser->objtype = OBJ_BulletType;
@@ -148,6 +149,7 @@ void defensefightertargetbullet(Ship *ship, Bullet *bullettotarget)
     laser->owner = ship;
     laser->gunowner = gun;
     laser->target = NULL;
+    refSet((SpaceObj *)laser, REF_Owner, (SpaceObj *)laser->owner);
 
     laser->bulletColor = etgBulletColor[shipstatic->shiprace][laser->soundType];
 
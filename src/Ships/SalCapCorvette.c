@@ -29,6 +29,7 @@
 #include "Ping.h"
 #include "prim3d.h"
 #include "Randy.h"
+#include "RefIndex.h"
 #include "SaveGame.h"
 #include "Select.h"
 #include "SinglePlayer.h"
@@ -2070,6 +2071,7 @@ reachedit:
                 ((Ship *)spec->target)->gettingrocked = ship;
 
                 ((Ship *)spec->target)->recentAttacker = ship;
+                refSet((SpaceObj *)spec->target, REF_RecentAttacker, (SpaceObj *)ship);
                 ((Ship *)spec->target)->recentlyAttacked = RECENT_ATTACK_DURATION;  // start counting down
             }
 
@@ -2092,6 +2094,7 @@ reachedit:
             ((Ship *)spec->target)->gettingrocked = ship;
 
             ((Ship *)spec->target)->recentAttacker = ship;
+            refSet((SpaceObj *)spec->target, REF_RecentAttacker, (SpaceObj *)ship);
             ((Ship *)spec->target)->recentlyAttacked = RECENT_ATTACK_DURATION;  // start counting down
         }
 
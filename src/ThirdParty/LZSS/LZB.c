@@ -0,0 +1,285 @@
+//
+//  LZB Compression Module
+//
+//  A byte oriented LZ77 block codec for data that has to decode quickly
+//  (saved games, bigfile entries).  The block layout is LZ4's, so it decodes
+//  with plain byte copies instead of LZSS's bit at a time BitIO reads.
+//
+//  Each sequence is:
+//      token           high nibble literal count, low nibble match length - 4;
+//                      15 in either means more length bytes follow, each
+//                      added on, until one that isn't 255
+//      literals
+//      offset          2 bytes little endian, 1..65535 back from the output
+//      match length    extra bytes, if the low nibble was 15
+//  The last sequence of a block has literals only and ends the input.
+//
+
+#include <string.h>
+#include "LZB.h"
+
+#define MIN_MATCH           4               // shortest match encoded
+#define HASH_BITS           12              // match finder table size
+#define HASH_SIZE           (1 << HASH_BITS)
+#define MAX_OFFSET          65535
+#define LAST_LITERALS       5               // the block always ends with this many literals
+#define MF_LIMIT            12              // no match starts this close to the end
+#define SKIP_TRIGGER        6               // step faster through data that doesn't match
+#define WILD_COPY           8               // decoder copies this many bytes at a time
+
+static unsigned int Read32(const unsigned char *p)
+{
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned int Hash32(unsigned int sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/*
+ * Writes a run length that didn't fit in its token nibble.
+ */
+static unsigned char *OutputLength(unsigned char *op, int length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+/*
+ * Writes one sequence: literals [anchor, anchor + literals) followed by a
+ * match of matchLength at offset, or no match if matchLength is 0.  Returns
+ * NULL if it would overflow the output.
+ */
+static unsigned char *OutputSequence(unsigned char *op, unsigned char *oend,
+                                     const unsigned char *anchor, int literals,
+                                     int offset, int matchLength)
+{
+    unsigned char *token;
+    int matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+
+    // token, literals and their length bytes, offset, match length bytes
+    if (oend - op < 1 + literals + literals / 255 + 1 + 2 + matchCode / 255 + 1)
+    {
+        return NULL;
+    }
+    token = op++;
+
+    if (literals >= 15)
+    {
+        *token = 15 << 4;
+        op = OutputLength(op, literals - 15);
+    }
+    else
+    {
+        *token = (unsigned char)(literals << 4);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    if (matchLength)
+    {
+        *op++ = (unsigned char)(offset & 0xff);
+        *op++ = (unsigned char)(offset >> 8);
+        if (matchCode >= 15)
+        {
+            *token |= 15;
+            op = OutputLength(op, matchCode - 15);
+        }
+        else
+        {
+            *token |= (unsigned char)matchCode;
+        }
+    }
+    return op;
+}
+
+int lzbCompressBuffer(char *input, int inputSize, char *output, int outputSize)
+{
+    const unsigned char *base = (const unsigned char *)input;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *iend = base + inputSize;
+    const unsigned char *mflimit = iend - MF_LIMIT;
+    const unsigned char *matchlimit = iend - LAST_LITERALS;
+    unsigned char *op = (unsigned char *)output;
+    unsigned char *oend = op + outputSize;
+    int table[HASH_SIZE];                   // last position seen for each hash, on the stack for thread safety
+
+    if (inputSize > MF_LIMIT)
+    {
+        memset(table, 0xff, sizeof(table));
+
+        while (ip < mflimit)
+        {
+            unsigned int sequence = Read32(ip);
+            unsigned int hash = Hash32(sequence);
+            int position = (int)(ip - base);
+            int candidate = table[hash];
+            const unsigned char *match;
+            int matchLength;
+
+            table[hash] = position;
+            if (candidate < 0 || position - candidate > MAX_OFFSET || Read32(base + candidate) != sequence)
+            {
+                ip += 1 + ((ip - anchor) >> SKIP_TRIGGER);
+                continue;
+            }
+
+            match = base + candidate;
+            while (ip > anchor && match > base && ip[-1] == match[-1])
+            {                               // extend backwards over the literals
+                ip--;
+                match--;
+            }
+
+            matchLength = MIN_MATCH;
+            while (ip + matchLength < matchlimit && ip[matchLength] == match[matchLength])
+            {
+                matchLength++;
+            }
+
+            op = OutputSequence(op, oend, anchor, (int)(ip - anchor), (int)(ip - match), matchLength);
+            if (op == NULL)
+            {
+                return 0;
+            }
+
+            ip += matchLength;
+            anchor = ip;
+            if (ip < mflimit)
+            {                               // catch a run starting inside the match
+                table[Hash32(Read32(ip - 2))] = (int)(ip - 2 - base);
+            }
+        }
+    }
+
+    op = OutputSequence(op, oend, anchor, (int)(iend - anchor), 0, 0);
+    if (op == NULL)
+    {
+        return 0;
+    }
+    return (int)(op - (unsigned char *)output);
+}
+
+/*
+ * Reads a run length that didn't fit in its token nibble.  Returns -1 if the
+ * input runs out.
+ */
+static int InputLength(const unsigned char **ipp, const unsigned char *iend, int length)
+{
+    const unsigned char *ip = *ipp;
+    unsigned int s;
+
+    do
+    {
+        if (ip >= iend)
+        {
+            return -1;
+        }
+        s = *ip++;
+        length += s;
+    } while (s == 255 && length < 0x40000000);
+
+    *ipp = ip;
+    return length;
+}
+
+int lzbExpandBuffer(char *input, int inputSize, char *output, int outputSize)
+{
+    const unsigned char *ip = (const unsigned char *)input;
+    const unsigned char *iend = ip + inputSize;
+    unsigned char *op = (unsigned char *)output;
+    unsigned char *oend = op + outputSize;
+
+    for (;;)
+    {
+        unsigned int token;
+        int length;
+        int offset;
+        const unsigned char *match;
+
+        if (ip >= iend)
+        {
+            return -1;
+        }
+        token = *ip++;
+
+        // literals
+        length = token >> 4;
+        if (length == 15 && (length = InputLength(&ip, iend, length)) < 0)
+        {
+            return -1;
+        }
+        if (length > iend - ip || length > oend - op)
+        {
+            return -1;
+        }
+        if (length <= 16 && iend - ip >= 16 && oend - op >= 16)
+        {
+            memcpy(op, ip, 16);             // short run, one fixed size copy
+        }
+        else
+        {
+            memcpy(op, ip, length);
+        }
+        op += length;
+        ip += length;
+
+        if (ip == iend)
+        {
+            break;                          // last sequence has no match
+        }
+
+        // match
+        if (iend - ip < 2)
+        {
+            return -1;
+        }
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - (unsigned char *)output)
+        {
+            return -1;
+        }
+        length = token & 15;
+        if (length == 15 && (length = InputLength(&ip, iend, length)) < 0)
+        {
+            return -1;
+        }
+        length += MIN_MATCH;
+        if (length > oend - op)
+        {
+            return -1;
+        }
+
+        match = op - offset;
+        if (offset >= WILD_COPY && oend - op >= length + WILD_COPY)
+        {                                   // whole words, may write up to WILD_COPY - 1 past the match
+            unsigned char *end = op + length;
+            do
+            {
+                memcpy(op, match, WILD_COPY);
+                op += WILD_COPY;
+                match += WILD_COPY;
+            } while (op < end);
+            op = end;
+        }
+        else
+        {                                   // overlapping run or close to the end
+            while (length-- > 0)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return (int)(op - (unsigned char *)output);
+}
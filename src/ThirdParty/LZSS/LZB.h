@@ -0,0 +1,25 @@
+// =============================================================================
+//  LZB.h
+//  - byte oriented LZ77 block codec, for data that must decode quickly
+// =============================================================================
+//  Blocks use the LZ4 block layout: a token byte holding a literal count and
+//  a match length, the literals, then a 16 bit little endian match offset.
+//  Unlike LZSS there is no bit stream, so decoding is a loop of memcpys.
+// =============================================================================
+
+#ifndef ___LZB_H
+#define ___LZB_H
+
+// largest compressed size of inputSize bytes
+#define lzbCompressBound(inputSize)     ((inputSize) + (inputSize) / 255 + 16)
+
+// compress input into output; returns the compressed size, or 0 if it did
+// not fit in outputSize bytes.  Thread safe.
+int lzbCompressBuffer(char *input, int inputSize, char *output, int outputSize);
+
+// expand input into output; returns the expanded size, or -1 if input is
+// corrupt or does not fit in outputSize bytes.  Never reads or writes outside
+// the buffers it is given.  Thread safe.
+int lzbExpandBuffer(char *input, int inputSize, char *output, int outputSize);
+
+#endif
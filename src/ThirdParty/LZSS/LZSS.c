@@ -55,28 +55,36 @@ char *CompressionName = "LZSS Encoder";
 char *Usage           = "in-file out-file\n\n";
 
 /*
- * These are the two global data structures used in this program.
- * The window[] array is exactly that, the window of previously seen
- * text, as well as the current look ahead text.  The tree[] structure
- * contains the binary tree of all of the strings in the window sorted
- * in order.
+ * These are the two data structures used by the encoder.  The window[]
+ * array is exactly that, the window of previously seen text, as well as
+ * the current look ahead text.  The lz->tree[] structure contains the binary
+ * tree of all of the strings in the window sorted in order.
+ *
+ * They used to be globals; they now live in a per-call state block so
+ * that several files can be compressed at once (see bigFastCreate) and
+ * so that the output for a given input never depends on whatever the
+ * previous call left lying around in the window.  The decoders only
+ * need a window and keep it on the stack.
 */
 
-unsigned char window[ WINDOW_SIZE ];
-
 struct tree_s {
     int parent;
     int smaller_child;
     int larger_child;
-} tree[ WINDOW_SIZE + 1 ];
+};
+
+typedef struct lzssState {
+    unsigned char window[ WINDOW_SIZE ];
+    struct tree_s tree[ WINDOW_SIZE + 1 ];
+} lzssState;
 
 // local prototypes
-static void InitTree( int r );
-static void ContractNode( int old_node, int new_node );
-static void ReplaceNode( int old_node, int new_node );
-static int FindNextNode( int node );
-static void DeleteString( int p );
-static int AddString( int new_node, int *match_position );
+static void InitTree( lzssState *lz, int r );
+static void ContractNode( lzssState *lz, int old_node, int new_node );
+static void ReplaceNode( lzssState *lz, int old_node, int new_node );
+static int FindNextNode( lzssState *lz, int node );
+static void DeleteString( lzssState *lz, int p );
+static int AddString( lzssState *lz, int new_node, int *match_position );
 
 /*
  * Since the tree is static data, it comes up with every node
@@ -84,14 +92,15 @@ static int AddString( int new_node, int *match_position );
  * However, to make the tree really usable, a single phrase has to be
  * added to the tree so it has a root node.  That is done right here.
 */
-static void InitTree( r )
+static void InitTree( lz, r )
+lzssState *lz;
 int r;
 {
-	memset((void*)&tree, 0, sizeof(struct tree_s) * WINDOW_SIZE + 1);
-    tree[ TREE_ROOT ].larger_child = r;
-    tree[ r ].parent = TREE_ROOT;
-    tree[ r ].larger_child = UNUSED;
-    tree[ r ].smaller_child = UNUSED;
+	memset((void*)lz->tree, 0, sizeof(struct tree_s) * WINDOW_SIZE + 1);
+    lz->tree[ TREE_ROOT ].larger_child = r;
+    lz->tree[ r ].parent = TREE_ROOT;
+    lz->tree[ r ].larger_child = UNUSED;
+    lz->tree[ r ].smaller_child = UNUSED;
 }
 
 /*
@@ -99,16 +108,17 @@ int r;
  * its descendant is broken by pulling the descendant in to overlay
  * the existing link.
  */
-static void ContractNode( old_node, new_node )
+static void ContractNode( lz, old_node, new_node )
+lzssState *lz;
 int old_node;
 int new_node;
 {
-    tree[ new_node ].parent = tree[ old_node ].parent;
-    if ( tree[ tree[ old_node ].parent ].larger_child == old_node )
-        tree[ tree[ old_node ].parent ].larger_child = new_node;
+    lz->tree[ new_node ].parent = lz->tree[ old_node ].parent;
+    if ( lz->tree[ lz->tree[ old_node ].parent ].larger_child == old_node )
+        lz->tree[ lz->tree[ old_node ].parent ].larger_child = new_node;
     else
-        tree[ tree[ old_node ].parent ].smaller_child = new_node;
-    tree[ old_node ].parent = UNUSED;
+        lz->tree[ lz->tree[ old_node ].parent ].smaller_child = new_node;
+    lz->tree[ old_node ].parent = UNUSED;
 }
 
 /*
@@ -116,21 +126,22 @@ int new_node;
  * in this case, it is being replaced by a node that was not previously
  * in the tree.
  */
-static void ReplaceNode( old_node, new_node )
+static void ReplaceNode( lz, old_node, new_node )
+lzssState *lz;
 int old_node;
 int new_node;
 {
     int parent;
 
-    parent = tree[ old_node ].parent;
-    if ( tree[ parent ].smaller_child == old_node )
-        tree[ parent ].smaller_child = new_node;
+    parent = lz->tree[ old_node ].parent;
+    if ( lz->tree[ parent ].smaller_child == old_node )
+        lz->tree[ parent ].smaller_child = new_node;
     else
-        tree[ parent ].larger_child = new_node;
-    tree[ new_node ] = tree[ old_node ];
-    tree[ tree[ new_node ].smaller_child ].parent = new_node;
-    tree[ tree[ new_node ].larger_child ].parent = new_node;
-    tree[ old_node ].parent = UNUSED;
+        lz->tree[ parent ].larger_child = new_node;
+    lz->tree[ new_node ] = lz->tree[ old_node ];
+    lz->tree[ lz->tree[ new_node ].smaller_child ].parent = new_node;
+    lz->tree[ lz->tree[ new_node ].larger_child ].parent = new_node;
+    lz->tree[ old_node ].parent = UNUSED;
 }
 
 /*
@@ -139,14 +150,15 @@ int new_node;
  * the next smallest child by going to the smaller_child node, then
  * going to the end of the larger_child descendant chain.
 */
-static int FindNextNode( node )
+static int FindNextNode( lz, node )
+lzssState *lz;
 int node;
 {
     int next;
 
-    next = tree[ node ].smaller_child;
-    while ( tree[ next ].larger_child != UNUSED )
-        next = tree[ next ].larger_child;
+    next = lz->tree[ node ].smaller_child;
+    while ( lz->tree[ next ].larger_child != UNUSED )
+        next = lz->tree[ next ].larger_child;
     return( next );
 }
 
@@ -158,21 +170,22 @@ int node;
  * is guaranteed to have a null link, then replace the node to be deleted
  * with the next link.
  */
-static void DeleteString( p )
+static void DeleteString( lz, p )
+lzssState *lz;
 int p;
 {
     int  replacement;
 
-    if ( tree[ p ].parent == UNUSED )
+    if ( lz->tree[ p ].parent == UNUSED )
         return;
-    if ( tree[ p ].larger_child == UNUSED )
-        ContractNode( p, tree[ p ].smaller_child );
-    else if ( tree[ p ].smaller_child == UNUSED )
-        ContractNode( p, tree[ p ].larger_child );
+    if ( lz->tree[ p ].larger_child == UNUSED )
+        ContractNode( lz, p, lz->tree[ p ].smaller_child );
+    else if ( lz->tree[ p ].smaller_child == UNUSED )
+        ContractNode( lz, p, lz->tree[ p ].larger_child );
     else {
-        replacement = FindNextNode( p );
-        DeleteString( replacement );
-        ReplaceNode( p, replacement );
+        replacement = FindNextNode( lz, p );
+        DeleteString( lz, replacement );
+        ReplaceNode( lz, p, replacement );
     }
 }
 
@@ -185,7 +198,8 @@ int p;
  * the old_node is deleted, for reasons of efficiency.
  */
 
-static int AddString( new_node, match_position )
+static int AddString( lz, new_node, match_position )
+lzssState *lz;
 int new_node;
 int *match_position;
 {
@@ -197,12 +211,12 @@ int *match_position;
 
     if ( new_node == END_OF_STREAM )
         return( 0 );
-    test_node = tree[ TREE_ROOT ].larger_child;
+    test_node = lz->tree[ TREE_ROOT ].larger_child;
     match_length = 0;
     for ( ; ; ) {
         for ( i = 0 ; i < LOOK_AHEAD_SIZE ; i++ ) {
-            delta = window[ MOD_WINDOW( new_node + i ) ] -
-                    window[ MOD_WINDOW( test_node + i ) ];
+            delta = lz->window[ MOD_WINDOW( new_node + i ) ] -
+                    lz->window[ MOD_WINDOW( test_node + i ) ];
             if ( delta != 0 )
                 break;
         }
@@ -210,19 +224,19 @@ int *match_position;
             match_length = i;
             *match_position = test_node;
             if ( match_length >= LOOK_AHEAD_SIZE ) {
-                ReplaceNode( test_node, new_node );
+                ReplaceNode( lz, test_node, new_node );
                 return( match_length );
             }
         }
         if ( delta >= 0 )
-            child = &tree[ test_node ].larger_child;
+            child = &lz->tree[ test_node ].larger_child;
         else
-            child = &tree[ test_node ].smaller_child;
+            child = &lz->tree[ test_node ].smaller_child;
         if ( *child == UNUSED ) {
             *child = new_node;
-            tree[ new_node ].parent = test_node;
-            tree[ new_node ].larger_child = UNUSED;
-            tree[ new_node ].smaller_child = UNUSED;
+            lz->tree[ new_node ].parent = test_node;
+            lz->tree[ new_node ].larger_child = UNUSED;
+            lz->tree[ new_node ].smaller_child = UNUSED;
             return( match_length );
         }
         test_node = *child;
@@ -250,15 +264,20 @@ BitFile *output;
     int replace_count;
     int match_length;
     int match_position;
+    lzssState *lz;
+
+    lz = (lzssState *) calloc( 1, sizeof( lzssState ) );
+    if ( lz == NULL )
+        return;
 
     current_position = 1;
     for ( i = 0 ; i < LOOK_AHEAD_SIZE ; i++ ) {
         if ( ( c = getc( input ) ) == EOF )
             break;
-        window[ current_position + i ] = (unsigned char) c;
+        lz->window[ current_position + i ] = (unsigned char) c;
     }
     look_ahead_bytes = i;
-    InitTree( current_position );
+    InitTree( lz, current_position );
     match_length = 0;
     match_position = 0;
     while ( look_ahead_bytes > 0 ) {
@@ -268,7 +287,7 @@ BitFile *output;
             replace_count = 1;
             bitioFileOutputBit( output, 1 );
             bitioFileOutputBits( output,
-                        (unsigned long) window[ current_position ], 8 );
+                        (unsigned long) lz->window[ current_position ], 8 );
         } else {
             bitioFileOutputBit( output, 0 );
             bitioFileOutputBits( output,
@@ -279,19 +298,20 @@ BitFile *output;
             replace_count = match_length;
         }
         for ( i = 0 ; i < replace_count ; i++ ) {
-            DeleteString( MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) );
+            DeleteString( lz, MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) );
             if ( ( c = getc( input ) ) == EOF )
                 look_ahead_bytes--;
             else
-                window[ MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) ]
+                lz->window[ MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) ]
                         = (unsigned char) c;
             current_position = MOD_WINDOW( current_position + 1 );
             if ( look_ahead_bytes )
-                match_length = AddString( current_position, &match_position );
+                match_length = AddString( lz, current_position, &match_position );
         }
     };
     bitioFileOutputBit( output, 0 );
     bitioFileOutputBits( output, (unsigned long) END_OF_STREAM, INDEX_BIT_COUNT );
+    free( lz );
 }
 
 //
@@ -308,6 +328,7 @@ FILE *output;
     int c;
     int match_length;
     int match_position;
+    unsigned char window[ WINDOW_SIZE ];
 
     current_position = 1;
     for ( ; ; ) {
@@ -359,6 +380,11 @@ int lzssCompressBuffer(char *input, int inputSize, char *output, int outputSize)
     int match_position;
     BitBuffer *outBuffer;
     char *inBuffer = input;
+    lzssState *lz;
+
+    lz = (lzssState *)calloc(1, sizeof(lzssState));
+    if (lz == NULL)
+        return -1;
 
     outBuffer = bitioBufferOpen(output);
 
@@ -369,10 +395,10 @@ int lzssCompressBuffer(char *input, int inputSize, char *output, int outputSize)
             break;
         else
             c = *(inBuffer++);
-        window[ current_position + i ] = (unsigned char) c;
+        lz->window[ current_position + i ] = (unsigned char) c;
     }
     look_ahead_bytes = i;
-    InitTree( current_position );
+    InitTree( lz, current_position );
     match_length = 0;
     match_position = 0;
     while ( look_ahead_bytes > 0 )
@@ -383,7 +409,7 @@ int lzssCompressBuffer(char *input, int inputSize, char *output, int outputSize)
         {
             replace_count = 1;
             bitioBufferOutputBit(outBuffer, 1 );
-            bitioBufferOutputBits(outBuffer, (unsigned long)window[current_position], 8);
+            bitioBufferOutputBits(outBuffer, (unsigned long)lz->window[current_position], 8);
         }
         else 
         {
@@ -394,22 +420,23 @@ int lzssCompressBuffer(char *input, int inputSize, char *output, int outputSize)
         }
         for ( i = 0 ; i < replace_count ; i++ )
         {
-            DeleteString( MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) );
+            DeleteString( lz, MOD_WINDOW( current_position + LOOK_AHEAD_SIZE ) );
             if (inBuffer >= input+inputSize)
                 look_ahead_bytes--;
             else
             {
                 c = *(inBuffer++);
-                window[MOD_WINDOW(current_position + LOOK_AHEAD_SIZE)] = (unsigned char)c;
+                lz->window[MOD_WINDOW(current_position + LOOK_AHEAD_SIZE)] = (unsigned char)c;
             }
             current_position = MOD_WINDOW( current_position + 1 );
             if ( look_ahead_bytes )
-                match_length = AddString( current_position, &match_position );
+                match_length = AddString( lz, current_position, &match_position );
         }
     };
 
     bitioBufferOutputBit(outBuffer, 0 );
     bitioBufferOutputBits(outBuffer, (unsigned long) END_OF_STREAM, INDEX_BIT_COUNT );
+    free(lz);
     return bitioBufferCloseOutput(outBuffer);
 }
 
@@ -434,6 +461,7 @@ int lzssExpandBuffer(char *input, int inputSize, char *output, int outputSize)
     int c;
     int match_length;
     int match_position;
+    unsigned char window[ WINDOW_SIZE ];
     BitBuffer *inBuffer;
     char *outBuffer = output;
  
@@ -481,6 +509,7 @@ int lzssExpandFileToBuffer(BitFile *input, char *output, int outputSize)
     int c;
     int match_length;
     int match_position;
+    unsigned char window[ WINDOW_SIZE ];
     char *outBuffer = output;
  
     current_position = 1;
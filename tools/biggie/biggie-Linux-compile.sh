@@ -1,5 +1,5 @@
 #!/bin/sh
-cc -o biggie -Wall -O2 -D_LINUX_FIX_ME -I../../src/ThirdParty/CRC \
+cc -o biggie -Wall -O2 -pthread -D_LINUX_FIX_ME -I../../src/ThirdParty/CRC \
         -I../../src/SDL \
 	-I../../src/ThirdParty/LZSS `sdl-config --cflags` \
 	main.c options.c ../../src/Game/BigFile.c \
@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# Fast-creates a bigfile from the same files with biggie -j1 and -j<n> and
+# checks the two come out identical byte for byte.
+#
+# usage: biggie-check-threads.sh [-j<n>] [biggie options] <files...>
+#
+#   -j<n>  threads for the second bigfile (default: 4)
+#
+# Other options (-c, -p) are passed to both runs.  Files are never moved
+# (-m0), since both runs need them.  Set BIGGIE to use a biggie other than
+# ./biggie.
+#
+
+BIGGIE=${BIGGIE:-./biggie}
+THREADS=4
+OPTIONS=
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-j*) THREADS=${1#-j} ;;
+		-*)  OPTIONS="$OPTIONS $1" ;;
+		*)   break ;;
+	esac
+	shift
+done
+
+if [ $# -eq 0 ]; then
+	echo "usage: $0 [-j<n>] [biggie options] <files...>"
+	exit 2
+fi
+
+TMPDIR=`mktemp -d` || exit 2
+trap 'rm -rf "$TMPDIR"' EXIT
+
+$BIGGIE -f $OPTIONS -m0 -j1 "$TMPDIR/j1.big" "$@" > "$TMPDIR/j1.log" || exit 2
+$BIGGIE -f $OPTIONS -m0 -j$THREADS "$TMPDIR/jn.big" "$@" > "$TMPDIR/jn.log" || exit 2
+
+if [ ! -f "$TMPDIR/j1.big" ] || [ ! -f "$TMPDIR/jn.big" ]; then
+	echo "biggie didn't create a bigfile:"
+	cat "$TMPDIR/j1.log"
+	exit 2
+fi
+
+if cmp "$TMPDIR/j1.big" "$TMPDIR/jn.big"; then
+	echo "-j1 and -j$THREADS bigfiles are identical (`wc -c < "$TMPDIR/j1.big"` bytes)"
+else
+	echo "-j1 and -j$THREADS bigfiles differ"
+	exit 1
+fi
@@ -18,6 +18,7 @@ extern int  OptPathnames;
 extern int  OptNewer;
 extern int  OptOverwrite;
 extern int  OptMove;
+extern int  OptThreads;
 
 void display_version(void) {
     printf("Biggie - version %s  [%s%s]\n", BIGGIE_VERSION, BF_FILE_HEADER, BF_VERSION);
@@ -30,6 +31,7 @@ void usage(void) {
 
     printf("Primary options:\n");
     printf("-a  Add/update files to bigfile\n");
+    printf("-b  Benchmark LZSS against LZB decoding\n");
     printf("-f  Fast-create a bigfile\n");
     printf("-d  Delete files from bigfile\n");
     printf("-u  Create a patch bigfile (see special usage, below)\n");
@@ -38,11 +40,12 @@ void usage(void) {
 
     printf("\nAdditional options, as they apply to the primary options:\n");
     printf("         AFDUVX\n");
-    printf("-c[0|1]  **      Compress files               (default: 1)\n");
+    printf("-c[0|1|2]**      Compress files, 2 = LZB      (default: 1)\n");
     printf("-m[0|1]  **   *  Move files to/from bigfile   (default: 0)\n");
     printf("-n[0|1]  *    *  Only newer files             (default: 0)\n");
     printf("-o[0|1]       *  Overwrite existing files     (default: 1)\n");
     printf("-p[0|1]  **   *  Store/restore full pathnames (default: 1)\n");
+    printf("-j<n>     *      Compress n files at once     (default: 1)\n");
 
     printf("\n----------------------------------------------------------\n\n");
 
@@ -103,13 +106,17 @@ int main(int argc, char *argv[]) {
                 OptCompression, OptNewer, OptMove, OptPathnames, 1);
             break;
             
+        case 'B':
+            bigBenchmark(bigfilename, 1);
+            break;
+
         case 'D':
             bigDelete(bigfilename, numFiles, filenames, 1);
             break;
                         
         case 'F':
             bigFastCreate(bigfilename, numFiles, filenames, 
-                OptCompression, OptNewer, OptMove, OptPathnames, 1);
+                OptCompression, OptNewer, OptMove, OptPathnames, OptThreads, 1);
             break;
             
         case 'U':
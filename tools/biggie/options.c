@@ -1,13 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "options.h"
 
-char OptCommand;	    // a|d|v|x (add|delete|view|extract)
+char OptCommand;	    // a|b|d|v|x (add|benchmark|delete|view|extract)
 
-int  OptCompression;	// true/false
+int  OptCompression;	// 0/1/2 (none/lzss/lzb)
 int  OptPathnames;      // true/false
 int  OptNewer;	        // true/false
 int  OptMove;           // true/false
 int  OptOverwrite;		// true/false
+int  OptThreads;        // 1+ (files read & compressed at once by -f)
 
 void optDefaultsSet(void) {
 	OptCommand     = 'a';
@@ -16,6 +18,7 @@ void optDefaultsSet(void) {
 	OptNewer       = 0;
 	OptOverwrite   = 1;
 	OptPathnames   = 1;
+	OptThreads     = 1;
 }
 
 //	override OptXXXX variables with user argument
@@ -30,6 +33,7 @@ int optProcessArgument(char *arg)
 
 	switch (arg[1])	{
         case 'a':
+        case 'b':
         case 'd':
         case 'v':
         case 'x':
@@ -39,7 +43,7 @@ int optProcessArgument(char *arg)
             break;
             
         case 'c':
-            optSetBoolean(arg, &OptCompression);
+            optSetLevel(arg, &OptCompression, 2);
             break;
             
         case 'm':
@@ -58,6 +62,10 @@ int optProcessArgument(char *arg)
             optSetBoolean(arg, &OptPathnames);
             break;
             
+        case 'j':
+            optSetCount(arg, &OptThreads);
+            break;
+            
         default:
             printf("WARNING: Undefined option \"%s\"\n", arg);
             break;
@@ -67,11 +75,28 @@ int optProcessArgument(char *arg)
 }
 
 void optSetBoolean(char *arg, int *option) {
-    // arg = "-"<char><0|1>
+    optSetLevel(arg, option, 1);
+}
+
+void optSetCount(char *arg, int *option) {
+    // arg = "-"<char><1 or more>
+    int value = atoi(arg + 2);
+
+    if (value >= 1) {
+        *option = value;
+    }
+    else {
+        printf("WARNING: Invalid option setting \"%s\"; using \"-%c1\"\n", arg, arg[1]);
+        *option = 1;
+    }
+}
+
+void optSetLevel(char *arg, int *option, int maxLevel) {
+    // arg = "-"<char><0..maxLevel>
     char flag  = arg[1];
     char value = arg[2];
 
-    if (value == '0' || value == '1') {
+    if (value >= '0' && value <= '0' + maxLevel) {
         *option = (int)(value - '0');
     }
     else {
@@ -4,6 +4,8 @@
 void optDefaultsSet(void);
 int  optProcessArgument(char *arg);
 void optSetBoolean(char *arg, int *option);
+void optSetLevel(char *arg, int *option, int maxLevel);
+void optSetCount(char *arg, int *option);
 
 #endif
 